@@ -19,7 +19,9 @@ page_fault_handler_asm:
     mov ds, ax
     mov es, ax
 
+    push dword [esp + 48]  ; Error code pushed by the CPU (above 8 GPRs and 4 segment registers)
     call page_fault_handler ; Call the C handler
+    add esp, 4
 
     pop gs                 ; Restore segment registers
     pop fs
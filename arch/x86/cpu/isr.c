@@ -3,6 +3,7 @@
 #include "include/kernel/panic.h"
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"
+#include "mm/mmap.h"
 
 // methods defined in the assembly file
 extern void isr0();
@@ -215,15 +216,16 @@ void divide_by_zero_handler(Registers* r) {
     }
 }
 
-void page_fault_handler() {
+void page_fault_handler(uint32_t error_code) {
     uint32_t faulting_address;
-    uint32_t error_code;
     
     // Read the faulting address from CR2
     asm volatile("mov %%cr2, %0" : "=r"(faulting_address));
     
-    // Get error code from stack (pushed by CPU)
-    asm volatile("mov 4(%%ebp), %0" : "=r"(error_code));
+    // Demand-paged file mappings: map the page and retry the access
+    if (mmap_handle_fault(faulting_address, error_code)) {
+        return;
+    }
     
     // Check privilege level
     // Note: Page fault handler gets called from assembly, CS should be on stack
@@ -62,6 +62,47 @@ void free_page(void* page) {
     mark_page_free(page_index);
 }
 
+// Allocate 'count' physically contiguous 4 KB pages
+void* allocate_pages(size_t count) {
+    if (count == 0) {
+        return NULL;
+    }
+
+    size_t total_pages = MEMORY_POOL_SIZE / PAGE_SIZE;
+    size_t run = 0;
+
+    for (size_t i = 0; i < total_pages; i++) {
+        // Skip fully used bitmap words in one step
+        if ((i % 32) == 0 && free_page_bitmap[i / 32] == 0xFFFFFFFF) {
+            run = 0;
+            i += 31;
+            continue;
+        }
+
+        if (free_page_bitmap[i / 32] & (1 << (i % 32))) {
+            run = 0;
+            continue;
+        }
+
+        if (++run == count) {
+            size_t first = i + 1 - count;
+            for (size_t j = first; j <= i; j++) {
+                mark_page_used(j);
+            }
+            return (void*)&memory_pool[first * PAGE_SIZE];
+        }
+    }
+
+    return NULL; // No run of the requested length available
+}
+
+// Free 'count' contiguous pages previously returned by allocate_pages
+void free_pages(void* pages, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free_page((uint8_t*)pages + i * PAGE_SIZE);
+    }
+}
+
 
 // Helper: Load CR3 (Page Directory Base Register)
 static inline void load_cr3(uint32_t address) {
@@ -85,6 +126,11 @@ static inline void flush_tlb() {
     asm volatile("mov %%cr3, %%eax; mov %%eax, %%cr3" ::: "eax");
 }
 
+// Helper: Flush a single TLB entry
+static inline void flush_tlb_entry(uint32_t address) {
+    asm volatile("invlpg (%0)" : : "r"(address) : "memory");
+}
+
 page_directory_t* create_page_directory() {
     page_directory_t* pd = allocate_page(); // Allocate one page for the directory
     if (!pd) {
@@ -129,6 +175,42 @@ void init_paging() {
     printf("Paging enabled successfully.\n");
 }
 
+// Identity map the whole 4 GB address space with 4 MB pages, leaving the
+// directory entries covering [hole_start, hole_end) empty so they can be
+// populated page by page (demand paging). Ring 0 writes to read-only pages fault.
+void init_paging_identity(uint32_t hole_start, uint32_t hole_end) {
+    if (paging_is_enabled()) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < PAGE_DIRECTORY_ENTRIES; i++) {
+        uint32_t base = i << 22;
+        if (base >= hole_start && base < hole_end) {
+            page_directory[i] = 0;
+        } else {
+            page_directory[i] = base | PAGE_PRESENT | PAGE_RW | PAGE_LARGE;
+        }
+    }
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_PSE;
+    asm volatile("mov %0, %%cr4" : : "r"(cr4));
+
+    load_cr3((uint32_t)page_directory);
+    write_cr0(read_cr0() | CR0_PG | CR0_WP);
+
+    printf("Paging enabled (identity mapped, hole 0x%08X-0x%08X).\n", hole_start, hole_end);
+}
+
+int paging_is_enabled() {
+    return (read_cr0() & CR0_PG) != 0;
+}
+
+page_directory_t* get_kernel_page_directory() {
+    return (page_directory_t*)page_directory;
+}
+
 // Test paging by accessing memory
 void test_paging() {
     volatile uint32_t* test_address = (uint32_t*)0x1000; // Identity-mapped address
@@ -166,7 +248,7 @@ void map_page(page_directory_t* pd, uint32_t virtual_address, uint32_t physical_
         memset(pt, 0, sizeof(page_table_t));
         pd->entries[dir_index].table = ((uint32_t)pt) >> 12;
         pd->entries[dir_index].present = 1;
-        pd->entries[dir_index].rw = (flags & 0x2) >> 1;
+        pd->entries[dir_index].rw = 1; // Access rights are enforced per page
         pd->entries[dir_index].user = (flags & 0x4) >> 2;
     } else {
         pt = (page_table_t*)((pd->entries[dir_index].table) << 12);
@@ -181,3 +263,33 @@ void map_page(page_directory_t* pd, uint32_t virtual_address, uint32_t physical_
     flush_tlb(); // Flush TLB after modifying page tables
 }
 
+void unmap_page(page_directory_t* pd, uint32_t virtual_address) {
+    uint32_t dir_index = (virtual_address >> 22) & 0x3FF;
+    uint32_t table_index = (virtual_address >> 12) & 0x3FF;
+
+    uint32_t pde = *(uint32_t*)&pd->entries[dir_index];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) {
+        return;
+    }
+
+    page_table_t* pt = (page_table_t*)(pde & ~0xFFF);
+    *(uint32_t*)&pt->entries[table_index] = 0;
+    flush_tlb_entry(virtual_address);
+}
+
+// Physical address backing a 4 KB mapping, 0 if the page is not mapped
+uint32_t get_mapped_address(page_directory_t* pd, uint32_t virtual_address) {
+    uint32_t dir_index = (virtual_address >> 22) & 0x3FF;
+    uint32_t table_index = (virtual_address >> 12) & 0x3FF;
+
+    uint32_t pde = *(uint32_t*)&pd->entries[dir_index];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) {
+        return 0;
+    }
+
+    page_table_t* pt = (page_table_t*)(pde & ~0xFFF);
+    if (!pt->entries[table_index].present) {
+        return 0;
+    }
+    return pt->entries[table_index].frame << 12;
+}
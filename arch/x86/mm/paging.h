@@ -4,6 +4,8 @@
 // Control Register flags
 #define CR0_PG 0x80000000 // Paging enable
 #define CR0_PE 0x00000001 // Protected mode enable
+#define CR0_WP 0x00010000 // Honour read-only pages in ring 0
+#define CR4_PSE 0x00000010 // 4 MB page support
 
 #define PAGE_SIZE 4096                      // 4 KB pages
 #define PAGE_TABLE_ENTRIES 1024             // 1024 entries per page table
@@ -20,8 +22,10 @@
 #define PAGE_PRESENT 0x1
 #define PAGE_RW 0x2
 #define PAGE_USER 0x4
+#define PAGE_LARGE 0x80                     // Page directory entry maps a 4 MB page
 
 #include <stdint.h>
+#include <stddef.h>
 
 
 typedef struct page_table_entry {
@@ -56,10 +60,22 @@ typedef struct page_directory {
 
 
 void init_paging();
+void init_paging_identity(uint32_t hole_start, uint32_t hole_end);
+int paging_is_enabled();
 void test_paging();
-void page_fault_handler();
+void page_fault_handler(uint32_t error_code);
+page_directory_t* get_kernel_page_directory();
 page_directory_t* create_page_directory();
 void free_page_directory(page_directory_t* pd);
 
+// Page frame allocator (4 KB pages from the paging memory pool)
+void* allocate_page();
+void free_page(void* page);
+void* allocate_pages(size_t count);
+void free_pages(void* pages, size_t count);
+void map_page(page_directory_t* pd, uint32_t virtual_address, uint32_t physical_address, uint32_t flags);
+void unmap_page(page_directory_t* pd, uint32_t virtual_address);
+uint32_t get_mapped_address(page_directory_t* pd, uint32_t virtual_address);
+
 
 #endif // PAGING_H
\ No newline at end of file
@@ -234,7 +234,32 @@ static void ata_soft_reset(unsigned short base, bool is_master) {
     * @return True if the sector was read successfully, false otherwise.
 */
 bool ata_read_sector(unsigned short base, unsigned int lba, void* buffer, bool is_master) {
-    //printf("ata_read_sector: base=0x%X, lba=%u, is_master=%d\n", base, lba, is_master);
+    return ata_read_sectors(base, lba, 1, buffer, is_master);
+}
+
+/*
+    * Reads consecutive sectors from the ATA drive, up to ATA_MAX_SECTORS_PER_CMD
+    * per READ SECTORS command.
+    * 
+    * @param lba The Logical Block Addressing of the first sector to read.
+    * @param count The number of sectors to read.
+    * @param buffer The buffer to read the sectors into (count * SECTOR_SIZE bytes).
+    * @return True if all sectors were read successfully, false otherwise.
+*/
+bool ata_read_sectors(unsigned short base, unsigned int lba, unsigned int count, void* buffer, bool is_master) {
+    while (count > ATA_MAX_SECTORS_PER_CMD) {
+        if (!ata_read_sectors(base, lba, ATA_MAX_SECTORS_PER_CMD, buffer, is_master)) {
+            return false;
+        }
+        lba += ATA_MAX_SECTORS_PER_CMD;
+        count -= ATA_MAX_SECTORS_PER_CMD;
+        buffer = (uint8_t*)buffer + ATA_MAX_SECTORS_PER_CMD * SECTOR_SIZE;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    //printf("ata_read_sectors: base=0x%X, lba=%u, count=%u, is_master=%d\n", base, lba, count, is_master);
     
     // On first read attempt, try a soft reset if drive isn't responding
     static bool first_read_attempted[2] = {false, false};  // Track per controller
@@ -291,7 +316,7 @@ bool ata_read_sector(unsigned short base, unsigned int lba, void* buffer, bool i
     
     // Set up sector count and LBA registers
     //printf("  Step 2: Setting up LBA registers...\n");
-    outb(ATA_SECTOR_CNT(base), 1); // Read 1 sector
+    outb(ATA_SECTOR_CNT(base), (unsigned char)count); // 0 means 256 sectors
     outb(ATA_LBA_LOW(base), (unsigned char)(lba & 0xFF));
     outb(ATA_LBA_MID(base), (unsigned char)((lba >> 8) & 0xFF));
     outb(ATA_LBA_HIGH(base), (unsigned char)((lba >> 16) & 0xFF));
@@ -308,23 +333,32 @@ bool ata_read_sector(unsigned short base, unsigned int lba, void* buffer, bool i
     }
     //printf("  Step 3: Command sent OK\n");
 
-    // Wait for the drive to be ready to transfer data
-    //printf("  Step 4: Waiting for data ready...\n");
-    if (!wait_for_drive_data_ready(base, ATA_WAIT_TIMEOUT_MS)) {
-        //printf("  ERROR: Data not ready (timeout)\n");
-        consecutive_read_failures++;
-        //printf("  Consecutive failures: %u/%u\n", consecutive_read_failures, MAX_CONSECUTIVE_FAILURES);
+    for (unsigned int sector = 0; sector < count; sector++) {
+        if (sector > 0) {
+            // 400ns for BSY to assert before polling for the next sector
+            for (volatile int i = 0; i < 4; i++) {
+                inb(ATA_ALT_STATUS(base));
+            }
+        }
 
-        // Add delay before returning to prevent rapid retry loops
-        pit_delay(100);  // 100ms delay on failure
-        return false;  // Drive data not ready within the timeout
-    }
-    //printf("  Step 4: Data ready OK\n");
+        // Wait for the drive to be ready to transfer data
+        //printf("  Step 4: Waiting for data ready...\n");
+        if (!wait_for_drive_data_ready(base, ATA_WAIT_TIMEOUT_MS)) {
+            //printf("  ERROR: Data not ready (timeout)\n");
+            consecutive_read_failures++;
+            //printf("  Consecutive failures: %u/%u\n", consecutive_read_failures, MAX_CONSECUTIVE_FAILURES);
+
+            // Add delay before returning to prevent rapid retry loops
+            pit_delay(100);  // 100ms delay on failure
+            return false;  // Drive data not ready within the timeout
+        }
+        //printf("  Step 4: Data ready OK\n");
 
-    // Read the data
-    //printf("  Step 5: Reading data...\n");
-    insw(ATA_DATA(base), buffer, SECTOR_SIZE / 2);
-    //printf("  Step 5: Data read OK\n");
+        // Read the data
+        //printf("  Step 5: Reading data...\n");
+        insw(ATA_DATA(base), (uint8_t*)buffer + sector * SECTOR_SIZE, SECTOR_SIZE / 2);
+        //printf("  Step 5: Data read OK\n");
+    }
 
 #ifdef REAL_HARDWARE
     // Real hardware: Wait for command completion
@@ -337,7 +371,7 @@ bool ata_read_sector(unsigned short base, unsigned int lba, void* buffer, bool i
     // Success - reset failure counter
     consecutive_read_failures = 0;
 
-    //printf("ata_read_sector: SUCCESS\n");
+    //printf("ata_read_sectors: SUCCESS\n");
     return true;
 }
 
@@ -34,6 +34,7 @@
 
 #define MAX_DRIVES          4      // Max of 4 ATA drives (primary/master, primary/slave, secondary/master, secondary/slave)
 #define SECTOR_SIZE 512
+#define ATA_MAX_SECTORS_PER_CMD 256 // LBA28 sector count register (0 = 256)
 
 // External declarations
 extern short drive_count;
@@ -50,6 +51,7 @@ void list_detected_drives();
 void ata_reset_error_counter();  // Reset consecutive failure counter
 
 bool ata_read_sector(unsigned short base, unsigned int lba, void* buffer, bool is_master);
+bool ata_read_sectors(unsigned short base, unsigned int lba, unsigned int count, void* buffer, bool is_master);
 bool ata_write_sector(unsigned short base, unsigned int lba, void* buffer, bool is_master);
 
 
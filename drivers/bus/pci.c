@@ -2,6 +2,7 @@
 
 #include "drivers/char/io.h"
 #include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
 #include <stdint.h>
 
 #define PCI_CONFIG_ADDRESS 0xCF8
@@ -138,6 +139,12 @@ void pci_write_config_word(uint8_t bus, uint8_t slot, uint8_t function, uint8_t
     outl(0xCFC, current_value);
 }
 
+void pci_write_config_dword(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value) {
+    uint32_t address = (uint32_t)((bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC) | 0x80000000);
+    outl(PCI_CONFIG_ADDRESS, address);
+    outl(PCI_CONFIG_DATA, value);
+}
+
 // Function to read a 32-bit value from the PCI configuration space
 uint32_t pci_read_config_dword(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
     uint32_t address = (uint32_t)((bus << 16) | (slot << 11) | (function << 8) | (offset & 0xFC) | 0x80000000);
@@ -157,6 +164,39 @@ uint8_t pci_read_config_byte(uint8_t bus, uint8_t slot, uint8_t function, uint8_
     return (uint8_t)((value >> ((offset & 3) * 8)) & 0xFF);
 }
 
+// Size the memory BARs (write all ones, read back the mask, restore) while
+// decoding is off, so other users of the address space (the mmap window)
+// can keep clear of them. Runs at scan time, before drivers touch the device.
+static void pci_size_bars(pci_device_t *dev) {
+    uint8_t type = dev->header_type & 0x7F;
+    int count = type == 0 ? 6 : (type == 1 ? 2 : 0);   // Bridges have two BARs
+    uint16_t command = pci_read_config_word(dev->bus, dev->slot, dev->function, PCI_COMMAND);
+    pci_write_config_word(dev->bus, dev->slot, dev->function, PCI_COMMAND, command & ~0x3);
+
+    for (int i = 0; i < count; i++) {
+        uint32_t bar = dev->bar[i];
+        if (bar & 0x01) {
+            continue;                   // I/O space
+        }
+        uint8_t offset = (uint8_t)(0x10 + i * 4);
+        pci_write_config_dword(dev->bus, dev->slot, dev->function, offset, 0xFFFFFFFF);
+        uint32_t mask = pci_read_config_dword(dev->bus, dev->slot, dev->function, offset) & ~0xFu;
+        pci_write_config_dword(dev->bus, dev->slot, dev->function, offset, bar);
+
+        int index = i;
+        if (((bar >> 1) & 0x3) == 0x2) {
+            i++;                        // 64-bit BAR: the next one holds the upper half
+            if (i < count && dev->bar[i] != 0) {
+                continue;               // Above 4 GB
+            }
+        }
+        if (mask && (bar & ~0xFu)) {
+            dev->bar_size[index] = ~mask + 1;
+        }
+    }
+    pci_write_config_word(dev->bus, dev->slot, dev->function, PCI_COMMAND, command);
+}
+
 // Scan a specific function of a device
 void pci_scan_function(uint8_t bus, uint8_t slot, uint8_t function) {
     pci_device_t dev;
@@ -185,7 +225,9 @@ void pci_scan_function(uint8_t bus, uint8_t slot, uint8_t function) {
     // Read BARs
     for (int i = 0; i < 6; i++) {
         dev.bar[i] = pci_read_config_dword(bus, slot, function, 0x10 + i * 4);
+        dev.bar_size[i] = 0;
     }
+    pci_size_bars(&dev);
 
     // Save the device to the list
     if (pci_device_count < MAX_PCI_DEVICES) {
@@ -212,12 +254,106 @@ void pci_scan_bus(uint8_t bus) {
     }
 }
 
+// ---------------------------------------------------------------------------
+// PCI Express MMCONFIG (ECAM) ranges from the ACPI MCFG table. The stack
+// still uses port 0xCF8 for config space; the ranges are only recorded so
+// nothing else gets placed on top of them.
+// ---------------------------------------------------------------------------
+#define PCI_MAX_MMCFG 4
+
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) pci_acpi_header_t;
+
+typedef struct {
+    uint64_t base;
+    uint16_t segment;
+    uint8_t start_bus;
+    uint8_t end_bus;
+    uint32_t reserved;
+} __attribute__((packed)) pci_mcfg_entry_t;
+
+static struct {
+    uint32_t base;
+    uint32_t size;
+} pci_mmcfg[PCI_MAX_MMCFG];
+static int pci_mmcfg_count = 0;
+
+extern void* find_rsdp();   // kernel/time/hpet.c
+
+static void pci_find_mmcfg(void) {
+    pci_mmcfg_count = 0;
+    uint8_t* rsdp = (uint8_t*)find_rsdp();
+    if (!rsdp) {
+        return;
+    }
+    uint32_t rsdt_address;
+    memcpy(&rsdt_address, rsdp + 16, 4);       // RSDP: signature, checksum, OEM, revision, RSDT
+    pci_acpi_header_t* rsdt = (pci_acpi_header_t*)rsdt_address;
+    if (!rsdt || memcmp(rsdt->signature, "RSDT", 4) != 0) {
+        return;
+    }
+
+    uint32_t* entries = (uint32_t*)(rsdt + 1);
+    uint32_t entry_count = (rsdt->length - sizeof(pci_acpi_header_t)) / 4;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        pci_acpi_header_t* table = (pci_acpi_header_t*)entries[i];
+        if (memcmp(table->signature, "MCFG", 4) != 0) {
+            continue;
+        }
+        // Header, 8 reserved bytes, then one entry per segment/bus range
+        uint8_t* p = (uint8_t*)(table + 1) + 8;
+        uint8_t* end = (uint8_t*)table + table->length;
+        for (; p + sizeof(pci_mcfg_entry_t) <= end && pci_mmcfg_count < PCI_MAX_MMCFG;
+             p += sizeof(pci_mcfg_entry_t)) {
+            pci_mcfg_entry_t* e = (pci_mcfg_entry_t*)p;
+            if (e->base >= 0x100000000ULL || e->end_bus < e->start_bus) {
+                continue;
+            }
+            // 1 MB of config space per bus, counted from bus 0
+            pci_mmcfg[pci_mmcfg_count].base = (uint32_t)e->base + ((uint32_t)e->start_bus << 20);
+            pci_mmcfg[pci_mmcfg_count].size = (uint32_t)(e->end_bus - e->start_bus + 1) << 20;
+            pci_mmcfg_count++;
+        }
+        return;
+    }
+}
+
+static bool pci_range_overlaps(uint32_t base, uint32_t size, uint32_t start, uint32_t end) {
+    return size && base < end && (uint64_t)base + size > start;
+}
+
+bool pci_mmio_overlaps(uint32_t start, uint32_t end) {
+    for (size_t i = 0; i < pci_device_count; i++) {
+        for (int j = 0; j < 6; j++) {
+            if (pci_range_overlaps(pci_devices[i].bar[j] & ~0xFu, pci_devices[i].bar_size[j], start, end)) {
+                return true;
+            }
+        }
+    }
+    for (int i = 0; i < pci_mmcfg_count; i++) {
+        if (pci_range_overlaps(pci_mmcfg[i].base, pci_mmcfg[i].size, start, end)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // PCI initialization function
 void pci_init() {
     pci_device_count = 0; // Reset device count
 
     // Scan all buses (assuming a single bus for simplicity)
     pci_scan_bus(0);
+    pci_find_mmcfg();
 
     // Print the detected devices
     // for (size_t i = 0; i < pci_device_count; i++) {
@@ -2,6 +2,7 @@
 #define PCI_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 
 // PCI-Konstanten
@@ -21,6 +22,7 @@ typedef struct {
     uint8_t slot;               // PCI slot number
     uint8_t function;           // PCI function number
     uint32_t bar[6];            // Base Address Registers (BARs), up to 6
+    uint32_t bar_size[6];       // Bytes decoded by each memory BAR below 4 GB (0 = I/O or unused)
     uint8_t irq_line;           // Interrupt line (IRQ number)
     uint8_t irq_pin;            // Interrupt pin (optional, A-D)
     uint8_t header_type;        // Header type of the PCI device
@@ -55,6 +57,7 @@ void pci_write_config_word(uint8_t bus, uint8_t slot, uint8_t function, uint8_t
 uint8_t pci_read_config_byte(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
 uint16_t pci_read_config_word(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
 uint32_t pci_read_config_dword(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+void pci_write_config_dword(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value);
 
 void pci_enable_device(pci_device_t *dev);
 uint32_t pci_read_bar(pci_device_t *dev, uint8_t bar_index);
@@ -63,6 +66,8 @@ uint8_t pci_configure_irq(pci_device_t *dev);
 void pci_register_driver(uint16_t vendor_id, uint16_t device_id, int (*probe)(pci_device_t *));
 void pci_probe_drivers();
 int pci_device_exists(uint16_t vendor_id, uint16_t device_id);
+// True if [start, end) overlaps a memory BAR or a PCI Express MMCONFIG range
+bool pci_mmio_overlaps(uint32_t start, uint32_t end);
 
 
 #endif // PCI_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdint.h>
+
+// =============================================================================
+// INTERNET CHECKSUM (RFC 1071)
+// The one's complement sum does not depend on byte order, so the data is
+// summed as native little-endian words and the folded result comes out in
+// network byte order, ready to be stored into a header as it is. Freestanding
+// so scripts/csum_bench.c can build it on the host.
+// =============================================================================
+
+// Add 'len' bytes at 'data' to the running 32-bit sum 'sum'. The data may
+// start at any address; an odd trailing byte counts as a word padded with zero.
+uint32_t csum_partial(const void *data, uint32_t len, uint32_t sum);
+
+static inline uint32_t csum_add(uint32_t a, uint32_t b) {
+    a += b;
+    return a + (a < b);             // End-around carry
+}
+
+// Fold to 16 bits and complement (network byte order)
+static inline uint16_t csum_fold(uint32_t sum) {
+    sum = (sum & 0xFFFFu) + (sum >> 16);
+    sum = (sum & 0xFFFFu) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static inline uint16_t csum_bswap16(uint16_t v) {
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static inline uint32_t csum_bswap32(uint32_t v) {
+    return (v << 24) | ((v & 0xFF00u) << 8) | ((v >> 8) & 0xFF00u) | (v >> 24);
+}
+
+// TCP/UDP pseudo header sum; addresses and length in host byte order
+static inline uint32_t csum_pseudo(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, uint16_t length) {
+    uint32_t sum = csum_add(csum_bswap32(src_ip), csum_bswap32(dst_ip));
+    return csum_add(sum, (uint32_t)csum_bswap16(protocol) + csum_bswap16(length));
+}
+
+// RFC 1624 incremental update, eqn. 3: HC' = ~(~HC + ~m + m'). 'check',
+// 'old' and 'new' are the 16/32-bit fields exactly as stored in the packet.
+static inline uint16_t csum_replace2(uint16_t check, uint16_t old, uint16_t new_value) {
+    uint32_t sum = (uint16_t)~check;
+    sum += (uint16_t)~old;
+    sum += new_value;
+    return csum_fold(sum);
+}
+
+static inline uint16_t csum_replace4(uint16_t check, uint32_t old, uint32_t new_value) {
+    uint32_t sum = (uint16_t)~check;
+    sum = csum_add(sum, ~old);
+    sum = csum_add(sum, new_value);
+    return csum_fold(sum);
+}
+
+#endif // CHECKSUM_H
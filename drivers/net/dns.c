@@ -0,0 +1,378 @@
+// drivers/net/dns.c
+// DNS stub resolver: one UDP socket with a receive callback, and a cache
+// whose entries double as the records of queries in flight. A lookup
+// that finds its name pending waits on that entry, so concurrent lookups
+// of one name share a single query. Blocking lookups spin on
+// netstack_poll() like every other blocking network call.
+
+#include "drivers/net/dns.h"
+#include "drivers/net/netstack.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define DNS_HEADER_LEN   12
+#define DNS_MSG_MAX      512         // UDP message limit without EDNS (RFC 1035 4.2.1)
+
+#define DNS_FLAG_QR      0x8000
+#define DNS_FLAG_RD      0x0100
+#define DNS_RCODE(f)     ((f) & 0x000F)
+#define DNS_RCODE_NXDOMAIN 3
+
+#define DNS_TYPE_A       1
+#define DNS_TYPE_SOA     6
+#define DNS_CLASS_IN     1
+
+static dns_entry_t dns_cache[DNS_CACHE_SIZE];
+static dns_stats_t dns_stats;
+static int dns_socket = -1;
+static uint16_t dns_next_id;
+
+static inline uint16_t dns_get16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t dns_get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline bool dns_expired(const dns_entry_t *e, uint32_t now) {
+    return (int32_t)(e->expires - now) <= 0;
+}
+
+// Lower-cases 'name' into 'out' and checks the label syntax; a trailing
+// dot is dropped
+static bool dns_normalize(const char *name, char *out) {
+    size_t len = strlen(name);
+    if (len && name[len - 1] == '.') len--;
+    if (len == 0 || len > DNS_NAME_MAX) return false;
+
+    size_t label = 0;
+    for (size_t i = 0; i < len; ++i) {
+        char c = name[i];
+        if (c == '.') {
+            if (label == 0) return false;
+            label = 0;
+        } else if (isalnum((unsigned char)c) || c == '-' || c == '_') {
+            if (++label > 63) return false;
+        } else {
+            return false;
+        }
+        out[i] = (char)tolower((unsigned char)c);
+    }
+    out[len] = '\0';
+    return label != 0;
+}
+
+// =============================================================================
+// Cache
+// =============================================================================
+static dns_entry_t *dns_find(const char *name) {
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        dns_entry_t *e = &dns_cache[i];
+        if (e->state != DNS_ENTRY_FREE && strcmp(e->name, name) == 0) return e;
+    }
+    return NULL;
+}
+
+// A free slot, else an expired one, else the least recently used answer.
+// Entries with a query in flight are never taken.
+static dns_entry_t *dns_alloc(const char *name) {
+    uint32_t now = pit_get_ticks();
+    dns_entry_t *victim = NULL;
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        dns_entry_t *e = &dns_cache[i];
+        if (e->state == DNS_ENTRY_FREE) { victim = e; break; }
+        if (e->state == DNS_ENTRY_PENDING) continue;
+        if (dns_expired(e, now)) { victim = e; break; }
+        if (!victim || (int32_t)(e->last_used - victim->last_used) < 0) victim = e;
+    }
+    if (!victim) return NULL;
+    memset(victim, 0, sizeof(*victim));
+    strcpy(victim->name, name);
+    return victim;
+}
+
+// Records the outcome of a query; ttl 0 answers the waiting lookups but
+// is not kept for later ones
+static void dns_complete(dns_entry_t *e, int result, uint32_t ip, uint32_t ttl) {
+    e->state   = result == DNS_OK ? DNS_ENTRY_VALID : DNS_ENTRY_NEGATIVE;
+    e->result  = result;
+    e->ip      = ip;
+    e->expires = pit_get_ticks() + ttl * 1000;
+}
+
+// =============================================================================
+// Messages
+// =============================================================================
+
+// Offset past the (possibly compressed) name at 'off', -1 if malformed
+static int dns_skip_name(const uint8_t *msg, uint16_t len, int off) {
+    while (off < len) {
+        uint8_t n = msg[off];
+        if (n == 0) return off + 1;
+        if ((n & 0xC0) == 0xC0) return off + 2 <= len ? off + 2 : -1;
+        if (n & 0xC0) return -1;
+        off += 1 + n;
+    }
+    return -1;
+}
+
+// Compares the name at 'off' with a normalized name, following
+// compression pointers
+static bool dns_name_equals(const uint8_t *msg, uint16_t len, int off, const char *name) {
+    size_t pos = 0;
+    for (int jumps = 0; off < len && jumps < 16;) {
+        uint8_t n = msg[off];
+        if ((n & 0xC0) == 0xC0) {
+            if (off + 1 >= len) return false;
+            off = ((n & 0x3F) << 8) | msg[off + 1];
+            jumps++;
+            continue;
+        }
+        if (n & 0xC0) return false;
+        if (n == 0) return name[pos] == '\0';
+        if (off + 1 + n > len) return false;
+        if (pos) {
+            if (name[pos] != '.') return false;
+            pos++;
+        }
+        for (uint8_t i = 0; i < n; ++i, ++pos) {
+            if (name[pos] == '\0' || tolower(msg[off + 1 + i]) != name[pos]) return false;
+        }
+        off += 1 + n;
+    }
+    return false;
+}
+
+static bool dns_send_query(dns_entry_t *e) {
+    uint8_t msg[DNS_HEADER_LEN + DNS_NAME_MAX + 2 + 4];
+    memset(msg, 0, DNS_HEADER_LEN);
+    msg[0] = (uint8_t)(e->id >> 8);
+    msg[1] = (uint8_t)e->id;
+    msg[2] = (uint8_t)(DNS_FLAG_RD >> 8);
+    msg[5] = 1;                                  // QDCOUNT
+
+    // QNAME as length-prefixed labels
+    int off = DNS_HEADER_LEN;
+    const char *label = e->name;
+    for (;;) {
+        const char *dot = strchr(label, '.');
+        size_t n = dot ? (size_t)(dot - label) : strlen(label);
+        msg[off++] = (uint8_t)n;
+        memcpy(&msg[off], label, (uint16_t)n);
+        off += (int)n;
+        if (!dot) break;
+        label = dot + 1;
+    }
+    msg[off++] = 0;
+    msg[off++] = 0; msg[off++] = DNS_TYPE_A;
+    msg[off++] = 0; msg[off++] = DNS_CLASS_IN;
+
+    e->tries++;
+    e->retry_at = pit_get_ticks() + DNS_TIMEOUT;
+    dns_stats.queries++;
+    return udp_sendto(dns_socket, netstack_get_dns_server(), DNS_PORT, msg, (uint16_t)off) >= 0;
+}
+
+// Receive callback of the resolver socket, runs from the RX path
+static void dns_input(uint32_t src_ip, uint16_t src_port, uint8_t *msg, uint16_t len) {
+    if (src_port != DNS_PORT || src_ip != netstack_get_dns_server() || len < DNS_HEADER_LEN) {
+        dns_stats.bad_responses++;
+        return;
+    }
+    uint16_t id = dns_get16(msg);
+    uint16_t flags = dns_get16(msg + 2);
+    uint16_t qdcount = dns_get16(msg + 4);
+    uint16_t ancount = dns_get16(msg + 6);
+    uint16_t nscount = dns_get16(msg + 8);
+
+    dns_entry_t *e = NULL;
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        if (dns_cache[i].state == DNS_ENTRY_PENDING && dns_cache[i].id == id) {
+            e = &dns_cache[i];
+            break;
+        }
+    }
+    // The question must echo ours, which also rules out stale replies
+    if (!e || !(flags & DNS_FLAG_QR) || qdcount != 1 ||
+        !dns_name_equals(msg, len, DNS_HEADER_LEN, e->name)) {
+        dns_stats.bad_responses++;
+        return;
+    }
+    dns_stats.responses++;
+
+    int off = dns_skip_name(msg, len, DNS_HEADER_LEN);
+    if (off < 0 || off + 4 > len) goto malformed;
+    off += 4;
+
+    uint8_t rcode = DNS_RCODE(flags);
+    if (rcode != 0 && rcode != DNS_RCODE_NXDOMAIN) {
+        dns_complete(e, DNS_ERR_SERVER, 0, 0);
+        return;
+    }
+
+    // Answers: the first A record, kept for the smallest TTL of the chain
+    // (CNAMEs included)
+    uint32_t ip = 0;
+    uint32_t ttl = DNS_TTL_MAX;
+    for (uint16_t i = 0; i < ancount; ++i) {
+        off = dns_skip_name(msg, len, off);
+        if (off < 0 || off + 10 > len) goto malformed;
+        uint16_t type = dns_get16(msg + off);
+        uint16_t cls = dns_get16(msg + off + 2);
+        uint32_t rr_ttl = dns_get32(msg + off + 4);
+        uint16_t rdlen = dns_get16(msg + off + 8);
+        off += 10;
+        if (off + rdlen > len) goto malformed;
+        if (rr_ttl < ttl) ttl = rr_ttl;
+        if (!ip && type == DNS_TYPE_A && cls == DNS_CLASS_IN && rdlen == 4) ip = dns_get32(msg + off);
+        off += rdlen;
+    }
+    if (rcode == 0 && ip) {
+        dns_complete(e, DNS_OK, ip, ttl);
+        return;
+    }
+
+    // Negative answer: cached for min(SOA TTL, SOA MINIMUM) (RFC 2308 5)
+    uint32_t neg_ttl = DNS_NEG_TTL_DEFAULT;
+    for (uint16_t i = 0; i < nscount; ++i) {
+        off = dns_skip_name(msg, len, off);
+        if (off < 0 || off + 10 > len) break;
+        uint16_t type = dns_get16(msg + off);
+        uint32_t rr_ttl = dns_get32(msg + off + 4);
+        uint16_t rdlen = dns_get16(msg + off + 8);
+        off += 10;
+        if (off + rdlen > len) break;
+        if (type == DNS_TYPE_SOA && rdlen >= 22) {
+            uint32_t minimum = dns_get32(msg + off + rdlen - 4);
+            neg_ttl = rr_ttl < minimum ? rr_ttl : minimum;
+            break;
+        }
+        off += rdlen;
+    }
+    if (neg_ttl > DNS_NEG_TTL_MAX) neg_ttl = DNS_NEG_TTL_MAX;
+    dns_complete(e, rcode == DNS_RCODE_NXDOMAIN ? DNS_ERR_NXDOMAIN : DNS_ERR_NODATA, 0, neg_ttl);
+    return;
+
+malformed:
+    dns_stats.bad_responses++;
+    dns_complete(e, DNS_ERR_SERVER, 0, 0);
+}
+
+static bool dns_open(void) {
+    if (dns_socket >= 0) return true;
+    dns_socket = udp_open(0);
+    if (dns_socket < 0) return false;
+    udp_bind(udp_local_port(dns_socket), dns_input);
+    return true;
+}
+
+// =============================================================================
+// API
+// =============================================================================
+void dns_init(void) {
+    // udp_init has already dropped the old socket
+    dns_socket = -1;
+    memset(dns_cache, 0, sizeof(dns_cache));
+    memset(&dns_stats, 0, sizeof(dns_stats));
+    dns_next_id = (uint16_t)(pit_get_ticks() * 2654435761u >> 16);
+}
+
+int dns_resolve(const char *name, uint32_t *ip) {
+    if (!name || !ip) return DNS_ERR_NAME;
+    dns_stats.lookups++;
+
+    uint32_t literal = parse_ipv4(name);
+    if (literal) {
+        *ip = literal;
+        return DNS_OK;
+    }
+
+    char key[DNS_NAME_MAX + 1];
+    if (!dns_normalize(name, key)) return DNS_ERR_NAME;
+
+    dns_entry_t *e = dns_find(key);
+    if (e && e->state == DNS_ENTRY_PENDING) {
+        dns_stats.coalesced++;
+    } else if (e && !dns_expired(e, pit_get_ticks())) {
+        e->last_used = pit_get_ticks();
+        if (e->state == DNS_ENTRY_VALID) {
+            dns_stats.hits++;
+            *ip = e->ip;
+        } else {
+            dns_stats.negative_hits++;
+        }
+        return e->result;
+    } else {
+        // Unconfigured default interface: try DHCP once for the server
+        if (netstack_get_dns_server() == 0) netstack_get_ip_address();
+        if (netstack_get_dns_server() == 0) return DNS_ERR_NO_SERVER;
+        if (!dns_open()) return DNS_ERR_BUSY;
+        if (!e) e = dns_alloc(key);
+        if (!e) return DNS_ERR_BUSY;
+        e->state = DNS_ENTRY_PENDING;
+        e->tries = 0;
+        e->id = dns_next_id;
+        dns_next_id += 0x9E37;                   // Odd step: visits every ID
+        dns_send_query(e);
+    }
+
+    // The entry stays pending (and in place) until the reply or the last timeout
+    while (e->state == DNS_ENTRY_PENDING) {
+        int frames = netstack_poll();
+        if (e->state != DNS_ENTRY_PENDING) break;
+        if ((int32_t)(pit_get_ticks() - e->retry_at) >= 0) {
+            if (e->tries >= DNS_RETRIES) {
+                dns_stats.timeouts++;
+                dns_complete(e, DNS_ERR_TIMEOUT, 0, 0);
+                break;
+            }
+            dns_stats.retransmits++;
+            dns_send_query(e);
+        }
+        if (frames == 0) __asm__ __volatile__("hlt");
+    }
+
+    e->last_used = pit_get_ticks();
+    if (e->result == DNS_OK) *ip = e->ip;
+    return e->result;
+}
+
+uint32_t dns_lookup(const char *name) {
+    uint32_t ip = 0;
+    return dns_resolve(name, &ip) == DNS_OK ? ip : 0;
+}
+
+const char* dns_strerror(int result) {
+    switch (result) {
+        case DNS_OK:            return "ok";
+        case DNS_ERR_NAME:      return "invalid host name";
+        case DNS_ERR_NXDOMAIN:  return "no such host";
+        case DNS_ERR_NODATA:    return "no address for host";
+        case DNS_ERR_TIMEOUT:   return "DNS server not responding";
+        case DNS_ERR_SERVER:    return "DNS server failure";
+        case DNS_ERR_NO_SERVER: return "no DNS server configured";
+        case DNS_ERR_BUSY:      return "resolver busy";
+        default:                return "unknown error";
+    }
+}
+
+void dns_flush(void) {
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        if (dns_cache[i].state != DNS_ENTRY_PENDING) memset(&dns_cache[i], 0, sizeof(dns_cache[i]));
+    }
+}
+
+const dns_entry_t* dns_get_entry(int index) {
+    if (index < 0 || index >= DNS_CACHE_SIZE || dns_cache[index].state == DNS_ENTRY_FREE) return NULL;
+    return &dns_cache[index];
+}
+
+void dns_get_stats(dns_stats_t *stats) {
+    if (stats) *stats = dns_stats;
+}
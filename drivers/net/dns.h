@@ -0,0 +1,80 @@
+#ifndef DNS_H
+#define DNS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// =============================================================================
+// DNS stub resolver (RFC 1035) for A records. Queries go to the server
+// learnt from DHCP (or set with netstack_set_dns_server) over one UDP
+// socket whose replies are handled from the RX path. Answers are cached
+// for their TTL, NXDOMAIN and empty answers for the SOA minimum
+// (RFC 2308). A lookup for a name that already has a query in flight
+// waits for that query instead of sending another one.
+// =============================================================================
+
+#define DNS_PORT              53
+#define DNS_NAME_MAX          96          // Longest cached name, without the final dot
+#define DNS_CACHE_SIZE        32
+#define DNS_TIMEOUT           1000        // Query resent after this (ms)
+#define DNS_RETRIES           3           // Queries sent before a lookup times out
+#define DNS_TTL_MAX           86400       // Cap on cached TTLs (s)
+#define DNS_NEG_TTL_DEFAULT   60          // Negative answers without an SOA (s)
+#define DNS_NEG_TTL_MAX       900
+
+// dns_resolve results
+#define DNS_OK                0
+#define DNS_ERR_NAME          -1          // Not a valid host name
+#define DNS_ERR_NXDOMAIN      -2          // Name does not exist
+#define DNS_ERR_NODATA        -3          // Name exists but has no A record
+#define DNS_ERR_TIMEOUT       -4
+#define DNS_ERR_SERVER        -5          // SERVFAIL, REFUSED or a malformed reply
+#define DNS_ERR_NO_SERVER     -6          // No DNS server configured
+#define DNS_ERR_BUSY          -7          // No socket or cache slot free
+
+typedef enum {
+    DNS_ENTRY_FREE,
+    DNS_ENTRY_PENDING,           // Query in flight
+    DNS_ENTRY_VALID,             // Address cached until 'expires'
+    DNS_ENTRY_NEGATIVE,          // Error cached until 'expires'
+} dns_entry_state_t;
+
+typedef struct {
+    dns_entry_state_t state;
+    char name[DNS_NAME_MAX + 1]; // Lower case
+    uint32_t ip;                 // Host order
+    int result;                  // DNS_OK or DNS_ERR_* once answered
+    uint32_t expires;            // PIT ms
+    uint32_t last_used;
+    uint16_t id;                 // Transaction ID of the query in flight
+    uint8_t tries;
+    uint32_t retry_at;
+} dns_entry_t;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t coalesced;          // Lookups that joined a query in flight
+    uint32_t queries;
+    uint32_t retransmits;
+    uint32_t responses;
+    uint32_t bad_responses;      // Unknown ID, wrong source or malformed
+    uint32_t timeouts;
+} dns_stats_t;
+
+void dns_init(void);
+
+// Resolves 'name' (a dotted quad is returned as is). Blocks until the
+// answer, an error or DNS_RETRIES timeouts; the address is in host order.
+int dns_resolve(const char *name, uint32_t *ip);
+// dns_resolve for callers that only need the address; 0 on any failure
+uint32_t dns_lookup(const char *name);
+const char* dns_strerror(int result);
+
+void dns_flush(void);
+// Entry by cache index, NULL if the slot is free
+const dns_entry_t* dns_get_entry(int index);
+void dns_get_stats(dns_stats_t *stats);
+
+#endif // DNS_H
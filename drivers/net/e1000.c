@@ -1,4 +1,5 @@
 #include "e1000.h"
+#include "drivers/net/pbuf.h"
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"
 #include "lib/libc/string.h"
@@ -6,7 +7,10 @@
 #include "drivers/char/io.h"
 #include "arch/x86/include/sys.h"
 #include "mm/kmalloc.h"
+#include "arch/x86/mm/paging.h"
 #include "kernel/time/pit.h"
+#include "arch/x86/include/interrupt.h"
+#include "drivers/net/netdev.h"
 
 
 // PCI Configuration Constants
@@ -31,16 +35,24 @@
 #define E1000_REG_RDLEN                 0x2808      // Receive Descriptor Length
 #define E1000_REG_RDH                   0x2810      // Receive Descriptor Head
 #define E1000_REG_RDT                   0x2818      // Receive Descriptor Tail
+#define E1000_REG_RDTR                  0x2820      // Receive Delay Timer
+#define E1000_REG_RADV                  0x282C      // Receive Interrupt Absolute Delay
 #define E1000_REG_TDBAL                 0x3800      // Transmit Descriptor Base Low
 #define E1000_REG_TDBAH                 0x3804      // Transmit Descriptor Base High
 #define E1000_REG_TDLEN                 0x3808      // Transmit Descriptor Length
 #define E1000_REG_TDH                   0x3810      // Transmit Descriptor Head
 #define E1000_REG_TDT                   0x3818      // Transmit Descriptor Tail
+#define E1000_REG_TIDV                  0x3820      // Transmit Interrupt Delay Value
 #define E1000_REG_TXDCTL                0x3828      // Transmit Descriptor Control
 #define E1000_REG_ICR                   0x00C0      // Interrupt Cause Read
+#define E1000_REG_ITR                   0x00C4      // Interrupt Throttling Rate
 #define E1000_REG_IMS                   0x00D0      // Interrupt Mask Set
 #define E1000_REG_ICS                   0x00C8      // Interrupt Cause Set
+#define E1000_REG_IMC                   0x00D8      // Interrupt Mask Clear
+#define E1000_REG_MPC                   0x04010     // Missed Packets Count (clear on read)
 #define E1000_REG_TPT                   0x040D4     // Total Packets Transmitted
+#define E1000_REG_STATS_START           0x04000     // Statistics registers, all clear on read
+#define E1000_REG_RXCSUM                0x5000      // Receive Checksum Control
 #define E1000_REG_RAL                   0x5400      // Receive Address Low
 #define E1000_REG_RAH                   0x5404      // Receive Address High
 
@@ -86,12 +98,62 @@
 // Transmit Descriptor Status Bits
 #define E1000_TXD_STAT_DD               (1 << 0)    // Descriptor Done
 
-// Interrupt Mask Bits
+// Receive Descriptor Status Bits
+#define E1000_RXD_STAT_DD               (1 << 0)    // Descriptor Done
+#define E1000_RXD_STAT_EOP              (1 << 1)    // End of Packet
+#define E1000_RXD_STAT_IXSM             (1 << 2)    // Ignore Checksum Indication
+#define E1000_RXD_STAT_TCPCS            (1 << 5)    // TCP/UDP Checksum Calculated
+
+// Receive Descriptor Error Bits
+#define E1000_RXD_ERR_TCPE              (1 << 5)    // TCP/UDP Checksum Error
+#define E1000_RXD_ERR_IPE               (1 << 6)    // IP Checksum Error
+
+// Receive Checksum Control (RXCSUM) Bits
+#define E1000_RXCSUM_IPOFL              (1 << 8)    // IP Checksum Offload Enable
+#define E1000_RXCSUM_TUOFL              (1 << 9)    // TCP/UDP Checksum Offload Enable
+
+// Interrupt Cause / Mask Bits
+#define E1000_ICR_TXDW                  (1 << 0)    // Transmit Descriptor Written Back
+#define E1000_ICR_LSC                   (1 << 2)    // Link Status Change
+#define E1000_ICR_RXDMT0                (1 << 4)    // RX Descriptor Minimum Threshold
+#define E1000_ICR_RXO                   (1 << 6)    // Receiver Overrun
 #define E1000_IMS_RXT0                  (1 << 7)    // Receive Timer Interrupt
-
-// Descriptor Ring Sizes
-#define E1000_NUM_RX_DESC               32          // Number of RX Descriptors
-#define E1000_NUM_TX_DESC               8           // Number of TX Descriptors
+#define E1000_IMS_RX                    (E1000_IMS_RXT0 | E1000_ICR_RXO | E1000_ICR_RXDMT0)
+
+// Descriptor Ring Sizes: defaults, changeable at runtime up to the maximum.
+// Every RX descriptor holds a pool buffer, so RX plus a full TX ring must
+// fit in PBUF_RING_BUDGET, which leaves the stack some buffers of its own.
+#ifndef E1000_NUM_RX_DESC
+#define E1000_NUM_RX_DESC               128         // Number of RX Descriptors (multiple of 8)
+#endif
+#ifndef E1000_NUM_TX_DESC
+#define E1000_NUM_TX_DESC               256         // Number of TX Descriptors (multiple of 8)
+#endif
+#define E1000_MAX_RX_DESC               256
+#define E1000_MAX_TX_DESC               256
+#define E1000_MIN_DESC                  8
+#if (E1000_NUM_RX_DESC % 8) != 0 || (E1000_NUM_TX_DESC % 8) != 0
+#error "E1000 ring sizes must be multiples of 8 (RDLEN/TDLEN are in 128 byte units)"
+#endif
+#if E1000_NUM_RX_DESC > E1000_MAX_RX_DESC || E1000_NUM_TX_DESC > E1000_MAX_TX_DESC
+#error "E1000 default ring size above the maximum"
+#endif
+#if E1000_NUM_RX_DESC + E1000_NUM_TX_DESC > PBUF_RING_BUDGET
+#error "E1000 default rings need more pool buffers than PBUF_RING_BUDGET"
+#endif
+
+// Interrupt moderation defaults. ITR caps the interrupt rate (256 ns units,
+// 488 = ~8000/s). RDTR delays the RX interrupt after each frame and RADV
+// bounds that delay; TIDV delays TX completion interrupts (all 1.024 us
+// units) so one interrupt reclaims a burst of descriptors.
+#define E1000_DEFAULT_ITR               488
+#define E1000_DEFAULT_RDTR              0
+#define E1000_DEFAULT_RADV              0
+#define E1000_DEFAULT_TIDV              64
+
+// RX polling: frames handed to the stack per e1000_poll call, and how many
+// descriptors are given back to the card per RDT write
+#define E1000_RX_REFILL_BATCH           8
 
 // PIC Constants
 #define PIC1_COMMAND                    0x20
@@ -100,11 +162,7 @@
 #define PIC2_DATA                       0xA1
 
 
-#define RX_BUFFER_SIZE 8192   // Size of each RX buffer
-
 typedef struct {
-    uint32_t tx_buffers[RX_BUFFER_SIZE];
-    uint32_t rx_buffers[RX_BUFFER_SIZE];
     volatile uint32_t *mmio_base;     // MMIO base address
     uint32_t irq;                     // IRQ number
     uint32_t tx_producer;             // TX producer index
@@ -114,18 +172,39 @@ typedef struct {
 
 e1000_device_t e1000_device = {0};
 
-struct e1000_rx_desc rx_descs[E1000_NUM_RX_DESC]; // Receive Descriptor Buffers
-struct e1000_tx_desc tx_descs[E1000_NUM_TX_DESC]; // Transmit Descriptor Buffers
+// Descriptor rings, from the page allocator: physically contiguous and
+// page aligned (the card needs 16 bytes)
+static struct e1000_rx_desc *rx_descs;
+static struct e1000_tx_desc *tx_descs;
+static uint16_t rx_count = E1000_NUM_RX_DESC;
+static uint16_t tx_count = E1000_NUM_TX_DESC;
 
-uint16_t rx_cur = 0;      // Current Receive Descriptor Buffer
+uint16_t rx_cur = 0;      // Next RX descriptor the card fills
 uint16_t tx_cur = 0;      // Current Transmit Descriptor Buffer
 uint8_t old_cur;
 
-// Buffers for RX and TX
-void *rx_buffers[E1000_NUM_RX_DESC]; // Array to hold RX buffer addresses
-
-// Static TX packet buffer (must be in kernel data section for DMA)
-static uint8_t tx_packet_buffer[2048] __attribute__((aligned(16)));
+// Packet buffers owned by the descriptors. RX descriptors always hold an
+// empty pbuf for the card to fill; TX descriptors hold the pbuf being sent
+// until the card reports it done.
+static pbuf_t *rx_pbufs[E1000_MAX_RX_DESC];
+static pbuf_t *tx_pbufs[E1000_MAX_TX_DESC];
+static uint16_t tx_clean = 0;     // Oldest TX descriptor not yet reclaimed
+static uint16_t tx_tail = 0;      // Last value written to TDT
+static uint16_t rx_tail = 0;      // Last value written to RDT
+
+static e1000_moderation_t moderation = {
+    .itr = E1000_DEFAULT_ITR,
+    .rdtr = E1000_DEFAULT_RDTR,
+    .radv = E1000_DEFAULT_RADV,
+    .tidv = E1000_DEFAULT_TIDV,
+};
+
+// RX interrupts stay masked from the first RX interrupt until e1000_poll
+// finds the ring empty
+static volatile bool rx_poll_scheduled = false;
+static e1000_queue_stats_t rx_stats;
+static e1000_queue_stats_t tx_stats;
+static netdev_t e1000_netdev;
 
 // Read a 32-bit register
 static inline uint32_t e1000_read_reg(uint32_t offset) {
@@ -138,28 +217,16 @@ static inline void e1000_write_reg(uint32_t offset, uint32_t value) {
 }
 
 // Forward declarations
-void e1000_send_arp_reply(uint8_t *request_packet);
+static void e1000_tx_reclaim(void);
 
 void e1000_enable_interrupts() {
-    // Enable common interrupts:
-    // Bit 0: TXDW (Transmit Descriptor Written Back)
-    // Bit 2: LSC (Link Status Change)
-    // Bit 6: RXO (Receiver Overrun)
-    // Bit 7: RXT0 (Receiver Timer Interrupt)
-    uint32_t ims = 0;
-    ims |= (1 << 0);  // TXDW
-    ims |= (1 << 2);  // LSC
-    ims |= (1 << 6);  // RXO
-    ims |= (1 << 7);  // RXT0 (most important for RX)
-    
+    // TX write-back, link changes and the RX causes
+    uint32_t ims = E1000_ICR_TXDW | E1000_ICR_LSC | E1000_IMS_RX;
     e1000_write_reg(E1000_REG_IMS, ims);
     printf("E1000: Interrupts enabled (IMS=0x%08X)\n", ims);
     
     // Read ICR to clear any pending interrupts
-    uint32_t icr = e1000_read_reg(E1000_REG_ICR);
-    if (icr) {
-        printf("E1000: Cleared pending interrupts (ICR=0x%08X)\n", icr);
-    }
+    e1000_read_reg(E1000_REG_ICR);
 }
 
 void e1000_enable_loopback() {
@@ -169,151 +236,246 @@ void e1000_enable_loopback() {
     rctl |= E1000_RCTL_BAM;          // Accept broadcast packets
     rctl |= E1000_RCTL_UPE;         // Unicast Promiscuous Enable
     rctl |= E1000_RCTL_MPE;         // Multicast Promiscuous Enable
-    rctl |= E1000_RCTL_BSIZE_8192;   // Set buffer size to 8192 bytes
+    rctl |= E1000_RCTL_BSIZE_2048;   // RX buffers are 2 KB pbufs
     e1000_write_reg(E1000_REG_RCTL, rctl);
 }
 
-void check_received_packet() {
-    uint8_t packet[2048];
-    int length = e1000_receive_packet(packet, sizeof(packet));
-    
-    if (length <= 0) {
+// Top half: mask RX interrupts and leave the ring to e1000_poll, which runs
+// from netstack_poll. The stack is not reentrant, so frames are never handed
+// up from interrupt context.
+void e1000_isr() {
+    uint32_t icr = e1000_read_reg(E1000_REG_ICR);
+    if (!icr) {
         return;
     }
-    
-    printf("E1000: Received packet (%d bytes)\n", length);
-    
-    // Parse ethernet frame
-    if (length < 14) {
-        printf("  Packet too small (< 14 bytes)\n");
-        return;
+
+    if (icr & E1000_IMS_RX) {
+        e1000_write_reg(E1000_REG_IMC, E1000_IMS_RX);
+        rx_poll_scheduled = true;
+        rx_stats.interrupts++;
+        if (icr & E1000_ICR_RXO) {
+            rx_stats.overruns++;
+        }
     }
-    
-    // Extract MAC addresses
-    uint8_t dst_mac[6], src_mac[6];
-    memcpy(dst_mac, packet, 6);
-    memcpy(src_mac, packet + 6, 6);
-    
-    // Extract EtherType
-    uint16_t ethertype = (packet[12] << 8) | packet[13];
-    
-    printf("  Dst MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", 
-           dst_mac[0], dst_mac[1], dst_mac[2], dst_mac[3], dst_mac[4], dst_mac[5]);
-    printf("  Src MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-           src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5]);
-    printf("  EtherType: 0x%04X", ethertype);
-    
-    if (ethertype == 0x0806) {
-        printf(" (ARP)\n");
-        
-        // Parse ARP packet (minimum 28 bytes after ethernet header)
-        if (length < 14 + 28) {
-            printf("  ARP packet too small\n");
-            return;
+
+    if (icr & E1000_ICR_TXDW) {
+        tx_stats.interrupts++;
+        e1000_tx_reclaim();
+    }
+
+    if (icr & E1000_ICR_LSC) {
+        uint32_t status = e1000_read_reg(E1000_REG_STATUS);
+        printf("E1000: Link is %s\n", (status & E1000_STATUS_LINK_UP) ? "up" : "down");
+    }
+}
+
+// Statistics registers. The octet counters are 64 bits wide: the low half
+// is read first and reading the high half clears both.
+typedef struct {
+    const char *name;
+    uint16_t reg;
+    bool wide;
+} e1000_hw_stat_reg_t;
+
+static const e1000_hw_stat_reg_t e1000_hw_stat_regs[] = {
+    {"rx_crc_errors",           0x4000, false},
+    {"rx_align_errors",         0x4004, false},
+    {"rx_symbol_errors",        0x4008, false},
+    {"rx_errors",               0x400C, false},
+    {"rx_missed",               E1000_REG_MPC, false},
+    {"tx_single_collisions",    0x4014, false},
+    {"tx_excessive_collisions", 0x4018, false},
+    {"tx_multi_collisions",     0x401C, false},
+    {"tx_late_collisions",      0x4020, false},
+    {"collisions",              0x4028, false},
+    {"tx_deferred",             0x4030, false},
+    {"rx_length_errors",        0x4040, false},
+    {"rx_xon",                  0x4048, false},
+    {"tx_xon",                  0x404C, false},
+    {"rx_xoff",                 0x4050, false},
+    {"tx_xoff",                 0x4054, false},
+    {"rx_size_64",              0x405C, false},
+    {"rx_size_65_127",          0x4060, false},
+    {"rx_size_128_255",         0x4064, false},
+    {"rx_size_256_511",         0x4068, false},
+    {"rx_size_512_1023",        0x406C, false},
+    {"rx_size_1024_1522",       0x4070, false},
+    {"rx_good_packets",         0x4074, false},
+    {"rx_broadcast",            0x4078, false},
+    {"rx_multicast",            0x407C, false},
+    {"tx_good_packets",         0x4080, false},
+    {"rx_good_bytes",           0x4088, true},
+    {"tx_good_bytes",           0x4090, true},
+    {"rx_no_buffer",            0x40A0, false},
+    {"rx_undersize",            0x40A4, false},
+    {"rx_fragments",            0x40A8, false},
+    {"rx_oversize",             0x40AC, false},
+    {"rx_jabbers",              0x40B0, false},
+    {"rx_total_bytes",          0x40C0, true},
+    {"tx_total_bytes",          0x40C8, true},
+    {"rx_total_packets",        0x40D0, false},
+    {"tx_total_packets",        E1000_REG_TPT, false},
+    {"tx_size_64",              0x40D8, false},
+    {"tx_size_65_127",          0x40DC, false},
+    {"tx_size_128_255",         0x40E0, false},
+    {"tx_size_256_511",         0x40E4, false},
+    {"tx_size_512_1023",        0x40E8, false},
+    {"tx_size_1024_1522",       0x40EC, false},
+    {"tx_multicast",            0x40F0, false},
+    {"tx_broadcast",            0x40F4, false},
+};
+
+#define E1000_HW_STATS (int)(sizeof(e1000_hw_stat_regs) / sizeof(e1000_hw_stat_regs[0]))
+
+// Running totals; the registers clear on every read
+static uint64_t hw_stats[E1000_HW_STATS];
+
+static void e1000_hw_stats_update(void) {
+    for (int i = 0; i < E1000_HW_STATS; i++) {
+        uint64_t value = e1000_read_reg(e1000_hw_stat_regs[i].reg);
+        if (e1000_hw_stat_regs[i].wide) {
+            value |= (uint64_t)e1000_read_reg(e1000_hw_stat_regs[i].reg + 4) << 32;
         }
-        
-        uint16_t ar_op = (packet[20] << 8) | packet[21];
-        printf("  ARP Operation: %u", ar_op);
-        
-        if (ar_op == 1) {
-            printf(" (Request)\n");
-            
-            // Extract target IP
-            uint8_t target_ip[4];
-            memcpy(target_ip, packet + 38, 4);
-            printf("  Target IP: %u.%u.%u.%u\n", 
-                   target_ip[0], target_ip[1], target_ip[2], target_ip[3]);
-            
-            // Check if it's for our IP (10.0.2.15)
-            if (target_ip[0] == 10 && target_ip[1] == 0 && 
-                target_ip[2] == 2 && target_ip[3] == 15) {
-                printf("    -> ARP request for our IP! Sending reply...\n");
-                e1000_send_arp_reply(packet);
-            }
-        } else if (ar_op == 2) {
-            printf(" (Reply)\n");
-        } else {
-            printf(" (Unknown)\n");
+        hw_stats[i] += value;
+        // Frames the card had to drop for lack of descriptors
+        if (e1000_hw_stat_regs[i].reg == E1000_REG_MPC) {
+            rx_stats.dropped += (uint32_t)value;
         }
-    } else if (ethertype == 0x0800) {
-        printf(" (IPv4)\n");
-    } else {
-        printf(" (Unknown)\n");
     }
 }
 
-void e1000_isr() {
-    uint32_t icr = e1000_read_reg(E1000_REG_ICR);
-    
-    if (!icr) {
-        return; // No interrupt
-    }
-    
-    printf("E1000 IRQ! ICR=0x%08X\n", icr);
-    
-    // Check for receiver overrun (bit 6)
-    if (icr & (1 << 6)) {
-        printf("E1000: RX Overrun detected! Attempting to recover...\n");
-        // Try to process any pending packets
-        check_received_packet();
-    }
-    
-    // Check for receive interrupts (bit 7)
-    if (icr & (1 << 7)) { // RXT0 - Receive Timer Interrupt
-        printf("E1000: RX interrupt\n");
-        // Process all available packets
-        check_received_packet();
+static uint64_t e1000_hw_stat(uint16_t reg) {
+    for (int i = 0; i < E1000_HW_STATS; i++) {
+        if (e1000_hw_stat_regs[i].reg == reg) {
+            return hw_stats[i];
+        }
     }
-    
-    // Check for transmit interrupts (bit 0 or 1)
-    if (icr & (1 << 0)) { // TXDW - Transmit Descriptor Written Back
-        printf("E1000: TX complete interrupt\n");
+    return 0;
+}
+
+int e1000_get_hw_stats(netdev_param_t *stats, int max) {
+    if (!e1000_is_initialized()) {
+        return 0;
     }
-    
-    // Check for link status change (bit 2)
-    if (icr & (1 << 2)) { // LSC - Link Status Change
-        uint32_t status = e1000_read_reg(E1000_REG_STATUS);
-        if (status & E1000_STATUS_LINK_UP) {
-            printf("E1000: Link is up\n");
-        } else {
-            printf("E1000: Link is down\n");
-        }
+    e1000_hw_stats_update();
+    for (int i = 0; i < E1000_HW_STATS && i < max; i++) {
+        stats[i].name = e1000_hw_stat_regs[i].name;
+        stats[i].value = hw_stats[i];
     }
+    return E1000_HW_STATS;
+}
+
+static uint32_t e1000_ring_pages(uint16_t count) {
+    return (count * sizeof(struct e1000_rx_desc) + PAGE_SIZE - 1) / PAGE_SIZE;
 }
 
-// Function to initialize rings and buffers
-void initialize_rings_and_buffers() {
-    // Initialize RX descriptors and buffers
-    for (int i = 0; i < E1000_NUM_RX_DESC; i++) {
-        // Allocate RX buffer with proper alignment
-        rx_buffers[i] = aligned_alloc(16, RX_BUFFER_SIZE);
-        if (!rx_buffers[i]) {
-            printf("Failed to allocate RX buffer %d\n", i);
-            exit(1); // Handle allocation failure
+// Function to initialize rings and buffers. Allocates both descriptor
+// rings and fills the RX ring with pool buffers the card receives into
+// directly. Returns false with nothing allocated if memory runs out.
+static bool initialize_rings_and_buffers(uint16_t rx, uint16_t tx) {
+    rx_descs = (struct e1000_rx_desc *)allocate_pages(e1000_ring_pages(rx));
+    tx_descs = (struct e1000_tx_desc *)allocate_pages(e1000_ring_pages(tx));
+    if (!rx_descs || !tx_descs) {
+        printf("E1000: cannot allocate descriptor rings (%u RX, %u TX)\n", rx, tx);
+        if (rx_descs) free_pages(rx_descs, e1000_ring_pages(rx));
+        if (tx_descs) free_pages(tx_descs, e1000_ring_pages(tx));
+        rx_descs = NULL;
+        tx_descs = NULL;
+        return false;
+    }
+    rx_count = rx;
+    tx_count = tx;
+
+    // Initialize RX descriptors
+    for (int i = 0; i < rx_count; i++) {
+        rx_pbufs[i] = pbuf_alloc(0);
+        if (!rx_pbufs[i]) {
+            printf("E1000: failed to allocate RX buffer %d\n", i);
+            while (--i >= 0) {
+                pbuf_free(rx_pbufs[i]);
+                rx_pbufs[i] = NULL;
+            }
+            free_pages(rx_descs, e1000_ring_pages(rx_count));
+            free_pages(tx_descs, e1000_ring_pages(tx_count));
+            rx_descs = NULL;
+            tx_descs = NULL;
+            return false;
         }
 
-        // Initialize RX descriptor
-        rx_descs[i].buffer_addr = (uint64_t)rx_buffers[i];
+        rx_descs[i].buffer_addr = (uint32_t)rx_pbufs[i]->buffer;
         rx_descs[i].length = 0;
+        rx_descs[i].checksum = 0;
         rx_descs[i].status = 0; // Descriptor not yet ready
         rx_descs[i].errors = 0;
         rx_descs[i].special = 0;
     }
 
-    printf("RX ring initialized with %d descriptors.\n", E1000_NUM_RX_DESC);
+    rx_cur = 0;
+    rx_tail = rx_count - 1;
+    rx_poll_scheduled = false;
+
+    printf("RX ring initialized with %d descriptors.\n", rx_count);
 
     // Initialize TX descriptors
-    for (int i = 0; i < E1000_NUM_TX_DESC; i++) {
+    tx_cur = 0;
+    tx_clean = 0;
+    tx_tail = 0;
+    for (int i = 0; i < tx_count; i++) {
+        tx_pbufs[i] = NULL;
         tx_descs[i].buffer_addr = 0;  // No buffer initially
         tx_descs[i].length = 0;
         tx_descs[i].cso = 0;
         tx_descs[i].cmd = 0;
-        tx_descs[i].status = 0xFF;   // Mark as available (e.g., TSTA_DD)
+        tx_descs[i].status = E1000_TXD_STAT_DD;   // Free
         tx_descs[i].css = 0;
         tx_descs[i].special = 0;
     }
 
-    printf("TX ring initialized with %d descriptors.\n", E1000_NUM_TX_DESC);
+    printf("TX ring initialized with %d descriptors.\n", tx_count);
+    return true;
+}
+
+// Returns every buffer to the pool and the rings to the page allocator.
+// Both engines must be stopped.
+static void release_rings_and_buffers(void) {
+    for (int i = 0; i < rx_count; i++) {
+        if (rx_pbufs[i]) {
+            pbuf_free(rx_pbufs[i]);
+            rx_pbufs[i] = NULL;
+        }
+    }
+    for (int i = 0; i < tx_count; i++) {
+        if (tx_pbufs[i]) {
+            pbuf_free(tx_pbufs[i]);
+            tx_pbufs[i] = NULL;
+        }
+    }
+    free_pages(rx_descs, e1000_ring_pages(rx_count));
+    free_pages(tx_descs, e1000_ring_pages(tx_count));
+    rx_descs = NULL;
+    tx_descs = NULL;
+}
+
+// Point the card at the rings: empty TX ring, every RX descriptor posted
+static void e1000_program_rings(void) {
+    e1000_write_reg(E1000_REG_RDBAL, (uint32_t)rx_descs);
+    e1000_write_reg(E1000_REG_RDBAH, 0);
+    e1000_write_reg(E1000_REG_RDLEN, rx_count * sizeof(struct e1000_rx_desc));
+    e1000_write_reg(E1000_REG_RDH, 0);
+    e1000_write_reg(E1000_REG_RDT, rx_tail);
+
+    e1000_write_reg(E1000_REG_TDBAL, (uint32_t)tx_descs);
+    e1000_write_reg(E1000_REG_TDBAH, 0);
+    e1000_write_reg(E1000_REG_TDLEN, tx_count * sizeof(struct e1000_tx_desc));
+    e1000_write_reg(E1000_REG_TDH, 0);
+    e1000_write_reg(E1000_REG_TDT, 0);
+}
+
+static void e1000_program_moderation(void) {
+    e1000_write_reg(E1000_REG_ITR, moderation.itr);
+    e1000_write_reg(E1000_REG_RDTR, moderation.rdtr);
+    e1000_write_reg(E1000_REG_RADV, moderation.radv);
+    e1000_write_reg(E1000_REG_TIDV, moderation.tidv);
 }
 
 void process_packet(void *packet, size_t length) {
@@ -321,69 +483,6 @@ void process_packet(void *packet, size_t length) {
     printf("Received packet: %.*s\n", length, (char *)packet);
 }
 
-// Send ARP reply in response to an ARP request
-void e1000_send_arp_reply(uint8_t *request_packet) {
-    uint8_t arp_reply[60];  // Minimum ethernet frame size
-    
-    // Get our MAC address
-    uint8_t our_mac[6];
-    e1000_get_mac_address(our_mac);
-    
-    // Ethernet header
-    // Destination MAC: from bytes 6-11 of request (sender MAC)
-    memcpy(arp_reply, request_packet + 6, 6);
-    
-    // Source MAC: our MAC
-    memcpy(arp_reply + 6, our_mac, 6);
-    
-    // EtherType: ARP (0x0806)
-    arp_reply[12] = 0x08;
-    arp_reply[13] = 0x06;
-    
-    // ARP packet
-    // Hardware type: Ethernet (0x0001)
-    arp_reply[14] = 0x00;
-    arp_reply[15] = 0x01;
-    
-    // Protocol type: IPv4 (0x0800)
-    arp_reply[16] = 0x08;
-    arp_reply[17] = 0x00;
-    
-    // Hardware size: 6 (MAC address length)
-    arp_reply[18] = 0x06;
-    
-    // Protocol size: 4 (IPv4 address length)
-    arp_reply[19] = 0x04;
-    
-    // Operation: Reply (0x0002)
-    arp_reply[20] = 0x00;
-    arp_reply[21] = 0x02;
-    
-    // Sender MAC: our MAC
-    memcpy(arp_reply + 22, our_mac, 6);
-    
-    // Sender IP: 10.0.2.15
-    arp_reply[28] = 10;
-    arp_reply[29] = 0;
-    arp_reply[30] = 2;
-    arp_reply[31] = 15;
-    
-    // Target MAC: from bytes 6-11 of request (requester's MAC)
-    memcpy(arp_reply + 32, request_packet + 6, 6);
-    
-    // Target IP: from bytes 28-31 of request (requester's IP)
-    memcpy(arp_reply + 38, request_packet + 28, 4);
-    
-    // Pad to minimum frame size (42 bytes used, pad to 60)
-    memset(arp_reply + 42, 0, 18);
-    
-    printf("E1000: Sending ARP reply to %02X:%02X:%02X:%02X:%02X:%02X\n",
-           arp_reply[0], arp_reply[1], arp_reply[2], 
-           arp_reply[3], arp_reply[4], arp_reply[5]);
-    
-    e1000_send_packet(arp_reply, 60);
-}
-
 // void e1000_init(uint8_t bus, uint8_t device, uint8_t function) {
 //     // Get BAR0 (Base Address Register 0)
 //     uint32_t bar0 = pci_read(bus, device, function, 0x10) & ~0xF;
@@ -450,51 +549,371 @@ void e1000_send_arp_reply(uint8_t *request_packet) {
 //     printf("E1000 initialized.\n");
 // }
 
+// Take the frame in the next filled descriptor and post a fresh buffer in
+// its place. The descriptor is not returned to the card here; callers do
+// that in batches with e1000_rx_give_back. Frames that are bad or cannot be
+// replaced (pool empty) are dropped and their buffer is reused.
+static pbuf_t *e1000_rx_next(void) {
+    while (rx_descs[rx_cur].status & E1000_RXD_STAT_DD) {
+        struct e1000_rx_desc *desc = &rx_descs[rx_cur];
+        uint16_t packet_length = desc->length;
+        pbuf_t *p = rx_pbufs[rx_cur];
+
+        uint8_t status = desc->status;
+
+        pbuf_t *fresh = NULL;
+        if ((status & E1000_RXD_STAT_EOP) && !desc->errors &&
+            packet_length > 0 && packet_length <= PBUF_BUF_SIZE) {
+            fresh = pbuf_alloc(0);
+        }
+        if (fresh) {
+            rx_pbufs[rx_cur] = fresh;
+            desc->buffer_addr = (uint32_t)fresh->buffer;
+        } else {
+            if (desc->errors & (E1000_RXD_ERR_TCPE | E1000_RXD_ERR_IPE)) {
+                rx_stats.csum_errors++;
+            }
+            rx_stats.dropped++;
+        }
+
+        desc->status = 0;
+        desc->length = 0;
+        rx_cur = (rx_cur + 1) % rx_count;
+
+        if (fresh) {
+            p->data = p->buffer;
+            p->len = packet_length;
+            // Errors were ruled out above, so a calculated checksum is a good one
+            if ((status & (E1000_RXD_STAT_TCPCS | E1000_RXD_STAT_IXSM)) == E1000_RXD_STAT_TCPCS) {
+                p->flags |= PBUF_F_CSUM_VALID;
+                rx_stats.csum_ok++;
+            }
+            rx_stats.packets++;
+            rx_stats.bytes += packet_length;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Hand every descriptor before rx_cur back to the card with one RDT write
+static void e1000_rx_give_back(void) {
+    __asm__ volatile("" ::: "memory");
+    uint32_t tail = (rx_cur + rx_count - 1) % rx_count;
+    if (tail != rx_tail) {
+        rx_tail = tail;
+        e1000_write_reg(E1000_REG_RDT, tail);
+        rx_stats.doorbells++;
+    }
+}
+
+pbuf_t *e1000_receive_pbuf(void) {
+    pbuf_t *p = e1000_rx_next();
+    e1000_rx_give_back();
+    return p;
+}
+
+// Pass up to 'budget' received frames to the stack. Re-enables RX
+// interrupts once the ring is empty; returns the number of frames handled.
+static int e1000_poll(netdev_t *dev, int budget) {
+    int done = 0;
+    pbuf_t *p;
+
+    while (done < budget && (p = e1000_rx_next()) != NULL) {
+        netdev_rx(dev, p);
+        if (++done % E1000_RX_REFILL_BATCH == 0) {
+            e1000_rx_give_back();
+        }
+    }
+    if (done % E1000_RX_REFILL_BATCH != 0) {
+        e1000_rx_give_back();
+    }
+
+    // Ring drained: back to interrupt mode. A frame that lands after the
+    // last DD check leaves its cause pending in ICR and fires on unmask.
+    if (done < budget && rx_poll_scheduled) {
+        rx_poll_scheduled = false;
+        e1000_write_reg(E1000_REG_IMS, E1000_IMS_RX);
+    }
+    if (done > 0) {
+        rx_stats.polls++;
+    }
+    return done;
+}
+
+void e1000_get_rx_stats(e1000_queue_stats_t *stats) {
+    e1000_hw_stats_update();
+    *stats = rx_stats;
+}
+
 int e1000_receive_packet(uint8_t *buffer, size_t buffer_size) {
-    // Read current head and tail
-    uint32_t head = e1000_read_reg(E1000_REG_RDH);
-    uint32_t tail = e1000_read_reg(E1000_REG_RDT);
-    
-    // Calculate next descriptor to process (tail + 1)
-    uint32_t next_desc = (tail + 1) % E1000_NUM_RX_DESC;
-    
-    // If next_desc == head, no packets available
-    if (next_desc == head) {
+    pbuf_t *p = e1000_receive_pbuf();
+    if (!p) {
         return 0;
     }
-    
-    // Check if descriptor has DD (Descriptor Done) bit set
-    if (!(rx_descs[next_desc].status & 0x01)) {
-        return 0;
+    int length = p->len <= buffer_size ? p->len : (int)buffer_size;
+    memcpy(buffer, p->data, (uint16_t)length);
+    pbuf_free(p);
+    return length;
+}
+
+// Free the pbufs of descriptors the card has finished sending. Runs from
+// the TX interrupt and from the send path, so it keeps interrupts off.
+static void e1000_tx_reclaim(void) {
+    uint32_t flags = irq_save();
+    while (tx_clean != tx_cur && (tx_descs[tx_clean].status & E1000_TXD_STAT_DD)) {
+        if (tx_pbufs[tx_clean]) {
+            pbuf_free(tx_pbufs[tx_clean]);
+            tx_pbufs[tx_clean] = NULL;
+        }
+        tx_clean = (tx_clean + 1) % tx_count;
     }
-    
-    // Get packet length from descriptor
-    uint16_t packet_length = rx_descs[next_desc].length;
-    
-    // Validate packet length
-    if (packet_length == 0 || packet_length > buffer_size || packet_length > RX_BUFFER_SIZE) {
-        printf("E1000: Invalid packet length %u (head=%u, tail=%u, desc=%u)\n", 
-               packet_length, head, tail, next_desc);
-        
-        // Clear descriptor and advance tail
-        rx_descs[next_desc].status = 0;
-        e1000_write_reg(E1000_REG_RDT, next_desc);
-        return 0;
+    irq_restore(flags);
+}
+
+int e1000_tx_free(void) {
+    e1000_tx_reclaim();
+    // One slot stays empty so a full ring is distinguishable from an empty one
+    return (tx_clean + tx_count - tx_cur - 1) % tx_count;
+}
+
+bool e1000_tx_idle(void) {
+    e1000_tx_reclaim();
+    return tx_clean == tx_cur;
+}
+
+bool e1000_queue_pbuf(pbuf_t *p) {
+    if (p->len < 14 || p->len > 1518) {
+        tx_stats.dropped++;
+        pbuf_free(p);
+        return false;
     }
-    
-    // Copy packet to user buffer
-    memcpy(buffer, rx_buffers[next_desc], packet_length);
-    
-    // Clear descriptor status for reuse
-    rx_descs[next_desc].status = 0;
-    rx_descs[next_desc].length = 0;
-    
-    // Update tail pointer to indicate descriptor is available for hardware
-    e1000_write_reg(E1000_REG_RDT, next_desc);
-    
-    return packet_length;
+    if ((tx_cur + 1) % tx_count == tx_clean && e1000_tx_free() == 0) {
+        tx_stats.overruns++;
+        tx_stats.dropped++;
+        pbuf_free(p);
+        return false;
+    }
+
+    // The card reads the frame straight out of the pbuf. A partial TCP/UDP
+    // checksum is finished by the card: it sums from CSS to the end of the
+    // frame and stores the result at CSO (legacy descriptor, IC).
+    uint32_t tail = tx_cur;
+    uint8_t cmd = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS | E1000_TXD_CMD_IDE;
+    uint32_t css = 0, cso = 0;
+    if (p->flags & PBUF_F_CSUM_PARTIAL) {
+        css = (uint32_t)(p->buffer + p->csum_start - p->data);
+        cso = css + p->csum_offset;
+        if (cso + 2 <= p->len && cso < 256) {
+            cmd |= E1000_TXD_CMD_IC;
+            tx_stats.csum_offloaded++;
+        } else {
+            css = cso = 0;
+        }
+    }
+    tx_descs[tail].buffer_addr = (uint32_t)p->data;
+    tx_descs[tail].length = p->len;
+    tx_descs[tail].cso = (uint8_t)cso;
+    tx_descs[tail].cmd = cmd;
+    tx_descs[tail].status = 0;
+    tx_descs[tail].css = (uint8_t)css;
+    tx_descs[tail].special = 0;
+    tx_pbufs[tail] = p;
+
+    tx_cur = (tx_cur + 1) % tx_count;
+    tx_stats.packets++;
+    tx_stats.bytes += p->len;
+    return true;
+}
+
+void e1000_tx_flush(void) {
+    if (tx_tail == tx_cur) {
+        return;
+    }
+    // Descriptors must be in memory before the card sees the new tail
+    __asm__ volatile("" ::: "memory");
+    tx_tail = tx_cur;
+    e1000_write_reg(E1000_REG_TDT, tx_tail);
+    tx_stats.doorbells++;
+}
+
+bool e1000_send_pbuf(pbuf_t *p) {
+    bool queued = e1000_queue_pbuf(p);
+    e1000_tx_flush();
+    return queued;
 }
 
+int e1000_send_batch(pbuf_t **frames, int count) {
+    int room = e1000_tx_free();
+    int sent = 0;
+    while (sent < count && sent < room) {
+        e1000_queue_pbuf(frames[sent++]);
+    }
+    e1000_tx_flush();
+    return sent;
+}
+
+void e1000_get_tx_stats(e1000_queue_stats_t *stats) {
+    *stats = tx_stats;
+}
+
+// =============================================================================
+// Tuning
+// =============================================================================
+void e1000_get_moderation(e1000_moderation_t *out) {
+    *out = moderation;
+}
+
+void e1000_set_moderation(const e1000_moderation_t *in) {
+    moderation = *in;
+    if (e1000_is_initialized()) {
+        e1000_program_moderation();
+    }
+}
+
+void e1000_get_ring_sizes(uint16_t *rx, uint16_t *tx) {
+    *rx = rx_count;
+    *tx = tx_count;
+}
+
+static bool e1000_ring_size_valid(uint16_t count, uint16_t max) {
+    return count >= E1000_MIN_DESC && count <= max && count % 8 == 0;
+}
+
+bool e1000_set_ring_sizes(uint16_t rx, uint16_t tx) {
+    if (!e1000_ring_size_valid(rx, E1000_MAX_RX_DESC) ||
+        !e1000_ring_size_valid(tx, E1000_MAX_TX_DESC) ||
+        rx + tx > PBUF_RING_BUDGET) {
+        return false;
+    }
+    if (!e1000_is_initialized() || !rx_descs) {
+        rx_count = rx;
+        tx_count = tx;
+        return true;
+    }
+
+    // Let queued frames go out, then stop both engines. Frames still in
+    // the RX ring are dropped with it.
+    uint32_t start = pit_get_ticks();
+    while (!e1000_tx_idle() && pit_get_ticks() - start < 100) {
+    }
+    e1000_write_reg(E1000_REG_IMC, 0xFFFFFFFF);
+    uint32_t rctl = e1000_read_reg(E1000_REG_RCTL);
+    uint32_t tctl = e1000_read_reg(E1000_REG_TCTL);
+    e1000_write_reg(E1000_REG_RCTL, rctl & ~E1000_RCTL_EN);
+    e1000_write_reg(E1000_REG_TCTL, tctl & ~E1000_TCTL_EN);
+
+    uint16_t old_rx = rx_count, old_tx = tx_count;
+    release_rings_and_buffers();
+    bool ok = initialize_rings_and_buffers(rx, tx);
+    if (!ok && !initialize_rings_and_buffers(old_rx, old_tx)) {
+        printf("E1000: no memory for the rings, interface stopped\n");
+        return false;
+    }
+    e1000_program_rings();
+
+    e1000_write_reg(E1000_REG_RCTL, rctl);
+    e1000_write_reg(E1000_REG_TCTL, tctl);
+    e1000_enable_interrupts();
+    return ok;
+}
+
+// =============================================================================
+// netdev glue
+// =============================================================================
+static bool e1000_netdev_xmit(netdev_t *dev, pbuf_t *p) {
+    (void)dev;
+    return e1000_queue_pbuf(p);
+}
+
+static void e1000_netdev_flush(netdev_t *dev) {
+    (void)dev;
+    e1000_tx_flush();
+}
+
+static bool e1000_netdev_tx_ready(netdev_t *dev) {
+    (void)dev;
+    return e1000_tx_free() > 0;
+}
+
+static void e1000_netdev_get_mac(netdev_t *dev, uint8_t *mac) {
+    (void)dev;
+    e1000_get_mac_address(mac);
+}
+
+static void e1000_netdev_get_stats(netdev_t *dev, netdev_stats_t *stats) {
+    e1000_queue_stats_t rx, tx;
+    e1000_get_rx_stats(&rx);
+    e1000_get_tx_stats(&tx);
+    *stats = dev->stats;
+    stats->rx_dropped = rx.dropped;
+    stats->tx_dropped = tx.dropped;
+}
+
+static int e1000_netdev_get_hw_stats(netdev_t *dev, netdev_param_t *stats, int max) {
+    (void)dev;
+    return e1000_get_hw_stats(stats, max);
+}
+
+static const char *const e1000_tunable_names[] = {
+    "itr", "rdtr", "radv", "tidv", "rx-ring", "tx-ring",
+};
+
+#define E1000_TUNABLES (int)(sizeof(e1000_tunable_names) / sizeof(e1000_tunable_names[0]))
+
+static int e1000_netdev_get_tunables(netdev_t *dev, netdev_param_t *params, int max) {
+    (void)dev;
+    const uint32_t values[E1000_TUNABLES] = {
+        moderation.itr, moderation.rdtr, moderation.radv, moderation.tidv, rx_count, tx_count,
+    };
+    for (int i = 0; i < E1000_TUNABLES && i < max; i++) {
+        params[i].name = e1000_tunable_names[i];
+        params[i].value = values[i];
+    }
+    return E1000_TUNABLES;
+}
+
+static bool e1000_netdev_set_tunable(netdev_t *dev, const char *name, uint32_t value) {
+    (void)dev;
+    // Ring sizes and the delay registers are all 16 bits wide
+    if (value > 0xFFFF) {
+        return false;
+    }
+    if (strcmp(name, "rx-ring") == 0) {
+        return e1000_set_ring_sizes((uint16_t)value, tx_count);
+    }
+    if (strcmp(name, "tx-ring") == 0) {
+        return e1000_set_ring_sizes(rx_count, (uint16_t)value);
+    }
+
+    e1000_moderation_t m = moderation;
+    if (strcmp(name, "itr") == 0) {
+        m.itr = (uint16_t)value;
+    } else if (strcmp(name, "rdtr") == 0) {
+        m.rdtr = (uint16_t)value;
+    } else if (strcmp(name, "radv") == 0) {
+        m.radv = (uint16_t)value;
+    } else if (strcmp(name, "tidv") == 0) {
+        m.tidv = (uint16_t)value;
+    } else {
+        return false;
+    }
+    e1000_set_moderation(&m);
+    return true;
+}
+
+static const netdev_ops_t e1000_netdev_ops = {
+    .xmit = e1000_netdev_xmit,
+    .flush = e1000_netdev_flush,
+    .poll = e1000_poll,
+    .tx_ready = e1000_netdev_tx_ready,
+    .get_mac = e1000_netdev_get_mac,
+    .get_stats = e1000_netdev_get_stats,
+    .get_hw_stats = e1000_netdev_get_hw_stats,
+    .get_tunables = e1000_netdev_get_tunables,
+    .set_tunable = e1000_netdev_set_tunable,
+};
+
 void e1000_get_mac_address(uint8_t *mac) {
     // Read MAC address from RAL (Receive Address Low) and RAH (Receive Address High) registers
     uint32_t mac_low = e1000_read_reg(E1000_REG_RAL);
@@ -552,28 +971,23 @@ void e1000_init(e1000_device_t *dev) {
     printf("E1000 device is ready and powered on.\n");
 
     // Initialize descriptor rings and buffers
-    initialize_rings_and_buffers();
-    
-    // Configure RX ring
-    e1000_write_reg(E1000_REG_RDBAL, (uint32_t)rx_descs);
-    e1000_write_reg(E1000_REG_RDBAH, 0);
-    e1000_write_reg(E1000_REG_RDLEN, E1000_NUM_RX_DESC * sizeof(struct e1000_rx_desc));
-    e1000_write_reg(E1000_REG_RDH, 0);
-    e1000_write_reg(E1000_REG_RDT, E1000_NUM_RX_DESC - 1);
-    
+    memset(&rx_stats, 0, sizeof(rx_stats));
+    memset(&tx_stats, 0, sizeof(tx_stats));
+    if (!initialize_rings_and_buffers(rx_count, tx_count)) {
+        return;
+    }
+    e1000_program_rings();
+
     printf("E1000: RX ring configured (base=0x%08X, len=%u, head=0, tail=%u)\n",
-           (uint32_t)rx_descs, E1000_NUM_RX_DESC * sizeof(struct e1000_rx_desc), E1000_NUM_RX_DESC - 1);
-    
-    // Configure TX ring
-    e1000_write_reg(E1000_REG_TDBAL, (uint32_t)tx_descs);
-    e1000_write_reg(E1000_REG_TDBAH, 0);
-    e1000_write_reg(E1000_REG_TDLEN, E1000_NUM_TX_DESC * sizeof(struct e1000_tx_desc));
-    e1000_write_reg(E1000_REG_TDH, 0);
-    e1000_write_reg(E1000_REG_TDT, 0);
-    
+           (uint32_t)rx_descs, rx_count * sizeof(struct e1000_rx_desc), rx_tail);
     printf("E1000: TX ring configured (base=0x%08X, len=%u)\n",
-           (uint32_t)tx_descs, E1000_NUM_TX_DESC * sizeof(struct e1000_tx_desc));
-    
+           (uint32_t)tx_descs, tx_count * sizeof(struct e1000_tx_desc));
+
+    // Coalesce interrupts (TX descriptors carry IDE); the counters start at zero
+    e1000_program_moderation();
+    e1000_hw_stats_update();
+    memset(hw_stats, 0, sizeof(hw_stats));
+
     // Configure TXDCTL - Enable transmit descriptor fetching
     uint32_t txdctl = e1000_read_reg(E1000_REG_TXDCTL);
     txdctl |= (1 << 25);  // GRAN bit - descriptor granularity
@@ -602,10 +1016,13 @@ void e1000_init(e1000_device_t *dev) {
     rctl |= E1000_RCTL_UPE;          // Unicast promiscuous (receive all packets)
     rctl |= E1000_RCTL_MPE;          // Multicast promiscuous
     rctl |= E1000_RCTL_BAM;          // Accept broadcast
-    rctl |= E1000_RCTL_BSIZE_8192;   // 8KB buffers
+    rctl |= E1000_RCTL_BSIZE_2048;   // 2KB buffers (one pbuf per frame)
     rctl |= E1000_RCTL_SECRC;        // Strip CRC
     e1000_write_reg(E1000_REG_RCTL, rctl);
     printf("E1000: Receiver enabled (RCTL=0x%08X)\n", rctl);
+
+    // Let the card verify IP and TCP/UDP checksums on receive
+    e1000_write_reg(E1000_REG_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
     
     // Enable transmitter - Read current value first
     uint32_t tctl = e1000_read_reg(E1000_REG_TCTL);
@@ -662,6 +1079,11 @@ int e1000_probe(pci_device_t *pci_dev) {
         printf("E1000 MAC: %02X:%02X:%02X:%02X:%02X:%02X, ", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
         printf("IO Base: 0x%08X, IRQ: %u\n", (uint32_t)e1000_device.mmio_base, e1000_device.irq);
 
+        e1000_netdev.ops = &e1000_netdev_ops;
+        e1000_netdev.speed = 1000;
+        e1000_netdev.features = NETDEV_F_TX_CSUM | NETDEV_F_RX_CSUM;
+        netdev_register(&e1000_netdev);
+
         return 0;
     }
 
@@ -728,10 +1150,11 @@ void e1000_debug_registers() {
     printf("Interrupts:\n");
     printf("  ICR:    0x%08X  IMS:   0x%08X\n", icr, ims);
     
-    // Check total packets transmitted counter
-    uint32_t tpt = e1000_read_reg(E1000_REG_TPT);
+    // Check total packets transmitted counter (clears on read, so go
+    // through the running totals)
+    e1000_hw_stats_update();
     printf("Statistics:\n");
-    printf("  TPT (Total Packets Transmitted): %u\n", tpt);
+    printf("  TPT (Total Packets Transmitted): %u\n", (uint32_t)e1000_hw_stat(E1000_REG_TPT));
     
     printf("===========================\n");
 }
@@ -791,11 +1214,11 @@ void e1000_test_registers() {
     }
 
     // Additional Debugging for Transmit and Receive Buffers
-    for (int i = 0; i < E1000_NUM_RX_DESC; i++) {
+    for (int i = 0; i < rx_count; i++) {
         printf("RX Desc %d: Buffer Addr: %p, Status: %u\n", i, rx_descs[i].buffer_addr, rx_descs[i].status);
     }
 
-    for (int i = 0; i < E1000_NUM_TX_DESC; i++) {
+    for (int i = 0; i < tx_count; i++) {
         printf("TX Desc %d: Buffer Addr: %p, Length: %u, Status: %u\n", i, tx_descs[i].buffer_addr, tx_descs[i].length, tx_descs[i].status);
     }
 
@@ -807,58 +1230,14 @@ void e1000_send_packet(void *packet, size_t length) {
         printf("E1000: Invalid packet length %u\n", length);
         return;
     }
-    
-    // Get current tail
-    uint32_t tail = tx_cur;
-    
-    printf("E1000: TX desc[%u] - packet addr=0x%08X, len=%u\n", tail, (uint32_t)packet, length);
-    
-    // Set up descriptor
-    tx_descs[tail].buffer_addr = (uint64_t)packet;
-    tx_descs[tail].length = (uint16_t)length;
-    tx_descs[tail].cso = 0;
-    tx_descs[tail].cmd = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS | E1000_TXD_CMD_IDE;
-    tx_descs[tail].status = 0;
-    tx_descs[tail].css = 0;
-    tx_descs[tail].special = 0;
-    
-    printf("E1000: TX desc[%u] after setup - buf_addr=0x%08X%08X, len=%u, cmd=0x%02X, status=0x%02X\n",
-           tail, (uint32_t)(tx_descs[tail].buffer_addr >> 32), (uint32_t)(tx_descs[tail].buffer_addr & 0xFFFFFFFF),
-           tx_descs[tail].length, tx_descs[tail].cmd, tx_descs[tail].status);
-    
-    // Show first 16 bytes of packet data at the buffer address
-    printf("E1000: Packet data at 0x%08X: ", (uint32_t)packet);
-    uint8_t *pkt = (uint8_t *)packet;
-    for (int i = 0; i < 16 && i < length; i++) {
-        printf("%02X ", pkt[i]);
-    }
-    printf("\n");
-    
-    // Memory barrier to ensure descriptor is written before TDT update
-    __asm__ volatile("" ::: "memory");
-    
-    // Update tail pointer to signal hardware
-    tx_cur = (tx_cur + 1) % E1000_NUM_TX_DESC;
-    e1000_write_reg(E1000_REG_TDT, tx_cur);
-    
-    printf("E1000: TDT updated to %u, waiting for TX...\n", tx_cur);
-    
-    // Give hardware time to process
-    pit_delay(10);
-    
-    // Check if transmission completed
-    uint32_t tdh = e1000_read_reg(E1000_REG_TDH);
-    uint8_t status = tx_descs[tail].status;
-    
-    if (status & E1000_TXD_STAT_DD) {
-        printf("E1000: TX completed! desc[%u].status=0x%02X (DD bit set)\n", tail, status);
-    } else if (tdh == tx_cur) {
-        printf("E1000: TX processed (TDH=%u matches TDT), but DD not set. status=0x%02X\n", tdh, status);
-    } else {
-        printf("E1000: TX pending? TDH=%u, TDT=%u, desc[%u].status=0x%02X\n", tdh, tx_cur, tail, status);
+
+    pbuf_t *p = pbuf_alloc(0);
+    if (!p) {
+        tx_stats.dropped++;
+        return;
     }
-    
-    printf("E1000: Packet sent (%u bytes)\n", length);
+    memcpy(pbuf_put(p, (uint16_t)length), packet, (uint16_t)length);
+    e1000_send_pbuf(p);
 }
 
 void e1000_send_test_packet() {
@@ -871,10 +1250,8 @@ void e1000_send_test_packet() {
     printf("E1000: Our MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
            our_mac[0], our_mac[1], our_mac[2], our_mac[3], our_mac[4], our_mac[5]);
     
-    // Use static buffer instead of stack for DMA compatibility
-    uint8_t *packet = tx_packet_buffer;
-    
-    printf("E1000: Using TX buffer at 0x%08X (static kernel data section)\n", (uint32_t)packet);
+    // e1000_send_packet copies the frame into a pool buffer
+    uint8_t packet[60];
     
     // Ethernet header
     // Destination: Broadcast
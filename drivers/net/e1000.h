@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "drivers/net/pbuf.h"
+#include "drivers/net/netdev.h"
 
 
 // Define the size of the transmit and receive rings
@@ -26,11 +28,60 @@ struct e1000_rx_desc {
     volatile uint16_t special;     // Special field
 } __attribute__((packed));
 
+// Counters for one descriptor queue
+typedef struct {
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t dropped;       // RX: bad frames, pool exhaustion, frames missed by the card
+                            // TX: bad length or ring full
+    uint32_t overruns;      // RX: RXO interrupts; TX: sends that found the ring full
+    uint32_t interrupts;    // RX: interrupts that switched to polling; TX: completion interrupts
+    uint32_t polls;         // Poll calls that found frames
+    uint32_t doorbells;     // RDT/TDT writes
+    uint32_t csum_ok;       // RX: TCP/UDP checksums verified by the card
+    uint32_t csum_errors;   // RX: frames dropped for a bad checksum
+    uint32_t csum_offloaded;// TX: TCP/UDP checksums inserted by the card
+} e1000_queue_stats_t;
+
+// Interrupt moderation, in the units of the registers they are written to
+typedef struct {
+    uint16_t itr;           // Minimum interrupt interval, 256 ns units (0 = off)
+    uint16_t rdtr;          // RX interrupt delay after each frame, 1.024 us units
+    uint16_t radv;          // Upper bound on the RDTR delay, 1.024 us units
+    uint16_t tidv;          // TX completion interrupt delay, 1.024 us units
+} e1000_moderation_t;
+
 void e1000_detect();
 bool e1000_is_initialized();
 void e1000_get_mac_address(uint8_t *mac);
 void e1000_send_packet(void *packet, size_t length);
 int e1000_receive_packet(uint8_t *buffer, size_t buffer_size);
+// Zero-copy variants: the card DMAs straight into / out of pool buffers.
+// The send functions take ownership of p and free it once the frame is sent,
+// or at once if it is dropped.
+pbuf_t *e1000_receive_pbuf(void);
+bool e1000_send_pbuf(pbuf_t *p);
+// Batched TX: queue descriptors without telling the card, then publish them
+// all with one TDT write. e1000_send_batch queues as many frames as fit and
+// returns how many it took; the rest still belong to the caller.
+bool e1000_queue_pbuf(pbuf_t *p);
+void e1000_tx_flush(void);
+int e1000_send_batch(pbuf_t **frames, int count);
+int e1000_tx_free(void);    // Free TX descriptors after reclaiming finished ones
+bool e1000_tx_idle(void);   // True once every queued frame has been sent
+void e1000_get_tx_stats(e1000_queue_stats_t *stats);
+void e1000_get_rx_stats(e1000_queue_stats_t *stats);
+// Statistics registers as named running totals ("ethtool -S"). Fills up to
+// 'max' entries and returns how many there are.
+int e1000_get_hw_stats(netdev_param_t *stats, int max);
+void e1000_get_moderation(e1000_moderation_t *moderation);
+void e1000_set_moderation(const e1000_moderation_t *moderation);
+// Ring sizes are multiples of 8 between 8 and 256, together at most
+// PBUF_RING_BUDGET. Resizing stops the card briefly and drops frames still
+// in the RX ring; returns false if a size is out of range or the new rings
+// cannot be allocated.
+bool e1000_set_ring_sizes(uint16_t rx, uint16_t tx);
+void e1000_get_ring_sizes(uint16_t *rx, uint16_t *tx);
 void e1000_send_test_packet();
 void e1000_debug_registers();
 
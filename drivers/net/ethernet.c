@@ -3,24 +3,6 @@
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"
 
-// ==== Byteorder (definitions matching prototypes in netstack.h) ====
-uint16_t htons(uint16_t x) {
-    return (uint16_t)((x << 8) | (x >> 8));
-}
-uint16_t ntohs(uint16_t x) {
-    return htons(x);
-}
-uint32_t htonl(uint32_t x) {
-    return ((x & 0x000000FFu) << 24) |
-           ((x & 0x0000FF00u) << 8)  |
-           ((x & 0x00FF0000u) >> 8)  |
-           ((x & 0xFF000000u) >> 24);
-}
-uint32_t ntohl(uint32_t x) {
-    return htonl(x);
-}
-
-
 void handle_ethernet_frame(const uint8_t* frame, uint16_t length) {
     if (length < sizeof(ethernet_header_t)) {
         printf("Fehler: Frame zu klein (%u Bytes).\n", length);
@@ -10,6 +10,7 @@
 #define ETHERTYPE_ARP  0x0806
 
 #include <stdint.h>
+#include "lib/libc/socket.h"        // htons
 
 
 // Struktur für den Ethernet-Header
@@ -20,7 +21,6 @@ typedef struct {
 } __attribute__((packed)) ethernet_header_t;
 
 
-uint16_t htons(uint16_t hostshort);
 void handle_ethernet_frame(const uint8_t* frame, uint16_t length);
 
 
@@ -0,0 +1,16 @@
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+// =============================================================================
+// LOOPBACK INTERFACE
+// "lo" owns 127.0.0.0/8. Frames sent to it are queued and come back in
+// through the stack on the next poll, so the protocol code can be measured
+// without any NIC in the path.
+// =============================================================================
+
+#define LOOPBACK_QUEUE_LEN  64      // Frames in flight before xmit drops
+#define LOOPBACK_MTU        1500
+
+void loopback_init(void);
+
+#endif // LOOPBACK_H
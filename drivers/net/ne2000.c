@@ -1,13 +1,26 @@
+// drivers/net/ne2000.c
+// NE2000 (RTL8029) over its I/O BAR.
+//
+// The card has no bus-master DMA: frames live in 16 KB of on-card memory
+// and move through the remote DMA data port, a word at a time with
+// rep insw/outsw (DCR word mode). Receive uses the card's page ring
+// (PSTART..PSTOP). Each frame starts on a page boundary behind a 4-byte
+// header and may wrap from PSTOP back to PSTART, so the data is read in
+// at most two pieces. Transmit ping-pongs between two buffers so the next
+// frame is loaded while the previous one is on the wire.
+
 #include "ne2000.h"
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"
 #include "lib/libc/string.h"
 #include "arch/x86/include/sys.h"
+#include "arch/x86/include/interrupt.h"
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "drivers/bus/pci.h"
 #include "drivers/char/io.h"
+#include "drivers/net/netdev.h"
 
 #define NE2000_VENDOR_ID 0x10EC
 #define NE2000_DEVICE_ID 0x8029
@@ -41,11 +54,27 @@
 // Define NE2000 command bits
 #define CR_STP 0x01  // Stop
 #define CR_STA 0x02  // Start
-#define CR_RD2 0x08  // Remote DMA Command
+#define CR_TXP 0x04  // Transmit Packet; cleared by the card when done
+#define CR_RD0 0x08  // Remote DMA Read
+#define CR_RD1 0x10  // Remote DMA Write
+#define CR_RD2 0x20  // Abort/Complete Remote DMA
+
+#define CR_NODMA     (CR_STA | CR_RD2)          // 0x22
+#define CR_DMA_READ  (CR_STA | CR_RD0)          // 0x0A
+#define CR_DMA_WRITE (CR_STA | CR_RD1)          // 0x12
+#define CR_TRANSMIT  (CR_STA | CR_RD2 | CR_TXP) // 0x26
 
 // Define NE2000 ISR bits
-#define ISR_RDC 0x40  // Remote DMA Complete
+#define ISR_PRX 0x01  // Packet Received
 #define ISR_PTX 0x02  // Packet Transmitted
+#define ISR_RXE 0x04  // Receive Error
+#define ISR_TXE 0x08  // Transmit Error
+#define ISR_OVW 0x10  // Receive ring overwrite
+#define ISR_RDC 0x40  // Remote DMA Complete
+
+// Define NE2000 status bits (ring header / TSR)
+#define RSR_PRX 0x01  // Frame received intact
+#define TSR_PTX 0x01  // Frame transmitted without error
 
 // Define NE2000 DCR bits
 #define DCR_WTS 0x01  // Word Transfer Select
@@ -57,41 +86,57 @@
 #define TCR_LB0         0x02  // Loopback Mode 0 (internal)
 #define TCR_LB1         0x04  // Loopback Mode 1 (external)
 
-// Define buffer pages
-#define RX_START_PAGE 0x40
-#define RX_STOP_PAGE  0x80
-#define TX_START_PAGE 0x20
+#define NE2000_FRAME_MIN   60    // Ethernet minimum without CRC
+#define NE2000_FRAME_MAX   1514
+#define NE2000_RX_FRAME_MAX 1518 // Some cards leave the CRC in the count
+
+#define NE2000_DMA_TIMEOUT 10000
+#define NE2000_TX_TIMEOUT  100000
 
 // I/O base address (to be set during runtime)
-uint16_t io_base = 0xc000;// = 0x300;
+static uint16_t io_base = 0xc000;// = 0x300;
 
-uint8_t mac_address[MAC_ADDRESS_LENGTH] = {0};
+static uint8_t mac_address[MAC_ADDRESS_LENGTH] = {0};
 static bool ne2000_initialized = false;
+static netdev_t ne2000_netdev;
+
+static ne2000_ring_layout_t ring = {
+    .tx_start = NE2000_TX_START_PAGE,
+    .rx_start = NE2000_RX_START_PAGE,
+    .rx_stop = NE2000_RX_STOP_PAGE,
+};
+
+// Transmit buffers: one on the wire, one loaded and waiting behind it
+static int8_t tx_active = -1;
+static int8_t tx_pending = -1;
+static uint16_t tx_length[2];
+
+// Set by the interrupt handler, handled by the next receive
+static volatile bool rx_overflow = false;
 
-// prototypes
-int ne2000_receive_packet(uint8_t *buffer, uint16_t buffer_size);
-void print_packet(const uint8_t *packet, uint16_t length);
-void print_hex_dump(const char* label, const uint8_t *data, uint16_t length);
-void ne2000_dump_page(uint8_t page_num, uint16_t length);
+static ne2000_stats_t stats;
 
 // Function to write to a NE2000 register
 static inline void ne2000_write(uint8_t reg, uint8_t value) {
-    if(io_base == 0) {
-        printf("IO base address not set\n");
-        return;
-    }
     outb(io_base + reg, value);
 }
 
 // Function to read from a NE2000 register
 static inline uint8_t ne2000_read(uint8_t reg) {
-     if(io_base == 0) {
-        printf("IO base address not set\n");
-        return;
-    }
     return inb(io_base + reg);
 }
 
+// CURR is the only register the data path needs from page 1. The interrupt
+// handler assumes page 0, so it must not run while page 1 is selected.
+static uint8_t ne2000_read_curr(void) {
+    uint32_t flags = irq_save();
+    ne2000_write(NE2000_CR, NE2000_CR_PAGE1 | CR_NODMA);
+    uint8_t curr = ne2000_read(NE2000_CURR);
+    ne2000_write(NE2000_CR, NE2000_CR_PAGE0 | CR_NODMA);
+    irq_restore(flags);
+    return curr;
+}
+
 // Function to enable loopback mode
 void ne2000_enable_loopback(uint16_t io_base) {
     // Ensure the card is started
@@ -112,6 +157,94 @@ void ne2000_disable_loopback(uint16_t io_base) {
     printf("NE2000 loopback mode disabled.\n");
 }
 
+// Frames are read from the ring by the netdev poll op, never from here.
+// An overwrite is only noted: resetting the ring stops the card, which
+// must not happen under a remote DMA the interrupted code is running.
+void ne2000_irq_handler() {
+    uint8_t isr = ne2000_read(NE2000_ISR);
+
+    // Silently ignore spurious interrupts
+    if (isr == 0) {
+        return;
+    }
+
+    if (isr & ISR_OVW) {
+        rx_overflow = true;
+    }
+
+    // Acknowledge RX/TX causes; RDC is left to the DMA wait loops
+    ne2000_write(NE2000_ISR, isr & ~ISR_RDC);
+}
+
+// =============================================================================
+// Remote DMA: the card's memory seen through the data port
+// =============================================================================
+static void ne2000_dma_start(uint16_t addr, uint16_t count, uint8_t cmd) {
+    ne2000_write(NE2000_CR, CR_NODMA);
+    ne2000_write(NE2000_RBCR0, count & 0xFF);
+    ne2000_write(NE2000_RBCR1, count >> 8);
+    ne2000_write(NE2000_RSAR0, addr & 0xFF);
+    ne2000_write(NE2000_RSAR1, addr >> 8);
+    ne2000_write(NE2000_ISR, ISR_RDC);
+    ne2000_write(NE2000_CR, cmd);
+}
+
+static bool ne2000_dma_wait(void) {
+    int timeout = NE2000_DMA_TIMEOUT;
+    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0) {
+    }
+    ne2000_write(NE2000_ISR, ISR_RDC);
+    return timeout > 0;
+}
+
+// In word mode the card moves whole words, so an odd length is rounded up
+// and the trailing byte taken from (or padded into) the last word
+static bool ne2000_pio_read(uint16_t addr, uint8_t *dst, uint16_t len) {
+    ne2000_dma_start(addr, (len + 1) & ~1u, CR_DMA_READ);
+    insw(io_base + NE2000_DATA, dst, len >> 1);
+    if (len & 1) {
+        dst[len - 1] = (uint8_t)inw(io_base + NE2000_DATA);
+    }
+    return ne2000_dma_wait();
+}
+
+// Writes 'len' bytes of frame data followed by zero padding up to 'total'
+static bool ne2000_pio_write(uint16_t addr, const uint8_t *src, uint16_t len, uint16_t total) {
+    uint16_t words = (total + 1) >> 1;
+    ne2000_dma_start(addr, words << 1, CR_DMA_WRITE);
+    outsw(io_base + NE2000_DATA, src, len >> 1);
+    words -= len >> 1;
+    if (len & 1) {
+        outw(io_base + NE2000_DATA, src[len - 1]);
+        words--;
+    }
+    while (words--) {
+        outw(io_base + NE2000_DATA, 0);
+    }
+    return ne2000_dma_wait();
+}
+
+// Reads from the receive ring, continuing at PSTART when the read reaches
+// PSTOP instead of running into the transmit buffers
+static bool ne2000_ring_read(uint16_t addr, uint8_t *dst, uint16_t len) {
+    uint32_t ring_end = (uint32_t)ring.rx_stop << 8;
+    if (addr + len > ring_end) {
+        uint16_t head = (uint16_t)(ring_end - addr);
+        if (!ne2000_pio_read(addr, dst, head)) {
+            return false;
+        }
+        dst += head;
+        len -= head;
+        addr = (uint16_t)ring.rx_start << 8;
+        stats.rx_wraps++;
+    }
+    return ne2000_pio_read(addr, dst, len);
+}
+
+// =============================================================================
+// Setup
+// =============================================================================
+
 // Function to reset the NE2000 card
 void ne2000_reset() {
     // Perform a software reset
@@ -130,101 +263,73 @@ void ne2000_reset() {
     printf("NE2000 reset complete.\n");
 }
 
-// Forward declarations
-void ne2000_send_arp_reply(uint8_t *request_packet);
+// Programs the ring registers for an empty ring; the card must be stopped.
+// BNRY trails one page behind the next frame, CURR is where it will land.
+static void ne2000_ring_program(void) {
+    ne2000_write(NE2000_PSTART, ring.rx_start);
+    ne2000_write(NE2000_PSTOP, ring.rx_stop);
+    ne2000_write(NE2000_BNRY, ring.rx_start);
+
+    uint32_t flags = irq_save();
+    ne2000_write(NE2000_CR, NE2000_CR_PAGE1 | CR_STP | CR_RD2);
+    ne2000_write(NE2000_CURR, ring.rx_start + 1);
+    ne2000_write(NE2000_CR, NE2000_CR_PAGE0 | CR_STP | CR_RD2);
+    irq_restore(flags);
+}
 
-void ne2000_irq_handler() {
-    uint8_t isr = ne2000_read(NE2000_ISR);
-    
-    // Silently ignore spurious interrupts
-    if (isr == 0) {
-        return;
+// Waits until the frame on the wire is out; stopping the card aborts it
+static bool ne2000_tx_idle(void) {
+    int timeout = NE2000_TX_TIMEOUT;
+    while ((ne2000_read(NE2000_CR) & CR_TXP) && timeout-- > 0) {
     }
-    
-    printf("NE2000 IRQ - ISR: 0x%02X\n", isr);
-
-    // Handle buffer overrun first (most critical)
-    if (isr & 0x10) {  // Overwrite warning
-        printf("[WARNING] RX buffer overrun - resetting receive buffer\n");
-        // Stop NIC
-        ne2000_write(NE2000_CR, 0x21);  // Stop
-        // Clear Remote DMA
-        ne2000_write(NE2000_RBCR0, 0);
-        ne2000_write(NE2000_RBCR1, 0);
-        // Reset receive buffer pointers
-        ne2000_write(NE2000_BNRY, RX_START_PAGE);
-        ne2000_write(NE2000_CR, 0x62);  // Page 1
-        ne2000_write(NE2000_CURR, RX_START_PAGE + 1);
-        ne2000_write(NE2000_CR, 0x22);  // Page 0, Start
-        // Clear overwrite flag
-        ne2000_write(NE2000_ISR, 0x10);
+    return timeout > 0;
+}
+
+// Discards everything in the receive ring. Used after an overwrite and on
+// a corrupt header, where the chain of next-page pointers cannot be trusted.
+static void ne2000_rx_reset(void) {
+    ne2000_tx_idle();
+    ne2000_write(NE2000_CR, CR_STP | CR_RD2);
+    ne2000_write(NE2000_RBCR0, 0);
+    ne2000_write(NE2000_RBCR1, 0);
+    ne2000_ring_program();
+    ne2000_write(NE2000_CR, CR_NODMA);
+    ne2000_write(NE2000_ISR, ISR_OVW);
+    rx_overflow = false;
+}
+
+static bool ne2000_ring_layout_valid(const ne2000_ring_layout_t *layout) {
+    uint16_t tx_end = layout->tx_start + 2 * NE2000_TX_PAGES;
+    if (layout->tx_start < NE2000_MEM_START_PAGE || tx_end > NE2000_MEM_STOP_PAGE) {
+        return false;
+    }
+    if (layout->rx_start < NE2000_MEM_START_PAGE || layout->rx_stop > NE2000_MEM_STOP_PAGE ||
+        layout->rx_stop < layout->rx_start + NE2000_RX_MIN_PAGES) {
+        return false;
     }
+    return tx_end <= layout->rx_start || layout->tx_start >= layout->rx_stop;
+}
 
-    // Process up to 5 packets per interrupt to avoid getting stuck
-    int packets_processed = 0;
-    const int max_packets_per_irq = 5;
-    
-    while ((isr & 0x01) && packets_processed < max_packets_per_irq) {  // Packet received
-        uint8_t packet[1500];
-        int length = ne2000_receive_packet(packet, sizeof(packet));
-        if (length > 0) {
-            printf("Received packet: %d bytes\n", length);
-            
-            // Parse and display ethernet frame
-            if (length >= 14) {  // Minimum ethernet frame has 14-byte header
-                printf("  Dst MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                       packet[0], packet[1], packet[2], packet[3], packet[4], packet[5]);
-                printf("  Src MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                       packet[6], packet[7], packet[8], packet[9], packet[10], packet[11]);
-                uint16_t ethertype = (packet[12] << 8) | packet[13];
-                printf("  EtherType: 0x%04X ", ethertype);
-                
-                if (ethertype == 0x0806) {
-                    printf("(ARP)\n");
-                    // Show ARP details if enough data
-                    if (length >= 42) {
-                        uint16_t ar_op = (packet[20] << 8) | packet[21];
-                        printf("    ARP Operation: %d %s\n", ar_op, 
-                               ar_op == 1 ? "(Request)" : ar_op == 2 ? "(Reply)" : "");
-                        printf("    Sender IP: %d.%d.%d.%d\n",
-                               packet[28], packet[29], packet[30], packet[31]);
-                        printf("    Target IP: %d.%d.%d.%d\n",
-                               packet[38], packet[39], packet[40], packet[41]);
-                        
-                        // If this is an ARP request for our IP (10.0.2.15), send a reply
-                        if (ar_op == 1 &&  // ARP Request
-                            packet[38] == 10 && packet[39] == 0 && 
-                            packet[40] == 2 && packet[41] == 15) {
-                            printf("    -> ARP request for our IP! Sending reply...\n");
-                            ne2000_send_arp_reply(packet);
-                        }
-                    }
-                } else if (ethertype == 0x0800) {
-                    printf("(IPv4)\n");
-                } else if (ethertype == 0x86DD) {
-                    printf("(IPv6)\n");
-                } else {
-                    printf("(Unknown)\n");
-                }
-            }
-            
-            print_packet(packet, length > 64 ? 64 : length);
-            packets_processed++;
-        } else if (length < 0) {
-            // Error occurred, stop processing
-            break;
-        } else {
-            // No more packets
-            break;
+bool ne2000_set_ring_layout(const ne2000_ring_layout_t *layout) {
+    if (!ne2000_ring_layout_valid(layout)) {
+        return false;
+    }
+    ring = *layout;
+    if (ne2000_initialized) {
+        // The queued frame sits in the old transmit buffer
+        if (tx_pending >= 0) {
+            tx_pending = -1;
+            stats.tx_errors++;
         }
-        
-        // Check if more packets arrived
-        isr = ne2000_read(NE2000_ISR);
+        tx_active = -1;
+        ne2000_rx_reset();
     }
+    return true;
+}
 
-    // Clear all ISR flags
-    ne2000_write(NE2000_ISR, 0xFF);
-}   
+void ne2000_get_ring_layout(ne2000_ring_layout_t *layout) {
+    *layout = ring;
+}
 
 // Function to initialize the NE2000 card
 void ne2000_init() {
@@ -235,56 +340,48 @@ void ne2000_init() {
     ne2000_reset();
 
     // === Proper NE2000 Initialization Sequence ===
-    
+
     // 1. Stop the NIC (CR = 0x21: Page 0, Stop, NoDMA)
     ne2000_write(NE2000_CR, 0x21);
-    
-    // 2. Set Data Configuration Register (DCR) - word mode for proper QEMU emulation
-    // DCR bits: WTS=1 (word mode), BOS=0, LAS=0, LS=0, ARM=1, FT=01
-    // NOTE: QEMU's NE2000 emulation works better in word mode
+
+    // 2. Set Data Configuration Register (DCR) - word mode: the data port
+    // moves 16 bits per access, which the rep insw/outsw paths rely on
+    // DCR bits: WTS=1 (word mode), BOS=0, LAS=0, LS=1, ARM=0, FT=10
     ne2000_write(NE2000_DCR, 0x49);  // Word mode
-    
+
     // 3. Clear Remote Byte Count Registers
     ne2000_write(NE2000_RBCR0, 0);
     ne2000_write(NE2000_RBCR1, 0);
-    
-    // 4. Set Receive Configuration Register (RCR) - monitor mode initially  
-    ne2000_write(NE2000_RCR, 0x20);  // Monitor mode (no packets accepted yet)
-    
+
+    // 4. Set Receive Configuration Register (RCR) - monitor mode initially
+    ne2000_write(NE2000_RCR, RCR_MON);  // Monitor mode (no packets accepted yet)
+
     // 5. Set Transmit Configuration Register (TCR) - loopback mode
-    ne2000_write(NE2000_TCR, 0x02);  // Internal loopback
-    
-    // 6. Set up Receive Buffer Ring
-    ne2000_write(NE2000_PSTART, RX_START_PAGE);
-    ne2000_write(NE2000_PSTOP, RX_STOP_PAGE);
-    ne2000_write(NE2000_BNRY, RX_START_PAGE);
-    
+    ne2000_write(NE2000_TCR, TCR_LB0);  // Internal loopback
+
+    // 6. Set up Receive Buffer Ring (PSTART, PSTOP, BNRY and CURR)
+    if (!ne2000_ring_layout_valid(&ring)) {
+        printf("[WARN] Invalid NE2000 ring layout, using defaults\n");
+        ring.tx_start = NE2000_MEM_START_PAGE;
+        ring.rx_start = NE2000_MEM_START_PAGE + 2 * NE2000_TX_PAGES;
+        ring.rx_stop = NE2000_MEM_STOP_PAGE;
+    }
+    ne2000_ring_program();
+
     // 7. Clear Interrupt Status Register
     ne2000_write(NE2000_ISR, 0xFF);
-    
-    // 8. Set Interrupt Mask Register - enable receive interrupt
-    ne2000_write(NE2000_IMR, 0x0F);  // Enable RX, TX, RX error, TX error interrupts
-    
-    // 9. Read MAC address from PROM using Remote DMA
-    // In byte mode (DCR=0x48), we need to read 32 bytes and extract every other byte
-    // The PROM stores each MAC byte twice in word format
-    ne2000_write(NE2000_CR, 0x21);      // Page 0, Stop, NoDMA
-    ne2000_write(NE2000_RBCR0, 32);     // Read 32 bytes to get 6-byte MAC with doubling
-    ne2000_write(NE2000_RBCR1, 0);
-    ne2000_write(NE2000_RSAR0, 0);      // Start at PROM address 0
-    ne2000_write(NE2000_RSAR1, 0);
-    ne2000_write(NE2000_CR, 0x0A);      // Start Remote DMA Read
-    
-    // Read MAC address from data port - in byte mode, skip every other byte
-    for (int i = 0; i < MAC_ADDRESS_LENGTH; i++) {
-        mac_address[i] = inb(io_base + NE2000_DATA);
-        inb(io_base + NE2000_DATA);  // Skip duplicate byte (PROM stores each byte twice)
-    }
-    
-    // Wait for Remote DMA to complete with timeout
-    int mac_timeout = 10000;
-    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && mac_timeout-- > 0);
-    if (mac_timeout <= 0) {
+
+    // 8. Set Interrupt Mask Register
+    ne2000_write(NE2000_IMR, ISR_PRX | ISR_PTX | ISR_RXE | ISR_TXE | ISR_OVW);
+
+    // 9. Read MAC address from PROM using Remote DMA. The PROM stores each
+    // byte twice, so in word mode every word carries one MAC byte.
+    uint16_t prom[MAC_ADDRESS_LENGTH];
+    if (ne2000_pio_read(0, (uint8_t *)prom, sizeof(prom))) {
+        for (int i = 0; i < MAC_ADDRESS_LENGTH; i++) {
+            mac_address[i] = (uint8_t)prom[i];
+        }
+    } else {
         printf("[WARN] Timeout reading MAC address, using default\n");
         // Use default MAC if read fails
         mac_address[0] = 0x52;
@@ -294,31 +391,27 @@ void ne2000_init() {
         mac_address[4] = 0x34;
         mac_address[5] = 0x56;
     }
-    ne2000_write(NE2000_ISR, ISR_RDC);  // Clear RDC flag
-    
+
     // 10. Switch to Page 1 to set Physical Address and Multicast
     ne2000_write(NE2000_CR, 0x61);  // Page 1, Stop, NoDMA
-    
+
     // 11. Set Physical Address Registers (write the MAC we just read)
     for (int i = 0; i < MAC_ADDRESS_LENGTH; i++) {
         ne2000_write(NE2000_PAR0 + i, mac_address[i]);
     }
-    
+
     // 12. Set Multicast Address Registers (accept all multicast for broadcast)
     for (int i = 0; i < 8; i++) {
         ne2000_write(0x08 + i, 0xFF);  // MAR0-MAR7
     }
-    
-    // 13. Set CURR (Current Page Register)
-    ne2000_write(NE2000_CURR, RX_START_PAGE + 1);
-    
-    // 14. Switch back to Page 0 and START the NIC
-    ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-    
-    // 15. Enable packet reception (exit monitor mode)
+
+    // 13. Switch back to Page 0 and START the NIC
+    ne2000_write(NE2000_CR, CR_NODMA);  // Page 0, Start, NoDMA
+
+    // 14. Enable packet reception (exit monitor mode)
     ne2000_write(NE2000_RCR, 0x04);  // Accept broadcast packets
-    
-    // 16. Set normal transmission mode initially (loopback will be set by test function)
+
+    // 15. Set normal transmission mode
     ne2000_write(NE2000_TCR, 0x00);  // Normal operation
 
     // set irq handler
@@ -341,9 +434,9 @@ void ne2000_print_status() {
     printf("\n=== NE2000 Network Card Status ===\n");
     printf("IO Base Address: 0x%04X\n", io_base);
     printf("MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n",
-           mac_address[0], mac_address[1], mac_address[2], 
+           mac_address[0], mac_address[1], mac_address[2],
            mac_address[3], mac_address[4], mac_address[5]);
-    
+
     printf("\nRegister Status:\n");
     printf("  PSTART:  0x%02X (RX buffer start page)\n", ne2000_read(NE2000_PSTART));
     printf("  PSTOP:   0x%02X (RX buffer stop page)\n", ne2000_read(NE2000_PSTOP));
@@ -351,470 +444,151 @@ void ne2000_print_status() {
     printf("  TPSR:    0x%02X (TX page start)\n", ne2000_read(NE2000_TPSR));
     printf("  ISR:     0x%02X (Interrupt status)\n", ne2000_read(NE2000_ISR));
     printf("  IMR:     0x%02X (Interrupt mask)\n", ne2000_read(NE2000_IMR));
-    
-    // Switch to page 1 to read CURR
-    ne2000_write(NE2000_CR, 0x62);
-    uint8_t current_page = ne2000_read(NE2000_CURR);
-    ne2000_write(NE2000_CR, 0x22);
-    printf("  CURR:    0x%02X (Current page)\n", current_page);
-    
+    printf("  CURR:    0x%02X (Current page)\n", ne2000_read_curr());
+
     printf("==================================\n\n");
 }
 
-void ne2000_send_packet(uint8_t *data, uint16_t length) {
-    if (length > 1500) {
-        printf("Packet too large to send: %d bytes\n", length);
-        return;
-    }
-
-    // Use the defined TX buffer page, not hardcoded
-    uint8_t tx_page_start = TX_START_PAGE;  // 0x20 - separate from RX buffer
-    
-    // Pad packet to minimum ethernet size (60 bytes)
-    uint16_t send_length = length;
-    if (send_length < 60) {
-        send_length = 60;
-    }
-
-    // 1. Set COMMAND register to "start" and "nodma" (0x22)
-    ne2000_write(NE2000_CR, 0x22);
-
-    // 2. Load RBCRx (Remote Byte Count Registers) with the packet size
-    ne2000_write(NE2000_RBCR0, send_length & 0xFF);    // Low byte
-    ne2000_write(NE2000_RBCR1, (send_length >> 8));    // High byte
-
-    // 3. Clear "Remote DMA complete" bit by writing 1 to bit 6 of ISR
-    ne2000_write(NE2000_ISR, ISR_RDC);  // Write 0x40 to ISR
-
-    // 4. Load RSARx (Remote Start Address Registers) with 0x00 (low) and target page number (high)
-    ne2000_write(NE2000_RSAR0, 0x00);             // Low byte
-    ne2000_write(NE2000_RSAR1, tx_page_start);    // High byte (target page)
+// =============================================================================
+// TX
+// =============================================================================
+static uint16_t ne2000_tx_addr(int buf) {
+    return (uint16_t)(ring.tx_start + buf * NE2000_TX_PAGES) << 8;
+}
 
-    // 5. Set COMMAND register to "start" and "remote write DMA" (0x12)
-    ne2000_write(NE2000_CR, 0x12);
+static void ne2000_tx_start(int buf) {
+    ne2000_write(NE2000_TPSR, ring.tx_start + buf * NE2000_TX_PAGES);
+    ne2000_write(NE2000_TBCR0, tx_length[buf] & 0xFF);
+    ne2000_write(NE2000_TBCR1, tx_length[buf] >> 8);
+    ne2000_write(NE2000_CR, CR_TRANSMIT);
+    tx_active = (int8_t)buf;
+    stats.tx_packets++;
+    stats.tx_bytes += tx_length[buf];
+}
 
-    // 6. Write packet data to the "data port" in word mode (16-bit transfers)
-    for (uint16_t i = 0; i + 1 < length; i += 2) {
-        uint16_t word = data[i] | (data[i + 1] << 8);  // Little endian
-        outw(io_base + NE2000_DATA, word);
+// Retires the frame on the wire once the card clears TXP and starts the
+// one waiting behind it
+static void ne2000_tx_reap(void) {
+    if (tx_active < 0 || (ne2000_read(NE2000_CR) & CR_TXP)) {
+        return;
     }
-    // Write last byte if length is odd
-    if (length & 1) {
-        outw(io_base + NE2000_DATA, data[length - 1]);
+    if (!(ne2000_read(NE2000_TSR) & TSR_PTX)) {
+        stats.tx_errors++;
     }
-    // Pad with zeros if necessary
-    for (uint16_t i = length; i < send_length; i += 2) {
-        outw(io_base + NE2000_DATA, 0);
+    tx_active = -1;
+    if (tx_pending >= 0) {
+        int buf = tx_pending;
+        tx_pending = -1;
+        ne2000_tx_start(buf);
     }
+}
 
-    // 7. Poll ISR register until bit 6 ("Remote DMA completed") is set
-    int timeout = 10000;
-    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0) {
-        // Wait for Remote DMA to complete
-    }
-    
-    if (timeout <= 0) {
-        printf("[TX] Timeout waiting for Remote DMA complete\n");
-        return;
+static bool ne2000_tx(const uint8_t *data, uint16_t length) {
+    if (length > NE2000_FRAME_MAX) {
+        stats.tx_errors++;
+        return false;
     }
 
-    // Clear "Remote DMA complete" bit
-    ne2000_write(NE2000_ISR, ISR_RDC);
-
-    // Start transmission
-    ne2000_write(NE2000_TPSR, tx_page_start);    // Set Transmit Page Start
-    ne2000_write(NE2000_TBCR0, send_length & 0xFF);  // Set Transmit Byte Count (low byte)
-    ne2000_write(NE2000_TBCR1, (send_length >> 8));  // Set Transmit Byte Count (high byte)
-    
-    printf("[TX] Starting transmission: page=0x%02X, length=%d\n", tx_page_start, send_length);
-    ne2000_write(NE2000_CR, 0x26);              // Start transmission (CR = 0x26 = Page 0, Start, TXP)
-
-    // Wait for transmission complete (ISR_PTX = 0x02)
-    timeout = 100000;  // Longer timeout for actual transmission
-    while (!(ne2000_read(NE2000_ISR) & ISR_PTX) && timeout-- > 0) {
-        // Wait for Packet Transmitted
+    ne2000_tx_reap();
+    if (tx_pending >= 0) {
+        // Both buffers taken: wait for the wire to move the queued frame up
+        stats.tx_busy++;
+        int timeout = NE2000_TX_TIMEOUT;
+        while (tx_pending >= 0 && timeout-- > 0) {
+            ne2000_tx_reap();
+        }
+        if (tx_pending >= 0) {
+            stats.tx_errors++;
+            return false;
+        }
     }
 
-    if (timeout <= 0) {
-        printf("[TX] Timeout waiting for packet transmission\n");
-        // Check for errors
-        uint8_t isr = ne2000_read(NE2000_ISR);
-        printf("[TX] ISR at timeout: 0x%02X\n", isr);
-        return;
+    // Load the buffer that is not on the wire
+    int buf = tx_active == 0 ? 1 : 0;
+    uint16_t send_length = length < NE2000_FRAME_MIN ? NE2000_FRAME_MIN : length;
+    if (!ne2000_pio_write(ne2000_tx_addr(buf), data, length, send_length)) {
+        stats.tx_errors++;
+        return false;
     }
+    tx_length[buf] = send_length;
 
-    // Clear transmission complete flag
-    ne2000_write(NE2000_ISR, ISR_PTX);
-    
-    uint8_t tsr = ne2000_read(NE2000_TSR);  // Read Transmit Status Register
-    printf("[TX] Transmission complete - TSR: 0x%02X\n", tsr);
-
-    printf("Packet sent successfully, length: %d bytes\n", length);
+    // The transmit may have finished while the frame was copied
+    ne2000_tx_reap();
+    if (tx_active < 0) {
+        ne2000_tx_start(buf);
+    } else {
+        tx_pending = (int8_t)buf;
+        stats.tx_queued++;
+    }
+    return true;
 }
 
-// Send ARP reply
-void ne2000_send_arp_reply(uint8_t *request_packet) {
-    uint8_t arp_reply[60];  // Minimum ethernet frame size
-    
-    // Build ethernet header
-    // Destination MAC: sender's MAC from the request (bytes 6-11 of request)
-    for (int i = 0; i < 6; i++) {
-        arp_reply[i] = request_packet[6 + i];  // Copy sender MAC to destination
-    }
-    
-    // Source MAC: our MAC address (use the actual MAC we read from PROM)
-    for (int i = 0; i < 6; i++) {
-        arp_reply[6 + i] = mac_address[i];
-    }
-    
-    // EtherType: ARP (0x0806)
-    arp_reply[12] = 0x08;
-    arp_reply[13] = 0x06;
-    
-    // ARP packet structure
-    // Hardware type: Ethernet (0x0001)
-    arp_reply[14] = 0x00;
-    arp_reply[15] = 0x01;
-    
-    // Protocol type: IPv4 (0x0800)
-    arp_reply[16] = 0x08;
-    arp_reply[17] = 0x00;
-    
-    // Hardware address length: 6
-    arp_reply[18] = 0x06;
-    
-    // Protocol address length: 4
-    arp_reply[19] = 0x04;
-    
-    // Operation: Reply (0x0002)
-    arp_reply[20] = 0x00;
-    arp_reply[21] = 0x02;
-    
-    // Sender hardware address (our MAC)
-    for (int i = 0; i < 6; i++) {
-        arp_reply[22 + i] = mac_address[i];
-    }
-    
-    // Sender protocol address (our IP: 10.0.2.15)
-    arp_reply[28] = 10;
-    arp_reply[29] = 0;
-    arp_reply[30] = 2;
-    arp_reply[31] = 15;
-    
-    // Target hardware address (requester's MAC from bytes 22-27 of request)
-    for (int i = 0; i < 6; i++) {
-        arp_reply[32 + i] = request_packet[22 + i];
-    }
-    
-    // Target protocol address (requester's IP from bytes 28-31 of request)
-    for (int i = 0; i < 4; i++) {
-        arp_reply[38 + i] = request_packet[28 + i];
-    }
-    
-    // Pad to minimum frame size
-    for (int i = 42; i < 60; i++) {
-        arp_reply[i] = 0;
+void ne2000_send_packet(uint8_t *data, uint16_t length) {
+    if (!ne2000_initialized || !ne2000_tx(data, length)) {
+        printf("NE2000: send of %d bytes failed\n", length);
     }
-    
-    printf("Sending ARP reply to %d.%d.%d.%d (MAC: %02X:%02X:%02X:%02X:%02X:%02X)\n",
-           arp_reply[38], arp_reply[39], arp_reply[40], arp_reply[41],
-           arp_reply[0], arp_reply[1], arp_reply[2], arp_reply[3], arp_reply[4], arp_reply[5]);
-    
-    // Show what we're sending
-    print_hex_dump("[TX] ARP Reply", arp_reply, 60);
-    
-    ne2000_send_packet(arp_reply, 60);
 }
 
-int ne2000_receive_packet(uint8_t *buffer, uint16_t buffer_size) {
-    // Switch to Page 1 to read CURR register
-    ne2000_write(NE2000_CR, 0x62);  // Page 1, Start, NoDMA
-    uint8_t current_page = ne2000_read(NE2000_CURR);
-    ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
+// =============================================================================
+// RX
+// =============================================================================
 
-    uint8_t boundary = ne2000_read(NE2000_BNRY);
-    
-    // Check if buffer is empty (CURR == next read position)
-    uint8_t next_read = boundary + 1;
-    if (next_read >= RX_STOP_PAGE) {
-        next_read = RX_START_PAGE;
-    }
-    
-    printf("[RX] CURR=0x%02X, BNRY=0x%02X, scanning pages 0x%02X-0x%02X\n", 
-           current_page, boundary, next_read, current_page - 1);
-    
-    // If no new packets, return silently
-    if (next_read == current_page) {
-        return 0;  // Buffer empty
+// Returns the frame length, 0 if the ring is empty or -1 if a frame was
+// dropped. The 4-byte ring header is fetched once; the frame behind it is
+// read in one transfer, or two if it wraps at the end of the ring.
+int ne2000_receive_packet(uint8_t *buffer, uint16_t buffer_size) {
+    if (rx_overflow || (ne2000_read(NE2000_ISR) & ISR_OVW)) {
+        stats.rx_overflows++;
+        ne2000_rx_reset();
+        return 0;
     }
 
-    // Scan forward to find first non-empty page (skip up to 5 empty pages)
-    uint8_t next_packet_page = next_read;
-    int empty_pages_skipped = 0;
-    const int max_empty_pages = 5;
-    
-    while (empty_pages_skipped < max_empty_pages && next_packet_page != current_page) {
-        // Try to read header from this page
-        ne2000_write(NE2000_CR, 0x22);
-        ne2000_write(NE2000_RBCR0, 4);
-        ne2000_write(NE2000_RBCR1, 0);
-        ne2000_write(NE2000_RSAR0, 0);
-        ne2000_write(NE2000_RSAR1, next_packet_page);
-        ne2000_write(NE2000_CR, 0x0A);
-        
-        uint8_t test_header[4];
-        uint16_t w1 = inw(io_base + NE2000_DATA);
-        uint16_t w2 = inw(io_base + NE2000_DATA);
-        test_header[0] = w1 & 0xFF;
-        test_header[1] = (w1 >> 8) & 0xFF;
-        test_header[2] = w2 & 0xFF;
-        test_header[3] = (w2 >> 8) & 0xFF;
-        
-        int timeout = 10000;
-        while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-        ne2000_write(NE2000_ISR, ISR_RDC);
-        
-        // Check if page is empty (all zeros)
-        if (test_header[0] == 0 && test_header[1] == 0 && 
-            test_header[2] == 0 && test_header[3] == 0) {
-            empty_pages_skipped++;
-            next_packet_page++;
-            if (next_packet_page >= RX_STOP_PAGE) {
-                next_packet_page = RX_START_PAGE;
-            }
-            continue;
-        }
-        
-        // Found non-empty page!
-        if (empty_pages_skipped > 0) {
-            printf("[RX] Skipped %d empty pages, found data at 0x%02X\n", 
-                   empty_pages_skipped, next_packet_page);
-        }
-        break;
+    uint8_t page = ne2000_read(NE2000_BNRY) + 1;
+    if (page >= ring.rx_stop) {
+        page = ring.rx_start;
     }
-    
-    if (next_packet_page == current_page) {
+    if (page == ne2000_read_curr()) {
         return 0;
     }
 
-    // Now read the actual packet header from the non-empty page
-    ne2000_write(NE2000_CR, 0x22);              // Page 0, Start, NoDMA
-    ne2000_write(NE2000_RBCR0, 4);              // Read 4 bytes (header)
-    ne2000_write(NE2000_RBCR1, 0);
-    ne2000_write(NE2000_RSAR0, 0);              // Start at offset 0 in page
-    ne2000_write(NE2000_RSAR1, next_packet_page); // Page number
-    ne2000_write(NE2000_CR, 0x0A);              // Page 0, Start, Remote Read
-
-    // Read packet header (4 bytes) in word mode
     uint8_t header[4];
-    uint16_t word1 = inw(io_base + NE2000_DATA);
-    uint16_t word2 = inw(io_base + NE2000_DATA);
-    header[0] = word1 & 0xFF;
-    header[1] = (word1 >> 8) & 0xFF;
-    header[2] = word2 & 0xFF;
-    header[3] = (word2 >> 8) & 0xFF;
-
-    // Wait for Remote DMA to complete with timeout
-    int timeout = 10000;
-    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-    if (timeout <= 0) {
-        printf("[RX] Timeout waiting for DMA (header)\n");
+    if (!ne2000_pio_read((uint16_t)page << 8, header, sizeof(header))) {
+        stats.rx_errors++;
         return -1;
     }
-    ne2000_write(NE2000_ISR, ISR_RDC);  // Clear RDC flag
-
     uint8_t status = header[0];
     uint8_t next_page = header[1];
-    uint16_t packet_length = header[2] | (header[3] << 8);
-
-    printf("[RX] Page 0x%02X: status=0x%02X, next=0x%02X, len=%d\n", 
-           next_packet_page, status, next_page, packet_length);
-
-    // Show first 64 bytes of page for diagnosis
-    if (packet_length > 1518) {
-        uint8_t page_data[64];
-        ne2000_write(NE2000_CR, 0x22);
-        ne2000_write(NE2000_RBCR0, 64);
-        ne2000_write(NE2000_RBCR1, 0);
-        ne2000_write(NE2000_RSAR0, 0);
-        ne2000_write(NE2000_RSAR1, next_packet_page);
-        ne2000_write(NE2000_CR, 0x0A);
-        for (int i = 0; i < 64; i++) {
-            page_data[i] = inb(io_base + NE2000_DATA);
-        }
-        int timeout = 10000;
-        while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-        ne2000_write(NE2000_ISR, ISR_RDC);
-        print_hex_dump("[RX] Page content", page_data, 64);
-    }
-
-    // Check status byte for errors
-    // Bit 0 (0x01) should be set for valid packet
-    if (!(status & 0x01)) {
-        printf("[RX] Bad status, skipping page\n");
-        // Try to advance past bad packet if we have valid next_page
-        if (next_page >= RX_START_PAGE && next_page < RX_STOP_PAGE) {
-            uint8_t new_boundary = next_page - 1;
-            if (new_boundary < RX_START_PAGE) {
-                new_boundary = RX_STOP_PAGE - 1;
-            }
-            // CRITICAL: Switch to Page 0 before writing BNRY!
-            ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-            ne2000_write(NE2000_BNRY, new_boundary);
-        } else {
-            // Both status and next_page are bad - manual advance
-            ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-            ne2000_write(NE2000_BNRY, next_packet_page);
-        }
-        return -1;
-    }
-
-    // Validate next_page pointer
-    if (next_page < RX_START_PAGE || next_page >= RX_STOP_PAGE) {
-        printf("[RX] Invalid next_page: 0x%02X - advancing manually\n", next_page);
-        // Manually advance to next page since next_page is corrupt
-        uint8_t manual_next = next_packet_page + 1;
-        if (manual_next >= RX_STOP_PAGE) {
-            manual_next = RX_START_PAGE;
-        }
-        ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-        ne2000_write(NE2000_BNRY, next_packet_page);
-        return -1;
-    }
-
-    // Validate packet length
-    if (packet_length < 60 || packet_length > 1518) {
-        printf("[RX] Invalid length: %d - trying to recover packet\n", packet_length);
-        
-        // Header is corrupt, but there might be valid data after it
-        // Try reading 64 bytes starting from offset 0 (include the corrupt header)
-        uint16_t recovery_length = 64;
-        
-        ne2000_write(NE2000_CR, 0x22);
-        ne2000_write(NE2000_RBCR0, recovery_length & 0xFF);
-        ne2000_write(NE2000_RBCR1, (recovery_length >> 8) & 0xFF);
-        ne2000_write(NE2000_RSAR0, 0);  // Start at offset 0 (include header)
-        ne2000_write(NE2000_RSAR1, next_packet_page);
-        ne2000_write(NE2000_CR, 0x0A);
-        
-        for (uint16_t i = 0; i + 1 < recovery_length; i += 2) {
-            uint16_t word = inw(io_base + NE2000_DATA);
-            buffer[i] = word & 0xFF;
-            buffer[i + 1] = (word >> 8) & 0xFF;
-        }
-        if (recovery_length & 1) {
-            uint16_t word = inw(io_base + NE2000_DATA);
-            buffer[recovery_length - 1] = word & 0xFF;
-        }
-        
-        int timeout = 10000;
-        while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-        ne2000_write(NE2000_ISR, ISR_RDC);
-        
-        printf("[RX] Recovered %d bytes, analyzing...\n", recovery_length);
-        print_hex_dump("[RX] Recovered data", buffer, recovery_length);
-        
-        // Look for common EtherType values anywhere in the first part of the packet
-        // 0x0800 = IP, 0x0806 = ARP, 0x86DD = IPv6
-        int found_offset = -1;
-        for (int i = 0; i < 20 && i + 1 < recovery_length; i++) {
-            uint16_t val = (buffer[i] << 8) | buffer[i + 1];
-            if (val == 0x0800 || val == 0x0806 || val == 0x86DD) {
-                // Found potential EtherType - it should be at offset 12 from frame start
-                // So frame start would be at (i - 12)
-                int frame_start = i - 12;
-                printf("[RX] Found EtherType 0x%04X at byte %d (frame would start at byte %d)\n", 
-                       val, i, frame_start);
-                
-                // Accept frame start between -4 and +4 (since header might be 4 bytes)
-                if (frame_start >= -4 && frame_start < 10) {
-                    // Adjust for NE2000 header
-                    if (frame_start < 0) {
-                        printf("[RX] Frame seems to be missing %d bytes at start (NE2000 header issue)\n", -frame_start);
-                        found_offset = 4;  // Start after 4-byte NE2000 header
-                    } else {
-                        found_offset = frame_start;
-                    }
-                    printf("[RX] Using offset %d as frame start\n", found_offset);
-                    break;
-                }
-            }
-        }
-        
-        if (found_offset >= 0) {
-            printf("[RX] Extracting packet starting at offset %d!\n", found_offset);
-            
-            // Shift data to start of buffer if needed
-            if (found_offset > 0) {
-                for (int i = 0; i < recovery_length - found_offset; i++) {
-                    buffer[i] = buffer[i + found_offset];
-                }
-                printf("[RX] Shifted packet data by %d bytes\n", found_offset);
-                print_hex_dump("[RX] Aligned packet", buffer, 60);
-            }
-            
-            // Advance BNRY and return the recovered data
-            ne2000_write(NE2000_CR, 0x22);
-            ne2000_write(NE2000_BNRY, next_packet_page);
-            return recovery_length - found_offset;
-        }
-        
-        printf("[RX] No valid ethernet frame found\n");
-        ne2000_write(NE2000_CR, 0x22);
-        ne2000_write(NE2000_BNRY, next_packet_page);
-        return -1;
-    }
+    uint16_t length = (header[2] | (header[3] << 8)) - sizeof(header);
 
-    if (packet_length - 4 > buffer_size) {  // Subtract 4 byte CRC
-        printf("Received packet too large: %d bytes (buffer: %d)\n", packet_length - 4, buffer_size);
-        ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-        ne2000_write(NE2000_BNRY, next_page - 1);
+    if (!(status & RSR_PRX) || next_page < ring.rx_start || next_page >= ring.rx_stop ||
+        length < NE2000_FRAME_MIN || length > NE2000_RX_FRAME_MAX) {
+        stats.rx_errors++;
+        ne2000_rx_reset();
         return -1;
     }
 
-    // Setup Remote DMA to read packet data (excluding 4-byte header we already read)
-    uint16_t data_length = packet_length - 4;  // Subtract CRC
-    ne2000_write(NE2000_CR, 0x22);              // Page 0, Start, NoDMA
-    ne2000_write(NE2000_RBCR0, data_length & 0xFF);
-    ne2000_write(NE2000_RBCR1, (data_length >> 8) & 0xFF);
-    ne2000_write(NE2000_RSAR0, 4);              // Start after 4-byte header
-    ne2000_write(NE2000_RSAR1, next_packet_page);
-    ne2000_write(NE2000_CR, 0x0A);              // Page 0, Start, Remote Read
-
-    // Read packet data in word mode (16-bit transfers)
-    for (uint16_t i = 0; i + 1 < data_length; i += 2) {
-        uint16_t word = inw(io_base + NE2000_DATA);
-        buffer[i] = word & 0xFF;
-        buffer[i + 1] = (word >> 8) & 0xFF;
-    }
-    // Read last byte if length is odd
-    if (data_length & 1) {
-        uint16_t word = inw(io_base + NE2000_DATA);
-        buffer[data_length - 1] = word & 0xFF;
-    }
-
-    // Wait for Remote DMA to complete with timeout
-    timeout = 10000;
-    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-    if (timeout <= 0) {
-        printf("[RX] Timeout waiting for DMA (data)\n");
-        return -1;
+    int result = -1;
+    if (length > buffer_size) {
+        stats.rx_dropped++;
+    } else if (ne2000_ring_read(((uint16_t)page << 8) + sizeof(header), buffer, length)) {
+        stats.rx_packets++;
+        stats.rx_bytes += length;
+        result = length;
+    } else {
+        stats.rx_errors++;
     }
-    ne2000_write(NE2000_ISR, ISR_RDC);  // Clear RDC flag
 
-    // Update Boundary Register to next_page - 1
-    uint8_t new_boundary = next_page - 1;
-    if (new_boundary < RX_START_PAGE) {
-        new_boundary = RX_STOP_PAGE - 1;
+    // Hand the frame's pages back to the card
+    uint8_t boundary = next_page - 1;
+    if (boundary < ring.rx_start) {
+        boundary = ring.rx_stop - 1;
     }
-    // CRITICAL: Switch to Page 0 before writing BNRY!
-    ne2000_write(NE2000_CR, 0x22);  // Page 0, Start, NoDMA
-    ne2000_write(NE2000_BNRY, new_boundary);
+    ne2000_write(NE2000_BNRY, boundary);
+    return result;
+}
 
-    printf("Packet received, length: %d bytes (header status: 0x%02X)\n", data_length, status);
-    print_hex_dump("[RX] Packet data", buffer, data_length > 64 ? 64 : data_length);
-    
-    return data_length;
+void ne2000_get_stats(ne2000_stats_t *out) {
+    *out = stats;
 }
 
 void ne2000_validate_init() {
@@ -836,6 +610,67 @@ void ne2000_get_mac_address(uint8_t *mac) {
     }
 }
 
+// =============================================================================
+// netdev glue: the card has no DMA into host memory, so frames are copied
+// through the data port in both directions
+// =============================================================================
+static bool ne2000_netdev_xmit(netdev_t *dev, pbuf_t *p) {
+    (void)dev;
+    bool ok = ne2000_tx(p->data, p->len);
+    pbuf_free(p);
+    return ok;
+}
+
+static bool ne2000_netdev_tx_ready(netdev_t *dev) {
+    (void)dev;
+    ne2000_tx_reap();
+    return tx_pending < 0;
+}
+
+static int ne2000_netdev_poll(netdev_t *dev, int budget) {
+    // Start a frame left queued behind the last transmit
+    ne2000_tx_reap();
+
+    int done = 0;
+    for (int n = 0; n < budget; n++) {
+        pbuf_t *p = pbuf_alloc(0);
+        if (!p) {
+            break;
+        }
+        int len = ne2000_receive_packet(p->data, PBUF_BUF_SIZE);
+        if (len <= 0) {
+            pbuf_free(p);
+            if (len == 0) {
+                break;
+            }
+            continue;
+        }
+        p->len = (uint16_t)len;
+        netdev_rx(dev, p);
+        done++;
+    }
+    return done;
+}
+
+static void ne2000_netdev_get_mac(netdev_t *dev, uint8_t *mac) {
+    (void)dev;
+    ne2000_get_mac_address(mac);
+}
+
+static void ne2000_netdev_get_stats(netdev_t *dev, netdev_stats_t *st) {
+    *st = dev->stats;
+    st->rx_dropped = stats.rx_dropped + stats.rx_errors;
+    st->tx_dropped = stats.tx_errors;
+}
+
+static const netdev_ops_t ne2000_netdev_ops = {
+    .xmit = ne2000_netdev_xmit,
+    .poll = ne2000_netdev_poll,
+    .tx_ready = ne2000_netdev_tx_ready,
+    .get_mac = ne2000_netdev_get_mac,
+    .get_stats = ne2000_netdev_get_stats,
+};
+
 void ne2000_detect() {
     printf("Detecting NE2000 network card...\n");
     for (uint16_t bus = 0; bus < 256; ++bus) {
@@ -869,6 +704,9 @@ void ne2000_detect() {
                     ne2000_validate_init();
                     ne2000_print_mac_address();
 
+                    ne2000_netdev.ops = &ne2000_netdev_ops;
+                    ne2000_netdev.speed = 10;
+                    netdev_register(&ne2000_netdev);
                     return;
                 }
             }
@@ -876,157 +714,6 @@ void ne2000_detect() {
     }
 }
 
-void print_hex_dump(const char* label, const uint8_t *data, uint16_t length) {
-    printf("%s (%d bytes):\n", label, length);
-    
-    for (uint16_t i = 0; i < length; i += 16) {
-        // Print offset
-        printf("  %04X: ", i);
-        
-        // Print hex values
-        for (uint16_t j = 0; j < 16; j++) {
-            if (i + j < length) {
-                printf("%02X ", data[i + j]);
-            } else {
-                printf("   ");
-            }
-            // Extra space in the middle
-            if (j == 7) printf(" ");
-        }
-        
-        printf(" | ");
-        
-        // Print ASCII values
-        for (uint16_t j = 0; j < 16 && i + j < length; j++) {
-            uint8_t c = data[i + j];
-            if (c >= 32 && c <= 126) {
-                printf("%c", c);
-            } else {
-                printf(".");
-            }
-        }
-        
-        printf("\n");
-    }
-}
-
-void ne2000_dump_page(uint8_t page_num, uint16_t length) {
-    printf("[DIAG] Dumping NE2000 page 0x%02X (%d bytes):\n", page_num, length);
-    
-    uint8_t buffer[256];
-    if (length > 256) length = 256;
-    
-    // Setup Remote DMA to read from page
-    ne2000_write(NE2000_CR, 0x22);              // Page 0, Start, NoDMA
-    ne2000_write(NE2000_RBCR0, length & 0xFF);
-    ne2000_write(NE2000_RBCR1, (length >> 8) & 0xFF);
-    ne2000_write(NE2000_RSAR0, 0);              // Start at offset 0
-    ne2000_write(NE2000_RSAR1, page_num);       // Page number
-    ne2000_write(NE2000_CR, 0x0A);              // Start Remote Read
-    
-    // Read data
-    for (uint16_t i = 0; i < length; i++) {
-        buffer[i] = inb(io_base + NE2000_DATA);
-    }
-    
-    // Wait for DMA complete
-    int timeout = 10000;
-    while (!(ne2000_read(NE2000_ISR) & ISR_RDC) && timeout-- > 0);
-    ne2000_write(NE2000_ISR, ISR_RDC);
-    
-    print_hex_dump("Page content", buffer, length);
-}
-
-void print_packet(const uint8_t *packet, uint16_t length) {
-    printf("Packet data (%d bytes): ", length);
-    for (uint16_t i = 0; i < length; i++) {
-        printf("%02X ", packet[i]);
-    }
-    printf("\n");
-}
-
-void test_ne2000_loopback(uint16_t io_base) {
-    uint8_t test_packet[] = {
-        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // Destination MAC (Broadcast)
-        0x00, 0x01, 0x02, 0x03, 0x04, 0x05,  // Source MAC
-        0x08, 0x00,                          // EtherType (IPv4)
-        0x45, 0x00, 0x00, 0x54,              // Payload
-        0x00, 0x01, 0xDE, 0xAD, 0xBE, 0xEF
-    };
-
-    printf("Testing NE2000 packet transmission...\n");
-    
-    // Try promiscuous mode to receive all packets
-    ne2000_write(NE2000_RCR, 0x10);  // Promiscuous mode - accept all packets
-    printf("Set promiscuous mode (RCR=0x10)\n");
-    
-    // DISABLE loopback - send real packet to network
-    // Loopback mode doesn't work in QEMU emulation
-    ne2000_write(NE2000_TCR, 0x00);  // Normal transmission mode
-    printf("Loopback DISABLED - sending real packet to network\n");
-
-    // Clear any pending interrupts
-    ne2000_write(NE2000_ISR, 0xFF);
-    
-    // Read initial register values (CURR requires Page 1)
-    ne2000_write(NE2000_CR, 0x62);  // Page 1
-    uint8_t curr_before = ne2000_read(NE2000_CURR);
-    ne2000_write(NE2000_CR, 0x22);  // Page 0
-    uint8_t bnry_before = ne2000_read(NE2000_BNRY);
-    uint8_t isr_before = ne2000_read(NE2000_ISR);
-    printf("Before send - CURR: 0x%02X, BNRY: 0x%02X, ISR: 0x%02X\n",
-           curr_before, bnry_before, isr_before);
-
-    // Send the packet
-    ne2000_send_packet(test_packet, sizeof(test_packet));
-
-    // Longer delay to allow packet transmission and potential network response
-    printf("Waiting for network activity...\n");
-    for (volatile int i = 0; i < 1000000; i++);  // 10x longer delay
-
-    // Check ISR for any activity
-    uint8_t isr = ne2000_read(NE2000_ISR);
-    printf("ISR after send: 0x%02X ", isr);
-    if (isr & 0x01) printf("(PTX-PacketTX) ");
-    if (isr & 0x02) printf("(PRX-PacketRX) ");
-    if (isr & 0x04) printf("(RXE-RXError) ");
-    if (isr & 0x08) printf("(TXE-TXError) ");
-    if (isr & 0x10) printf("(OVW-Overwrite) ");
-    if (isr & 0x20) printf("(CNT-Counter) ");
-    if (isr & 0x40) printf("(RDC-RemoteDMA) ");
-    if (isr & 0x80) printf("(RST-Reset) ");
-    printf("\n");
-
-    // Check CURR and BNRY to see if packets arrived
-    ne2000_write(NE2000_CR, 0x62);  // Page 1
-    uint8_t curr = ne2000_read(NE2000_CURR);
-    ne2000_write(NE2000_CR, 0x22);  // Page 0
-    uint8_t bnry = ne2000_read(NE2000_BNRY);
-    printf("CURR: 0x%02X, BNRY: 0x%02X\n", curr, bnry);
-    
-    if (curr != bnry) {
-        printf("Buffer has data! (CURR != BNRY)\n");
-    } else {
-        printf("Buffer empty (CURR == BNRY)\n");
-    }
-
-    // Try to receive ANY packets (not just our test packet)
-    uint8_t received_packet[1500];
-    int received_length = ne2000_receive_packet(received_packet, sizeof(received_packet));
-
-    if (received_length > 0) {
-        printf("Received %d bytes from network:\n", received_length);
-        print_packet(received_packet, received_length);
-    } else {
-        printf("No packets received.\n");
-        printf("NOTE: QEMU NE2000 loopback emulation may not work.\n");
-        printf("Try: make run-net-dump to capture packets with Wireshark\n");
-    }
-
-    // Restore normal RCR (accept broadcasts)
-    ne2000_write(NE2000_RCR, 0x04);
-}
-
 void ne2000_test_send() {
     // Send a simple test packet (broadcast)
     uint8_t test_packet[] = {
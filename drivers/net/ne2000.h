@@ -4,6 +4,48 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// On-card packet memory of a 16-bit NE2000, in 256-byte pages
+#define NE2000_MEM_START_PAGE   0x40
+#define NE2000_MEM_STOP_PAGE    0x80
+
+// Each of the two transmit buffers holds one full frame
+#define NE2000_TX_PAGES         6
+
+// Default layout: both TX buffers at the bottom, the receive ring above.
+// Override at build time or with ne2000_set_ring_layout().
+#ifndef NE2000_TX_START_PAGE
+#define NE2000_TX_START_PAGE    NE2000_MEM_START_PAGE
+#endif
+#ifndef NE2000_RX_START_PAGE
+#define NE2000_RX_START_PAGE    (NE2000_TX_START_PAGE + 2 * NE2000_TX_PAGES)
+#endif
+#ifndef NE2000_RX_STOP_PAGE
+#define NE2000_RX_STOP_PAGE     NE2000_MEM_STOP_PAGE
+#endif
+
+// Smallest receive ring: one full frame plus the page CURR may not reach
+#define NE2000_RX_MIN_PAGES     8
+
+typedef struct {
+    uint8_t tx_start;           // First of 2 * NE2000_TX_PAGES transmit pages
+    uint8_t rx_start;           // PSTART
+    uint8_t rx_stop;            // PSTOP, exclusive
+} ne2000_ring_layout_t;
+
+typedef struct {
+    uint32_t rx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;        // Good frames that did not fit the caller's buffer
+    uint32_t rx_errors;         // Bad ring headers; each discards the ring
+    uint32_t rx_overflows;      // OVW: the ring filled up and was reset
+    uint32_t rx_wraps;          // Frames split at the end of the ring
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_queued;         // Frames loaded while the other buffer was on the wire
+    uint32_t tx_busy;           // Sends that had to wait for a free buffer
+    uint32_t tx_errors;         // Aborted transmits and remote DMA timeouts
+} ne2000_stats_t;
+
 // NE2000 driver functions
 void ne2000_detect();
 void ne2000_test_send();
@@ -13,5 +55,11 @@ void ne2000_print_mac_address();
 void ne2000_get_mac_address(uint8_t *mac);
 void ne2000_send_packet(uint8_t *data, uint16_t length);
 int ne2000_receive_packet(uint8_t *buffer, uint16_t buffer_size);
+void ne2000_get_stats(ne2000_stats_t *stats);
+
+// Moves the TX buffers and the receive ring. Frames still in the ring are
+// discarded. Returns false if the regions overlap or leave card memory.
+bool ne2000_set_ring_layout(const ne2000_ring_layout_t *layout);
+void ne2000_get_ring_layout(ne2000_ring_layout_t *layout);
 
 #endif // NE2000_H
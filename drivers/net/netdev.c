@@ -0,0 +1,158 @@
+// drivers/net/netdev.c
+// Interface table shared by the NIC drivers and the protocol stack.
+
+#include "drivers/net/netdev.h"
+#include "drivers/net/netstack.h"
+#include "drivers/net/pcap.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
+
+#include <stddef.h>
+
+static netdev_t* netdevs[NETDEV_MAX];
+static int netdev_num = 0;
+static netdev_t* default_dev = NULL;
+static int tx_hold_depth = 0;
+
+int netdev_register(netdev_t* dev) {
+    if (!dev || !dev->ops || !dev->ops->xmit || netdev_num >= NETDEV_MAX) {
+        return -1;
+    }
+
+    if (dev->name[0] == '\0') {
+        // eth0, eth1, ... in registration order
+        int eth = 0;
+        for (int i = 0; i < netdev_num; i++) {
+            if (strncmp(netdevs[i]->name, "eth", 3) == 0) {
+                eth++;
+            }
+        }
+        strcpy(dev->name, "eth0");
+        dev->name[3] = (char)('0' + eth);
+    }
+    if (dev->ops->get_mac) {
+        dev->ops->get_mac(dev, dev->mac);
+    }
+    if (dev->mtu == 0) {
+        dev->mtu = ETH_MAX_PAYLOAD;
+    }
+    memset(&dev->stats, 0, sizeof(dev->stats));
+
+    int index = netdev_num;
+    netdevs[netdev_num++] = dev;
+
+    // Prefer the fastest real NIC for default traffic
+    if (!(dev->features & NETDEV_F_LOOPBACK) &&
+        (!default_dev || dev->speed > default_dev->speed)) {
+        default_dev = dev;
+    }
+    netstack_route_flush();
+
+    char mac_s[18];
+    format_mac(dev->mac, mac_s);
+    printf("[NET] %s registered (MAC %s, %u Mbit/s)\n", dev->name, mac_s, dev->speed);
+    return index;
+}
+
+int netdev_count(void) {
+    return netdev_num;
+}
+
+netdev_t* netdev_get(int index) {
+    if (index < 0 || index >= netdev_num) {
+        return NULL;
+    }
+    return netdevs[index];
+}
+
+netdev_t* netdev_find(const char* name) {
+    for (int i = 0; i < netdev_num; i++) {
+        if (strcmp(netdevs[i]->name, name) == 0) {
+            return netdevs[i];
+        }
+    }
+    return NULL;
+}
+
+netdev_t* netdev_default(void) {
+    return default_dev;
+}
+
+void netdev_set_default(netdev_t* dev) {
+    if (dev) {
+        default_dev = dev;
+        netstack_route_flush();
+    }
+}
+
+void netdev_rx(netdev_t* dev, pbuf_t* p) {
+    dev->stats.rx_packets++;
+    dev->stats.rx_bytes += p->len;
+    pcap_capture(dev, p, PCAP_DIR_RX);
+    netstack_input(dev, p);
+}
+
+bool netdev_xmit(netdev_t* dev, pbuf_t* p) {
+    uint16_t len = p->len;
+    // Captured before xmit takes ownership of p
+    pcap_capture(dev, p, PCAP_DIR_TX);
+    if (!dev->ops->xmit(dev, p)) {
+        dev->stats.tx_dropped++;
+        return false;
+    }
+    dev->stats.tx_packets++;
+    dev->stats.tx_bytes += len;
+    if (tx_hold_depth == 0 && dev->ops->flush) {
+        dev->ops->flush(dev);
+    }
+    return true;
+}
+
+bool netdev_tx_ready(netdev_t* dev) {
+    return !dev->ops->tx_ready || dev->ops->tx_ready(dev);
+}
+
+void netdev_get_stats(netdev_t* dev, netdev_stats_t* stats) {
+    if (dev->ops->get_stats) {
+        dev->ops->get_stats(dev, stats);
+    } else {
+        *stats = dev->stats;
+    }
+}
+
+int netdev_get_hw_stats(netdev_t* dev, netdev_param_t* stats, int max) {
+    return dev->ops->get_hw_stats ? dev->ops->get_hw_stats(dev, stats, max) : 0;
+}
+
+int netdev_get_tunables(netdev_t* dev, netdev_param_t* params, int max) {
+    return dev->ops->get_tunables ? dev->ops->get_tunables(dev, params, max) : 0;
+}
+
+bool netdev_set_tunable(netdev_t* dev, const char* name, uint32_t value) {
+    return dev->ops->set_tunable && dev->ops->set_tunable(dev, name, value);
+}
+
+void netdev_tx_hold(void) {
+    tx_hold_depth++;
+}
+
+void netdev_tx_release(void) {
+    if (tx_hold_depth == 0 || --tx_hold_depth > 0) {
+        return;
+    }
+    for (int i = 0; i < netdev_num; i++) {
+        if (netdevs[i]->ops->flush) {
+            netdevs[i]->ops->flush(netdevs[i]);
+        }
+    }
+}
+
+int netdev_poll_all(int budget) {
+    int done = 0;
+    for (int i = 0; i < netdev_num; i++) {
+        if (netdevs[i]->ops->poll) {
+            done += netdevs[i]->ops->poll(netdevs[i], budget);
+        }
+    }
+    return done;
+}
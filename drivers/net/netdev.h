@@ -0,0 +1,108 @@
+#ifndef NETDEV_H
+#define NETDEV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drivers/net/pbuf.h"
+
+// =============================================================================
+// NETWORK DEVICES
+// Every NIC driver registers one netdev_t per interface it brings up. The
+// stack only talks to drivers through the ops table: it hands frames to
+// xmit and lets poll deliver received frames through netdev_rx. Each
+// interface carries its own IPv4 configuration and the stack routes by it.
+// =============================================================================
+
+#define NETDEV_MAX          4
+#define NETDEV_NAME_LEN     8
+
+// Feature flags
+#define NETDEV_F_TX_CSUM    0x01    // Hardware fills in IPv4/TCP/UDP checksums on transmit
+#define NETDEV_F_RX_CSUM    0x02    // Hardware verifies checksums on receive
+#define NETDEV_F_LOOPBACK   0x04    // No wire: frames are looped back, no ARP needed
+
+typedef struct netdev_stats {
+    uint32_t rx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_dropped;
+} netdev_stats_t;
+
+// A named driver counter ("ethtool -S") or tunable ("ifconfig eth0 itr 4000")
+typedef struct netdev_param {
+    const char* name;
+    uint64_t value;
+} netdev_param_t;
+
+struct netdev;
+
+typedef struct netdev_ops {
+    // Queue one frame for transmission. Takes ownership of p in every case;
+    // returns false if the frame was dropped.
+    bool (*xmit)(struct netdev* dev, pbuf_t* p);
+    // Publish frames queued by xmit to the hardware (optional)
+    void (*flush)(struct netdev* dev);
+    // Pass up to 'budget' received frames to netdev_rx; returns how many
+    int (*poll)(struct netdev* dev, int budget);
+    // False while the transmit queue is full (optional, default: always ready)
+    bool (*tx_ready)(struct netdev* dev);
+    void (*get_mac)(struct netdev* dev, uint8_t* mac);
+    // Driver counters (optional, default: the counters kept by netdev_rx/xmit)
+    void (*get_stats)(struct netdev* dev, netdev_stats_t* stats);
+    // Hardware counters (optional). Fills up to 'max' entries and returns
+    // how many there are.
+    int (*get_hw_stats)(struct netdev* dev, netdev_param_t* stats, int max);
+    // Driver tunables (optional), listed like the hardware counters. set
+    // returns false for an unknown name or a value out of range.
+    int (*get_tunables)(struct netdev* dev, netdev_param_t* params, int max);
+    bool (*set_tunable)(struct netdev* dev, const char* name, uint32_t value);
+} netdev_ops_t;
+
+typedef struct netdev {
+    char name[NETDEV_NAME_LEN];         // Assigned on registration ("eth0", ...) unless preset
+    const netdev_ops_t* ops;
+    void* priv;                         // Driver data
+    uint8_t mac[6];                     // Filled from ops->get_mac on registration
+    uint16_t mtu;
+    uint32_t features;                  // NETDEV_F_*
+    uint32_t speed;                     // Mbit/s; the fastest interface becomes the default
+
+    // IPv4 configuration (host order, 0 = unconfigured)
+    uint32_t ip_address;
+    uint32_t netmask;
+    uint32_t gateway;
+
+    netdev_stats_t stats;               // Frames seen by netdev_rx / netdev_xmit
+} netdev_t;
+
+// Registration; returns the interface index or -1 if the table is full
+int netdev_register(netdev_t* dev);
+int netdev_count(void);
+netdev_t* netdev_get(int index);
+netdev_t* netdev_find(const char* name);
+// Interface used for broadcasts and off-link traffic without a better match
+netdev_t* netdev_default(void);
+void netdev_set_default(netdev_t* dev);
+
+// Called by drivers from their poll op; consumes p
+void netdev_rx(netdev_t* dev, pbuf_t* p);
+// Consumes p. Inside a netdev_tx_hold section frames are only queued.
+bool netdev_xmit(netdev_t* dev, pbuf_t* p);
+bool netdev_tx_ready(netdev_t* dev);
+void netdev_get_stats(netdev_t* dev, netdev_stats_t* stats);
+// Return 0 / false when the driver has no hardware counters or tunables
+int netdev_get_hw_stats(netdev_t* dev, netdev_param_t* stats, int max);
+int netdev_get_tunables(netdev_t* dev, netdev_param_t* params, int max);
+bool netdev_set_tunable(netdev_t* dev, const char* name, uint32_t value);
+
+// TX batching: frames sent between hold and release reach each NIC with a
+// single flush when the outermost release runs
+void netdev_tx_hold(void);
+void netdev_tx_release(void);
+
+// Poll every interface; returns the number of frames received
+int netdev_poll_all(int budget);
+
+#endif // NETDEV_H
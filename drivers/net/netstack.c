@@ -1,10 +1,15 @@
 // drivers/net/netstack.c
-// NE2000-focused improved stack (header-aligned)
+// Ethernet/ARP/IPv4/ICMP/UDP on top of the registered netdev interfaces
 
 #include "drivers/net/netstack.h"
-#include "drivers/net/ne2000.h"
+#include "drivers/net/netdev.h"
+#include "drivers/net/pbuf.h"
+#include "drivers/net/checksum.h"
+#include "drivers/net/dns.h"
+#include "kernel/time/pit.h"
 #include "lib/libc/string.h"
 #include "lib/libc/stdio.h"
+#include "lib/libc/stdlib.h"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -14,17 +19,14 @@
 // =============================================================================
 // GLOBAL STATE
 // =============================================================================
-static network_config_t net_config;
+static uint32_t dns_server = 0;
+static netstack_stats_t stats;
 static arp_cache_entry_t arp_cache[ARP_CACHE_SIZE];
 static uint16_t ip_identification = 0;
+static bool netstack_ready = false;
+static uint32_t route_generation = 1;   // Bumped whenever a cached netstack_route_t may be stale
 
-// =============================================================================
-// Byte order: nur Deklarationen verwenden (Implementierung z.B. in ethernet.c)
-// =============================================================================
-extern uint16_t htons(uint16_t host_short);
-extern uint16_t ntohs(uint16_t net_short);
-extern uint32_t htonl(uint32_t host_long);
-extern uint32_t ntohl(uint32_t net_long);
+#define NETSTACK_POLL_BUDGET 32   // Frames handled per netstack_poll
 
 // =============================================================================
 // IPv4-Parser (von command.c genutzt)
@@ -112,139 +114,475 @@ void format_mac(uint8_t *mac, char *buffer) {
 // =============================================================================
 // Checksummen
 // =============================================================================
-static uint32_t checksum_accumulate(const void *data, size_t len, uint32_t sum) {
-    const uint8_t *p = (const uint8_t*)data;
-    while (len > 1) {
-        uint16_t w = ((uint16_t)p[0] << 8) | p[1];
-        sum += w;
-        p += 2; len -= 2;
-    }
-    if (len > 0) {
-        // letztes Byte als High-Byte addieren
-        sum += ((uint16_t)p[0]) << 8;
-    }
-    return sum;
+// Beide liefern Host-Order (Aufrufer speichern mit htons); die eigentliche
+// Summe rechnet csum_partial in checksum.c
+uint16_t ip_checksum(void *data, uint16_t length) {
+    return csum_bswap16(csum_fold(csum_partial(data, length, 0)));
 }
-static uint16_t fold_checksum(uint32_t sum) {
-    while (sum >> 16) sum = (sum & 0xFFFFu) + (sum >> 16);
-    return (uint16_t)(~sum);
+
+uint16_t ip_pseudo_checksum(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, const void *data, uint16_t length) {
+    uint32_t sum = csum_pseudo(src_ip, dst_ip, protocol, length);
+    return csum_bswap16(csum_fold(csum_partial(data, length, sum)));
 }
-uint16_t ip_checksum(void *data, uint16_t length) {
-    return fold_checksum(checksum_accumulate(data, length, 0));
+
+void netstack_csum_request(pbuf_t *p, const void *l4_header, uint16_t check_offset) {
+    p->flags = (uint8_t)((p->flags & ~PBUF_F_CSUM_VALID) | PBUF_F_CSUM_PARTIAL);
+    p->csum_start = (uint16_t)((const uint8_t *)l4_header - p->buffer);
+    p->csum_offset = check_offset;
 }
 
-static uint16_t udp_checksum(const ip_header_t* ip, const udp_header_t* udp, const uint8_t* payload, size_t len) {
-    struct pseudo {
-        uint32_t src, dst;
-        uint8_t  zero;
-        uint8_t  proto;
-        uint16_t udp_len;
-    } __attribute__((packed)) pseudo = {
-        ip->src_ip, ip->dst_ip, 0, IP_PROTOCOL_UDP, htons((uint16_t)(sizeof(*udp)+len))
-    };
-    uint32_t sum = 0;
-    sum = checksum_accumulate(&pseudo, sizeof(pseudo), sum);
-    sum = checksum_accumulate(udp, sizeof(*udp), sum);
-    sum = checksum_accumulate(payload, len, sum);
-    return fold_checksum(sum);
+// TCP/UDP-Prüfsumme vorbereiten: Pseudo-Header-Summe ins Feld, den Rest
+// rechnet die NIC (offload) oder hier die CPU
+static void ip_output_csum(pbuf_t *p, uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, bool offload) {
+    uint8_t *l4 = p->buffer + p->csum_start;
+    uint16_t l4_len = (uint16_t)(p->data + p->len - l4);
+    uint8_t *field = l4 + p->csum_offset;
+    uint16_t check = (uint16_t)~csum_fold(csum_pseudo(src_ip, dst_ip, protocol, l4_len));
+    memcpy(field, &check, 2);
+    if (offload) return;
+
+    check = csum_fold(csum_partial(l4, l4_len, 0));
+    if (check == 0 && protocol == IP_PROTOCOL_UDP) check = 0xFFFF;   // 0 hieße "keine Prüfsumme"
+    memcpy(field, &check, 2);
+    p->flags &= (uint8_t)~PBUF_F_CSUM_PARTIAL;
 }
 
 // =============================================================================
-// NIC-Wrapper (NE2000 only)
+// Routing
+// Längste Präfixe zuerst sortiertes Array: der erste Treffer ist der
+// Longest Prefix Match. Direkt angeschlossene Netze und Default-Routen über
+// die Gateways werden aus der Interface-Konfiguration erzeugt, statische
+// Routen kommen mit route_add dazu. Der letzte Treffer wird gemerkt, weil
+// Pakete meist in Folgen an dasselbe Ziel gehen.
 // =============================================================================
-static inline bool nic_send(uint8_t *p, size_t n) {
-    if (ne2000_is_initialized()) { ne2000_send_packet(p, (uint16_t)n); return true; }
-    printf("[ETH] No NIC initialized\n");
-    return false;
+static route_entry_t route_table[ROUTE_TABLE_SIZE];
+static int route_count = 0;
+static bool ip_forwarding = false;
+
+static struct {
+    uint32_t dst_ip;
+    int index;
+    uint32_t generation;         // 0 = empty
+} route_last;
+
+static void route_invalidate(void) {
+    if (++route_generation == 0) route_generation = 1;
+}
+
+static uint32_t route_mask(uint8_t prefix_len) {
+    return prefix_len ? 0xFFFFFFFFu << (32 - prefix_len) : 0;
+}
+
+static uint8_t route_prefix_len(uint32_t netmask) {
+    uint8_t len = 0;
+    while (len < 32 && (netmask & (0x80000000u >> len))) len++;
+    return len;
+}
+
+// Sort key: longer prefix first, then lower metric; a static route goes in
+// front of an interface route it ties with
+static bool route_before(const route_entry_t *a, const route_entry_t *b) {
+    if (a->prefix_len != b->prefix_len) return a->prefix_len > b->prefix_len;
+    if (a->metric != b->metric) return a->metric < b->metric;
+    return (a->flags & ROUTE_F_STATIC) && !(b->flags & ROUTE_F_STATIC);
 }
-static inline int nic_recv(uint8_t *buf, size_t cap) {
-    if (ne2000_is_initialized()) return ne2000_receive_packet(buf, (uint16_t)cap);
+
+// Static routes are unique per prefix, interface routes per prefix and interface
+static int route_find(uint32_t prefix, uint8_t prefix_len, uint8_t flags, const netdev_t *dev) {
+    for (int i = 0; i < route_count; ++i) {
+        const route_entry_t *r = &route_table[i];
+        if (r->prefix != prefix || r->prefix_len != prefix_len ||
+            (r->flags & ROUTE_F_STATIC) != (flags & ROUTE_F_STATIC)) continue;
+        if ((flags & ROUTE_F_STATIC) || r->dev == dev) return i;
+    }
     return -1;
 }
 
+static int route_insert(uint32_t prefix, uint8_t prefix_len, uint32_t gateway, netdev_t *dev, uint16_t metric, uint8_t flags) {
+    route_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.netmask = route_mask(prefix_len);
+    e.prefix = prefix & e.netmask;
+    e.prefix_len = prefix_len;
+    e.gateway = gateway;
+    e.dev = dev;
+    e.metric = metric;
+    e.flags = (uint8_t)(flags | (gateway ? ROUTE_F_GATEWAY : 0));
+
+    // Gleiches Präfix derselben Art wird ersetzt
+    int old = route_find(e.prefix, prefix_len, flags, dev);
+    if (old >= 0) {
+        memmove(&route_table[old], &route_table[old + 1], (route_count - old - 1) * sizeof(route_entry_t));
+        route_count--;
+    }
+    if (route_count >= ROUTE_TABLE_SIZE) return -1;
+
+    int pos = 0;
+    while (pos < route_count && !route_before(&e, &route_table[pos])) pos++;
+    memmove(&route_table[pos + 1], &route_table[pos], (route_count - pos) * sizeof(route_entry_t));
+    route_table[pos] = e;
+    route_count++;
+    return 0;
+}
+
+// Interface routes neu aus netdev_t erzeugen; statische bleiben stehen
+static void route_sync_interfaces(void) {
+    int kept = 0;
+    for (int i = 0; i < route_count; ++i) {
+        if (route_table[i].flags & ROUTE_F_STATIC) route_table[kept++] = route_table[i];
+    }
+    route_count = kept;
+
+    netdev_t *def = netdev_default();
+    for (int i = 0; i < netdev_count(); ++i) {
+        netdev_t *dev = netdev_get(i);
+        if (!dev->ip_address) continue;
+        route_insert(dev->ip_address, route_prefix_len(dev->netmask), 0, dev, 0, ROUTE_F_CONNECTED);
+        // Das Gateway des Default-Interfaces gewinnt, die anderen bleiben als Ersatz
+        if (dev->gateway) route_insert(0, 0, dev->gateway, dev, dev == def ? 0 : 1, 0);
+    }
+}
+
+static const route_entry_t *route_match(uint32_t dst_ip) {
+    if (route_last.generation == route_generation && route_last.dst_ip == dst_ip) {
+        return route_last.index >= 0 ? &route_table[route_last.index] : NULL;
+    }
+    int index = -1;
+    for (int i = 0; i < route_count; ++i) {
+        if ((dst_ip & route_table[i].netmask) == route_table[i].prefix) { index = i; break; }
+    }
+    route_last.dst_ip = dst_ip;
+    route_last.index = index;
+    route_last.generation = route_generation;
+    return index >= 0 ? &route_table[index] : NULL;
+}
+
+// Ohne Route geht es über das Default-Interface direkt an dst_ip
+static netdev_t *route_output(uint32_t dst_ip, uint32_t *next_hop) {
+    *next_hop = dst_ip;
+    if (dst_ip == 0xFFFFFFFFu) return netdev_default();
+
+    const route_entry_t *r = route_match(dst_ip);
+    if (!r) return netdev_default();
+    if (r->gateway) *next_hop = r->gateway;
+    return r->dev;
+}
+
+static bool is_local_address(uint32_t ip) {
+    for (int i = 0; i < netdev_count(); ++i) {
+        if (ip != 0 && netdev_get(i)->ip_address == ip) return true;
+    }
+    return false;
+}
+
+uint32_t netstack_source_address(uint32_t dst_ip) {
+    uint32_t hop;
+    netdev_t *dev = route_output(dst_ip, &hop);
+    return dev ? dev->ip_address : 0;
+}
+
+void netstack_route_flush(void) {
+    route_sync_interfaces();
+    route_invalidate();
+}
+
+bool netstack_tx_ready(uint32_t dst_ip) {
+    uint32_t hop;
+    netdev_t *dev = route_output(dst_ip, &hop);
+    return !dev || netdev_tx_ready(dev);
+}
+
+int route_add(uint32_t prefix, uint8_t prefix_len, uint32_t gateway, netdev_t *dev, uint16_t metric) {
+    if (prefix_len > 32) return -1;
+    if (!dev) {
+        // Interface über das Gateway finden; es muss direkt erreichbar sein
+        const route_entry_t *via = gateway ? route_match(gateway) : NULL;
+        if (!via || via->gateway) return -1;
+        dev = via->dev;
+    }
+    int r = route_insert(prefix, prefix_len, gateway, dev, metric, ROUTE_F_STATIC);
+    route_invalidate();
+    return r;
+}
+
+int route_del(uint32_t prefix, uint8_t prefix_len) {
+    if (prefix_len > 32) return -1;
+    int i = route_find(prefix & route_mask(prefix_len), prefix_len, ROUTE_F_STATIC, NULL);
+    if (i < 0) return -1;
+    memmove(&route_table[i], &route_table[i + 1], (route_count - i - 1) * sizeof(route_entry_t));
+    route_count--;
+    route_invalidate();
+    return 0;
+}
+
+const route_entry_t* route_lookup(uint32_t dst_ip) {
+    return route_match(dst_ip);
+}
+
+const route_entry_t* route_get_entry(int index) {
+    return index >= 0 && index < route_count ? &route_table[index] : NULL;
+}
+
+void netstack_set_forwarding(bool enable) {
+    ip_forwarding = enable;
+}
+
+bool netstack_get_forwarding(void) {
+    return ip_forwarding;
+}
+
+// Prepend the Ethernet header and send
+static bool eth_output(netdev_t *dev, pbuf_t *p, const uint8_t *dst_mac, uint16_t ethertype) {
+    eth_header_t *eth = (eth_header_t *)pbuf_push(p, sizeof(eth_header_t));
+    if (!eth) { pbuf_free(p); return false; }
+    memcpy(eth->dst_mac, dst_mac, ETH_ADDR_LEN);
+    memcpy(eth->src_mac, dev->mac, ETH_ADDR_LEN);
+    eth->ethertype = htons(ethertype);
+    return netdev_xmit(dev, p);
+}
+
+// Datagram (p at the IP header) larger than the MTU: copy it out in frames
+// of at most MTU bytes, payload cut at multiples of 8. A forwarded fragment
+// is split further, keeping its offset and MF. Consumes p.
+static bool ip_fragment(netdev_t *dev, pbuf_t *p, const uint8_t *dst_mac) {
+    const ip_header_t *ip = (const ip_header_t *)p->data;
+    const uint8_t *payload = p->data + sizeof(ip_header_t);
+    uint32_t payload_length = p->len - sizeof(ip_header_t);
+    uint32_t chunk = (dev->mtu - sizeof(ip_header_t)) & ~7u;
+    uint16_t ff = ntohs(ip->flags_fragment);
+    uint32_t base = (uint32_t)(ff & IP_FRAG_OFFSET_MASK) * 8;
+    bool ok = chunk > 0;
+
+    for (uint32_t offset = 0; ok && offset < payload_length; offset += chunk) {
+        uint16_t n = (uint16_t)(payload_length - offset < chunk ? payload_length - offset : chunk);
+        bool more = offset + n < payload_length || (ff & IP_FLAG_MF);
+        pbuf_t *f = pbuf_alloc(PBUF_HEADROOM);
+        if (!f) { ok = false; break; }
+        ip_header_t *fip = (ip_header_t *)pbuf_put(f, (uint16_t)(sizeof(ip_header_t) + n));
+        memcpy(fip, ip, sizeof(ip_header_t));
+        memcpy((uint8_t *)(fip + 1), payload + offset, n);
+        fip->total_length    = htons((uint16_t)(sizeof(ip_header_t) + n));
+        fip->flags_fragment  = htons((uint16_t)(((base + offset) >> 3) | (more ? IP_FLAG_MF : 0)));
+        fip->header_checksum = 0;
+        fip->header_checksum = csum_fold(csum_partial(fip, sizeof(ip_header_t), 0));
+        stats.ip_frags_out++;
+        ok = eth_output(dev, f, dst_mac, ETHERTYPE_IPV4);
+    }
+    pbuf_free(p);
+    return ok;
+}
+
+// IP packet to a resolved neighbour, fragmented if it exceeds the MTU
+static bool ip_xmit(netdev_t *dev, pbuf_t *p, const uint8_t *dst_mac) {
+    if (p->len > dev->mtu) return ip_fragment(dev, p, dst_mac);
+    return eth_output(dev, p, dst_mac, ETHERTYPE_IPV4);
+}
+
 // =============================================================================
-// ARP (öffentliche Signaturen aus Header)
+// ARP-Cache
+// Hashtabelle über die IP, verkettet über Indizes wie die TCP-Tabelle.
+// Unaufgelöste Einträge halten die ersten Pakete fest, bis die Antwort kommt;
+// arp_timer wiederholt Requests und lässt alte Einträge verfallen.
 // =============================================================================
-void arp_add_entry(uint32_t ip, uint8_t *mac) {
-    int slot = -1;
-    for (int i = 0; i < ARP_CACHE_SIZE; ++i) {
-        if (arp_cache[i].valid && arp_cache[i].ip == ip) { slot = i; break; }
-        if (!arp_cache[i].valid && slot < 0) slot = i;
+static int arp_hash[ARP_HASH_BUCKETS];
+static arp_stats_t arp_stats;
+static uint32_t arp_last_timer = 0;
+
+static inline uint32_t arp_hash_key(uint32_t ip) {
+    uint32_t h = ip ^ (ip >> 16);
+    h ^= h >> 8;
+    return h & (ARP_HASH_BUCKETS - 1);
+}
+
+static arp_cache_entry_t *arp_find(uint32_t ip) {
+    for (int idx = arp_hash[arp_hash_key(ip)]; idx >= 0; idx = arp_cache[idx].hash_next) {
+        if (arp_cache[idx].ip == ip) return &arp_cache[idx];
     }
-    if (slot < 0) slot = 0;
-    arp_cache[slot].ip = ip;
-    memcpy(arp_cache[slot].mac, mac, ETH_ADDR_LEN);
-    arp_cache[slot].valid = true;
-    arp_cache[slot].timestamp = 0;
-    char ip_s[16], mac_s[18];
-    format_ipv4(ip, ip_s); format_mac(mac, mac_s);
-    printf("[ARP] Add %s -> %s\n", ip_s, mac_s);
+    return NULL;
 }
 
-bool arp_lookup(uint32_t ip, uint8_t *mac_out) {
+static void arp_release(arp_cache_entry_t *e) {
+    int idx = (int)(e - arp_cache);
+    for (int *link = &arp_hash[arp_hash_key(e->ip)]; *link >= 0; link = &arp_cache[*link].hash_next) {
+        if (*link == idx) { *link = e->hash_next; break; }
+    }
+    if (e->state == ARP_STATE_RESOLVED) route_invalidate();
+    arp_stats.queue_drops += e->pending.count;
+    pbuf_queue_flush(&e->pending);
+    memset(e, 0, sizeof(*e));
+    e->hash_next = -1;
+}
+
+// Freier Slot, sonst wird der älteste Eintrag verdrängt
+static arp_cache_entry_t *arp_alloc(uint32_t ip, netdev_t *dev) {
+    arp_cache_entry_t *e = &arp_cache[0];
     for (int i = 0; i < ARP_CACHE_SIZE; ++i) {
-        if (arp_cache[i].valid && arp_cache[i].ip == ip) {
-            memcpy(mac_out, arp_cache[i].mac, ETH_ADDR_LEN);
-            return true;
-        }
+        arp_cache_entry_t *c = &arp_cache[i];
+        if (c->state == ARP_STATE_FREE) { e = c; break; }
+        if ((int32_t)(c->timestamp - e->timestamp) < 0) e = c;
     }
-    return false;
+    if (e->state != ARP_STATE_FREE) arp_release(e);
+
+    uint32_t b = arp_hash_key(ip);
+    e->ip = ip;
+    e->dev = dev;
+    e->state = ARP_STATE_PENDING;
+    e->timestamp = pit_get_ticks();
+    e->hash_next = arp_hash[b];
+    arp_hash[b] = (int)(e - arp_cache);
+    return e;
 }
 
-void arp_send_request(uint32_t target_ip) {
-    uint8_t packet[sizeof(eth_header_t) + sizeof(arp_packet_t)];
-    eth_header_t *eth = (eth_header_t *)packet;
-    arp_packet_t *arp = (arp_packet_t *)(packet + sizeof(eth_header_t));
+// MAC bekannt: Eintrag auffrischen und wartende Pakete abschicken
+static void arp_resolve_entry(arp_cache_entry_t *e, const uint8_t *mac) {
+    bool changed = e->state != ARP_STATE_RESOLVED || memcmp(e->mac, mac, ETH_ADDR_LEN) != 0;
+    memcpy(e->mac, mac, ETH_ADDR_LEN);
+    e->state = ARP_STATE_RESOLVED;
+    e->timestamp = pit_get_ticks();
+    e->retries = 0;
+    if (!changed) return;
+
+    route_invalidate();
+    arp_stats.updates++;
+
+    pbuf_t *p;
+    while ((p = pbuf_queue_pop(&e->pending)) != NULL) {
+        ip_xmit(e->dev, p, e->mac);
+    }
+}
+
+void arp_add_entry(uint32_t ip, uint8_t *mac) {
+    arp_cache_entry_t *e = arp_find(ip);
+    if (!e) {
+        uint32_t hop;
+        e = arp_alloc(ip, route_output(ip, &hop));
+    }
+    arp_resolve_entry(e, mac);
+}
+
+bool arp_lookup(uint32_t ip, uint8_t *mac_out) {
+    arp_cache_entry_t *e = arp_find(ip);
+    if (!e || e->state != ARP_STATE_RESOLVED) return false;
+    memcpy(mac_out, e->mac, ETH_ADDR_LEN);
+    return true;
+}
+
+const arp_cache_entry_t* arp_get_entry(int index) {
+    if (index < 0 || index >= ARP_CACHE_SIZE || arp_cache[index].state == ARP_STATE_FREE) return NULL;
+    return &arp_cache[index];
+}
+
+void arp_get_stats(arp_stats_t *out) {
+    *out = arp_stats;
+}
 
-    // Ethernet header (Broadcast)
-    memset(eth->dst_mac, 0xFF, ETH_ADDR_LEN);
-    memcpy(eth->src_mac, net_config.mac_address, ETH_ADDR_LEN);
-    eth->ethertype = htons(ETHERTYPE_ARP);
+static void arp_send(netdev_t *dev, uint16_t op, uint32_t target_ip, const uint8_t *target_mac, const uint8_t *eth_dst) {
+    pbuf_t *p = pbuf_alloc(PBUF_HEADROOM);
+    if (!p) return;
+    arp_packet_t *arp = (arp_packet_t *)pbuf_put(p, sizeof(arp_packet_t));
 
-    // ARP packet
     arp->hardware_type     = htons(ARP_HARDWARE_ETHERNET);
     arp->protocol_type     = htons(ARP_PROTOCOL_IPV4);
     arp->hardware_addr_len = ETH_ADDR_LEN;
     arp->protocol_addr_len = 4;
-    arp->operation         = htons(ARP_REQUEST);
+    arp->operation         = htons(op);
 
-    memcpy(arp->sender_mac, net_config.mac_address, ETH_ADDR_LEN);
-    uint32_t sip = net_config.ip_address ? net_config.ip_address : 0;
-    arp->sender_ip = htonl(sip);
-    memset(arp->target_mac, 0, ETH_ADDR_LEN);
+    memcpy(arp->sender_mac, dev->mac, ETH_ADDR_LEN);
+    arp->sender_ip = htonl(dev->ip_address);
+    memcpy(arp->target_mac, target_mac, ETH_ADDR_LEN);
     arp->target_ip = htonl(target_ip);
 
-    char ip_s[16]; format_ipv4(target_ip, ip_s);
-    printf("[ARP] Request for %s\n", ip_s);
-    nic_send(packet, sizeof(packet));
+    eth_output(dev, p, eth_dst, ETHERTYPE_ARP);
+}
+
+static const uint8_t eth_zero[ETH_ADDR_LEN] = {0};
+static const uint8_t eth_bcast[ETH_ADDR_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static void arp_request_on(netdev_t *dev, uint32_t target_ip) {
+    arp_stats.requests_out++;
+    arp_send(dev, ARP_REQUEST, target_ip, eth_zero, eth_bcast);
+}
+
+static void arp_reply_on(netdev_t *dev, uint32_t target_ip, const uint8_t *target_mac) {
+    arp_stats.replies_out++;
+    arp_send(dev, ARP_REPLY, target_ip, target_mac, target_mac);
+}
+
+// Gratuitous ARP: Request mit der eigenen Adresse als Ziel
+void arp_announce(netdev_t *dev) {
+    if (!dev->ip_address || (dev->features & NETDEV_F_LOOPBACK)) return;
+    arp_send(dev, ARP_REQUEST, dev->ip_address, eth_zero, eth_bcast);
+}
+
+void arp_send_request(uint32_t target_ip) {
+    uint32_t hop;
+    netdev_t *dev = route_output(target_ip, &hop);
+    if (dev) arp_request_on(dev, target_ip);
 }
 
 void arp_send_reply(uint32_t target_ip, uint8_t *target_mac) {
-    uint8_t packet[sizeof(eth_header_t) + sizeof(arp_packet_t)];
-    eth_header_t *eth = (eth_header_t *)packet;
-    arp_packet_t *arp = (arp_packet_t *)(packet + sizeof(eth_header_t));
+    uint32_t hop;
+    netdev_t *dev = route_output(target_ip, &hop);
+    if (dev) arp_reply_on(dev, target_ip, target_mac);
+}
 
-    memcpy(eth->dst_mac, target_mac, ETH_ADDR_LEN);
-    memcpy(eth->src_mac, net_config.mac_address, ETH_ADDR_LEN);
-    eth->ethertype = htons(ETHERTYPE_ARP);
+// Pending-Eintrag anlegen und einmal fragen; weitere Requests schickt arp_timer
+static arp_cache_entry_t *arp_start(netdev_t *dev, uint32_t hop) {
+    arp_cache_entry_t *e = arp_find(hop);
+    if (e) return e;
+    e = arp_alloc(hop, dev);
+    e->retries = 1;
+    arp_request_on(dev, hop);
+    return e;
+}
 
-    arp->hardware_type     = htons(ARP_HARDWARE_ETHERNET);
-    arp->protocol_type     = htons(ARP_PROTOCOL_IPV4);
-    arp->hardware_addr_len = ETH_ADDR_LEN;
-    arp->protocol_addr_len = 4;
-    arp->operation         = htons(ARP_REPLY);
+// Parks an IP packet until 'hop' answers. Consumes p.
+static void arp_queue(netdev_t *dev, uint32_t hop, pbuf_t *p) {
+    arp_cache_entry_t *e = arp_start(dev, hop);
+    if (e->pending.count >= ARP_QUEUE_LEN) {
+        pbuf_free(pbuf_queue_pop(&e->pending));
+        arp_stats.queue_drops++;
+    }
+    pbuf_queue_push(&e->pending, p);
+    arp_stats.queued++;
+}
 
-    memcpy(arp->sender_mac, net_config.mac_address, ETH_ADDR_LEN);
-    arp->sender_ip = htonl(net_config.ip_address);
-    memcpy(arp->target_mac, target_mac, ETH_ADDR_LEN);
-    arp->target_ip = htonl(target_ip);
+static void arp_timer(void) {
+    uint32_t now = pit_get_ticks();
+    if (now - arp_last_timer < ARP_TIMER_INTERVAL) return;
+    arp_last_timer = now;
 
-    char ip_s[16]; format_ipv4(target_ip, ip_s);
-    printf("[ARP] Reply to %s\n", ip_s);
-    nic_send(packet, sizeof(packet));
+    for (int i = 0; i < ARP_CACHE_SIZE; ++i) {
+        arp_cache_entry_t *e = &arp_cache[i];
+        if (e->state == ARP_STATE_PENDING && now - e->timestamp >= ARP_RETRY_INTERVAL) {
+            if (e->retries >= ARP_MAX_RETRIES || !e->dev) {
+                char ip_s[16]; format_ipv4(e->ip, ip_s);
+                printf("[ARP] %s unreachable\n", ip_s);
+                arp_stats.timeouts++;
+                arp_release(e);
+            } else {
+                e->retries++;
+                e->timestamp = now;
+                arp_request_on(e->dev, e->ip);
+            }
+        } else if (e->state == ARP_STATE_RESOLVED && now - e->timestamp >= ARP_ENTRY_TIMEOUT) {
+            arp_release(e);
+        }
+    }
 }
 
-static void handle_arp_packet(uint8_t *packet, uint16_t length) {
+static void arp_init(void) {
+    for (int i = 0; i < ARP_CACHE_SIZE; ++i) {
+        if (arp_cache[i].state != ARP_STATE_FREE) pbuf_queue_flush(&arp_cache[i].pending);
+    }
+    memset(arp_cache, 0, sizeof(arp_cache));
+    for (int i = 0; i < ARP_CACHE_SIZE; ++i) arp_cache[i].hash_next = -1;
+    for (int i = 0; i < ARP_HASH_BUCKETS; ++i) arp_hash[i] = -1;
+    memset(&arp_stats, 0, sizeof(arp_stats));
+    route_invalidate();
+}
+
+static void handle_arp_packet(netdev_t *dev, uint8_t *packet, uint16_t length) {
     if (length < sizeof(arp_packet_t)) return;
     arp_packet_t *arp = (arp_packet_t *)packet;
 
@@ -256,14 +594,36 @@ static void handle_arp_packet(uint8_t *packet, uint16_t length) {
     uint16_t op   = ntohs(arp->operation);
     uint32_t sip  = ntohl(arp->sender_ip);
     uint32_t tip  = ntohl(arp->target_ip);
+    bool for_us   = tip != 0 && tip == dev->ip_address;
+
+    if (sip != 0 && sip == tip) arp_stats.gratuitous++;
+    if (op == ARP_REPLY) arp_stats.replies_in++;
+    if (op == ARP_REQUEST && for_us) arp_stats.requests_in++;
+
+    // Jemand anderes beansprucht unsere Adresse
+    if (sip != 0 && sip == dev->ip_address) {
+        if (memcmp(arp->sender_mac, dev->mac, ETH_ADDR_LEN) != 0) {
+            char ip_s[16], mac_s[18];
+            format_ipv4(sip, ip_s); format_mac(arp->sender_mac, mac_s);
+            printf("[ARP] %s: address conflict, %s claimed by %s\n", dev->name, ip_s, mac_s);
+            arp_stats.conflicts++;
+        }
+        return;
+    }
 
-    arp_add_entry(sip, arp->sender_mac);
+    // RFC 826: bekannte Absender immer aktualisieren (auch per gratuitous
+    // ARP), neue Einträge nur anlegen, wenn die Anfrage uns galt
+    if (sip != 0) {
+        arp_cache_entry_t *e = arp_find(sip);
+        if (!e && for_us) e = arp_alloc(sip, dev);
+        if (e) {
+            if (!e->dev) e->dev = dev;
+            arp_resolve_entry(e, arp->sender_mac);
+        }
+    }
 
-    if (op == ARP_REQUEST && tip == net_config.ip_address) {
-        arp_send_reply(sip, arp->sender_mac);
-    } else if (op == ARP_REPLY) {
-        char ip_s[16]; format_ipv4(sip, ip_s);
-        printf("[ARP] Reply from %s\n", ip_s);
+    if (op == ARP_REQUEST && for_us) {
+        arp_reply_on(dev, sip, arp->sender_mac);
     }
 }
 
@@ -271,163 +631,220 @@ static void handle_arp_packet(uint8_t *packet, uint16_t length) {
 // IPv4/ICMP
 // =============================================================================
 void icmp_send_echo_reply(uint32_t dst_ip, uint16_t id, uint16_t seq, uint8_t *data, uint16_t data_len) {
-    uint8_t packet[1514] = {0};
-    eth_header_t  *eth  = (eth_header_t *)packet;
-    ip_header_t   *ip   = (ip_header_t  *)(packet + sizeof(eth_header_t));
-    icmp_header_t *icmp = (icmp_header_t *)(packet + sizeof(eth_header_t) + sizeof(ip_header_t));
-    uint8_t       *payload = packet + sizeof(eth_header_t) + sizeof(ip_header_t) + sizeof(icmp_header_t);
-
-    uint32_t next_hop = (((dst_ip & net_config.netmask) == (net_config.ip_address & net_config.netmask)) || dst_ip==0xFFFFFFFFu)
-                        ? dst_ip : net_config.gateway;
-
-    uint8_t dst_mac[ETH_ADDR_LEN];
-    if (dst_ip == 0xFFFFFFFFu) {
-        memset(dst_mac, 0xFF, ETH_ADDR_LEN);
-    } else if (!arp_lookup(next_hop, dst_mac)) {
-        printf("[ICMP] No ARP entry; send ARP first\n");
-        arp_send_request(next_hop);
-        return;
-    }
-
-    memcpy(eth->dst_mac, dst_mac, ETH_ADDR_LEN);
-    memcpy(eth->src_mac, net_config.mac_address, ETH_ADDR_LEN);
-    eth->ethertype = htons(ETHERTYPE_IPV4);
-
-    ip->version_ihl      = 0x45;
-    ip->tos              = 0;
-    ip->total_length     = htons((uint16_t)(sizeof(ip_header_t) + sizeof(icmp_header_t) + data_len));
-    ip->identification   = htons(ip_identification++);
-    ip->flags_fragment   = 0;
-    ip->ttl              = 64;
-    ip->protocol         = IP_PROTOCOL_ICMP;
-    ip->src_ip           = htonl(net_config.ip_address);
-    ip->dst_ip           = htonl(dst_ip);
-    ip->header_checksum  = 0;
-    ip->header_checksum  = ip_checksum(ip, sizeof(ip_header_t));
+    pbuf_t *p = pbuf_alloc(PBUF_HEADROOM);
+    if (!p) return;
+    icmp_header_t *icmp = (icmp_header_t *)pbuf_put(p, (uint16_t)(sizeof(icmp_header_t) + data_len));
+    if (!icmp) { pbuf_free(p); return; }
 
     icmp->type       = ICMP_ECHO_REPLY;
     icmp->code       = 0;
     icmp->identifier = htons(id);
     icmp->sequence   = htons(seq);
     icmp->checksum   = 0;
+    if (data && data_len) memcpy((uint8_t *)(icmp + 1), data, data_len);
+    icmp->checksum = htons(ip_checksum(icmp, p->len));
+    netstack_ip_output(dst_ip, IP_PROTOCOL_ICMP, p);
+}
 
-    if (data && data_len) memcpy(payload, data, data_len);
-    icmp->checksum = ip_checksum(icmp, (uint16_t)(sizeof(icmp_header_t) + data_len));
-
-    char dip[16]; format_ipv4(dst_ip, dip);
-    printf("[ICMP] Echo reply -> %s (id=%u, seq=%u)\n", dip, id, seq);
-    size_t total_len = sizeof(eth_header_t) + sizeof(ip_header_t) + sizeof(icmp_header_t) + data_len;
-    nic_send(packet, total_len);
+// Error about the datagram in 'orig' (at its IP header): its header and the
+// first 8 payload bytes go back to the sender (RFC 792). Nothing is sent
+// about ICMP errors or later fragments, and at most ICMP_ERROR_RATE per
+// second so a flood of expiring packets is not answered in kind.
+static void icmp_send_error(const pbuf_t *orig, uint8_t type, uint8_t code, uint16_t mtu) {
+    static uint32_t window_start = 0, sent = 0;
+    const ip_header_t *ip = (const ip_header_t *)orig->data;
+    uint16_t ihl = (uint16_t)IP_HEADER_LEN(ip);
+    if (ntohs(ip->flags_fragment) & IP_FRAG_OFFSET_MASK) return;
+    if (ip->protocol == IP_PROTOCOL_ICMP && orig->len > ihl &&
+        orig->data[ihl] != ICMP_ECHO_REQUEST && orig->data[ihl] != ICMP_ECHO_REPLY) return;
+
+    uint32_t now = pit_get_ticks();
+    if (now - window_start >= 1000) { window_start = now; sent = 0; }
+    if (sent >= ICMP_ERROR_RATE) return;
+    sent++;
+
+    uint16_t quote = orig->len < ihl + 8 ? orig->len : (uint16_t)(ihl + 8);
+    pbuf_t *p = pbuf_alloc(PBUF_HEADROOM);
+    if (!p) return;
+    icmp_header_t *icmp = (icmp_header_t *)pbuf_put(p, (uint16_t)(sizeof(icmp_header_t) + quote));
+    icmp->type       = type;
+    icmp->code       = code;
+    icmp->identifier = 0;
+    icmp->sequence   = htons(mtu);     // Next-hop MTU for ICMP_FRAG_NEEDED (RFC 1191), else unused
+    icmp->checksum   = 0;
+    memcpy((uint8_t *)(icmp + 1), ip, quote);
+    icmp->checksum = htons(ip_checksum(icmp, p->len));
+    stats.icmp_errors_out++;
+    netstack_ip_output(ntohl(ip->src_ip), IP_PROTOCOL_ICMP, p);
 }
 
-static void handle_icmp_packet(uint8_t *packet, uint16_t length, uint32_t src_ip) {
-    if (length < sizeof(icmp_header_t)) return;
-    icmp_header_t *icmp = (icmp_header_t *)packet;
-    uint8_t *data = packet + sizeof(icmp_header_t);
-    uint16_t dlen = length - sizeof(icmp_header_t);
+// Consumes p (positioned at the ICMP header)
+static void handle_icmp_packet(pbuf_t *p, uint32_t src_ip) {
+    if (p->len < sizeof(icmp_header_t)) { pbuf_free(p); return; }
+    icmp_header_t *icmp = (icmp_header_t *)p->data;
 
     if (icmp->type == ICMP_ECHO_REQUEST) {
-        char s[16]; format_ipv4(src_ip, s);
-        printf("[ICMP] Echo request from %s (id=%u, seq=%u)\n", s, ntohs(icmp->identifier), ntohs(icmp->sequence));
-        icmp_send_echo_reply(src_ip, ntohs(icmp->identifier), ntohs(icmp->sequence), data, dlen);
+        stats.icmp_echo_requests++;
+        // Turn the request into the reply in place; only the type word
+        // changes, so the checksum is patched instead of recomputed (RFC 1624)
+        uint16_t old_word, new_word;
+        memcpy(&old_word, icmp, 2);
+        icmp->type = ICMP_ECHO_REPLY;
+        memcpy(&new_word, icmp, 2);
+        icmp->checksum = csum_replace2(icmp->checksum, old_word, new_word);
+        netstack_ip_output(src_ip, IP_PROTOCOL_ICMP, p);
+        return;
     }
+    if (icmp->type == ICMP_ECHO_REPLY) stats.icmp_echo_replies++;
+    pbuf_free(p);
 }
 
 // =============================================================================
-// UDP low-level (für DHCP ausreichend)
+// IPv4 output
 // =============================================================================
-static int netstack_send_udp_low(uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, void *data, size_t len, bool with_checksum) {
-    if (sizeof(eth_header_t)+sizeof(ip_header_t)+sizeof(udp_header_t)+len > 1514) return -1;
-
-    uint8_t packet[1514] = {0};
-    uint8_t *ptr = packet;
+// Interface and next-hop MAC for dst_ip. rt->generation stays 0 while the
+// next hop is unresolved; rt->dev is NULL without a route.
+static void route_resolve(netstack_route_t *rt, uint32_t dst_ip) {
+    rt->generation = 0;
+    rt->dst_ip = dst_ip;
+    rt->dev = route_output(dst_ip, &rt->next_hop);
+    if (!rt->dev) return;
+
+    if (rt->dev->features & NETDEV_F_LOOPBACK) {
+        memcpy(rt->mac, rt->dev->mac, ETH_ADDR_LEN);
+    } else if (dst_ip == 0xFFFFFFFFu) {
+        memset(rt->mac, 0xFF, ETH_ADDR_LEN);
+    } else if (!arp_lookup(rt->next_hop, rt->mac)) {
+        return;
+    }
+    rt->generation = route_generation;
+}
 
-    uint32_t next_hop = (((dst_ip & net_config.netmask) == (net_config.ip_address & net_config.netmask)) || dst_ip==0xFFFFFFFFu)
-                        ? dst_ip : net_config.gateway;
+int netstack_ip_output(uint32_t dst_ip, uint8_t protocol, pbuf_t *p) {
+    netstack_route_t rt;
+    rt.generation = 0;
+    return netstack_ip_output_route(&rt, dst_ip, protocol, p);
+}
 
-    uint8_t dst_mac[6];
-    if (dst_ip == 0xFFFFFFFFu) {
-        memset(dst_mac, 0xFF, 6); // Broadcast
-    } else if (!arp_lookup(next_hop, dst_mac)) {
-        printf("[UDP] No ARP for next-hop; send ARP\n");
-        arp_send_request(next_hop);
-        return -1;
+int netstack_ip_output_route(netstack_route_t *rt, uint32_t dst_ip, uint8_t protocol, pbuf_t *p) {
+    if (rt->generation != route_generation || rt->dst_ip != dst_ip) {
+        route_resolve(rt, dst_ip);
+        if (!rt->dev) { pbuf_free(p); return -1; }
     }
+    netdev_t *dev = rt->dev;
+    uint16_t payload_length = p->len;
+    // Was nicht in die MTU passt, wird fragmentiert; die NIC kann dann keine Prüfsumme rechnen
+    bool fragment = sizeof(ip_header_t) + payload_length > dev->mtu;
+    ip_header_t *ip = payload_length <= IP_MAX_PAYLOAD ? (ip_header_t *)pbuf_push(p, sizeof(ip_header_t)) : NULL;
+    if (!ip) { pbuf_free(p); return -1; }
 
-    // Ethernet
-    memcpy(ptr, dst_mac, 6); ptr += 6;
-    memcpy(ptr, net_config.mac_address, 6); ptr += 6;
-    *(uint16_t*)ptr = htons(0x0800); ptr += 2; // IPv4
-
-    // IPv4
-    ip_header_t *ip = (ip_header_t*)ptr;
     ip->version_ihl      = 0x45;
     ip->tos              = 0;
-    ip->total_length     = htons((uint16_t)(sizeof(ip_header_t) + sizeof(udp_header_t) + len));
+    ip->total_length     = htons((uint16_t)(sizeof(ip_header_t) + payload_length));
     ip->identification   = htons(ip_identification++);
-    ip->flags_fragment   = 0;
+    ip->flags_fragment   = htons(fragment ? 0 : IP_FLAG_DF);   // DF: TCP segments are sized to the MTU
     ip->ttl              = 64;
-    ip->protocol         = IP_PROTOCOL_UDP;
-    ip->src_ip           = htonl(net_config.ip_address);
+    ip->protocol         = protocol;
+    ip->src_ip           = htonl(dev->ip_address);
     ip->dst_ip           = htonl(dst_ip);
     ip->header_checksum  = 0;
-    ip->header_checksum  = ip_checksum(ip, sizeof(ip_header_t));
-    ptr += sizeof(ip_header_t);
-
-    // UDP
-    udp_header_t *udp = (udp_header_t*)ptr;
-    udp->src_port = htons(src_port);
-    udp->dst_port = htons(dst_port);
-    udp->length   = htons((uint16_t)(sizeof(udp_header_t) + len));
-    udp->checksum = 0; // IPv4: optional
-    ptr += sizeof(udp_header_t);
-
-    memcpy(ptr, data, len);
-    if (with_checksum) {
-        udp->checksum = udp_checksum(ip, udp, (const uint8_t*)data, len);
+    ip->header_checksum  = csum_fold(csum_partial(ip, sizeof(ip_header_t), 0));
+    if (p->flags & PBUF_F_CSUM_PARTIAL) {
+        ip_output_csum(p, dev->ip_address, dst_ip, protocol, !fragment && (dev->features & NETDEV_F_TX_CSUM));
     }
-    ptr += len;
 
-    size_t total_len = (size_t)(ptr - packet);
-    return nic_send(packet, total_len) ? 0 : -1;
+    stats.ip_out++;
+    // Erstes Paket an einen unbekannten Nachbarn wartet im ARP-Cache (ganz, fragmentiert wird beim Senden)
+    if (rt->generation == 0) { arp_queue(dev, rt->next_hop, p); return 0; }
+    return ip_xmit(dev, p, rt->mac) ? 0 : -1;
 }
 
-static int netstack_receive_udp_low(uint16_t port, void *buffer, size_t buflen, uint32_t *src_ip, uint16_t *src_port, int poll_count) {
-    uint8_t pkt[1514];
-    for (int i = 0; i < poll_count; ++i) {
-        int len = nic_recv(pkt, sizeof(pkt));
-        if (len <= 0) continue;
-        if (len < 42) continue; // min eth+ip+udp
+bool netstack_resolve(uint32_t dst_ip, uint32_t timeout_ms) {
+    uint8_t mac[ETH_ADDR_LEN];
+    uint32_t hop;
+    netdev_t *dev = route_output(dst_ip, &hop);
+    if (!dev) return false;
+    if (dst_ip == 0xFFFFFFFFu || (dev->features & NETDEV_F_LOOPBACK) || arp_lookup(hop, mac)) return true;
+
+    arp_start(dev, hop);
+    uint32_t start = pit_get_ticks();
+    while (pit_get_ticks() - start < timeout_ms) {
+        netstack_poll();
+        if (arp_lookup(hop, mac)) return true;
+    }
+    return false;
+}
 
-        uint16_t ethertype = (uint16_t)(pkt[12] << 8 | pkt[13]);
-        if (ethertype != 0x0800) continue; // IPv4 only
+// =============================================================================
+// IPv4 forwarding (RFC 1812)
+// Pakete für fremde Adressen gehen, wenn eingeschaltet, über die Routing-
+// Tabelle wieder hinaus. Der pbuf wird nicht kopiert: TTL runter, die
+// Header-Prüfsumme nur nachgeführt (RFC 1624), neuer Ethernet-Header davor.
+// Route und Nachbar-MAC je Ziel liegen in einem kleinen Cache, sodass ein
+// bekannter Fluss weder die Tabelle noch den ARP-Cache durchsucht.
+// =============================================================================
+static netstack_route_t fwd_cache[ROUTE_FWD_CACHE_SIZE];
 
-        ip_header_t *ip = (ip_header_t *)(pkt + 14);
-        int ihl_bytes = (IP_IHL(ip)) * 4;
-        if (ihl_bytes < (int)sizeof(ip_header_t) || (14 + ihl_bytes) > len) continue;
-        if (ip->protocol != IP_PROTOCOL_UDP) continue;
+static inline netstack_route_t *fwd_cache_slot(uint32_t dst_ip) {
+    uint32_t h = dst_ip ^ (dst_ip >> 16);
+    h ^= h >> 8;
+    return &fwd_cache[h & (ROUTE_FWD_CACHE_SIZE - 1)];
+}
 
-        uint16_t saved = ip->header_checksum;
-        ip->header_checksum = 0;
-        uint16_t calc = ip_checksum(ip, (uint16_t)ihl_bytes);
-        ip->header_checksum = saved;
-        if (saved != calc) { printf("[IP] checksum mismatch\n"); continue; }
+// Adressen, die nie weitergeleitet werden: 0/8, 127/8, Multicast, Broadcast
+static bool ip_martian(uint32_t ip) {
+    uint8_t net = (uint8_t)(ip >> 24);
+    return net == 0 || net == 127 || net >= 224;
+}
 
-        udp_header_t *udp = (udp_header_t *)(pkt + 14 + ihl_bytes);
-        if (ntohs(udp->dst_port) != port) continue;
+// Consumes p (at the IP header, trimmed to the datagram)
+static void ip_forward(pbuf_t *p) {
+    ip_header_t *ip = (ip_header_t *)p->data;
+    uint32_t dst = ntohl(ip->dst_ip);
+    uint32_t src = ntohl(ip->src_ip);
+    if (ip_martian(dst) || ip_martian(src)) { stats.ip_fwd_dropped++; pbuf_free(p); return; }
+
+    netstack_route_t *rt = fwd_cache_slot(dst);
+    if (rt->generation != route_generation || rt->dst_ip != dst) {
+        const route_entry_t *r = route_match(dst);
+        if (!r || (r->dev->features & NETDEV_F_LOOPBACK)) {
+            stats.ip_fwd_no_route++;
+            icmp_send_error(p, ICMP_DEST_UNREACH, ICMP_NET_UNREACH, 0);
+            pbuf_free(p);
+            return;
+        }
+        // Directed broadcast to a connected network (RFC 2644)
+        if (!r->gateway && r->prefix_len < 31 && (dst | r->netmask) == 0xFFFFFFFFu) {
+            stats.ip_fwd_dropped++; pbuf_free(p); return;
+        }
+        route_resolve(rt, dst);
+    }
 
-        int udp_pl = (int)ntohs(udp->length) - (int)sizeof(udp_header_t);
-        int avail  = len - (14 + ihl_bytes + (int)sizeof(udp_header_t));
-        if (udp_pl < 0 || udp_pl > avail) continue;
+    if (ip->ttl <= 1) {
+        stats.ip_fwd_ttl_expired++;
+        icmp_send_error(p, ICMP_TIME_EXCEEDED, ICMP_TTL_EXCEEDED, 0);
+        pbuf_free(p);
+        return;
+    }
+    netdev_t *out = rt->dev;
+    if (p->len > out->mtu && ((ntohs(ip->flags_fragment) & IP_FLAG_DF) || IP_HEADER_LEN(ip) != sizeof(ip_header_t))) {
+        // ip_fragment copies a plain 20 byte header, so datagrams with options are not split
+        stats.ip_fwd_frag_needed++;
+        icmp_send_error(p, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED, out->mtu);
+        pbuf_free(p);
+        return;
+    }
 
-        if (src_ip)   *src_ip   = ntohl(ip->src_ip);
-        if (src_port) *src_port = ntohs(udp->src_port);
+    // TTL und Protokoll teilen sich ein 16-Bit-Wort der Prüfsumme
+    uint16_t old_word, new_word;
+    memcpy(&old_word, &ip->ttl, 2);
+    ip->ttl--;
+    memcpy(&new_word, &ip->ttl, 2);
+    ip->header_checksum = csum_replace2(ip->header_checksum, old_word, new_word);
 
-        int copy = udp_pl < (int)buflen ? udp_pl : (int)buflen;
-        memcpy(buffer, pkt + 14 + ihl_bytes + sizeof(udp_header_t), (size_t)copy);
-        return copy;
-    }
-    return -1;
+    stats.ip_forwarded++;
+    if (rt->generation == 0) { arp_queue(out, rt->next_hop, p); return; }
+    ip_xmit(out, p, rt->mac);
 }
 
 // =============================================================================
@@ -440,6 +857,7 @@ static int netstack_receive_udp_low(uint16_t port, void *buffer, size_t buflen,
 #define DHCP_REQUEST     3
 #define DHCP_ACK         5
 #define DHCP_MAGIC_COOKIE 0x63825363u
+#define DHCP_TIMEOUT_MS  3000
 
 #define DHO_MSG_TYPE   53
 #define DHO_PARAM_REQ  55
@@ -503,13 +921,13 @@ static bool dhcp_parse_opts(const struct dhcp_packet *pkt, uint32_t *server_id_n
     return true;
 }
 
-static bool dhcp_discover_request(uint32_t *out_ip, uint32_t *out_subnet, uint32_t *out_router, uint32_t *out_dns) {
+static bool dhcp_exchange(netdev_t *dev, int sock, uint32_t *out_ip, uint32_t *out_subnet, uint32_t *out_router, uint32_t *out_dns) {
     struct dhcp_packet pkt; memset(&pkt, 0, sizeof(pkt));
     pkt.op    = 1; pkt.htype = 1; pkt.hlen = 6; pkt.hops = 0;
     pkt.xid   = rng32();
     pkt.secs  = 0;
     pkt.flags = htons(0x8000); // Broadcast-Antwort erwünscht
-    memcpy(pkt.chaddr, net_config.mac_address, 6);
+    memcpy(pkt.chaddr, dev->mac, 6);
 
     uint8_t *opt = pkt.options;
     uint32_t mc = htonl(DHCP_MAGIC_COOKIE);
@@ -520,13 +938,13 @@ static bool dhcp_discover_request(uint32_t *out_ip, uint32_t *out_subnet, uint32
     *opt++ = DHO_END;
 
     printf("[DHCP] DISCOVER xid=0x%08x\n", (unsigned)pkt.xid);
-    if (netstack_send_udp_low(0xFFFFFFFFu, DHCP_CLIENT_PORT, DHCP_SERVER_PORT, &pkt, sizeof(pkt), false) != 0) {
+    if (udp_sendto(sock, 0xFFFFFFFFu, DHCP_SERVER_PORT, (uint8_t *)&pkt, sizeof(pkt)) < 0) {
         printf("[DHCP] send DISCOVER failed\n");
         return false;
     }
 
     struct dhcp_packet offer; uint32_t sip = 0; uint16_t sport = 0;
-    int r = netstack_receive_udp_low(DHCP_CLIENT_PORT, &offer, sizeof(offer), &sip, &sport, 512);
+    int r = udp_recvfrom(sock, &offer, sizeof(offer), &sip, &sport, DHCP_TIMEOUT_MS);
     if (r <= 0) { printf("[DHCP] no OFFER\n"); return false; }
     if (offer.op != 2 || offer.xid != pkt.xid) { printf("[DHCP] OFFER mismatch\n"); return false; }
 
@@ -539,7 +957,7 @@ static bool dhcp_discover_request(uint32_t *out_ip, uint32_t *out_subnet, uint32
 
     struct dhcp_packet reqpkt; memset(&reqpkt, 0, sizeof(reqpkt));
     reqpkt.op=1; reqpkt.htype=1; reqpkt.hlen=6; reqpkt.xid=pkt.xid; reqpkt.flags=htons(0x8000);
-    memcpy(reqpkt.chaddr, net_config.mac_address, 6);
+    memcpy(reqpkt.chaddr, dev->mac, 6);
     opt = reqpkt.options;
     memcpy(opt, &mc, 4); opt += 4;
     opt = dhcp_opt_put_u8 (opt, DHO_MSG_TYPE, DHCP_REQUEST);
@@ -552,12 +970,12 @@ static bool dhcp_discover_request(uint32_t *out_ip, uint32_t *out_subnet, uint32
     *opt++ = DHO_END;
 
     printf("[DHCP] REQUEST for offered IP\n");
-    if (netstack_send_udp_low(0xFFFFFFFFu, DHCP_CLIENT_PORT, DHCP_SERVER_PORT, &reqpkt, sizeof(reqpkt), false) != 0) {
+    if (udp_sendto(sock, 0xFFFFFFFFu, DHCP_SERVER_PORT, (uint8_t *)&reqpkt, sizeof(reqpkt)) < 0) {
         printf("[DHCP] send REQUEST failed\n");
         return false;
     }
 
-    struct dhcp_packet ack; r = netstack_receive_udp_low(DHCP_CLIENT_PORT, &ack, sizeof(ack), &sip, &sport, 512);
+    struct dhcp_packet ack; r = udp_recvfrom(sock, &ack, sizeof(ack), &sip, &sport, DHCP_TIMEOUT_MS);
     if (r <= 0 || ack.xid != pkt.xid) { printf("[DHCP] no ACK\n"); return false; }
     mtype = 0; sid_n=mask_n=gw_n=dns_n=0;
     if (!dhcp_parse_opts(&ack, &sid_n, &mask_n, &gw_n, &dns_n, &mtype) || mtype != DHCP_ACK) {
@@ -571,172 +989,341 @@ static bool dhcp_discover_request(uint32_t *out_ip, uint32_t *out_subnet, uint32
     return true;
 }
 
+static bool dhcp_discover_request(netdev_t *dev, uint32_t *out_ip, uint32_t *out_subnet, uint32_t *out_router, uint32_t *out_dns) {
+    int sock = udp_open(DHCP_CLIENT_PORT);
+    if (sock < 0) { printf("[DHCP] port %u busy\n", DHCP_CLIENT_PORT); return false; }
+    bool ok = dhcp_exchange(dev, sock, out_ip, out_subnet, out_router, out_dns);
+    udp_close(sock);
+    return ok;
+}
+
+// =============================================================================
+// IPv4 Reassembly (RFC 815)
+// Fragmente werden gleich in den großen pbuf des Datagramms kopiert und
+// freigegeben, damit sie keine RX-Puffer blockieren. Offen sind nur noch
+// die Lücken in der Hole-Liste.
+// =============================================================================
+typedef struct {
+    uint16_t first;              // Missing payload bytes first..last (inclusive)
+    uint16_t last;
+} ip_hole_t;
+
+typedef struct {
+    bool used;
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t id;
+    uint8_t protocol;
+    uint8_t hole_count;
+    uint32_t end;                // Highest payload byte received + 1
+    bool last_seen;              // Fragment without MF arrived; 'end' is the datagram length
+    uint32_t timestamp;          // PIT ms of the first fragment
+    pbuf_t *p;                   // Payload collects at PBUF_HEADROOM
+    ip_hole_t holes[IP_REASS_MAX_HOLES];
+} ip_reass_t;
+
+static ip_reass_t ip_reass[IP_REASS_SLOTS];
+
+static void ip_reass_release(ip_reass_t *r) {
+    pbuf_free(r->p);
+    memset(r, 0, sizeof(*r));
+}
+
+static ip_reass_t *ip_reass_find(uint32_t src, uint32_t dst, uint16_t id, uint8_t protocol) {
+    ip_reass_t *victim = &ip_reass[0];
+    for (int i = 0; i < IP_REASS_SLOTS; ++i) {
+        ip_reass_t *r = &ip_reass[i];
+        if (r->used && r->src_ip == src && r->dst_ip == dst && r->id == id && r->protocol == protocol) return r;
+    }
+    // Neues Datagramm: freier Slot, sonst das älteste verdrängen
+    for (int i = 0; i < IP_REASS_SLOTS; ++i) {
+        ip_reass_t *r = &ip_reass[i];
+        if (!r->used) { victim = r; break; }
+        if ((int32_t)(r->timestamp - victim->timestamp) < 0) victim = r;
+    }
+    if (victim->used) { stats.ip_reass_timeouts++; ip_reass_release(victim); }
+
+    victim->p = pbuf_alloc_len(PBUF_HEADROOM, IP_MAX_PAYLOAD);
+    if (!victim->p) return NULL;
+    victim->used = true;
+    victim->src_ip = src;
+    victim->dst_ip = dst;
+    victim->id = id;
+    victim->protocol = protocol;
+    victim->timestamp = pit_get_ticks();
+    victim->holes[0].first = 0;
+    victim->holes[0].last = 0xFFFF;      // Bis zum letzten Fragment offen
+    victim->hole_count = 1;
+    return victim;
+}
+
+// Fragment [first, last] aus der Hole-Liste streichen
+static bool ip_reass_fill(ip_reass_t *r, uint16_t first, uint16_t last, bool more) {
+    ip_hole_t holes[IP_REASS_MAX_HOLES + 1];  // Ein Loch kann sich in zwei teilen
+    int count = 0;
+    for (int i = 0; i < r->hole_count; ++i) {
+        ip_hole_t h = r->holes[i];
+        if (!more && h.first > last) continue;              // Hinter dem Ende des Datagramms
+        if (last < h.first || first > h.last) { holes[count++] = h; continue; }
+        if (first > h.first) {
+            holes[count].first = h.first;
+            holes[count++].last = (uint16_t)(first - 1);
+        }
+        if (last < h.last && more) {
+            holes[count].first = (uint16_t)(last + 1);
+            holes[count++].last = h.last;
+        }
+    }
+    if (count > IP_REASS_MAX_HOLES) return false;
+    memcpy(r->holes, holes, (uint16_t)(count * sizeof(ip_hole_t)));
+    r->hole_count = (uint8_t)count;
+    return true;
+}
+
+// Takes a fragment positioned at its payload. Returns the whole datagram
+// (payload only) once its last gap is filled, otherwise NULL.
+static pbuf_t *ip_reass_input(uint32_t src, uint32_t dst, uint16_t id, uint8_t protocol, uint16_t ff, pbuf_t *p) {
+    stats.ip_frags_in++;
+    uint32_t first = (uint32_t)(ff & IP_FRAG_OFFSET_MASK) * 8;
+    uint32_t end = first + p->len;
+    bool more = (ff & IP_FLAG_MF) != 0;
+    // Nur das letzte Fragment darf eine Länge haben, die kein Vielfaches von 8 ist
+    if (p->len == 0 || end > IP_MAX_PAYLOAD || (more && (p->len & 7))) {
+        stats.ip_reass_drops++; pbuf_free(p); return NULL;
+    }
+
+    ip_reass_t *r = ip_reass_find(src, dst, id, protocol);
+    if (!r) { stats.ip_reass_drops++; pbuf_free(p); return NULL; }
+
+    // Widerspricht das Fragment der schon bekannten Länge, ist das Datagramm kaputt
+    if ((r->last_seen && end > r->end) || (!more && (r->last_seen ? end != r->end : end < r->end)) ||
+        !ip_reass_fill(r, (uint16_t)first, (uint16_t)(end - 1), more)) {
+        stats.ip_reass_drops++;
+        ip_reass_release(r);
+        pbuf_free(p);
+        return NULL;
+    }
+    memcpy(r->p->data + first, p->data, p->len);
+    pbuf_free(p);
+    if (end > r->end) r->end = end;
+    if (!more) r->last_seen = true;
+    if (r->hole_count) return NULL;
+
+    pbuf_t *whole = r->p;
+    pbuf_put(whole, (uint16_t)r->end);
+    r->p = NULL;
+    ip_reass_release(r);
+    stats.ip_reassembled++;
+    return whole;
+}
+
+static void ip_reass_timer(void) {
+    uint32_t now = pit_get_ticks();
+    for (int i = 0; i < IP_REASS_SLOTS; ++i) {
+        if (ip_reass[i].used && now - ip_reass[i].timestamp >= IP_REASS_TIMEOUT) {
+            stats.ip_reass_timeouts++;
+            ip_reass_release(&ip_reass[i]);
+        }
+    }
+}
+
+static void ip_reass_init(void) {
+    for (int i = 0; i < IP_REASS_SLOTS; ++i) {
+        if (ip_reass[i].used) ip_reass_release(&ip_reass[i]);
+    }
+}
+
 // =============================================================================
 // IP/ETH Demux
 // =============================================================================
-static void handle_ip_packet(uint8_t *packet, uint16_t length) {
-    if (length < sizeof(ip_header_t)) return;
-    ip_header_t *ip = (ip_header_t *)packet;
+// Consumes p (positioned at the IP header). l2_bcast: the frame was sent to
+// the Ethernet broadcast address, so it is never forwarded.
+static void handle_ip_packet(netdev_t *dev, pbuf_t *p, bool l2_bcast) {
+    stats.ip_in++;
+    if (p->len < sizeof(ip_header_t)) { stats.ip_dropped++; pbuf_free(p); return; }
+    ip_header_t *ip = (ip_header_t *)p->data;
 
     int ihl_bytes = (IP_IHL(ip)) * 4;
-    if (ihl_bytes < (int)sizeof(ip_header_t) || ihl_bytes > (int)length) return;
+    if (ihl_bytes < (int)sizeof(ip_header_t) || ihl_bytes > (int)p->len) { stats.ip_dropped++; pbuf_free(p); return; }
 
-    uint16_t saved = ip->header_checksum;
-    ip->header_checksum = 0;
-    uint16_t calc = ip_checksum(ip, (uint16_t)ihl_bytes);
-    ip->header_checksum = saved;
-    if (saved != calc) { printf("[IP] checksum mismatch -> drop\n"); return; }
+    // Summing a valid header including its checksum field gives zero
+    if (ip_checksum(ip, (uint16_t)ihl_bytes) != 0) { stats.ip_bad_checksum++; stats.ip_dropped++; pbuf_free(p); return; }
 
     uint32_t dst = ntohl(ip->dst_ip);
-    if (dst != net_config.ip_address && dst != 0xFFFFFFFFu) return;
+    uint32_t src = ntohl(ip->src_ip);
+    uint16_t total = ntohs(ip->total_length);
+    if (total < ihl_bytes || total > p->len) { stats.ip_dropped++; pbuf_free(p); return; }
+
+    // Über lo ist jede 127/8-Adresse lokal
+    bool local = is_local_address(dst) || dst == 0xFFFFFFFFu || (dev->features & NETDEV_F_LOOPBACK);
+    if (!local) {
+        if (!ip_forwarding || l2_bcast) { stats.ip_dropped++; pbuf_free(p); return; }
+        pbuf_trim(p, total);
+        ip_forward(p);
+        return;
+    }
 
+    // Strip Ethernet padding and the IP header; the payload stays where it is
+    uint8_t protocol = ip->protocol;
     uint16_t ff = ntohs(ip->flags_fragment);
-    if (ff & 0x3FFF) { printf("[IP] fragment -> drop\n"); return; }
+    uint16_t id = ntohs(ip->identification);
+    pbuf_trim(p, total);
+    pbuf_pull(p, (uint16_t)ihl_bytes);
 
-    uint8_t *payload = (uint8_t*)ip + ihl_bytes;
-    uint16_t payload_len = (uint16_t)(ntohs(ip->total_length) - ihl_bytes);
+    if (ff & (IP_FLAG_MF | IP_FRAG_OFFSET_MASK)) {
+        p = ip_reass_input(src, dst, id, protocol, ff, p);
+        if (!p) return;
+    }
 
-    switch (ip->protocol) {
+    switch (protocol) {
         case IP_PROTOCOL_ICMP:
-            handle_icmp_packet(payload, payload_len, ntohl(ip->src_ip));
+            handle_icmp_packet(p, src);
+            break;
+        case IP_PROTOCOL_TCP:
+            tcp_input(src, dst, p);
             break;
         case IP_PROTOCOL_UDP:
-            // UDP wird über netstack_receive_udp_low konsumiert
+            stats.udp_in++;
+            udp_input(src, dst, p);
             break;
         default:
-            printf("[IP] proto=%u not handled\n", ip->protocol);
+            stats.ip_unknown_proto++;
+            pbuf_free(p);
             break;
     }
 }
 
-void netstack_process_packet(uint8_t *packet, uint16_t length) {
-    if (length < sizeof(eth_header_t)) return;
-    eth_header_t *eth = (eth_header_t *)packet;
+int netstack_poll(void) {
+    if (!netstack_ready) return 0;
+    // Replies generated while draining RX leave in one TX batch
+    netdev_tx_hold();
+    int frames = netdev_poll_all(NETSTACK_POLL_BUDGET);
+    arp_timer();
+    ip_reass_timer();
+    tcp_timer();
+    netdev_tx_release();
+    return frames;
+}
+
+void netstack_input(netdev_t *dev, pbuf_t *p) {
+    if (p->len < sizeof(eth_header_t)) { pbuf_free(p); return; }
+    eth_header_t *eth = (eth_header_t *)p->data;
     uint16_t type = ntohs(eth->ethertype);
-    uint8_t *payload = packet + sizeof(eth_header_t);
-    uint16_t plen = length - sizeof(eth_header_t);
 
     // nur für uns / Broadcast
     bool is_bcast = true;
     for (int i=0;i<6;++i) if (eth->dst_mac[i] != 0xFF) { is_bcast=false; break; }
-    if (!is_bcast && memcmp(eth->dst_mac, net_config.mac_address, ETH_ADDR_LEN)!=0) {
+    if (!is_bcast && memcmp(eth->dst_mac, dev->mac, ETH_ADDR_LEN)!=0) {
+        pbuf_free(p);
         return;
     }
 
+    pbuf_pull(p, sizeof(eth_header_t));
     switch (type) {
-        case ETHERTYPE_ARP:  handle_arp_packet(payload, plen); break;
-        case ETHERTYPE_IPV4: handle_ip_packet(payload, plen);  break;
-        default: break;
+        case ETHERTYPE_ARP:  handle_arp_packet(dev, p->data, p->len); pbuf_free(p); break;
+        case ETHERTYPE_IPV4: handle_ip_packet(dev, p, is_bcast); break;
+        default: pbuf_free(p); break;
     }
 }
 
+// Entry point for callers holding a plain buffer (shell diagnostics)
+void netstack_process_packet(uint8_t *packet, uint16_t length) {
+    netdev_t *dev = netdev_default();
+    if (!dev || length > PBUF_BUF_SIZE) return;
+    pbuf_t *p = pbuf_alloc(0);
+    if (!p) return;
+    memcpy(pbuf_put(p, length), packet, length);
+    netstack_input(dev, p);
+}
+
 // =============================================================================
 // Öffentliche API
 // =============================================================================
 void netstack_init(void) {
     printf("[NET] init...\n");
-    for (int i = 0; i < ARP_CACHE_SIZE; ++i) arp_cache[i].valid = false;
-
-    if (ne2000_is_initialized()) {
-        ne2000_get_mac_address(net_config.mac_address);
-    } else {
-        memset(net_config.mac_address, 0, ETH_ADDR_LEN);
-    }
-
-    net_config.ip_address = 0;
-    net_config.netmask    = 0;
-    net_config.gateway    = 0;
-    net_config.dns_server = 0;
+    arp_init();
+    ip_reass_init();
+    tcp_init();
+    udp_init();
+    dns_init();
+    netstack_ready = true;
+
+    dns_server = 0;
+    printf("[NET] %d interface(s), default %s\n", netdev_count(),
+           netdev_default() ? netdev_default()->name : "-");
+}
 
-    char mac_s[18]; format_mac(net_config.mac_address, mac_s);
-    printf("[NET] MAC=%s\n", mac_s);
+void netstack_configure(netdev_t *dev, uint32_t ip, uint32_t netmask, uint32_t gateway) {
+    dev->ip_address = ip;
+    dev->netmask    = netmask;
+    dev->gateway    = gateway;
+    netstack_route_flush();
+    arp_announce(dev);
+    char ip_s[16]; format_ipv4(ip, ip_s);
+    printf("[NET] %s: IP configured: %s\n", dev->name, ip_s);
 }
 
 void netstack_set_config(uint32_t ip, uint32_t netmask, uint32_t gateway) {
-    net_config.ip_address = ip;
-    net_config.netmask    = netmask;
-    net_config.gateway    = gateway;
-    char ip_s[16]; format_ipv4(ip, ip_s);
-    printf("[NET] IP configured: %s\n", ip_s);
+    netdev_t *dev = netdev_default();
+    if (dev) netstack_configure(dev, ip, netmask, gateway);
 }
 
 uint32_t netstack_get_ip_address(void) {
-    if (net_config.ip_address == 0) {
+    netdev_t *dev = netdev_default();
+    if (!dev) return 0;
+    if (dev->ip_address == 0) {
         uint32_t ip=0, mask=0, gw=0, dns=0;
-        if (dhcp_discover_request(&ip, &mask, &gw, &dns)) {
-            net_config.ip_address = ip;
-            net_config.netmask    = mask;
-            net_config.gateway    = gw;
-            net_config.dns_server = dns;
+        if (dhcp_discover_request(dev, &ip, &mask, &gw, &dns)) {
+            dev->ip_address = ip;
+            dev->netmask    = mask;
+            dev->gateway    = gw;
+            dns_server      = dns;
+            netstack_route_flush();
+            arp_announce(dev);
             char ip_s[16], m_s[16], gw_s[16], dns_s[16];
             format_ipv4(ip, ip_s); format_ipv4(mask, m_s); format_ipv4(gw, gw_s); format_ipv4(dns, dns_s);
-            printf("[DHCP] ACK IP=%s MASK=%s GW=%s DNS=%s\n", ip_s, m_s, gw_s, dns_s);
+            printf("[DHCP] %s: ACK IP=%s MASK=%s GW=%s DNS=%s\n", dev->name, ip_s, m_s, gw_s, dns_s);
         } else {
             printf("[DHCP] failed; no IP\n");
         }
     }
-    return net_config.ip_address;
+    return dev->ip_address;
 }
 
-void icmp_send_echo_request(uint32_t dst_ip, uint16_t id, uint16_t seq) {
-    uint8_t data[4] = {'p','i','n','g'};
-    uint8_t packet[1514] = {0};
-
-    eth_header_t  *eth  = (eth_header_t *)packet;
-    ip_header_t   *ip   = (ip_header_t  *)(packet + sizeof(eth_header_t));
-    icmp_header_t *icmp = (icmp_header_t *)(packet + sizeof(eth_header_t) + sizeof(ip_header_t));
-    uint8_t       *payload = packet + sizeof(eth_header_t) + sizeof(ip_header_t) + sizeof(icmp_header_t);
-
-    uint32_t next_hop = (((dst_ip & net_config.netmask) == (net_config.ip_address & net_config.netmask)) || dst_ip==0xFFFFFFFFu)
-                        ? dst_ip : net_config.gateway;
-    uint8_t dst_mac[ETH_ADDR_LEN];
-    if (dst_ip == 0xFFFFFFFFu) memset(dst_mac, 0xFF, ETH_ADDR_LEN);
-    else if (!arp_lookup(next_hop, dst_mac)) { printf("[ICMP] ARP needed\n"); arp_send_request(next_hop); return; }
+uint32_t netstack_get_dns_server(void) {
+    return dns_server;
+}
 
-    memcpy(eth->dst_mac, dst_mac, ETH_ADDR_LEN);
-    memcpy(eth->src_mac, net_config.mac_address, ETH_ADDR_LEN);
-    eth->ethertype = htons(ETHERTYPE_IPV4);
+void netstack_set_dns_server(uint32_t ip) {
+    if (ip != dns_server) dns_flush();
+    dns_server = ip;
+}
 
-    ip->version_ihl      = 0x45;
-    ip->tos              = 0;
-    ip->total_length     = htons((uint16_t)(sizeof(ip_header_t) + sizeof(icmp_header_t) + sizeof(data)));
-    ip->identification   = htons(ip_identification++);
-    ip->flags_fragment   = 0;
-    ip->ttl              = 64;
-    ip->protocol         = IP_PROTOCOL_ICMP;
-    ip->src_ip           = htonl(net_config.ip_address);
-    ip->dst_ip           = htonl(dst_ip);
-    ip->header_checksum  = 0;
-    ip->header_checksum  = ip_checksum(ip, sizeof(ip_header_t));
+int icmp_send_echo(uint32_t dst_ip, uint16_t id, uint16_t seq, uint16_t data_len) {
+    if (sizeof(icmp_header_t) + data_len > IP_MAX_PAYLOAD) return -1;
+    pbuf_t *p = pbuf_alloc_len(PBUF_HEADROOM, sizeof(icmp_header_t) + data_len);
+    if (!p) return -1;
+    icmp_header_t *icmp = (icmp_header_t *)pbuf_put(p, (uint16_t)(sizeof(icmp_header_t) + data_len));
 
     icmp->type       = ICMP_ECHO_REQUEST;
     icmp->code       = 0;
     icmp->identifier = htons(id);
     icmp->sequence   = htons(seq);
     icmp->checksum   = 0;
+    uint8_t *data = (uint8_t *)(icmp + 1);
+    for (uint16_t i = 0; i < data_len; ++i) data[i] = (uint8_t)('a' + i % 23);
+    icmp->checksum = htons(ip_checksum(icmp, p->len));
+    return netstack_ip_output(dst_ip, IP_PROTOCOL_ICMP, p);
+}
 
-    memcpy(payload, data, sizeof(data));
-    icmp->checksum = ip_checksum(icmp, (uint16_t)(sizeof(icmp_header_t)+sizeof(data)));
-
+void icmp_send_echo_request(uint32_t dst_ip, uint16_t id, uint16_t seq) {
     char dip[16]; format_ipv4(dst_ip, dip);
     printf("[ICMP] Echo request -> %s (id=%u, seq=%u)\n", dip, id, seq);
-
-    size_t total_len = sizeof(eth_header_t) + sizeof(ip_header_t) + sizeof(icmp_header_t) + sizeof(data);
-    nic_send(packet, total_len);
-}
-
-// UDP-Send API (Header-Signatur: data non-const)
-int udp_send(uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t *data, uint16_t length) {
-    return netstack_send_udp_low(dst_ip, src_port, dst_port, data, length, /*with_checksum*/false);
+    if (icmp_send_echo(dst_ip, id, seq, 4) != 0) {
+        printf("[ICMP] send failed\n");
+    }
 }
 
-void udp_bind(uint16_t port, udp_callback_t cb) {
-    (void)port; (void)cb;
-    printf("[UDP] bind not implemented\n");
+void netstack_get_stats(netstack_stats_t *out) {
+    *out = stats;
 }
-
-// TCP Stubs
-int  tcp_connect(uint32_t dst_ip, uint16_t dst_port){ (void)dst_ip;(void)dst_port; printf("[TCP] connect n/i\n"); return -1; }
-int  tcp_send(int socket, uint8_t *data, uint16_t length){ (void)socket;(void)data;(void)length; printf("[TCP] send n/i\n"); return -1; }
-int  tcp_recv(int socket, uint8_t *buffer, uint16_t max_length){ (void)socket;(void)buffer;(void)max_length; printf("[TCP] recv n/i\n"); return -1; }
-void tcp_close(int socket){ (void)socket; printf("[TCP] close n/i\n"); }
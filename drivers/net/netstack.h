@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "drivers/net/pbuf.h"
+#include "drivers/net/netdev.h"
+#include "lib/libc/socket.h"        // htons/ntohs/htonl/ntohl
 
 // =============================================================================
 // ETHERNET LAYER (Layer 2)
@@ -45,15 +49,45 @@ typedef struct {
     uint32_t target_ip;
 } __attribute__((packed)) arp_packet_t;
 
-// ARP Cache Entry
-#define ARP_CACHE_SIZE 32
+// ARP cache: hashed by IP, entries age out on the PIT clock
+#define ARP_CACHE_SIZE       32
+#define ARP_HASH_BUCKETS     32          // Power of two
+#define ARP_QUEUE_LEN        4           // Packets held per unresolved neighbour (oldest dropped)
+#define ARP_ENTRY_TIMEOUT    300000      // Resolved entries are forgotten after this (ms)
+#define ARP_RETRY_INTERVAL   1000        // Unanswered requests are repeated after this (ms)
+#define ARP_MAX_RETRIES      3           // Requests before an entry and its packets are dropped
+#define ARP_TIMER_INTERVAL   100         // How often netstack_poll ages the cache (ms)
+
+typedef enum {
+    ARP_STATE_FREE,
+    ARP_STATE_PENDING,           // Request sent, packets may be waiting
+    ARP_STATE_RESOLVED
+} arp_state_t;
+
 typedef struct {
     uint32_t ip;
     uint8_t mac[ETH_ADDR_LEN];
-    uint32_t timestamp;
-    bool valid;
+    arp_state_t state;
+    uint32_t timestamp;          // PIT ms of the last confirmation or request
+    uint8_t retries;             // Requests sent while pending
+    int hash_next;               // Next entry in the same hash bucket (-1 = end)
+    netdev_t *dev;               // Interface the neighbour was resolved on
+    pbuf_queue_t pending;        // IP packets waiting for the MAC
 } arp_cache_entry_t;
 
+typedef struct {
+    uint32_t requests_out;
+    uint32_t replies_in;
+    uint32_t requests_in;        // Requests for one of our addresses
+    uint32_t replies_out;
+    uint32_t updates;            // Entries resolved or given a new MAC
+    uint32_t queued;             // Packets parked until resolution
+    uint32_t queue_drops;        // Parked packets dropped (queue full, timeout, eviction)
+    uint32_t timeouts;           // Neighbours that never answered
+    uint32_t gratuitous;         // Gratuitous ARPs received
+    uint32_t conflicts;          // Someone else claimed one of our addresses
+} arp_stats_t;
+
 // =============================================================================
 // IP LAYER (Layer 3)
 // =============================================================================
@@ -80,12 +114,33 @@ typedef struct {
 #define IP_IHL(iph)        ((iph)->version_ihl & 0x0F)
 #define IP_HEADER_LEN(iph) (IP_IHL(iph) * 4)
 
+// flags_fragment (host order)
+#define IP_FLAG_DF          0x4000
+#define IP_FLAG_MF          0x2000
+#define IP_FRAG_OFFSET_MASK 0x1FFF       // In units of 8 bytes
+#define IP_MAX_PAYLOAD      (65535 - 20) // Largest datagram payload; bigger ones are fragmented above the MTU
+
+// Fragment reassembly (RFC 815). Every datagram being reassembled holds one
+// large pbuf, so PBUF_LARGE_COUNT also caps the memory used.
+#define IP_REASS_SLOTS      4            // Datagrams reassembled at the same time (oldest evicted)
+#define IP_REASS_MAX_HOLES  16           // Gaps tracked per datagram; more and it is dropped
+#define IP_REASS_TIMEOUT    15000        // Incomplete datagrams are dropped after this (ms)
+
 // =============================================================================
 // ICMP PROTOCOL (Internet Control Message Protocol)
 // =============================================================================
 
-#define ICMP_ECHO_REPLY   0
-#define ICMP_ECHO_REQUEST 8
+#define ICMP_ECHO_REPLY     0
+#define ICMP_DEST_UNREACH   3
+#define ICMP_ECHO_REQUEST   8
+#define ICMP_TIME_EXCEEDED  11
+
+// Codes
+#define ICMP_NET_UNREACH    0            // ICMP_DEST_UNREACH: no route
+#define ICMP_FRAG_NEEDED    4            // ICMP_DEST_UNREACH: DF set and larger than the next MTU
+#define ICMP_TTL_EXCEEDED   0            // ICMP_TIME_EXCEEDED: TTL ran out in transit
+
+#define ICMP_ERROR_RATE     100          // ICMP errors sent per second at most
 
 typedef struct {
     uint8_t  type;
@@ -106,6 +161,74 @@ typedef struct {
     uint16_t checksum;
 } __attribute__((packed)) udp_header_t;
 
+// Services answered by the stack itself (used by nettest)
+#define UDP_PORT_ECHO     7       // RFC 862: datagrams are sent back
+#define UDP_PORT_DISCARD  9       // RFC 863: datagrams are counted and dropped
+
+// UDP tuning
+#define UDP_MAX_SOCKETS       16
+#define UDP_HASH_BUCKETS      16          // Socket lookup by local port
+#define UDP_RCV_QUEUE_LEN     32          // Datagrams a socket may hold; further ones are dropped
+#define UDP_EPHEMERAL_BASE    49152
+#define UDP_WAIT_FOREVER      0xFFFFFFFFu // udp_recvfrom timeout: block until a datagram arrives
+
+// Route and next-hop MAC resolved for one destination. Reused by
+// netstack_ip_output_route until the interface configuration or the ARP
+// entry behind it changes.
+typedef struct {
+    uint32_t dst_ip;
+    uint32_t next_hop;
+    netdev_t *dev;
+    uint8_t  mac[ETH_ADDR_LEN];
+    uint32_t generation;         // 0 = nothing cached
+} netstack_route_t;
+
+// =============================================================================
+// ROUTING
+// =============================================================================
+
+#define ROUTE_TABLE_SIZE      32
+#define ROUTE_FWD_CACHE_SIZE  16          // Destinations whose route and MAC the forwarder keeps (power of two)
+
+#define ROUTE_F_CONNECTED     0x01        // Network of an interface address
+#define ROUTE_F_GATEWAY       0x02        // Sent to 'gateway' instead of the destination
+#define ROUTE_F_STATIC        0x04        // Added with route_add; kept when interfaces change
+
+// Entries are kept sorted by prefix length (longest first), then metric
+typedef struct {
+    uint32_t prefix;             // Host order, masked
+    uint32_t netmask;
+    uint8_t  prefix_len;
+    uint8_t  flags;              // ROUTE_F_*
+    uint16_t metric;             // Lower wins between equal prefixes
+    uint32_t gateway;            // 0 = on link
+    netdev_t *dev;
+} route_entry_t;
+
+typedef void (*udp_callback_t)(uint32_t src_ip, uint16_t src_port, uint8_t *data, uint16_t length);
+
+typedef struct {
+    bool used;
+    uint16_t local_port;
+    int hash_next;               // Next socket in the same hash bucket (-1 = end)
+    udp_callback_t callback;     // Set by udp_bind: datagrams are handed over instead of queued
+    pbuf_queue_t rcv;            // Received datagrams, payload left in the NIC's buffers
+    netstack_route_t route;      // Last destination used by udp_sendto
+
+    // Statistics
+    uint32_t datagrams_in;
+    uint32_t datagrams_out;
+    uint32_t dropped;            // Receive queue full
+} udp_socket_t;
+
+typedef struct {
+    uint32_t datagrams_in;
+    uint32_t datagrams_out;
+    uint32_t no_port;            // Nobody bound to the destination port
+    uint32_t queue_drops;        // Receive queue full
+    uint32_t bad_checksum;
+} udp_stats_t;
+
 // =============================================================================
 // TCP PROTOCOL (Transmission Control Protocol)
 // =============================================================================
@@ -147,17 +270,129 @@ typedef enum {
     TCP_TIME_WAIT
 } tcp_state_t;
 
-// =============================================================================
-// NETWORK CONFIGURATION
-// =============================================================================
+// TCP tuning
+#define TCP_MAX_SOCKETS       16
+#define TCP_HASH_BUCKETS      32          // Connection lookup by (ports, remote IP)
+#define TCP_LISTEN_BACKLOG    4           // Pending connections per listener
+#define TCP_BUFFER_SIZE       16384       // Send ring and receive window per socket
+#define TCP_RCV_MAX_PBUFS     32          // Segments a socket may hold before its window closes
+#define TCP_MSS_DEFAULT       536         // Assumed when the peer's SYN has no MSS option
+#define TCP_MSS_LOCAL         (ETH_MAX_PAYLOAD - 40)
+#define TCP_OPT_MSS           2
+#define TCP_RTO_INITIAL       1000        // Retransmission timeout bounds (ms)
+#define TCP_RTO_MIN           200
+#define TCP_RTO_MAX           30000
+#define TCP_MAX_RETRIES       8           // Timeouts in a row before the connection is dropped
+#define TCP_DELACK_TIMEOUT    200         // Longest an ACK is held back (ms)
+#define TCP_TIME_WAIT_TIMEOUT 2000        // Shortened 2*MSL (ms)
+#define TCP_CONNECT_TIMEOUT   10000
+#define TCP_IO_TIMEOUT        10000       // Blocking send/recv/close give up after this (ms)
+#define TCP_EPHEMERAL_BASE    49152
+
+// Sequence number comparison (modulo 2^32)
+#define SEQ_LT(a, b)  ((int32_t)((a) - (b)) < 0)
+#define SEQ_LEQ(a, b) ((int32_t)((a) - (b)) <= 0)
+#define SEQ_GT(a, b)  ((int32_t)((a) - (b)) > 0)
+#define SEQ_GEQ(a, b) ((int32_t)((a) - (b)) >= 0)
+
+// Byte ring holding a socket's unacknowledged and unsent data
+typedef struct {
+    uint8_t *data;
+    uint32_t head;               // Offset of the oldest byte
+    uint32_t count;              // Bytes stored
+} tcp_ring_t;
+
+// Transmission control block
+typedef struct {
+    bool used;
+    tcp_state_t state;
+    uint32_t local_ip;
+    uint32_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+    int hash_next;               // Next socket in the same hash bucket (-1 = end)
+    int parent;                  // Listener that created this socket (-1 = none)
+    bool accepted;               // Handed out by tcp_accept
+    bool user_closed;            // tcp_close called, free once the connection is gone
+    bool nodelay;                // Nagle disabled
+    bool tx_blocked;             // tcp_output stopped on a full NIC ring; retried by tcp_timer
+    bool reset;                  // Connection refused, reset or timed out
+
+    // Send side: the ring holds unacknowledged and unsent data starting at snd_una
+    uint32_t iss;
+    uint32_t snd_una;            // Oldest unacknowledged sequence number
+    uint32_t snd_nxt;            // Next sequence number to send
+    uint32_t snd_max;            // Highest sequence number sent
+    uint32_t snd_wnd;            // Peer's advertised window
+    uint32_t cwnd;               // Congestion window
+    uint32_t ssthresh;
+    uint16_t mss;                // Negotiated maximum segment size
+    uint8_t dupacks;
+    bool fin_pending;            // FIN queued behind the send ring
+    bool fin_acked;
+
+    // Receive side
+    uint32_t irs;
+    uint32_t rcv_nxt;            // Next sequence number expected
+    uint32_t rcv_adv;            // Right edge of the last advertised window
+    bool fin_received;
+    uint8_t ack_pending;         // Segments received since the last ACK we sent
+
+    // Timers (PIT milliseconds, 0 = stopped)
+    uint32_t rto;
+    uint32_t srtt;               // Smoothed RTT << 3
+    uint32_t rttvar;             // RTT variance << 2
+    uint32_t rtt_seq;            // Segment being timed (ACK at or past it ends the sample)
+    uint32_t rtt_start;
+    bool rtt_timing;
+    uint8_t retries;
+    uint32_t rto_deadline;
+    uint32_t delack_deadline;
+    uint32_t timewait_deadline;
+
+    tcp_ring_t snd;
+    pbuf_queue_t rcv;            // In-order segments, payload left in the NIC's buffers
+
+    // Statistics
+    uint32_t bytes_out;
+    uint32_t bytes_in;
+    uint32_t retransmits;
+} tcp_socket_t;
 
 typedef struct {
-    uint32_t ip_address;      // Our IP address
-    uint32_t netmask;         // Network mask
-    uint32_t gateway;         // Default gateway
-    uint32_t dns_server;      // DNS server
-    uint8_t  mac_address[ETH_ADDR_LEN];  // Our MAC address
-} network_config_t;
+    uint32_t segs_in;
+    uint32_t segs_out;
+    uint32_t retransmits;        // Segments resent after a timeout
+    uint32_t fast_retransmits;   // Segments resent after three duplicate ACKs
+    uint32_t delayed_acks;       // ACKs sent by the delayed ACK timer
+    uint32_t resets_out;
+    uint32_t bad_checksum;
+    uint32_t out_of_order;       // Segments dropped because they were ahead of rcv_nxt
+    uint32_t tx_stalls;          // Output deferred because the NIC TX ring was full
+} tcp_stats_t;
+
+// IP/ICMP/UDP counters
+typedef struct {
+    uint32_t ip_in;
+    uint32_t ip_out;
+    uint32_t ip_dropped;         // Bad header, not for us
+    uint32_t ip_bad_checksum;    // Header checksum mismatches (also in ip_dropped)
+    uint32_t ip_unknown_proto;   // Local datagrams for a protocol we do not speak
+    uint32_t ip_frags_out;       // Fragments sent
+    uint32_t ip_frags_in;        // Fragments received
+    uint32_t ip_reassembled;     // Datagrams put back together
+    uint32_t ip_reass_timeouts;  // Incomplete datagrams expired or evicted
+    uint32_t ip_reass_drops;     // Fragments dropped (bad offset, too many gaps, no buffer)
+    uint32_t icmp_echo_requests; // Answered echo requests
+    uint32_t icmp_echo_replies;  // Echo replies received
+    uint32_t icmp_errors_out;    // Unreachable/time exceeded sent
+    uint32_t udp_in;
+    uint32_t ip_forwarded;       // Datagrams routed on to another host
+    uint32_t ip_fwd_no_route;
+    uint32_t ip_fwd_ttl_expired;
+    uint32_t ip_fwd_frag_needed; // Larger than the outgoing MTU but not to be fragmented
+    uint32_t ip_fwd_dropped;     // Martian or broadcast addresses
+} netstack_stats_t;
 
 // =============================================================================
 // NETWORK STACK API
@@ -165,42 +400,110 @@ typedef struct {
 
 // Initialization
 void netstack_init(void);
+// IPv4 configuration is per interface; set_config targets the default one
+void netstack_configure(netdev_t *dev, uint32_t ip, uint32_t netmask, uint32_t gateway);
 void netstack_set_config(uint32_t ip, uint32_t netmask, uint32_t gateway);
 
 // Packet Processing
-void netstack_process_packet(uint8_t *packet, uint16_t length);
+void netstack_input(netdev_t *dev, pbuf_t *frame);               // Consumes the frame
+void netstack_process_packet(uint8_t *packet, uint16_t length);  // Copies into a pbuf first
+// Drain the receive queues of all interfaces and run protocol timers;
+// blocking calls spin on this. Returns the number of frames received.
+int netstack_poll(void);
+// False while the TX queue of the interface that dst_ip routes to is full
+bool netstack_tx_ready(uint32_t dst_ip);
+// Address of the interface that dst_ip routes to (0 = unconfigured)
+uint32_t netstack_source_address(uint32_t dst_ip);
+// IP of the default interface; runs DHCP on it if it has none yet
+uint32_t netstack_get_ip_address(void);
+// DNS server from DHCP or set by hand (0 = none)
+uint32_t netstack_get_dns_server(void);
+void netstack_set_dns_server(uint32_t ip);
+void netstack_get_stats(netstack_stats_t *stats);
+
+// Output path shared by the protocols: prepends the IP and Ethernet headers
+// in front of p->data (allocate with PBUF_HEADROOM) and sends. Consumes p.
+int netstack_ip_output(uint32_t dst_ip, uint8_t protocol, pbuf_t *p);
+// Same, but skips routing and the ARP lookup while 'route' still holds a
+// valid result for dst_ip
+int netstack_ip_output_route(netstack_route_t *route, uint32_t dst_ip, uint8_t protocol, pbuf_t *p);
+// Rebuild the interface routes and invalidate every netstack_route_t
+// (called when interfaces are reconfigured)
+void netstack_route_flush(void);
+// Wait until the next hop for dst_ip is in the ARP cache
+bool netstack_resolve(uint32_t dst_ip, uint32_t timeout_ms);
+
+// Routing table. Interface addresses and gateways add their routes by
+// themselves; route_add adds a static one (dev NULL: the interface the
+// gateway is on). Both return 0 or -1.
+int route_add(uint32_t prefix, uint8_t prefix_len, uint32_t gateway, netdev_t *dev, uint16_t metric);
+int route_del(uint32_t prefix, uint8_t prefix_len);             // Static routes only
+const route_entry_t* route_lookup(uint32_t dst_ip);             // Longest match, NULL if none
+const route_entry_t* route_get_entry(int index);                // NULL past the end
+// Forward datagrams for other hosts between the interfaces (off by default)
+void netstack_set_forwarding(bool enable);
+bool netstack_get_forwarding(void);
 
 // ARP Functions
 void arp_send_request(uint32_t target_ip);
 void arp_send_reply(uint32_t target_ip, uint8_t *target_mac);
 bool arp_lookup(uint32_t ip, uint8_t *mac_out);
 void arp_add_entry(uint32_t ip, uint8_t *mac);
+// Broadcast our address on dev (sent whenever an interface gets an IP)
+void arp_announce(netdev_t *dev);
+// Entry by table index, NULL if the slot is free
+const arp_cache_entry_t* arp_get_entry(int index);
+void arp_get_stats(arp_stats_t *stats);
 
 // ICMP Functions
 void icmp_send_echo_request(uint32_t dst_ip, uint16_t id, uint16_t seq);
+// Quiet variant with a 'data_len' byte payload; returns -1 if it was not sent
+int icmp_send_echo(uint32_t dst_ip, uint16_t id, uint16_t seq, uint16_t data_len);
 void icmp_send_echo_reply(uint32_t dst_ip, uint16_t id, uint16_t seq, uint8_t *data, uint16_t data_len);
 
-// UDP Functions
+// UDP Functions (sockets are indices into the socket table)
+void udp_init(void);
+int udp_open(uint16_t port);     // 0 = ephemeral port; returns the socket or -1
+void udp_close(int socket);
+int udp_sendto(int socket, uint32_t dst_ip, uint16_t dst_port, const uint8_t *data, uint16_t length);
+// Returns the datagram length (truncated to buflen) or -1. timeout_ms 0
+// only polls once, UDP_WAIT_FOREVER blocks.
+int udp_recvfrom(int socket, void *buffer, size_t buflen, uint32_t *src_ip, uint16_t *src_port, uint32_t timeout_ms);
+uint16_t udp_local_port(int socket);
+const udp_socket_t* udp_get_socket(int socket);
+void udp_get_stats(udp_stats_t *stats);
+void udp_input(uint32_t src_ip, uint32_t dst_ip, pbuf_t *datagram);   // Consumes the datagram
+// One-shot helpers without a socket of their own
 int udp_send(uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t *data, uint16_t length);
-typedef void (*udp_callback_t)(uint32_t src_ip, uint16_t src_port, uint8_t *data, uint16_t length);
+// Wait up to timeout_ms for one datagram to 'port'; returns its length or -1
+int udp_receive(uint16_t port, void *buffer, size_t buflen, uint32_t *src_ip, uint16_t *src_port, uint32_t timeout_ms);
+// Deliver datagrams for 'port' to a callback from the receive path
+// (NULL unbinds)
 void udp_bind(uint16_t port, udp_callback_t callback);
 
-// TCP Functions (simplified for now)
+// TCP Functions (sockets are indices into the connection table)
+void tcp_init(void);
 int tcp_connect(uint32_t dst_ip, uint16_t dst_port);
+int tcp_listen(uint16_t port);
+int tcp_accept(int listener, uint32_t timeout_ms);
 int tcp_send(int socket, uint8_t *data, uint16_t length);
-int tcp_recv(int socket, uint8_t *buffer, uint16_t max_length);
+int tcp_recv(int socket, uint8_t *buffer, uint16_t max_length);   // 0 = peer closed
 void tcp_close(int socket);
+void tcp_set_nodelay(int socket, bool nodelay);
+const tcp_socket_t* tcp_get_socket(int socket);
+void tcp_get_stats(tcp_stats_t *stats);
+void tcp_input(uint32_t src_ip, uint32_t dst_ip, pbuf_t *segment);   // Consumes the segment
+void tcp_timer(void);
 
 // Utility Functions
-uint16_t ip_checksum(void *data, uint16_t length);
+uint16_t ip_checksum(void *data, uint16_t length);   // Host order; 0 over a valid header
+// Checksum over the IPv4 pseudo header and an L4 segment (host order addresses)
+uint16_t ip_pseudo_checksum(uint32_t src_ip, uint32_t dst_ip, uint8_t protocol, const void *data, uint16_t length);
+// Leave the TCP/UDP checksum at 'check_offset' into l4_header to
+// netstack_ip_output: it is offloaded to the NIC or computed there
+void netstack_csum_request(pbuf_t *p, const void *l4_header, uint16_t check_offset);
 uint32_t parse_ipv4(const char *ip_string);  // "192.168.1.1" -> uint32_t
 void format_ipv4(uint32_t ip, char *buffer);  // uint32_t -> "192.168.1.1"
 void format_mac(uint8_t *mac, char *buffer);  // MAC -> "AA:BB:CC:DD:EE:FF"
 
-// Network byte order conversion (big-endian <-> little-endian)
-uint16_t htons(uint16_t host_short);
-uint32_t htonl(uint32_t host_long);
-uint16_t ntohs(uint16_t net_short);
-uint32_t ntohl(uint32_t net_long);
-
 #endif // NETSTACK_H
@@ -0,0 +1,240 @@
+// drivers/net/pbuf.c
+// Packet buffer pool. Buffers come from the page allocator, which hands out
+// identity-mapped memory, so their addresses can be given to bus-master NICs.
+
+#include "drivers/net/pbuf.h"
+#include "arch/x86/mm/paging.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
+
+#include <stddef.h>
+
+#define PBUF_POOL_PAGES ((PBUF_POOL_SIZE * PBUF_BUF_SIZE + PAGE_SIZE - 1) / PAGE_SIZE)
+#define PBUF_LARGE_PAGES ((PBUF_LARGE_COUNT * PBUF_LARGE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE)
+
+static pbuf_t pbuf_descs[PBUF_POOL_SIZE];
+static pbuf_t *pbuf_free_list;
+static bool pbuf_ready;
+static pbuf_stats_t pbuf_stats;
+
+// Allocated on first use; most configurations never fragment
+static pbuf_t pbuf_large_descs[PBUF_LARGE_COUNT];
+static pbuf_t *pbuf_large_free_list;
+static bool pbuf_large_ready;
+
+static bool pbuf_pool_init(void) {
+    uint8_t *memory = (uint8_t *)allocate_pages(PBUF_POOL_PAGES);
+    if (!memory) {
+        printf("[PBUF] cannot allocate %u pages for the packet pool\n", PBUF_POOL_PAGES);
+        return false;
+    }
+
+    pbuf_free_list = NULL;
+    for (int i = PBUF_POOL_SIZE - 1; i >= 0; --i) {
+        pbuf_t *p = &pbuf_descs[i];
+        p->buffer = memory + (uint32_t)i * PBUF_BUF_SIZE;
+        p->data = p->buffer;
+        p->len = 0;
+        p->refcount = 0;
+        p->size = PBUF_BUF_SIZE;
+        p->next = pbuf_free_list;
+        pbuf_free_list = p;
+    }
+    pbuf_stats.total = PBUF_POOL_SIZE;
+    pbuf_stats.free = PBUF_POOL_SIZE;
+    pbuf_stats.low_water = PBUF_POOL_SIZE;
+    pbuf_stats.large_total = PBUF_LARGE_COUNT;     // Memory follows on first use
+    pbuf_stats.large_free = PBUF_LARGE_COUNT;
+    pbuf_ready = true;
+    return true;
+}
+
+static bool pbuf_large_pool_init(void) {
+    uint8_t *memory = (uint8_t *)allocate_pages(PBUF_LARGE_PAGES);
+    if (!memory) {
+        printf("[PBUF] cannot allocate %u pages for large buffers\n", PBUF_LARGE_PAGES);
+        return false;
+    }
+
+    pbuf_large_free_list = NULL;
+    for (int i = PBUF_LARGE_COUNT - 1; i >= 0; --i) {
+        pbuf_t *p = &pbuf_large_descs[i];
+        p->buffer = memory + (uint32_t)i * PBUF_LARGE_SIZE;
+        p->data = p->buffer;
+        p->len = 0;
+        p->refcount = 0;
+        p->size = PBUF_LARGE_SIZE;
+        p->next = pbuf_large_free_list;
+        pbuf_large_free_list = p;
+    }
+    pbuf_large_ready = true;
+    return true;
+}
+
+// The pool is touched from NIC interrupt handlers as well as the stack
+static inline uint32_t pbuf_irq_save(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void pbuf_irq_restore(uint32_t flags) {
+    __asm__ __volatile__("push %0; popf" :: "r"(flags) : "memory", "cc");
+}
+
+pbuf_t* pbuf_alloc(uint16_t headroom) {
+    if (headroom > PBUF_BUF_SIZE) return NULL;
+
+    uint32_t flags = pbuf_irq_save();
+    if (!pbuf_ready && !pbuf_pool_init()) {
+        pbuf_irq_restore(flags);
+        return NULL;
+    }
+    pbuf_t *p = pbuf_free_list;
+    if (p) {
+        pbuf_free_list = p->next;
+        if (--pbuf_stats.free < pbuf_stats.low_water) {
+            pbuf_stats.low_water = pbuf_stats.free;
+        }
+    } else {
+        pbuf_stats.alloc_failures++;
+    }
+    pbuf_irq_restore(flags);
+
+    if (p) {
+        p->data = p->buffer + headroom;
+        p->len = 0;
+        p->refcount = 1;
+        p->flags = 0;
+        p->next = NULL;
+    }
+    return p;
+}
+
+static pbuf_t* pbuf_alloc_large(uint16_t headroom) {
+    uint32_t flags = pbuf_irq_save();
+    if (!pbuf_large_ready && !pbuf_large_pool_init()) {
+        pbuf_stats.large_total = pbuf_stats.large_free = 0;
+        pbuf_stats.large_failures++;
+        pbuf_irq_restore(flags);
+        return NULL;
+    }
+    pbuf_t *p = pbuf_large_free_list;
+    if (p) {
+        pbuf_large_free_list = p->next;
+        pbuf_stats.large_free--;
+    } else {
+        pbuf_stats.large_failures++;
+    }
+    pbuf_irq_restore(flags);
+
+    if (p) {
+        p->data = p->buffer + headroom;
+        p->len = 0;
+        p->refcount = 1;
+        p->flags = 0;
+        p->next = NULL;
+    }
+    return p;
+}
+
+pbuf_t* pbuf_alloc_len(uint16_t headroom, uint32_t len) {
+    if ((uint32_t)headroom + len <= PBUF_BUF_SIZE) return pbuf_alloc(headroom);
+    if ((uint32_t)headroom + len > PBUF_LARGE_SIZE) return NULL;
+    return pbuf_alloc_large(headroom);
+}
+
+void pbuf_ref(pbuf_t *p) {
+    if (p) p->refcount++;
+}
+
+void pbuf_free(pbuf_t *p) {
+    if (!p || p->refcount == 0) return;
+
+    uint32_t flags = pbuf_irq_save();
+    if (--p->refcount == 0) {
+        if (p->size == PBUF_LARGE_SIZE) {
+            p->next = pbuf_large_free_list;
+            pbuf_large_free_list = p;
+            pbuf_stats.large_free++;
+        } else {
+            p->next = pbuf_free_list;
+            pbuf_free_list = p;
+            pbuf_stats.free++;
+        }
+    }
+    pbuf_irq_restore(flags);
+}
+
+uint8_t* pbuf_push(pbuf_t *p, uint16_t n) {
+    if ((uint32_t)(p->data - p->buffer) < n) return NULL;
+    p->data -= n;
+    p->len += n;
+    return p->data;
+}
+
+uint8_t* pbuf_pull(pbuf_t *p, uint16_t n) {
+    if (p->len < n) return NULL;
+    p->data += n;
+    p->len -= n;
+    return p->data;
+}
+
+uint8_t* pbuf_put(pbuf_t *p, uint16_t n) {
+    uint32_t end = (uint32_t)(p->data - p->buffer) + p->len;
+    if (end + n > p->size) return NULL;
+    uint8_t *tail = p->data + p->len;
+    p->len += n;
+    return tail;
+}
+
+void pbuf_trim(pbuf_t *p, uint16_t len) {
+    if (len < p->len) p->len = len;
+}
+
+void pbuf_queue_push(pbuf_queue_t *q, pbuf_t *p) {
+    p->next = NULL;
+    if (q->tail) q->tail->next = p;
+    else q->head = p;
+    q->tail = p;
+    q->bytes += p->len;
+    q->count++;
+}
+
+pbuf_t* pbuf_queue_pop(pbuf_queue_t *q) {
+    pbuf_t *p = q->head;
+    if (!p) return NULL;
+    q->head = p->next;
+    if (!q->head) q->tail = NULL;
+    q->bytes -= p->len;
+    q->count--;
+    p->next = NULL;
+    return p;
+}
+
+void pbuf_queue_flush(pbuf_queue_t *q) {
+    pbuf_t *p;
+    while ((p = pbuf_queue_pop(q)) != NULL) {
+        pbuf_free(p);
+    }
+}
+
+uint32_t pbuf_queue_read(pbuf_queue_t *q, uint8_t *dst, uint32_t len) {
+    uint32_t copied = 0;
+    while (copied < len && q->head) {
+        pbuf_t *p = q->head;
+        uint16_t n = (uint16_t)(len - copied < p->len ? len - copied : p->len);
+        memcpy(dst + copied, p->data, n);
+        pbuf_pull(p, n);
+        q->bytes -= n;
+        copied += n;
+        if (p->len == 0) {
+            pbuf_free(pbuf_queue_pop(q));
+        }
+    }
+    return copied;
+}
+
+void pbuf_get_stats(pbuf_stats_t *stats) {
+    if (stats) *stats = pbuf_stats;
+}
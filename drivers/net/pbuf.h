@@ -0,0 +1,86 @@
+#ifndef PBUF_H
+#define PBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// =============================================================================
+// PACKET BUFFERS
+// Fixed-size, physically contiguous buffers shared by the drivers and the
+// protocol stack. A frame is received into a pbuf by the NIC, headers are
+// stripped with pbuf_pull on the way up, and payload stays in the same
+// buffer until the socket consumer reads it. On the way down headers are
+// prepended in place with pbuf_push and the NIC sends straight from the pbuf.
+// =============================================================================
+
+#define PBUF_POOL_SIZE  512         // Buffers in the pool (1 MB); covers a full e1000 TX ring plus RX
+#define PBUF_BUF_SIZE   2048        // One Ethernet frame; matches the e1000 2 KB RX buffer size
+#define PBUF_HEADROOM   128         // Room for Ethernet + IP + TCP headers with options
+#define PBUF_STACK_RESERVE 64      // Kept back from NIC rings for socket, ARP and TX queues
+#define PBUF_RING_BUDGET (PBUF_POOL_SIZE - PBUF_STACK_RESERVE)  // RX plus TX descriptors, all NICs
+
+// A few buffers that hold a whole IP datagram (reassembly, datagrams that
+// are fragmented on output). Never handed to a NIC.
+#define PBUF_LARGE_COUNT 4
+#define PBUF_LARGE_SIZE  (65536 + PBUF_HEADROOM)
+
+// Checksum state (pbuf_t.flags)
+#define PBUF_F_CSUM_PARTIAL 0x01    // TX: L4 checksum field holds the pseudo header sum, the
+                                    // rest is summed from csum_start by the NIC or the stack
+#define PBUF_F_CSUM_VALID   0x02    // RX: the NIC has verified the L4 checksum
+
+typedef struct pbuf {
+    uint8_t *buffer;                // Start of the buffer (identity mapped, usable for DMA)
+    uint8_t *data;                  // First valid byte
+    uint16_t len;                   // Valid bytes starting at data
+    uint16_t refcount;
+    uint32_t size;                  // Buffer capacity (PBUF_BUF_SIZE or PBUF_LARGE_SIZE)
+    uint8_t flags;                  // PBUF_F_*
+    uint16_t csum_start;            // PBUF_F_CSUM_PARTIAL: L4 header offset from buffer
+    uint16_t csum_offset;           // Checksum field offset from csum_start
+    struct pbuf *next;              // Free list / queue link
+} pbuf_t;
+
+// FIFO of pbufs, e.g. a socket receive queue
+typedef struct {
+    pbuf_t *head;
+    pbuf_t *tail;
+    uint32_t bytes;                 // Sum of len over the queue
+    uint32_t count;                 // Number of pbufs
+} pbuf_queue_t;
+
+typedef struct {
+    uint32_t total;
+    uint32_t free;
+    uint32_t low_water;             // Fewest free buffers seen
+    uint32_t alloc_failures;
+    uint32_t large_total;
+    uint32_t large_free;
+    uint32_t large_failures;
+} pbuf_stats_t;
+
+// Allocate a buffer with 'headroom' bytes reserved in front of data (len = 0)
+pbuf_t* pbuf_alloc(uint16_t headroom);
+// Same, but from the large pool when headroom + len does not fit a normal buffer
+pbuf_t* pbuf_alloc_len(uint16_t headroom, uint32_t len);
+void pbuf_ref(pbuf_t *p);
+void pbuf_free(pbuf_t *p);          // Drop one reference
+
+// Prepend 'n' bytes (returns the new data pointer, NULL without headroom)
+uint8_t* pbuf_push(pbuf_t *p, uint16_t n);
+// Strip 'n' bytes from the front (returns the new data pointer, NULL if too short)
+uint8_t* pbuf_pull(pbuf_t *p, uint16_t n);
+// Append 'n' bytes at the end (returns a pointer to them, NULL without tailroom)
+uint8_t* pbuf_put(pbuf_t *p, uint16_t n);
+// Cut the valid data down to 'len' bytes
+void pbuf_trim(pbuf_t *p, uint16_t len);
+
+void pbuf_queue_push(pbuf_queue_t *q, pbuf_t *p);
+pbuf_t* pbuf_queue_pop(pbuf_queue_t *q);
+void pbuf_queue_flush(pbuf_queue_t *q);
+// Copy up to 'len' bytes out of the queue, freeing pbufs as they drain
+uint32_t pbuf_queue_read(pbuf_queue_t *q, uint8_t *dst, uint32_t len);
+
+void pbuf_get_stats(pbuf_stats_t *stats);
+
+#endif // PBUF_H
@@ -0,0 +1,386 @@
+// drivers/net/pcap.c
+// In-kernel packet capture. The tap runs on the RX/TX path and is the only
+// writer of the ring; exports read it without stopping the tap. Every
+// record carries a sequence number that the writer clears before touching
+// the record and sets once it is complete, so a reader that sees the same
+// sequence before and after copying a record knows the copy is whole.
+
+#include "drivers/net/pcap.h"
+#include "drivers/net/netstack.h"
+#include "drivers/char/serial.h"
+#include "drivers/char/rtc.h"
+#include "fs/vfs/vfs.h"
+#include "include/kernel/panic.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdlib.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define PCAP_MAGIC          0xA1B2C3D4u
+#define PCAP_VERSION_MAJOR  2
+#define PCAP_VERSION_MINOR  4
+#define PCAP_LINKTYPE_ETH   1
+#define PCAP_EXPORT_CHUNK   4096
+
+#define pcap_barrier()      __asm__ __volatile__("" ::: "memory")
+
+STATIC_ASSERT((PCAP_RING_RECORDS & (PCAP_RING_RECORDS - 1)) == 0);
+
+// libpcap file format; all fields in host byte order, which the magic tells readers
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t  thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} __attribute__((packed)) pcap_file_header_t;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t caplen;
+    uint32_t len;
+} __attribute__((packed)) pcap_record_header_t;
+
+typedef struct {
+    volatile uint32_t seq;              // Position + 1 once complete, 0 while written
+    uint32_t ts_ms;
+    uint16_t len;
+    uint16_t caplen;
+    uint8_t data[PCAP_SNAPLEN_MAX];
+} pcap_record_t;
+
+volatile bool pcap_active = false;
+
+static pcap_record_t pcap_ring[PCAP_RING_RECORDS];
+static volatile uint32_t pcap_head;     // Records ever written since the last clear
+static pcap_filter_t pcap_filter;
+static uint16_t pcap_snaplen = PCAP_SNAPLEN;
+static uint32_t pcap_seen;
+static uint32_t pcap_filtered;
+static uint32_t pcap_epoch_sec;         // RTC time (UTC) at pcap_start...
+static uint32_t pcap_epoch_ms;          // ...and the tick count it was read at
+static uint8_t pcap_chunk[PCAP_EXPORT_CHUNK];
+
+// =============================================================================
+// Filter
+// =============================================================================
+
+// Fields the filter terms look at, pulled out of the frame once
+typedef struct {
+    uint16_t ethertype;
+    uint8_t proto;                      // IPv4 only
+    bool has_ip;
+    bool has_ports;
+    uint32_t src, dst;                  // IPv4 or ARP sender/target, host order
+    uint16_t sport, dport;
+} pcap_fields_t;
+
+static uint32_t pcap_be32(const uint8_t* b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static void pcap_parse(const uint8_t* f, uint16_t len, pcap_fields_t* out) {
+    memset(out, 0, sizeof(*out));
+    if (len < sizeof(eth_header_t)) return;
+    out->ethertype = (uint16_t)((f[12] << 8) | f[13]);
+    f += sizeof(eth_header_t);
+    len -= sizeof(eth_header_t);
+
+    if (out->ethertype == ETHERTYPE_ARP && len >= sizeof(arp_packet_t)) {
+        out->has_ip = true;
+        out->src = pcap_be32(f + 14);
+        out->dst = pcap_be32(f + 24);
+        return;
+    }
+    if (out->ethertype != ETHERTYPE_IPV4 || len < sizeof(ip_header_t)) return;
+
+    uint16_t ihl = (uint16_t)((f[0] & 0x0F) * 4);
+    out->has_ip = true;
+    out->proto = f[9];
+    out->src = pcap_be32(f + 12);
+    out->dst = pcap_be32(f + 16);
+    // Ports are only in the first fragment
+    uint16_t frag = (uint16_t)(((f[6] << 8) | f[7]) & IP_FRAG_OFFSET_MASK);
+    if (frag == 0 && (out->proto == IP_PROTOCOL_TCP || out->proto == IP_PROTOCOL_UDP) && len >= ihl + 4) {
+        out->has_ports = true;
+        out->sport = (uint16_t)((f[ihl] << 8) | f[ihl + 1]);
+        out->dport = (uint16_t)((f[ihl + 2] << 8) | f[ihl + 3]);
+    }
+}
+
+static bool pcap_term_match(const pcap_term_t* t, const pcap_fields_t* f, netdev_t* dev, uint8_t dir) {
+    switch (t->type) {
+    case PCAP_TERM_ETHERTYPE: return f->ethertype == t->value;
+    case PCAP_TERM_IPPROTO:   return f->ethertype == ETHERTYPE_IPV4 && f->has_ip && f->proto == t->value;
+    case PCAP_TERM_HOST:      return f->has_ip && (f->src == t->value || f->dst == t->value);
+    case PCAP_TERM_SRC_HOST:  return f->has_ip && f->src == t->value;
+    case PCAP_TERM_DST_HOST:  return f->has_ip && f->dst == t->value;
+    case PCAP_TERM_PORT:      return f->has_ports && (f->sport == t->value || f->dport == t->value);
+    case PCAP_TERM_DIR:       return dir == t->value;
+    case PCAP_TERM_DEV:       return netdev_get((int)t->value) == dev;
+    }
+    return false;
+}
+
+static bool pcap_filter_match(const uint8_t* frame, uint16_t len, netdev_t* dev, uint8_t dir) {
+    if (pcap_filter.count == 0) return true;
+    pcap_fields_t f;
+    pcap_parse(frame, len, &f);
+    for (int i = 0; i < pcap_filter.count; i++) {
+        const pcap_term_t* t = &pcap_filter.terms[i];
+        if (pcap_term_match(t, &f, dev, dir) == t->negate) return false;
+    }
+    return true;
+}
+
+static bool pcap_parse_number(const char* s, uint32_t max, uint32_t* out) {
+    char* end;
+    if (!s || !*s) return false;
+    unsigned long v = strtoul(s, &end, 0);
+    if (*end || v > max) return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
+bool pcap_filter_compile(pcap_filter_t* filter, int argc, const char** argv, const char** error) {
+    memset(filter, 0, sizeof(*filter));
+    bool negate = false;
+
+    for (int i = 0; i < argc; i++) {
+        const char* w = argv[i];
+        const char* arg = i + 1 < argc ? argv[i + 1] : NULL;
+        pcap_term_t t = { 0, negate, 0 };
+        *error = w;
+
+        if (strcmp(w, "and") == 0 || strcmp(w, "&&") == 0) {
+            continue;
+        }
+        if (strcmp(w, "not") == 0 || strcmp(w, "!") == 0) {
+            negate = !negate;
+            continue;
+        }
+
+        if (strcmp(w, "arp") == 0) {
+            t.type = PCAP_TERM_ETHERTYPE; t.value = ETHERTYPE_ARP;
+        } else if (strcmp(w, "ip6") == 0) {
+            t.type = PCAP_TERM_ETHERTYPE; t.value = ETHERTYPE_IPV6;
+        } else if (strcmp(w, "ip") == 0 || strcmp(w, "ether") == 0) {
+            // "ip" alone or "ip proto <n>" / "ether proto <n>"
+            if (arg && strcmp(arg, "proto") == 0) {
+                t.type = w[0] == 'i' ? PCAP_TERM_IPPROTO : PCAP_TERM_ETHERTYPE;
+                i += 2;
+                if (i >= argc || !pcap_parse_number(argv[i], w[0] == 'i' ? 0xFF : 0xFFFF, &t.value)) {
+                    if (i < argc) *error = argv[i];
+                    return false;
+                }
+            } else if (w[0] == 'i') {
+                t.type = PCAP_TERM_ETHERTYPE; t.value = ETHERTYPE_IPV4;
+            } else {
+                return false;
+            }
+        } else if (strcmp(w, "icmp") == 0) {
+            t.type = PCAP_TERM_IPPROTO; t.value = IP_PROTOCOL_ICMP;
+        } else if (strcmp(w, "tcp") == 0) {
+            t.type = PCAP_TERM_IPPROTO; t.value = IP_PROTOCOL_TCP;
+        } else if (strcmp(w, "udp") == 0) {
+            t.type = PCAP_TERM_IPPROTO; t.value = IP_PROTOCOL_UDP;
+        } else if (strcmp(w, "host") == 0 || strcmp(w, "src") == 0 || strcmp(w, "dst") == 0) {
+            t.type = w[0] == 'h' ? PCAP_TERM_HOST : w[0] == 's' ? PCAP_TERM_SRC_HOST : PCAP_TERM_DST_HOST;
+            if (w[0] != 'h' && arg && strcmp(arg, "host") == 0) {
+                i++;
+            }
+            if (++i >= argc || (t.value = parse_ipv4(argv[i])) == 0) {
+                if (i < argc) *error = argv[i];
+                return false;
+            }
+        } else if (strcmp(w, "port") == 0) {
+            t.type = PCAP_TERM_PORT;
+            if (++i >= argc || !pcap_parse_number(argv[i], 0xFFFF, &t.value)) {
+                if (i < argc) *error = argv[i];
+                return false;
+            }
+        } else if (strcmp(w, "rx") == 0 || strcmp(w, "tx") == 0) {
+            t.type = PCAP_TERM_DIR;
+            t.value = w[0] == 'r' ? PCAP_DIR_RX : PCAP_DIR_TX;
+        } else if (strcmp(w, "dev") == 0) {
+            t.type = PCAP_TERM_DEV;
+            netdev_t* dev = arg ? netdev_find(arg) : NULL;
+            if (!dev) {
+                if (arg) *error = arg;
+                return false;
+            }
+            i++;
+            for (int n = 0; n < netdev_count(); n++) {
+                if (netdev_get(n) == dev) t.value = (uint32_t)n;
+            }
+        } else {
+            return false;
+        }
+
+        if (filter->count == PCAP_FILTER_TERMS) return false;
+        filter->terms[filter->count++] = t;
+        negate = false;
+    }
+
+    *error = negate ? "not" : NULL;
+    return !negate;
+}
+
+// =============================================================================
+// Tap
+// =============================================================================
+void pcap_tap(netdev_t* dev, const pbuf_t* p, uint8_t dir) {
+    pcap_seen++;
+    if (!pcap_filter_match(p->data, p->len, dev, dir)) {
+        pcap_filtered++;
+        return;
+    }
+
+    uint32_t n = pcap_head;
+    pcap_record_t* r = &pcap_ring[n & (PCAP_RING_RECORDS - 1)];
+    r->seq = 0;
+    pcap_barrier();
+    r->ts_ms = pit_get_ticks();
+    r->len = p->len;
+    r->caplen = p->len < pcap_snaplen ? p->len : pcap_snaplen;
+    memcpy(r->data, p->data, r->caplen);
+    pcap_barrier();
+    r->seq = n + 1;
+    pcap_head = n + 1;
+}
+
+void pcap_clear(void) {
+    bool was_active = pcap_active;
+    pcap_active = false;
+    pcap_barrier();
+    for (int i = 0; i < PCAP_RING_RECORDS; i++) pcap_ring[i].seq = 0;
+    pcap_head = 0;
+    pcap_seen = 0;
+    pcap_filtered = 0;
+    pcap_barrier();
+    pcap_active = was_active;
+}
+
+// Seconds since 1970-01-01 for an RTC date (days_from_civil)
+static uint32_t pcap_rtc_epoch(void) {
+    int year, month, day, h, m, sec;
+    read_date(&year, &month, &day);
+    read_time(&h, &m, &sec);
+    if (month < 1 || month > 12 || year < 1970) return 0;
+    int y = month <= 2 ? year - 1 : year;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = (uint32_t)(era * 146097 + doe - 719468);
+    return days * 86400u + (uint32_t)(h * 3600 + m * 60 + sec);
+}
+
+void pcap_start(const pcap_filter_t* filter, uint16_t snaplen) {
+    pcap_active = false;
+    pcap_clear();
+    if (filter) pcap_filter = *filter;
+    else memset(&pcap_filter, 0, sizeof(pcap_filter));
+    if (snaplen == 0) snaplen = PCAP_SNAPLEN;
+    pcap_snaplen = snaplen < PCAP_SNAPLEN_MAX ? snaplen : PCAP_SNAPLEN_MAX;
+    pcap_epoch_sec = pcap_rtc_epoch();
+    pcap_epoch_ms = pit_get_ticks();
+    pcap_barrier();
+    pcap_active = true;
+}
+
+void pcap_stop(void) {
+    pcap_active = false;
+}
+
+void pcap_get_stats(pcap_stats_t* stats) {
+    stats->running = pcap_active;
+    stats->snaplen = pcap_snaplen;
+    stats->seen = pcap_seen;
+    stats->captured = pcap_head;
+    stats->filtered = pcap_filtered;
+    stats->buffered = pcap_head < PCAP_RING_RECORDS ? pcap_head : PCAP_RING_RECORDS;
+}
+
+// =============================================================================
+// Export
+// =============================================================================
+
+// Receives the file in pieces; returns false to abort
+typedef bool (*pcap_writer_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+static int pcap_export(pcap_writer_t write, void* ctx) {
+    pcap_file_header_t fh = {
+        PCAP_MAGIC, PCAP_VERSION_MAJOR, PCAP_VERSION_MINOR, 0, 0, PCAP_SNAPLEN_MAX, PCAP_LINKTYPE_ETH
+    };
+    uint32_t fill = sizeof(fh);
+    memcpy(pcap_chunk, &fh, sizeof(fh));
+
+    // Records from the oldest still in the ring up to the head at entry
+    uint32_t head = pcap_head;
+    uint32_t first = head > PCAP_RING_RECORDS ? head - PCAP_RING_RECORDS : 0;
+    int written = 0;
+    for (uint32_t n = first; n < head; n++) {
+        pcap_record_t* r = &pcap_ring[n & (PCAP_RING_RECORDS - 1)];
+        if (r->seq != n + 1) continue;
+        pcap_barrier();
+
+        uint16_t caplen = r->caplen;
+        if (caplen > PCAP_SNAPLEN_MAX) continue;
+        if (fill + sizeof(pcap_record_header_t) + caplen > PCAP_EXPORT_CHUNK) {
+            if (!write(ctx, pcap_chunk, fill)) return -1;
+            fill = 0;
+        }
+        uint32_t ms = r->ts_ms - pcap_epoch_ms;
+        pcap_record_header_t rh = { pcap_epoch_sec + ms / 1000, (ms % 1000) * 1000, caplen, r->len };
+        memcpy(pcap_chunk + fill + sizeof(rh), r->data, caplen);
+        pcap_barrier();
+        // Overwritten while being copied: leave it out
+        if (r->seq != n + 1) continue;
+        memcpy(pcap_chunk + fill, &rh, sizeof(rh));
+        fill += sizeof(rh) + caplen;
+        written++;
+    }
+    if (fill && !write(ctx, pcap_chunk, fill)) return -1;
+    return written;
+}
+
+typedef struct {
+    vfs_node_t* node;
+    uint32_t offset;
+} pcap_file_ctx_t;
+
+static bool pcap_file_write(void* ctx, const uint8_t* data, uint32_t len) {
+    pcap_file_ctx_t* f = (pcap_file_ctx_t*)ctx;
+    if (vfs_write(f->node, f->offset, len, data) != (int)len) return false;
+    f->offset += len;
+    return true;
+}
+
+int pcap_save(const char* path) {
+    pcap_file_ctx_t f = { NULL, 0 };
+    vfs_delete(path);
+    if (vfs_create(path) != VFS_OK || vfs_open(path, &f.node) != VFS_OK) return -1;
+    int n = pcap_export(pcap_file_write, &f);
+    vfs_close(f.node);
+    if (n < 0) vfs_delete(path);
+    return n;
+}
+
+static bool pcap_serial_write(void* ctx, const uint8_t* data, uint32_t len) {
+    uint16_t port = (uint16_t)(uintptr_t)ctx;
+    for (uint32_t i = 0; i < len; i++) serial_write_char(port, (char)data[i]);
+    return true;
+}
+
+int pcap_stream_serial(uint16_t port) {
+    // COM1 carries the console; any other port is set up on first use
+    if (port != SERIAL_COM1) serial_init(port);
+    return pcap_export(pcap_serial_write, (void*)(uintptr_t)port);
+}
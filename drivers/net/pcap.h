@@ -0,0 +1,81 @@
+#ifndef PCAP_H
+#define PCAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drivers/net/netdev.h"
+
+// =============================================================================
+// PACKET CAPTURE
+// netdev_rx and netdev_xmit copy the head of every frame that passes the
+// filter into a ring of fixed-size records, overwriting the oldest. The
+// ring is exported as a classic libpcap file (LINKTYPE_ETHERNET) to the
+// VFS or as a raw byte stream on a serial port.
+// =============================================================================
+
+#define PCAP_RING_RECORDS   256         // Power of two
+#define PCAP_SNAPLEN_MAX    256         // Bytes stored per frame
+#define PCAP_SNAPLEN        128         // Default snap length
+#define PCAP_FILTER_TERMS   8
+
+#define PCAP_DIR_RX         0
+#define PCAP_DIR_TX         1
+
+// Filter primitives, ANDed; each may be negated with "not"
+typedef enum {
+    PCAP_TERM_ETHERTYPE,                // arp, ip, ip6, ether proto <n>
+    PCAP_TERM_IPPROTO,                  // icmp, tcp, udp, ip proto <n>
+    PCAP_TERM_HOST,                     // host <a.b.c.d>: IPv4 or ARP source/target
+    PCAP_TERM_SRC_HOST,                 // src host <a.b.c.d>
+    PCAP_TERM_DST_HOST,                 // dst host <a.b.c.d>
+    PCAP_TERM_PORT,                     // port <n>: TCP/UDP source or destination
+    PCAP_TERM_DIR,                      // rx, tx
+    PCAP_TERM_DEV,                      // dev <name>
+} pcap_term_type_t;
+
+typedef struct {
+    uint8_t type;                       // pcap_term_type_t
+    bool negate;
+    uint32_t value;                     // Host order; DEV: interface index
+} pcap_term_t;
+
+typedef struct {
+    int count;
+    pcap_term_t terms[PCAP_FILTER_TERMS];
+} pcap_filter_t;
+
+typedef struct {
+    bool running;
+    uint16_t snaplen;
+    uint32_t seen;                      // Frames offered to the tap while running
+    uint32_t captured;                  // Frames stored (oldest overwritten first)
+    uint32_t filtered;                  // Frames rejected by the filter
+    uint32_t buffered;                  // Records currently in the ring
+} pcap_stats_t;
+
+// Set by pcap_start; tested inline so an idle tap costs a single load
+extern volatile bool pcap_active;
+
+void pcap_tap(netdev_t* dev, const pbuf_t* p, uint8_t dir);
+
+static inline void pcap_capture(netdev_t* dev, const pbuf_t* p, uint8_t dir) {
+    if (pcap_active) pcap_tap(dev, p, dir);
+}
+
+// Compiles "tcp port 80 not host 10.0.2.2" style expressions. An empty
+// expression matches everything. Returns false with 'error' pointing at the
+// offending word.
+bool pcap_filter_compile(pcap_filter_t* filter, int argc, const char** argv, const char** error);
+
+// Clears the ring and starts capturing (snaplen 0 = PCAP_SNAPLEN)
+void pcap_start(const pcap_filter_t* filter, uint16_t snaplen);
+void pcap_stop(void);
+void pcap_clear(void);
+void pcap_get_stats(pcap_stats_t* stats);
+
+// Both return the number of records written or -1. The ring may keep
+// filling while it is exported; records overwritten meanwhile are skipped.
+int pcap_save(const char* path);
+int pcap_stream_serial(uint16_t port);
+
+#endif // PCAP_H
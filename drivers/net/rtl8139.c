@@ -1,477 +1,547 @@
+// drivers/net/rtl8139.c
+// Realtek RTL8139 over its I/O BAR.
+//
+// The card receives into one contiguous ring: each frame is preceded by a
+// 4-byte header (status, length including the CRC) and starts on a dword
+// boundary. The ring runs in WRAP mode, so a frame that reaches the end of
+// the ring continues into a 1.5 KB tail behind it instead of wrapping and
+// is always contiguous. The poll op consumes frames up to the card's write
+// offset (CBR) and hands the space back with a single CAPR write per pass.
+// RX interrupts only wake the poll: the handler masks them in IMR and the
+// poll acknowledges ISR and unmasks once the ring is empty.
+//
+// TX uses the four fixed descriptors round robin; a descriptor is free
+// again once the card sets its OWN bit.
+
 #include "rtl8139.h"
 #include "drivers/char/io.h"
-#include "mm/kmalloc.h"
-#include <stdint.h>
-#include "lib/libc/stdio.h"
-#include "lib/libc/stdlib.h"
-#include "arch/x86/include/sys.h"
-#include <stddef.h>
 #include "drivers/bus/pci.h"
-#include "drivers/net/ethernet.h"
-
-#define CR_WRITABLE_MASK (CR_RECEIVER_ENABLE | CR_TRANSMITTER_ENABLE)
-
-// RTL8139-spezifische Konstanten
-#define RTL8139_VENDOR_ID  0x10EC
-#define RTL8139_DEVICE_ID  0x8139
-
-#define REG_ID0 0x00
-#define REG_ID4 0x04
-#define REG_TRANSMIT_STATUS0 0x10
-#define REG_TRANSMIT_ADDR0 0x20
-#define REG_RECEIVE_BUFFER 0x30
-#define REG_COMMAND 0x37
-#define CR_RECEIVER_ENABLE (1 << 3)
-#define CR_TRANSMITTER_ENABLE (1 << 2)
-#define CR_WRITABLE_MASK (CR_RECEIVER_ENABLE | CR_TRANSMITTER_ENABLE)
-#define REG_CUR_READ_ADDR 0x38
-#define REG_INTERRUPT_MASK 0x3C
-#define REG_INTERRUPT_STATUS 0x3E
-#define REG_TRANSMIT_CONFIGURATION 0x40
-#define REG_RECEIVE_CONFIGURATION 0x44
-// Werte für die Register // Kontrollregister
-
-#define CR_RESET (1 << 4)
-#define CR_RECEIVER_ENABLE (1 << 3)
-#define CR_TRANSMITTER_ENABLE (1 << 2)
-#define CR_BUFFER_IS_EMPTY (1 << 0)
-// Transmitter-Konfiguration
-
-#define TCR_IFG_STANDARD (3 << 24)
-#define TCR_MXDMA_512 (5 << 8)
-#define TCR_MXDMA_1024 (6 << 8)
-#define TCR_MXDMA_2048 (7 << 8)
-// Receiver-Konfiguration
-
-#define RCR_MXDMA_512 (5 << 8)
-#define RCR_MXDMA_1024 (6 << 8)
-#define RCR_MXDMA_UNLIMITED (7 << 8)
-#define RCR_ACCEPT_BROADCAST (1 << 3)
-#define RCR_ACCEPT_MULTICAST (1 << 2)
-#define RCR_ACCEPT_PHYS_MATCH (1 << 1)
-// Interrupt-Statusregister
-
-#define ISR_RECEIVE_BUFFER_OVERFLOW (1 << 4)
-#define ISR_TRANSMIT_OK (1 << 2)
-#define ISR_RECEIVE_OK (1 << 0)
-
+#include "drivers/net/netdev.h"
+#include "drivers/net/netstack.h"
+#include "drivers/net/pbuf.h"
+#include "arch/x86/include/sys.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
 
+#include <stdint.h>
+#include <stddef.h>
 
-#define MAX_TX_BUFFERS 4
-#define TX_BUFFER_SIZE 2048 // Dynamische Größe für jeden TX-Puffer
+// Registers
+#define REG_IDR0            0x00
+#define REG_MAR0            0x08
+#define REG_TSD0            0x10        // 4 x 32 bit
+#define REG_TSAD0           0x20        // 4 x 32 bit
+#define REG_RBSTART         0x30
+#define REG_CR              0x37
+#define REG_CAPR            0x38        // Current address of packet read (minus 16)
+#define REG_CBR             0x3A        // Current buffer address: the card's write offset
+#define REG_IMR             0x3C
+#define REG_ISR             0x3E
+#define REG_TCR             0x40
+#define REG_RCR             0x44
+#define REG_MPC             0x4C        // Missed packet counter
+
+// Command register
+#define CR_RST              0x10
+#define CR_RE               0x08
+#define CR_TE               0x04
+#define CR_BUFE             0x01
+
+// Interrupt status / mask
+#define ISR_ROK             0x0001
+#define ISR_RER             0x0002
+#define ISR_TOK             0x0004
+#define ISR_TER             0x0008
+#define ISR_RXOVW           0x0010
+#define ISR_PUN             0x0020      // Packet underrun / link change
+#define ISR_FOVW            0x0040
+#define ISR_SERR            0x8000
+#define ISR_RX              (ISR_ROK | ISR_RER | ISR_RXOVW | ISR_FOVW)
+#define IMR_DEFAULT         (ISR_RX | ISR_PUN | ISR_SERR)
+
+// Receive configuration
+#define RCR_APM             0x00000002  // Own address
+#define RCR_AM              0x00000004  // Multicast
+#define RCR_AB              0x00000008  // Broadcast
+#define RCR_WRAP            0x00000080
+#define RCR_MXDMA_UNLIMITED (7 << 8)
+#define RCR_RBLEN_32K       (2 << 11)
+#define RCR_RXFTH_NONE      (7 << 13)   // Start DMA once the whole frame is in
+#define RCR_DEFAULT         (RCR_APM | RCR_AM | RCR_AB | RCR_WRAP | RCR_MXDMA_UNLIMITED | \
+                             RCR_RBLEN_32K | RCR_RXFTH_NONE)
+
+// Transmit configuration and status
+#define TCR_MXDMA_2048      (7 << 8)
+#define TCR_IFG_STANDARD    (3 << 24)
+#define TCR_LOOPBACK        (3 << 17)
+#define TSD_OWN             (1 << 13)   // Set by the card once the buffer may be reused
+#define TSD_ERTXTH_256      (8 << 16)   // Early TX threshold in 32-byte units
+
+// RX header status
+#define RX_STAT_ROK         0x0001
+
+#define RX_RING_SIZE        32768       // Must match RCR_RBLEN
+#define RX_RING_TAIL        (16 + 1536) // WRAP overflow area behind the ring
+#define RX_EARLY_RX         0xFFF0      // Length while the card is still copying
+#define RX_MIN_SIZE         (14 + 4)
+#define RX_MAX_SIZE         (1514 + 4)
+
+#define TX_DESCRIPTORS      4
+#define TX_BUFFER_SIZE      1536
+#define TX_MIN_FRAME        60
+
+static uint8_t rx_ring[RX_RING_SIZE + RX_RING_TAIL] __attribute__((aligned(16)));
+static uint8_t tx_buffers[TX_DESCRIPTORS][TX_BUFFER_SIZE] __attribute__((aligned(16)));
+
+static uint16_t io_base = 0;
+static uint8_t irq_line = 0;
+static uint8_t mac_address[6];
+static bool initialized = false;
+static uint32_t rx_offset = 0;          // Next header to read
+static volatile bool rx_poll_scheduled = false;
+static uint8_t tx_cur = 0;
+static rtl8139_stats_t stats;
+static netdev_t rtl8139_netdev;
+
+typedef void (*rtl8139_deliver_t)(pbuf_t* p);
+
+// =============================================================================
+// Interrupts
+// =============================================================================
+static void rtl8139_isr(void) {
+    uint16_t isr = inw(io_base + REG_ISR);
+    if (!isr || isr == 0xFFFF) {
+        return;
+    }
 
-#define RX_BUFFER_SIZE (64 * 1024) // 64 KB für den RX-Puffer
-#define REG_RECEIVE_BUFFER 0x30    // Offset für RBSTART-Register
+    // RX causes stay latched until the poll has drained the ring
+    if (isr & ISR_RX) {
+        outw(io_base + REG_IMR, IMR_DEFAULT & ~ISR_RX);
+        rx_poll_scheduled = true;
+        stats.interrupts++;
+    }
+    if (isr & ~ISR_RX) {
+        outw(io_base + REG_ISR, isr & ~ISR_RX);
+    }
+    if (isr & ISR_SERR) {
+        printf("RTL8139: PCI system error\n");
+    }
+}
 
-// Gültiger Bereich für RTL8139 (32-Bit-Adressraum)
-#define MAX_DMA_ADDRESS 0xFFFFFFFF
+// =============================================================================
+// RX
+// =============================================================================
+
+// Restart the receiver after a corrupt header; the ring starts over at 0
+static void rtl8139_rx_reset(void) {
+    outb(io_base + REG_CR, CR_TE);
+    outb(io_base + REG_CR, CR_RE | CR_TE);
+    outl(io_base + REG_RCR, RCR_DEFAULT);
+    rx_offset = 0;
+    outw(io_base + REG_CAPR, (uint16_t)(rx_offset - 16));
+}
 
-typedef struct {
-    uint32_t tx_buffers[TX_BUFFER_SIZE];
-    uint32_t rx_buffers[RX_BUFFER_SIZE];
-    volatile uint32_t *mmio_base;     // MMIO base address
-    uint32_t irq;                     // IRQ number
-    uint32_t tx_producer;             // TX producer index
-    uint32_t rx_producer;             // RX producer index
-} rtl8139_device_t;
+static bool rtl8139_rx_pending(void) {
+    return (inw(io_base + REG_CBR) % RX_RING_SIZE) != rx_offset;
+}
 
-rtl8139_device_t rtl8139_device = {0};
+// Takes up to 'budget' frames out of the ring. Frames up to the write
+// offset read at the start of a pass are consumed without touching the
+// card; CAPR is written once per pass.
+static int rtl8139_rx(int budget, rtl8139_deliver_t deliver) {
+    int done = 0;
 
-// static uint8_t* tx_buffers[MAX_TX_BUFFERS] = {NULL}; // Dynamische TX-Puffer
-// static uint8_t current_tx_buffer = 0;               // Aktueller TX-Puffer
+    while (done < budget) {
+        uint32_t cbr = inw(io_base + REG_CBR) % RX_RING_SIZE;
+        if (cbr == rx_offset) {
+            break;
+        }
+        uint32_t start = rx_offset;
+
+        while (done < budget && rx_offset != cbr) {
+            const uint8_t* hdr = rx_ring + rx_offset;
+            uint16_t status = *(const volatile uint16_t*)hdr;
+            uint16_t size = *(const volatile uint16_t*)(hdr + 2);
+            if (size == RX_EARLY_RX) {
+                break;
+            }
+            if (!(status & RX_STAT_ROK) || size < RX_MIN_SIZE || size > RX_MAX_SIZE) {
+                stats.rx_errors++;
+                rtl8139_rx_reset();
+                return done;
+            }
+
+            uint16_t len = (uint16_t)(size - 4);
+            pbuf_t* p = pbuf_alloc(0);
+            if (p) {
+                memcpy(pbuf_put(p, len), hdr + 4, len);
+                stats.rx_packets++;
+                stats.rx_bytes += len;
+                deliver(p);
+            } else {
+                stats.rx_dropped++;
+            }
+            rx_offset = ((rx_offset + size + 4 + 3) & ~3u) % RX_RING_SIZE;
+            done++;
+        }
 
-// // Globale Variablen
-// uint8_t* rx_buffer = NULL;
+        if (rx_offset == start) {
+            break;
+        }
+        outw(io_base + REG_CAPR, (uint16_t)(rx_offset - 16));
+        stats.capr_writes++;
+    }
+    return done;
+}
 
-void write_and_verify_register(uint32_t base, uint32_t offset, uint32_t value) {
-    // Write the value to the register
-    outl(base + offset, value);
+static void rtl8139_deliver(pbuf_t* p) {
+    netdev_rx(&rtl8139_netdev, p);
+}
 
-    // Read the value back
-    uint32_t read_value = inl(base + offset);
+static int rtl8139_poll(netdev_t* dev, int budget) {
+    (void)dev;
+    int done = rtl8139_rx(budget, rtl8139_deliver);
+    if (done > 0) {
+        stats.polls++;
+    }
 
-    // Compare written and read values
-    if (read_value != value) {
-        printf("(!)Register write mismatch @ 0x%X. Written: 0x%08X, Read: 0x%08X\n",
-               offset, value, read_value);
+    // Ring drained: acknowledge the RX causes, then check once more so a
+    // frame that arrived before the acknowledgement is not left behind
+    if (done < budget && (done > 0 || rx_poll_scheduled)) {
+        uint16_t isr = inw(io_base + REG_ISR) & ISR_RX;
+        if (isr & (ISR_RXOVW | ISR_FOVW)) {
+            stats.rx_overflows++;
+        }
+        if (isr) {
+            outw(io_base + REG_ISR, isr);
+        }
+        if (rx_poll_scheduled && !rtl8139_rx_pending()) {
+            rx_poll_scheduled = false;
+            outw(io_base + REG_IMR, IMR_DEFAULT);
+        }
     }
+    return done;
 }
 
-void write_and_verify_register_b(uint32_t base, uint8_t offset, uint8_t value) {
-    outb(base + offset, value);
-
-    uint8_t read_value = inb(base + offset);
+// =============================================================================
+// TX
+// =============================================================================
+static bool rtl8139_tx_free(uint8_t desc) {
+    return inl(io_base + REG_TSD0 + desc * 4) & TSD_OWN;
+}
 
-    if ((read_value & CR_WRITABLE_MASK) != (value & CR_WRITABLE_MASK)) {
-        printf("Warning: Command register mismatch. Expected: 0x%02X, Actual: 0x%02X\n",
-               value & CR_WRITABLE_MASK, read_value & CR_WRITABLE_MASK);
+static bool rtl8139_tx(const void* data, uint16_t len) {
+    if (len > TX_BUFFER_SIZE) {
+        return false;
+    }
+    if (!rtl8139_tx_free(tx_cur)) {
+        stats.tx_busy++;
+        return false;
     }
-}
 
-void write_and_verify_register_w(uint32_t base, uint32_t offset, uint32_t value) {
-    // Write the value to the register
-    outw(base + offset, value);
+    uint8_t* buf = tx_buffers[tx_cur];
+    memcpy(buf, data, len);
+    if (len < TX_MIN_FRAME) {
+        memset(buf + len, 0, TX_MIN_FRAME - len);
+        len = TX_MIN_FRAME;
+    }
+    // Writing the size clears OWN and starts the transfer
+    outl(io_base + REG_TSD0 + tx_cur * 4, TSD_ERTXTH_256 | len);
+    tx_cur = (uint8_t)((tx_cur + 1) % TX_DESCRIPTORS);
 
-    // Read the value back
-    uint32_t read_value = inw(base + offset);
+    stats.tx_packets++;
+    stats.tx_bytes += len;
+    return true;
+}
 
-    // Compare written and read values
-    if (read_value != value) {
-        printf("Warning: Register write mismatch at offset 0x%X. Written: 0x%08X, Read: 0x%08X\n",
-               offset, value, read_value);
+void rtl8139_send_packet(void* data, uint16_t len) {
+    if (!initialized || !rtl8139_tx(data, len)) {
+        printf("RTL8139: send of %u bytes failed\n", len);
     }
 }
 
-void enable_rx_tx(uint32_t base) {
-    uint8_t command_value = CR_RECEIVER_ENABLE | CR_TRANSMITTER_ENABLE;
-    write_and_verify_register_b(base, REG_COMMAND, command_value & CR_WRITABLE_MASK);
+// =============================================================================
+// netdev glue
+// =============================================================================
+static bool rtl8139_netdev_xmit(netdev_t* dev, pbuf_t* p) {
+    (void)dev;
+    bool ok = rtl8139_tx(p->data, p->len);
+    pbuf_free(p);
+    return ok;
 }
 
-/**
- * Prüft, ob die Adresse im gültigen Bereich für die RTL8139 liegt.
- *
- * @param address Die zu prüfende Adresse.
- * @return 1, wenn die Adresse gültig ist, sonst 0.
- */
-int is_address_valid(uintptr_t address) {
-    return (address <= MAX_DMA_ADDRESS);
+static bool rtl8139_netdev_tx_ready(netdev_t* dev) {
+    (void)dev;
+    return rtl8139_tx_free(tx_cur);
 }
 
-/**
- * Überprüft die RX- und TX-Pufferadressen und gibt Fehler aus, wenn sie ungültig sind.
- */
-void check_buffer_addresses(void* rx_buffer, uint8_t** tx_buffers, int tx_buffer_count) {
-    uintptr_t rx_address = (uintptr_t)rx_buffer;
-
-    // RX-Puffer überprüfen
-    if (!is_address_valid(rx_address)) {
-        printf("Fehler: RX-Puffer-Adresse (0x%016lX) liegt außerhalb des erlaubten Bereichs.\n", rx_address);
-    } 
-
-    // TX-Puffer überprüfen
-    for (int i = 0; i < tx_buffer_count; ++i) {
-        uintptr_t tx_address = (uintptr_t)tx_buffers[i];
-        if (!is_address_valid(tx_address)) {
-            printf("Fehler: TX-Puffer %d-Adresse (0x%016lX) liegt außerhalb des erlaubten Bereichs.\n", i, tx_address);
-        }
-    }
+static void rtl8139_netdev_get_mac(netdev_t* dev, uint8_t* mac) {
+    (void)dev;
+    rtl8139_get_mac_address(mac);
 }
 
-// Hilfsfunktion: Unmaskiert einen IRQ
-// void unmask_irq(uint8_t irq) {
-//     uint16_t port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
-//     uint8_t value = inb(port);
-//     value &= ~(1 << (irq % 8));
-//     outb(port, value);
-// }
-
-void initialize_rx_buffer() {
-    // Allokiere Speicher für den RX-Puffer
-    // rtl8139_device.rx_buffers = (uint8_t*)aligned_alloc(4096, RX_BUFFER_SIZE); // 4-KB-Ausrichtung
-    // if (!rx_buffer) {
-    //     printf("Fehler: RX-Puffer konnte nicht allokiert werden.\n");
-    //     return;
-    // }
-
-    // // RX-Puffer mit Nullen initialisieren
-    // memset(rx_buffer, 0, RX_BUFFER_SIZE);
-
-    // Schreibe die physische Adresse des RX-Puffers in das RBSTART-Register
-    uintptr_t phys_address = (uintptr_t)rtl8139_device.rx_buffers;
-    if (phys_address > 0xFFFFFFFF) {
-        printf("Fehler: RX-Puffer-Adresse liegt außerhalb des 32-Bit-Adressraums.\n");
-        free(rtl8139_device.rx_buffers);
-        return;
+static void rtl8139_netdev_get_stats(netdev_t* dev, netdev_stats_t* st) {
+    *st = dev->stats;
+    st->rx_dropped = stats.rx_dropped + stats.rx_errors + inl(io_base + REG_MPC);
+    st->tx_dropped = stats.tx_busy;
+}
+
+static const netdev_ops_t rtl8139_netdev_ops = {
+    .xmit = rtl8139_netdev_xmit,
+    .poll = rtl8139_poll,
+    .tx_ready = rtl8139_netdev_tx_ready,
+    .get_mac = rtl8139_netdev_get_mac,
+    .get_stats = rtl8139_netdev_get_stats,
+};
+
+// =============================================================================
+// Setup
+// =============================================================================
+static void rtl8139_init(void) {
+    outb(io_base + REG_CR, CR_RST);
+    for (int timeout = 100000; (inb(io_base + REG_CR) & CR_RST) && timeout > 0; timeout--) {
     }
 
-    write_and_verify_register(rtl8139_device.mmio_base, REG_RECEIVE_BUFFER, (uint32_t)phys_address);
+    for (int i = 0; i < 6; i++) {
+        mac_address[i] = inb(io_base + REG_IDR0 + i);
+    }
 
-    //printf("RX-Puffer initialisiert: Virtuelle Adresse = %p, Physische Adresse = 0x%08X\n", rx_buffer, (uint32_t)phys_address);
+    outl(io_base + REG_RBSTART, (uint32_t)rx_ring);
+    for (int i = 0; i < TX_DESCRIPTORS; i++) {
+        outl(io_base + REG_TSAD0 + i * 4, (uint32_t)tx_buffers[i]);
+    }
+    rx_offset = 0;
+    tx_cur = 0;
+
+    // RE/TE first: TCR and RCR only take effect with the engines enabled
+    outb(io_base + REG_CR, CR_RE | CR_TE);
+    outl(io_base + REG_MAR0, 0xFFFFFFFF);
+    outl(io_base + REG_MAR0 + 4, 0xFFFFFFFF);
+    outl(io_base + REG_RCR, RCR_DEFAULT);
+    outl(io_base + REG_TCR, TCR_IFG_STANDARD | TCR_MXDMA_2048);
+    outl(io_base + REG_MPC, 0);
+
+    register_interrupt_handler(irq_line, rtl8139_isr);
+    outw(io_base + REG_ISR, 0xFFFF);
+    outw(io_base + REG_IMR, IMR_DEFAULT);
 }
 
-void initialize_tx_buffers() {
-    // for (int i = 0; i < MAX_TX_BUFFERS; ++i) {
-    //     tx_buffers[i] = (uint8_t*)malloc(TX_BUFFER_SIZE);
-    //     if (!tx_buffers[i]) {
-    //         printf("Fehler: Speicherzuweisung für TX-Puffer %d fehlgeschlagen.\n", i);
-    //     }
-    // }
+void rtl8139_get_mac_address(uint8_t* mac) {
+    memcpy(mac, mac_address, 6);
 }
 
-void free_tx_buffers() {
-    // for (int i = 0; i < MAX_TX_BUFFERS; ++i) {
-    //     if (tx_buffers[i]) {
-    //         free(tx_buffers[i]);
-    //         tx_buffers[i] = NULL;
-    //         printf("TX-Puffer %d freigegeben.\n", i);
-    //     }
-    // }
+void rtl8139_get_stats(rtl8139_stats_t* out) {
+    *out = stats;
 }
 
-// Initialisiert die RTL8139-Netzwerkkarte
-void rtl8139_init(rtl8139_device_t *device) {
-    // printf("Initialisiere RTL8139 Netzwerkkarte...\n");
-    // printf("PCI-Konfiguration: IO-Base-Adresse = 0x%04X\n", rtl8139_device.mmio_base);
-
-    outb(rtl8139_device.mmio_base + REG_COMMAND, CR_RESET);
-    while (inb(rtl8139_device.mmio_base + REG_COMMAND) & CR_RESET);
-
-    initialize_rx_buffer();
-    initialize_tx_buffers();
+int rtl8139_probe(pci_device_t* pci_dev) {
+    if (pci_dev->vendor_id != RTL8139_VENDOR_ID || pci_dev->device_id != RTL8139_DEVICE_ID) {
+        return -1;
+    }
+    if (!(pci_dev->bar[0] & 0x01)) {
+        printf("RTL8139: BAR0 is not an I/O BAR\n");
+        return -1;
+    }
 
-    check_buffer_addresses(rtl8139_device.rx_buffers, rtl8139_device.tx_buffers, MAX_TX_BUFFERS);
+    pci_enable_device(pci_dev);
+    pci_set_bus_master(pci_dev->bus, pci_dev->slot, 1);
+    io_base = (uint16_t)(pci_dev->bar[0] & ~0x3);
+    irq_line = pci_configure_irq(pci_dev);
 
-    write_and_verify_register(rtl8139_device.mmio_base, REG_RECEIVE_CONFIGURATION,
-                          0x0000000F | // Accept all packets
-                          (1 << 7) |   // Wrap around buffer
-                          (7 << 8));   // Maximum DMA burst size
+    rtl8139_init();
+    initialized = true;
 
-    write_and_verify_register_w(rtl8139_device.mmio_base, REG_INTERRUPT_MASK, 0x0005); // Enable RX and TX interrupts
-    enable_rx_tx(rtl8139_device.mmio_base);
+    char mac_s[18];
+    format_mac(mac_address, mac_s);
+    printf("RTL8139: MAC %s, IO Base 0x%04X, IRQ %u, RX ring %u KB\n",
+           mac_s, io_base, irq_line, RX_RING_SIZE / 1024);
 
-    printf("RTL8139 initialisiert.\n");
+    rtl8139_netdev.ops = &rtl8139_netdev_ops;
+    rtl8139_netdev.speed = 100;
+    netdev_register(&rtl8139_netdev);
+    return 0;
 }
 
-void rtl8139_send_packet(void* data, uint16_t len) {
-    if (len > TX_BUFFER_SIZE) {
-        printf("Error: Packet too large (%u bytes, max %u bytes).\n", len, TX_BUFFER_SIZE);
-        return;
-    }
+void rtl8139_detect() {
+    printf("Detecting rtl8139 network card...\n");
 
-    uint32_t io_base = (uint32_t)rtl8139_device.mmio_base;
-    static uint8_t current_tx_buffer = 0;
-    
-    // Copy data to TX buffer
-    memcpy((void*)rtl8139_device.tx_buffers, data, len);
-
-    printf("RTL8139: Sending via TX buffer %u\n", current_tx_buffer);
-    printf("  Buffer addr: 0x%08X, Length: %u bytes\n", (uint32_t)rtl8139_device.tx_buffers, len);
-    printf("  IO base: 0x%08X\n", io_base);
-    
-    // Write TX buffer physical address to TSAD register
-    uint32_t tx_buffer_phys = (uint32_t)rtl8139_device.tx_buffers;
-    outl(io_base + REG_TRANSMIT_ADDR0 + (current_tx_buffer * 4), tx_buffer_phys);
-    
-    // Write packet length and trigger transmission
-    outl(io_base + REG_TRANSMIT_STATUS0 + (current_tx_buffer * 4), len & 0x1FFF);
-    
-    // Wait a bit and check status
-    for (volatile int i = 0; i < 10000; i++);
-    
-    uint32_t status = inl(io_base + REG_TRANSMIT_STATUS0 + (current_tx_buffer * 4));
-    printf("  TX Status after send: 0x%08X\n", status);
-    if (status & (1 << 15)) printf("    TOK: Transmit OK\n");
-    if (status & (1 << 14)) printf("    TUN: Transmit FIFO Underrun\n");
-    if (status & (1 << 13)) printf("    OWN: Owned by NIC\n");
-    
-    printf("RTL8139: Packet sent via buffer %u (%u bytes)\n", current_tx_buffer, len);
-    
-    // Move to next TX buffer (RTL8139 has 4 TX descriptors)
-    current_tx_buffer = (current_tx_buffer + 1) % 4;
+    pci_register_driver(RTL8139_VENDOR_ID, RTL8139_DEVICE_ID, rtl8139_probe);
 }
 
-// Empfängt ein Ethernet-Paket
-void rtl8139_receive_packet() {
-    static uint32_t rx_offset = 0;
-
-    while (!(inb(rtl8139_device.mmio_base + REG_COMMAND) & 0x01)) { // Check RX buffer empty
-        uint16_t status = *(volatile uint16_t*)(rtl8139_device.rx_buffers + rx_offset);
-        uint16_t length = *(volatile uint16_t*)(rtl8139_device.rx_buffers + rx_offset + 2);
+int rtl8139_is_initialized() {
+    return initialized;
+}
 
-        printf("RX Offset: %u, Status: 0x%04X, Length: %u\n", rx_offset, status, length);
+// =============================================================================
+// Receive-rate benchmark
+// =============================================================================
+#define RTL8139_BENCH_ETHERTYPE 0x88B5  // Local experimental
 
-        if (status == 0 || length == 0) {
-            printf("No valid packets in RX buffer at offset %u.\n", rx_offset);
-            return;
-        }
+static uint32_t bench_next_seq;
+static uint32_t bench_good;
 
+static inline uint64_t rtl8139_rdtsc(void) {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
 
-        if (!(status & 0x01)) { // Check "Packet OK" bit
-            printf("Invalid packet received. Status: 0x%04X\n", status);
-            break;
-        }
+// Frames must come back in order; after a gap the count resumes at the
+// next frame seen
+static void rtl8139_bench_sink(pbuf_t* p) {
+    uint32_t seq;
+    memcpy(&seq, p->data + 14, sizeof(seq));
+    if (p->len >= 18 && seq == bench_next_seq) {
+        bench_good++;
+    }
+    bench_next_seq = seq + 1;
+    pbuf_free(p);
+}
 
-        if (length == 0 || length > 1500) { // Ensure length is within bounds
-            printf("Error: Invalid packet length: %u\n", length);
-            break;
+// Wait until every descriptor is back with the driver
+static bool rtl8139_bench_tx_idle(uint32_t timeout_ms) {
+    uint32_t start = pit_get_ticks();
+    for (;;) {
+        bool idle = true;
+        for (uint8_t d = 0; d < TX_DESCRIPTORS; d++) {
+            idle = idle && rtl8139_tx_free(d);
         }
-
-        // Dump packet data for debugging
-        uint8_t* packet = rtl8139_device.rx_buffers + rx_offset + 4;
-        printf("Packet Data (first 16 bytes): ");
-        for (int i = 0; i < 16; i++) {
-            printf("%02X ", packet[i]);
+        if (idle) {
+            return true;
         }
-        printf("\n");
-
-        // Process the packet
-        handle_ethernet_frame(packet, length);
-
-        // Update RX offset (4-byte aligned)
-        rx_offset = (rx_offset + length + 4 + 3) & ~3; // 4-byte alignment
-        if (rx_offset >= RX_BUFFER_SIZE) {
-            rx_offset -= RX_BUFFER_SIZE; // Wrap around
+        if (pit_get_ticks() - start >= timeout_ms) {
+            return false;
         }
-        outw(rtl8139_device.mmio_base + 0x38, rx_offset - 16); // Update CURR register
     }
-
-    hex_dump(rtl8139_device.rx_buffers, RX_BUFFER_SIZE);
 }
 
-// Interrupt-Handler
-void rtl8139_interrupt_handler() {
-    uint16_t isr = inw(rtl8139_device.mmio_base + REG_INTERRUPT_STATUS);
-    printf("+++++++ rtl8139 Interrupt Status: 0x%04X\n", isr);
-
-    if (isr & 0x01) { // RX OK
-        printf("RX OK: Packet received interrupt triggered.\n");
-        rtl8139_receive_packet();
+bool rtl8139_rx_benchmark(uint32_t count, uint16_t size, rtl8139_bench_t* result) {
+    memset(result, 0, sizeof(*result));
+    if (!initialized || count == 0) {
+        return false;
     }
+    if (size < TX_MIN_FRAME) size = TX_MIN_FRAME;
+    if (size > 1514) size = 1514;
 
-    if (isr & 0x04) { // TX OK
-        printf("TX OK: Packet sent interrupt triggered.\n");
+    // Whatever is still in the ring belongs to the stack
+    outw(io_base + REG_IMR, 0);
+    while (rtl8139_rx(64, rtl8139_deliver) > 0) {
     }
 
-    // Clear the handled interrupts
-    outw(rtl8139_device.mmio_base + REG_INTERRUPT_STATUS, isr);
-}
-
-void rtl8139_get_mac_address(uint8_t* mac) {
-    for (int i = 0; i < 6; i++) {
-        mac[i] = inb((unsigned short)(rtl8139_device.mmio_base + i));
+    uint8_t frame[1514];
+    memcpy(frame, mac_address, 6);
+    memcpy(frame + 6, mac_address, 6);
+    frame[12] = RTL8139_BENCH_ETHERTYPE >> 8;
+    frame[13] = RTL8139_BENCH_ETHERTYPE & 0xFF;
+    for (uint16_t i = 18; i < size; i++) {
+        frame[i] = (uint8_t)i;
     }
-}
-
-// // Findet die RTL8139-Karte im PCI-Bus
-// int find_rtl8139() {
-//     for (uint16_t bus = 0; bus < 256; ++bus) {
-//         for (uint8_t device = 0; device < 32; ++device) {
-//             // Prüfen, ob das Gerät existiert
-//             uint32_t id = pci_read(bus, device, 0, 0);
-//             if ((id & 0xFFFF) == 0xFFFF) { // Kein Gerät vorhanden
-//                 continue;
-//             }
-
-//             // Prüfen, ob das Gerät mehrere Funktionen unterstützt
-//             uint32_t header_type = pci_read(bus, device, 0, 0x0C) >> 16;
-//             uint8_t multifunction = (header_type & 0x80) != 0;
-
-//             // Über alle Funktionen iterieren
-//             for (uint8_t function = 0; function < (multifunction ? 8 : 1); ++function) {
-//                 // PCI-Geräte-ID und Vendor-ID auslesen
-//                 id = pci_read(bus, device, function, 0);
-//                 if ((id & 0xFFFF) == RTL8139_VENDOR_ID && ((id >> 16) & 0xFFFF) == RTL8139_DEVICE_ID) {
-//                     // BAR0 (I/O Base) auslesen
-//                     uint32_t bar0 = pci_read(bus, device, function, 0x10);
-//                     rtl8139_io_base = bar0 & ~0x3; // Nur I/O-Bits verwenden
-
-//                     //pci_set_irq(bus, device, function, 11);
-
-//                     // IRQ-Nummer auslesen
-//                     uint32_t irq_line = pci_read(bus, device, function, 0x3C) & 0xFF;
-//                     printf("RTL8139 gefunden: Bus %u, Device %u, Funktion %u, IRQ %u\n", bus, device, function, irq_line);
-
-//                     // Bus Mastering aktivieren
-//                     pci_set_bus_master(bus, device, 1);
-
-//                     // Interrupt-Handler registrieren
-//                     register_interrupt_handler(irq_line, rtl8139_interrupt_handler);
-//                     //unmask_irq(irq_line);
-
-//                     // MAC-Adresse ausgeben
-//                     print_mac_address();
-
-//                     return 0;
-//                 }
-//             }
-//         }
-//     }
-//     return -1; // Keine RTL8139-Karte gefunden
-// }
-
-void rtl8139_probe(pci_device_t *pci_dev) {
-    if (pci_dev->vendor_id == RTL8139_VENDOR_ID && pci_dev->device_id == RTL8139_DEVICE_ID) {
-        //printf("Detected e1000 device\n");
-        // Enable the device
-        pci_enable_device(pci_dev);
-
-        // Map MMIO region
-        uint64_t bar0 = pci_read_bar(pci_dev, 0);
-        rtl8139_device.mmio_base = (volatile uint32_t *)map_mmio(bar0);
-
-        // Configure IRQ
-        rtl8139_device.irq = pci_configure_irq(pci_dev);
-
-        // Initialize the device
-        rtl8139_init(&rtl8139_device);
-
-        uint8_t mac[6];
-        rtl8139_get_mac_address(&mac);
-
-        printf("RTL8139 MAC: %02X:%02X:%02X:%02X:%02X:%02X, ", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        printf("IO Base: 0x%08X, IRQ: %u\n", rtl8139_device.mmio_base, rtl8139_device.irq);
 
+    // Fill the ring with as many frames as fit, then time draining them
+    uint32_t stride = (size + 4 + 4 + 3) & ~3u;
+    uint32_t per_fill = (RX_RING_SIZE - RX_MAX_SIZE) / stride;
+    uint32_t tcr = inl(io_base + REG_TCR);
+    outl(io_base + REG_TCR, tcr | TCR_LOOPBACK);
+
+    bench_next_seq = 0;
+    bench_good = 0;
+    uint32_t sent = 0;
+    uint32_t start = pit_get_ticks();
+    while (sent < count) {
+        uint32_t n = count - sent < per_fill ? count - sent : per_fill;
+        uint32_t queued = 0;
+        while (queued < n) {
+            if (!rtl8139_bench_tx_idle(100)) {
+                break;
+            }
+            for (uint8_t d = 0; d < TX_DESCRIPTORS && queued < n; d++, queued++) {
+                uint32_t seq = sent + queued;
+                memcpy(frame + 14, &seq, sizeof(seq));
+                rtl8139_tx(frame, size);
+            }
+        }
+        rtl8139_bench_tx_idle(100);
+        sent += queued;
+
+        uint64_t t0 = rtl8139_rdtsc();
+        uint32_t got = 0;
+        while (got < queued) {
+            int r = rtl8139_rx((int)(queued - got), rtl8139_bench_sink);
+            if (r <= 0) {
+                break;
+            }
+            got += (uint32_t)r;
+        }
+        result->rx_cycles += rtl8139_rdtsc() - t0;
+        result->batches++;
+        if (queued < n) {
+            break;
+        }
     }
-}
+    result->elapsed_ms = pit_get_ticks() - start;
 
-void rtl8139_detect() {
-    printf("Detecting rtl8139 network card...\n");
-
-    pci_register_driver(RTL8139_VENDOR_ID, RTL8139_DEVICE_ID, rtl8139_probe);
-}
+    outl(io_base + REG_TCR, tcr);
+    outw(io_base + REG_ISR, ISR_RX);
+    rx_poll_scheduled = false;
+    outw(io_base + REG_IMR, IMR_DEFAULT);
 
-int rtl8139_is_initialized() {
-    return (rtl8139_device.mmio_base != 0);
+    result->frames = bench_good;
+    result->bytes = result->frames * size;
+    result->lost = count - result->frames;
+    return result->lost == 0;
 }
 
-
+// =============================================================================
+// Test frame
+// =============================================================================
 void rtl8139_send_test_packet() {
     printf("RTL8139: Sending broadcast ARP packet...\n");
-    
+
     // Get our MAC address
     uint8_t our_mac[6];
     rtl8139_get_mac_address(our_mac);
-    
+
     printf("RTL8139: Our MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
            our_mac[0], our_mac[1], our_mac[2], our_mac[3], our_mac[4], our_mac[5]);
-    
+
     // Create broadcast ARP request packet
     uint8_t packet[60];  // Minimum ethernet frame size
     memset(packet, 0, 60);
-    
+
     // Ethernet header
     // Destination: Broadcast
     packet[0] = 0xFF; packet[1] = 0xFF; packet[2] = 0xFF;
     packet[3] = 0xFF; packet[4] = 0xFF; packet[5] = 0xFF;
-    
+
     // Source: Our MAC
     packet[6] = our_mac[0]; packet[7] = our_mac[1]; packet[8] = our_mac[2];
     packet[9] = our_mac[3]; packet[10] = our_mac[4]; packet[11] = our_mac[5];
-    
+
     // EtherType: ARP (0x0806)
     packet[12] = 0x08; packet[13] = 0x06;
-    
+
     // ARP packet
     packet[14] = 0x00; packet[15] = 0x01; // Hardware type: Ethernet
     packet[16] = 0x08; packet[17] = 0x00; // Protocol type: IPv4
     packet[18] = 0x06; // Hardware size: 6
     packet[19] = 0x04; // Protocol size: 4
     packet[20] = 0x00; packet[21] = 0x01; // Operation: Request
-    
+
     // Sender MAC
     packet[22] = our_mac[0]; packet[23] = our_mac[1]; packet[24] = our_mac[2];
     packet[25] = our_mac[3]; packet[26] = our_mac[4]; packet[27] = our_mac[5];
-    
+
     // Sender IP: 10.0.2.15
     packet[28] = 10; packet[29] = 0; packet[30] = 2; packet[31] = 15;
-    
+
     // Target MAC: 00:00:00:00:00:00
     packet[32] = 0x00; packet[33] = 0x00; packet[34] = 0x00;
     packet[35] = 0x00; packet[36] = 0x00; packet[37] = 0x00;
-    
+
     // Target IP: 10.0.2.1 (gateway)
     packet[38] = 10; packet[39] = 0; packet[40] = 2; packet[41] = 1;
-    
+
     printf("RTL8139: Sending ARP request for 10.0.2.1 (gateway)\n");
     printf("RTL8139: Packet data (first 42 bytes):\n");
     for (int i = 0; i < 42; i++) {
@@ -480,7 +550,7 @@ void rtl8139_send_test_packet() {
         if ((i + 1) % 16 == 0) printf("\n");
     }
     printf("\n");
-    
+
     rtl8139_send_packet(packet, 60);
     printf("RTL8139: ARP packet sent (60 bytes)\n");
 }
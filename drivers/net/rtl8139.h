@@ -2,17 +2,45 @@
 #define RTL8139_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
+#define RTL8139_VENDOR_ID   0x10EC
+#define RTL8139_DEVICE_ID   0x8139
+
+typedef struct {
+    uint32_t rx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;        // Good frames lost to an empty pbuf pool
+    uint32_t rx_errors;         // Bad header status or length; each resets the receiver
+    uint32_t rx_overflows;      // RXOVW/FOVW: the card ran out of ring space
+    uint32_t interrupts;        // RX interrupts that switched to polling
+    uint32_t polls;             // Poll calls that found frames
+    uint32_t capr_writes;       // Ring space handed back to the card
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_busy;           // Sends that found all four descriptors in use
+} rtl8139_stats_t;
+
+// Receive-rate benchmark in internal loopback; see rtl8139_rx_benchmark()
+typedef struct {
+    uint32_t frames;            // Frames received and verified
+    uint32_t bytes;
+    uint32_t batches;           // Ring fills drained
+    uint64_t rx_cycles;         // TSC cycles spent draining the ring
+    uint32_t elapsed_ms;        // Wall time including the loopback transmits
+    uint32_t lost;              // Frames sent but never seen
+} rtl8139_bench_t;
 
-void initialize_rtl8139(uint8_t bus, uint8_t device, uint8_t function);
-uint32_t pci_read(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset);
-void rtl8139_send_packet(void* data, uint16_t len);
-void rtl8139_receive_packet();
-void test_loopback();
-void rtl8139_init();
-int find_rtl8139();
 void rtl8139_detect();
-void rtl8139_send_test_packet();
 int rtl8139_is_initialized();
+void rtl8139_get_mac_address(uint8_t* mac);
+void rtl8139_send_packet(void* data, uint16_t len);
+void rtl8139_send_test_packet();
+void rtl8139_get_stats(rtl8139_stats_t* stats);
+
+// Loops 'count' frames of 'size' bytes through the card and times how
+// fast the ring consumer takes them out. The card is taken from the stack
+// meanwhile. Returns false if the card is missing or frames were lost.
+bool rtl8139_rx_benchmark(uint32_t count, uint16_t size, rtl8139_bench_t* result);
 
-#endif  // RTL8139_H
\ No newline at end of file
+#endif  // RTL8139_H
@@ -0,0 +1,315 @@
+// drivers/net/socket.c
+// BSD socket syscalls on top of the UDP and TCP socket tables. Blocking
+// calls run inside INT 0x80 with interrupts enabled and spin on
+// netstack_poll(), halting until the next interrupt whenever a poll found
+// nothing, like udp_recvfrom().
+
+#include "drivers/net/socket.h"
+#include "drivers/net/dns.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SOCKET_WAIT_FOREVER  0xFFFFFFFFu
+#define SOCKET_UDP_MAX       (65535 - 8 - 20)   // Largest UDP payload of one IP datagram
+
+typedef enum {
+    SOCK_NEW,                    // No netstack socket yet
+    SOCK_BOUND,                  // UDP: open; TCP: local port chosen
+    SOCK_LISTENING,
+    SOCK_CONNECTED,              // UDP: default destination set
+} sock_state_t;
+
+typedef struct {
+    bool used;
+    uint8_t type;                // SOCK_STREAM or SOCK_DGRAM
+    sock_state_t state;
+    int sock;                    // udp_/tcp_ socket, -1 = none
+    uint16_t local_port;
+    uint32_t peer_ip;            // Host order
+    uint16_t peer_port;
+} ksocket_t;
+
+static ksocket_t sockets[SOCKET_MAX];
+
+static ksocket_t *sock_get(int fd) {
+    if (fd < 0 || fd >= SOCKET_MAX || !sockets[fd].used) return NULL;
+    return &sockets[fd];
+}
+
+static int sock_alloc(uint8_t type) {
+    for (int i = 0; i < SOCKET_MAX; ++i) {
+        if (sockets[i].used) continue;
+        memset(&sockets[i], 0, sizeof(sockets[i]));
+        sockets[i].used = true;
+        sockets[i].type = type;
+        sockets[i].sock = -1;
+        return i;
+    }
+    return -1;
+}
+
+static bool sock_addr_valid(const struct sockaddr_in *addr) {
+    return addr && addr->sin_family == AF_INET;
+}
+
+static void sock_fill_addr(struct sockaddr_in *addr, uint32_t ip, uint16_t port) {
+    if (!addr) return;
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    addr->sin_addr.s_addr = htonl(ip);
+}
+
+// Give an unbound UDP socket an ephemeral port (sendto/connect before bind)
+static bool sock_udp_open(ksocket_t *s, uint16_t port) {
+    if (s->sock >= 0) return true;
+    s->sock = udp_open(port);
+    if (s->sock < 0) return false;
+    s->local_port = udp_local_port(s->sock);
+    s->state = SOCK_BOUND;
+    return true;
+}
+
+// =============================================================================
+// Readiness
+// =============================================================================
+static bool tcp_has_pending(int listener) {
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        const tcp_socket_t *c = tcp_get_socket(i);
+        if (c && c->parent == listener && !c->accepted &&
+            (c->state == TCP_ESTABLISHED || c->state == TCP_CLOSE_WAIT)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static short sock_events(const ksocket_t *s) {
+    if (s->type == SOCK_DGRAM) {
+        if (s->sock < 0) return POLLOUT;
+        short ev = udp_get_socket(s->sock)->rcv.count ? POLLIN : 0;
+        if (s->state != SOCK_CONNECTED || netstack_tx_ready(s->peer_ip)) ev |= POLLOUT;
+        return ev;
+    }
+
+    if (s->state == SOCK_LISTENING) return tcp_has_pending(s->sock) ? POLLIN : 0;
+    if (s->state != SOCK_CONNECTED) return 0;
+
+    const tcp_socket_t *t = tcp_get_socket(s->sock);
+    if (!t) return POLLERR | POLLHUP;
+    short ev = 0;
+    if (t->rcv.bytes || t->fin_received) ev |= POLLIN;
+    if (t->reset || t->state == TCP_CLOSED) ev |= POLLERR | POLLHUP;
+    if ((t->state == TCP_ESTABLISHED || t->state == TCP_CLOSE_WAIT) && t->snd.count < TCP_BUFFER_SIZE) {
+        ev |= POLLOUT;
+    }
+    return ev;
+}
+
+// Wait until one of 'events' (or an error) is reported for s
+static short sock_wait(const ksocket_t *s, short events, uint32_t timeout_ms) {
+    uint32_t start = pit_get_ticks();
+    for (;;) {
+        int frames = netstack_poll();
+        short ev = sock_events(s) & (events | POLLERR | POLLHUP);
+        if (ev) return ev;
+        if (timeout_ms != SOCKET_WAIT_FOREVER && pit_get_ticks() - start >= timeout_ms) return 0;
+        if (frames == 0) __asm__ __volatile__("hlt");
+    }
+}
+
+// =============================================================================
+// Syscalls
+// =============================================================================
+int sys_socket(int domain, int type, int protocol) {
+    if (domain != AF_INET) return -1;
+    if (type == SOCK_STREAM && (protocol == 0 || protocol == IP_PROTOCOL_TCP)) return sock_alloc(SOCK_STREAM);
+    if (type == SOCK_DGRAM && (protocol == 0 || protocol == IP_PROTOCOL_UDP)) return sock_alloc(SOCK_DGRAM);
+    return -1;
+}
+
+int sys_bind(int fd, const struct sockaddr_in *addr) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->state != SOCK_NEW || !sock_addr_valid(addr)) return -1;
+    uint16_t port = ntohs(addr->sin_port);
+
+    if (s->type == SOCK_DGRAM) return sock_udp_open(s, port) ? 0 : -1;
+
+    // TCP only needs the port once listen() is called
+    if (port == 0) return -1;
+    s->local_port = port;
+    s->state = SOCK_BOUND;
+    return 0;
+}
+
+int sys_connect(int fd, const struct sockaddr_in *addr) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || !sock_addr_valid(addr)) return -1;
+    uint32_t ip = ntohl(addr->sin_addr.s_addr);
+    uint16_t port = ntohs(addr->sin_port);
+
+    if (s->type == SOCK_DGRAM) {
+        if (!sock_udp_open(s, 0)) return -1;
+        s->peer_ip = ip;
+        s->peer_port = port;
+        s->state = SOCK_CONNECTED;
+        return 0;
+    }
+
+    // tcp_connect picks its own ephemeral port; a bound port is not kept
+    if (s->state != SOCK_NEW && s->state != SOCK_BOUND) return -1;
+    int c = tcp_connect(ip, port);
+    if (c < 0) return -1;
+    s->sock = c;
+    s->local_port = tcp_get_socket(c)->local_port;
+    s->peer_ip = ip;
+    s->peer_port = port;
+    s->state = SOCK_CONNECTED;
+    return 0;
+}
+
+int sys_listen(int fd, int backlog) {
+    (void)backlog;                       // Fixed at TCP_LISTEN_BACKLOG
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->type != SOCK_STREAM || s->state != SOCK_BOUND) return -1;
+    int l = tcp_listen(s->local_port);
+    if (l < 0) return -1;
+    s->sock = l;
+    s->state = SOCK_LISTENING;
+    return 0;
+}
+
+int sys_accept(int fd, struct sockaddr_in *addr) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || s->state != SOCK_LISTENING) return -1;
+
+    // Take the slot first so an accepted connection is never dropped
+    int nfd = sock_alloc(SOCK_STREAM);
+    if (nfd < 0) return -1;
+    int c = tcp_accept(s->sock, SOCKET_WAIT_FOREVER);
+    if (c < 0) {
+        sockets[nfd].used = false;
+        return -1;
+    }
+
+    const tcp_socket_t *t = tcp_get_socket(c);
+    ksocket_t *n = &sockets[nfd];
+    n->sock = c;
+    n->local_port = t->local_port;
+    n->peer_ip = t->remote_ip;
+    n->peer_port = t->remote_port;
+    n->state = SOCK_CONNECTED;
+    sock_fill_addr(addr, n->peer_ip, n->peer_port);
+    return nfd;
+}
+
+int sys_sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr_in *addr) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || (len && !buf)) return -1;
+
+    if (s->type == SOCK_DGRAM) {
+        uint32_t ip = s->peer_ip;
+        uint16_t port = s->peer_port;
+        if (addr) {
+            if (!sock_addr_valid(addr)) return -1;
+            ip = ntohl(addr->sin_addr.s_addr);
+            port = ntohs(addr->sin_port);
+        } else if (s->state != SOCK_CONNECTED) {
+            return -1;
+        }
+        if (len > SOCKET_UDP_MAX || !sock_udp_open(s, 0)) return -1;
+        return udp_sendto(s->sock, ip, port, (const uint8_t *)buf, (uint16_t)len);
+    }
+
+    if (s->state != SOCK_CONNECTED) return -1;
+    const tcp_socket_t *t = tcp_get_socket(s->sock);
+    if (!t) return -1;
+    if (flags & MSG_DONTWAIT) {
+        // Only what fits the send ring now
+        uint32_t room = TCP_BUFFER_SIZE - t->snd.count;
+        if (room == 0) return -1;
+        if (len > room) len = room;
+    }
+
+    // tcp_send copies from the caller's buffer straight into the send ring
+    size_t sent = 0;
+    while (sent < len) {
+        uint16_t chunk = len - sent > 0xFFFF ? 0xFFFF : (uint16_t)(len - sent);
+        int n = tcp_send(s->sock, (uint8_t *)buf + sent, chunk);
+        if (n <= 0) break;
+        sent += (size_t)n;
+        if (n < chunk) break;
+    }
+    return sent || len == 0 ? (int)sent : -1;
+}
+
+int sys_recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr_in *addr) {
+    ksocket_t *s = sock_get(fd);
+    if (!s || !buf) return -1;
+
+    if (s->type == SOCK_DGRAM) {
+        if (s->sock < 0) return -1;
+        uint32_t ip;
+        uint16_t port;
+        uint32_t timeout = (flags & MSG_DONTWAIT) ? 0 : SOCKET_WAIT_FOREVER;
+        int n = udp_recvfrom(s->sock, buf, len, &ip, &port, timeout);
+        if (n >= 0) sock_fill_addr(addr, ip, port);
+        return n;
+    }
+
+    if (s->state != SOCK_CONNECTED) return -1;
+    uint32_t timeout = (flags & MSG_DONTWAIT) ? 0 : SOCKET_WAIT_FOREVER;
+    if (!sock_wait(s, POLLIN, timeout)) return -1;
+
+    // Copied out of the queued segments, which still sit in the NIC's buffers
+    int n = tcp_recv(s->sock, buf, len > 0xFFFF ? 0xFFFF : (uint16_t)len);
+    if (n >= 0) sock_fill_addr(addr, s->peer_ip, s->peer_port);
+    return n;
+}
+
+int sys_close(int fd) {
+    ksocket_t *s = sock_get(fd);
+    if (!s) return -1;
+    if (s->sock >= 0) {
+        if (s->type == SOCK_DGRAM) udp_close(s->sock);
+        else tcp_close(s->sock);
+    }
+    memset(s, 0, sizeof(*s));
+    return 0;
+}
+
+int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout_ms) {
+    if (nfds && !fds) return -1;
+    uint32_t timeout = timeout_ms < 0 ? SOCKET_WAIT_FOREVER : (uint32_t)timeout_ms;
+
+    uint32_t start = pit_get_ticks();
+    for (;;) {
+        int frames = netstack_poll();
+        int ready = 0;
+        for (nfds_t i = 0; i < nfds; ++i) {
+            const ksocket_t *s = sock_get(fds[i].fd);
+            if (fds[i].fd < 0) {
+                fds[i].revents = 0;              // Negative entries are skipped
+            } else if (!s) {
+                fds[i].revents = POLLNVAL;
+            } else {
+                fds[i].revents = sock_events(s) & (fds[i].events | POLLERR | POLLHUP);
+            }
+            if (fds[i].revents) ready++;
+        }
+        if (ready) return ready;
+        if (timeout != SOCKET_WAIT_FOREVER && pit_get_ticks() - start >= timeout) return 0;
+        if (frames == 0) __asm__ __volatile__("hlt");
+    }
+}
+
+int sys_resolve(const char *host, struct in_addr *addr) {
+    uint32_t ip;
+    if (!addr || dns_resolve(host, &ip) != DNS_OK) return -1;
+    addr->s_addr = htonl(ip);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef NET_SOCKET_H
+#define NET_SOCKET_H
+
+#include <stdint.h>
+#include "drivers/net/netstack.h"
+#include "lib/libc/socket.h"
+
+// =============================================================================
+// Kernel side of the socket syscalls (SYS_SOCKET .. SYS_POLL). A socket is
+// an index into a table that maps it onto a UDP or TCP socket of the
+// netstack. User buffers are handed straight to udp_sendto/tcp_send and
+// filled straight from the receive queues, so payload is copied once in
+// each direction, between the caller and the packet buffers.
+// =============================================================================
+
+#define SOCKET_MAX   (UDP_MAX_SOCKETS + TCP_MAX_SOCKETS)
+
+int sys_socket(int domain, int type, int protocol);
+int sys_bind(int fd, const struct sockaddr_in *addr);
+int sys_connect(int fd, const struct sockaddr_in *addr);
+int sys_listen(int fd, int backlog);
+int sys_accept(int fd, struct sockaddr_in *addr);
+// 'addr' may be NULL on a connected socket
+int sys_sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr_in *addr);
+int sys_recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr_in *addr);
+int sys_close(int fd);
+int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout_ms);
+// Host name to a network order address (drivers/net/dns.c)
+int sys_resolve(const char *host, struct in_addr *addr);
+
+#endif // NET_SOCKET_H
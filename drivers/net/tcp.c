@@ -0,0 +1,951 @@
+// drivers/net/tcp.c
+// TCP: hashed connection table, sliding window with retransmission,
+// delayed ACKs, Nagle and MSS negotiation on top of netstack_ip_output.
+// There is no network thread: blocking calls spin on netstack_poll(),
+// which feeds tcp_input() and runs tcp_timer().
+
+#include "drivers/net/netstack.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/stdlib.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+static tcp_socket_t tcp_sockets[TCP_MAX_SOCKETS];
+static int tcp_hash[TCP_HASH_BUCKETS];
+static tcp_stats_t tcp_stats;
+static uint16_t tcp_next_port = TCP_EPHEMERAL_BASE;
+
+static void tcp_output(tcp_socket_t *s, bool probe);
+
+static inline uint32_t tcp_min(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+static inline bool tcp_expired(uint32_t deadline, uint32_t now) {
+    return deadline != 0 && (int32_t)(now - deadline) >= 0;
+}
+
+// Never hand out 0 as a deadline, it means "timer stopped"
+static inline uint32_t tcp_deadline(uint32_t delay) {
+    uint32_t t = pit_get_ticks() + delay;
+    return t ? t : 1;
+}
+
+static uint32_t tcp_generate_iss(void) {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return low ^ (high << 16) ^ (pit_get_ticks() << 8);
+}
+
+// =============================================================================
+// Byte rings
+// =============================================================================
+static uint32_t ring_write(tcp_ring_t *r, const uint8_t *src, uint32_t len) {
+    uint32_t n = tcp_min(len, TCP_BUFFER_SIZE - r->count);
+    uint32_t tail = (r->head + r->count) % TCP_BUFFER_SIZE;
+    uint32_t first = tcp_min(n, TCP_BUFFER_SIZE - tail);
+    memcpy(r->data + tail, src, first);
+    memcpy(r->data, src + first, n - first);
+    r->count += n;
+    return n;
+}
+
+// Copy 'len' bytes starting 'offset' bytes into the ring without consuming them
+static void ring_peek(const tcp_ring_t *r, uint32_t offset, uint8_t *dst, uint32_t len) {
+    uint32_t pos = (r->head + offset) % TCP_BUFFER_SIZE;
+    uint32_t first = tcp_min(len, TCP_BUFFER_SIZE - pos);
+    memcpy(dst, r->data + pos, first);
+    memcpy(dst + first, r->data, len - first);
+}
+
+static void ring_consume(tcp_ring_t *r, uint32_t len) {
+    r->head = (r->head + len) % TCP_BUFFER_SIZE;
+    r->count -= len;
+}
+
+// =============================================================================
+// Connection table
+// =============================================================================
+static inline uint32_t tcp_hash_key(uint16_t local_port, uint32_t remote_ip, uint16_t remote_port) {
+    uint32_t h = remote_ip ^ ((uint32_t)local_port << 16) ^ remote_port;
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (TCP_HASH_BUCKETS - 1);
+}
+
+static void tcp_hash_insert(tcp_socket_t *s) {
+    uint32_t b = tcp_hash_key(s->local_port, s->remote_ip, s->remote_port);
+    s->hash_next = tcp_hash[b];
+    tcp_hash[b] = (int)(s - tcp_sockets);
+}
+
+static void tcp_hash_remove(tcp_socket_t *s) {
+    uint32_t b = tcp_hash_key(s->local_port, s->remote_ip, s->remote_port);
+    int idx = (int)(s - tcp_sockets);
+    for (int *link = &tcp_hash[b]; *link >= 0; link = &tcp_sockets[*link].hash_next) {
+        if (*link == idx) {
+            *link = s->hash_next;
+            break;
+        }
+    }
+    s->hash_next = -1;
+}
+
+static tcp_socket_t *tcp_lookup(uint16_t local_port, uint32_t remote_ip, uint16_t remote_port) {
+    int idx = tcp_hash[tcp_hash_key(local_port, remote_ip, remote_port)];
+    while (idx >= 0) {
+        tcp_socket_t *s = &tcp_sockets[idx];
+        if (s->local_port == local_port && s->remote_ip == remote_ip && s->remote_port == remote_port) {
+            return s;
+        }
+        idx = s->hash_next;
+    }
+    return NULL;
+}
+
+// Listeners are few and have no remote end, so they stay out of the hash
+static tcp_socket_t *tcp_lookup_listener(uint16_t local_port) {
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        if (tcp_sockets[i].used && tcp_sockets[i].state == TCP_LISTEN &&
+            tcp_sockets[i].local_port == local_port) {
+            return &tcp_sockets[i];
+        }
+    }
+    return NULL;
+}
+
+static void tcp_release(tcp_socket_t *s) {
+    if (s->state != TCP_LISTEN) {
+        tcp_hash_remove(s);
+    }
+    free(s->snd.data);
+    pbuf_queue_flush(&s->rcv);
+    memset(s, 0, sizeof(*s));
+    s->hash_next = -1;
+    s->parent = -1;
+}
+
+// Nobody holds a handle to the socket any more: closed by its user, or a
+// listener child that died before accept() took it
+static inline bool tcp_orphaned(const tcp_socket_t *s) {
+    return s->user_closed || (s->parent >= 0 && !s->accepted);
+}
+
+static tcp_socket_t *tcp_alloc(bool with_buffers) {
+    tcp_socket_t *s = NULL;
+    for (int i = 0; i < TCP_MAX_SOCKETS && !s; ++i) {
+        if (!tcp_sockets[i].used) s = &tcp_sockets[i];
+    }
+    if (!s) return NULL;
+
+    memset(s, 0, sizeof(*s));
+    s->hash_next = -1;
+    s->parent = -1;
+    if (with_buffers) {
+        s->snd.data = (uint8_t*)malloc(TCP_BUFFER_SIZE);
+        if (!s->snd.data) {
+            return NULL;
+        }
+    }
+    s->used = true;
+    s->mss = TCP_MSS_DEFAULT;
+    s->rto = TCP_RTO_INITIAL;
+    s->ssthresh = 65535;
+    return s;
+}
+
+static bool tcp_port_in_use(uint16_t port) {
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        if (tcp_sockets[i].used && tcp_sockets[i].local_port == port) return true;
+    }
+    return false;
+}
+
+static uint16_t tcp_ephemeral_port(void) {
+    for (int tries = 0; tries < 16384; ++tries) {
+        uint16_t port = tcp_next_port++;
+        if (tcp_next_port == 0) tcp_next_port = TCP_EPHEMERAL_BASE;
+        if (!tcp_port_in_use(port)) return port;
+    }
+    return 0;
+}
+
+// Start the socket's sequence space and congestion state once the MSS is known
+static void tcp_start_sequence(tcp_socket_t *s) {
+    s->iss = tcp_generate_iss();
+    s->snd_una = s->iss;
+    s->snd_nxt = s->iss + 1;       // SYN occupies one sequence number
+    s->snd_max = s->snd_nxt;
+}
+
+static void tcp_set_cwnd(tcp_socket_t *s) {
+    // Initial window per RFC 3390: min(4*MSS, max(2*MSS, 4380 bytes))
+    s->cwnd = tcp_min(4u * s->mss, 4380 > 2u * s->mss ? 4380 : 2u * s->mss);
+}
+
+// =============================================================================
+// Segment output
+// =============================================================================
+// Queued payload is bounded in bytes and, since every segment pins a whole
+// packet buffer, in segments
+static uint16_t tcp_receive_window(const tcp_socket_t *s) {
+    if (!s->snd.data || s->rcv.count >= TCP_RCV_MAX_PBUFS) return 0;
+    return (uint16_t)tcp_min(TCP_BUFFER_SIZE - s->rcv.bytes, 65535);
+}
+
+// Build and send one segment. Payload comes from the send ring at 'offset'.
+static int tcp_emit(tcp_socket_t *s, uint32_t seq, uint8_t flags, uint32_t offset, uint16_t len) {
+    uint16_t hlen = sizeof(tcp_header_t) + ((flags & TCP_FLAG_SYN) ? 4 : 0);
+    pbuf_t *p = pbuf_alloc(PBUF_HEADROOM);
+    if (!p) return -1;
+    tcp_header_t *th = (tcp_header_t *)pbuf_put(p, (uint16_t)(hlen + len));
+    if (!th) { pbuf_free(p); return -1; }
+
+    if (flags & TCP_FLAG_SYN) {
+        uint8_t *opt = (uint8_t *)(th + 1);
+        opt[0] = TCP_OPT_MSS;
+        opt[1] = 4;
+        opt[2] = (uint8_t)(TCP_MSS_LOCAL >> 8);
+        opt[3] = (uint8_t)(TCP_MSS_LOCAL & 0xFF);
+    }
+
+    uint16_t window = tcp_receive_window(s);
+    th->src_port             = htons(s->local_port);
+    th->dst_port             = htons(s->remote_port);
+    th->seq_num              = htonl(seq);
+    th->ack_num              = (flags & TCP_FLAG_ACK) ? htonl(s->rcv_nxt) : 0;
+    th->data_offset_reserved = (uint8_t)((hlen / 4) << 4);
+    th->flags                = flags;
+    th->window_size          = htons(window);
+    th->checksum             = 0;
+    th->urgent_pointer       = 0;
+
+    if (len) ring_peek(&s->snd, offset, (uint8_t *)th + hlen, len);
+    netstack_csum_request(p, th, offsetof(tcp_header_t, checksum));
+
+    if (flags & TCP_FLAG_ACK) {
+        // Any segment carrying an ACK satisfies a pending delayed ACK
+        s->ack_pending = 0;
+        s->delack_deadline = 0;
+        s->rcv_adv = s->rcv_nxt + window;
+    }
+    tcp_stats.segs_out++;
+    return netstack_ip_output(s->remote_ip, IP_PROTOCOL_TCP, p);
+}
+
+static void tcp_send_ack(tcp_socket_t *s) {
+    tcp_emit(s, s->snd_nxt, TCP_FLAG_ACK, 0, 0);
+}
+
+static void tcp_send_syn(tcp_socket_t *s) {
+    uint8_t flags = TCP_FLAG_SYN;
+    if (s->state == TCP_SYN_RECEIVED) flags |= TCP_FLAG_ACK;
+    tcp_emit(s, s->iss, flags, 0, 0);
+}
+
+// Reset in answer to a segment that matches no connection (RFC 793, p. 36)
+static void tcp_send_reset(uint32_t src_ip, uint32_t dst_ip, const tcp_header_t *in, uint16_t seg_len) {
+    tcp_socket_t tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.local_ip    = dst_ip;
+    tmp.remote_ip   = src_ip;
+    tmp.local_port  = ntohs(in->dst_port);
+    tmp.remote_port = ntohs(in->src_port);
+
+    uint8_t flags = TCP_FLAG_RST;
+    uint32_t seq = 0;
+    if (in->flags & TCP_FLAG_ACK) {
+        seq = ntohl(in->ack_num);
+    } else {
+        flags |= TCP_FLAG_ACK;
+        tmp.rcv_nxt = ntohl(in->seq_num) + seg_len;
+        if (in->flags & TCP_FLAG_SYN) tmp.rcv_nxt++;
+        if (in->flags & TCP_FLAG_FIN) tmp.rcv_nxt++;
+    }
+    tcp_stats.resets_out++;
+    tcp_emit(&tmp, seq, flags, 0, 0);
+}
+
+static void tcp_abort(tcp_socket_t *s) {
+    if (s->state != TCP_CLOSED && s->state != TCP_LISTEN && s->state != TCP_SYN_SENT &&
+        s->state != TCP_TIME_WAIT) {
+        tcp_emit(s, s->snd_nxt, TCP_FLAG_RST | TCP_FLAG_ACK, 0, 0);
+        tcp_stats.resets_out++;
+    }
+    s->state = TCP_CLOSED;
+    s->reset = true;
+}
+
+// Send as much queued data as the windows and Nagle allow, then the FIN.
+// 'probe' forces one byte into a zero window.
+static void tcp_output(tcp_socket_t *s, bool probe) {
+    if (s->state != TCP_ESTABLISHED && s->state != TCP_CLOSE_WAIT &&
+        s->state != TCP_FIN_WAIT_1 && s->state != TCP_CLOSING && s->state != TCP_LAST_ACK) {
+        return;
+    }
+
+    // Segments of one call reach the NIC as one batch
+    netdev_tx_hold();
+    s->tx_blocked = false;
+    for (;;) {
+        uint32_t flight = s->snd_nxt - s->snd_una;
+        uint32_t offset = flight;
+        uint32_t avail = offset < s->snd.count ? s->snd.count - offset : 0;
+        uint32_t wnd = tcp_min(s->snd_wnd, s->cwnd);
+        uint32_t usable = wnd > flight ? wnd - flight : 0;
+
+        if (probe && usable == 0 && avail > 0) usable = 1;
+        uint32_t len = tcp_min(tcp_min(avail, usable), s->mss);
+        bool fin = s->fin_pending && !s->fin_acked && offset + len == s->snd.count;
+
+        if (len == 0 && !fin) {
+            // Zero window with data waiting: let the retransmission timer probe it
+            if (avail > 0 && flight == 0 && s->rto_deadline == 0) {
+                s->rto_deadline = tcp_deadline(s->rto);
+            }
+            break;
+        }
+        // Nagle: hold back a small segment while earlier data is unacknowledged
+        if (len > 0 && len < s->mss && flight > 0 && !s->nodelay && !fin && !probe) break;
+
+        // Backpressure: leave the data queued rather than have the NIC drop it
+        if (!netstack_tx_ready(s->remote_ip)) {
+            s->tx_blocked = true;
+            tcp_stats.tx_stalls++;
+            break;
+        }
+
+        uint8_t flags = TCP_FLAG_ACK;
+        if (len > 0 && offset + len == s->snd.count) flags |= TCP_FLAG_PSH;
+        if (fin) flags |= TCP_FLAG_FIN;
+
+        bool new_data = s->snd_nxt == s->snd_max;
+        if (!new_data) {
+            s->retransmits++;
+        }
+        if (tcp_emit(s, s->snd_nxt, flags, offset, (uint16_t)len) == 0 && new_data && len > 0 && !s->rtt_timing) {
+            s->rtt_timing = true;
+            s->rtt_seq = s->snd_nxt + len;
+            s->rtt_start = pit_get_ticks();
+        }
+
+        s->snd_nxt += len + (fin ? 1 : 0);
+        s->bytes_out += new_data ? len : 0;
+        if (SEQ_GT(s->snd_nxt, s->snd_max)) s->snd_max = s->snd_nxt;
+        if (s->rto_deadline == 0) s->rto_deadline = tcp_deadline(s->rto);
+        probe = false;
+        if (fin) break;
+    }
+    netdev_tx_release();
+}
+
+// Resend the oldest unacknowledged segment without touching snd_nxt
+static void tcp_retransmit_head(tcp_socket_t *s) {
+    uint32_t len = tcp_min(s->snd.count, s->mss);
+    uint8_t flags = TCP_FLAG_ACK;
+    if (len == s->snd.count && s->fin_pending && SEQ_GT(s->snd_max, s->snd_una + s->snd.count)) {
+        flags |= TCP_FLAG_FIN;
+    }
+    if (len == 0 && !(flags & TCP_FLAG_FIN)) return;
+    s->retransmits++;
+    tcp_emit(s, s->snd_una, flags, 0, (uint16_t)len);
+}
+
+// =============================================================================
+// Round trip estimation (Jacobson/Karels, RFC 6298)
+// =============================================================================
+static void tcp_rtt_sample(tcp_socket_t *s, uint32_t rtt) {
+    if (rtt == 0) rtt = 1;
+    if (s->srtt == 0) {
+        s->srtt = rtt << 3;
+        s->rttvar = rtt << 1;
+    } else {
+        int32_t delta = (int32_t)rtt - (int32_t)(s->srtt >> 3);
+        s->srtt = (uint32_t)((int32_t)s->srtt + delta);
+        if (delta < 0) delta = -delta;
+        delta -= (int32_t)(s->rttvar >> 2);
+        s->rttvar = (uint32_t)((int32_t)s->rttvar + delta);
+    }
+    uint32_t rto = (s->srtt >> 3) + s->rttvar;
+    if (rto < TCP_RTO_MIN) rto = TCP_RTO_MIN;
+    if (rto > TCP_RTO_MAX) rto = TCP_RTO_MAX;
+    s->rto = rto;
+}
+
+// =============================================================================
+// Segment input
+// =============================================================================
+static uint16_t tcp_parse_mss(const tcp_header_t *th) {
+    const uint8_t *opt = (const uint8_t *)th + sizeof(tcp_header_t);
+    const uint8_t *end = (const uint8_t *)th + TCP_HEADER_LEN(th);
+    while (opt < end) {
+        if (opt[0] == 0) break;                        // End of options
+        if (opt[0] == 1) { ++opt; continue; }          // NOP
+        if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end) break;
+        if (opt[0] == TCP_OPT_MSS && opt[1] == 4) {
+            uint16_t mss = (uint16_t)((opt[2] << 8) | opt[3]);
+            if (mss > TCP_MSS_LOCAL) mss = TCP_MSS_LOCAL;
+            return mss ? mss : TCP_MSS_DEFAULT;
+        }
+        opt += opt[1];
+    }
+    return TCP_MSS_DEFAULT;
+}
+
+// New data acknowledged: advance the send window and open the congestion window
+static void tcp_ack_advance(tcp_socket_t *s, uint32_t ack) {
+    uint32_t acked = ack - s->snd_una;
+    uint32_t data = tcp_min(acked, s->snd.count);
+    ring_consume(&s->snd, data);
+    if (acked > data) s->fin_acked = true;
+    s->snd_una = ack;
+    if (SEQ_LT(s->snd_nxt, s->snd_una)) s->snd_nxt = s->snd_una;
+
+    if (s->rtt_timing && SEQ_GEQ(ack, s->rtt_seq)) {
+        tcp_rtt_sample(s, pit_get_ticks() - s->rtt_start);
+        s->rtt_timing = false;
+    }
+
+    if (s->cwnd < s->ssthresh) {
+        s->cwnd += s->mss;                                      // Slow start
+    } else {
+        uint32_t inc = (uint32_t)s->mss * s->mss / s->cwnd;     // Congestion avoidance
+        s->cwnd += inc ? inc : 1;
+    }
+
+    s->dupacks = 0;
+    s->retries = 0;
+    s->rto_deadline = s->snd_una == s->snd_max ? 0 : tcp_deadline(s->rto);
+}
+
+static void tcp_enter_time_wait(tcp_socket_t *s) {
+    s->state = TCP_TIME_WAIT;
+    s->rto_deadline = 0;
+    s->timewait_deadline = tcp_deadline(TCP_TIME_WAIT_TIMEOUT);
+}
+
+static void tcp_input_listen(tcp_socket_t *l, uint32_t src_ip, uint32_t dst_ip, const tcp_header_t *th, uint16_t seg_len) {
+    if (th->flags & TCP_FLAG_RST) return;
+    if (th->flags & TCP_FLAG_ACK) { tcp_send_reset(src_ip, dst_ip, th, seg_len); return; }
+    if (!(th->flags & TCP_FLAG_SYN)) return;
+
+    int pending = 0;
+    int lidx = (int)(l - tcp_sockets);
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        if (tcp_sockets[i].used && tcp_sockets[i].parent == lidx && !tcp_sockets[i].accepted) pending++;
+    }
+    if (pending >= TCP_LISTEN_BACKLOG) return;   // Peer retries the SYN
+
+    tcp_socket_t *s = tcp_alloc(true);
+    if (!s) return;
+    s->parent      = lidx;
+    s->local_ip    = dst_ip;
+    s->local_port  = l->local_port;
+    s->remote_ip   = src_ip;
+    s->remote_port = ntohs(th->src_port);
+    s->nodelay     = l->nodelay;
+    s->irs         = ntohl(th->seq_num);
+    s->rcv_nxt     = s->irs + 1;
+    s->snd_wnd     = ntohs(th->window_size);
+    s->mss         = tcp_parse_mss(th);
+    s->state       = TCP_SYN_RECEIVED;
+    tcp_start_sequence(s);
+    tcp_set_cwnd(s);
+    tcp_hash_insert(s);
+
+    tcp_send_syn(s);
+    s->rto_deadline = tcp_deadline(s->rto);
+}
+
+static void tcp_input_syn_sent(tcp_socket_t *s, const tcp_header_t *th, uint32_t src_ip, uint16_t seg_len) {
+    uint32_t seq = ntohl(th->seq_num);
+    uint32_t ack = ntohl(th->ack_num);
+    bool ack_ok = (th->flags & TCP_FLAG_ACK) && ack == s->iss + 1;
+
+    if ((th->flags & TCP_FLAG_ACK) && !ack_ok) {
+        if (!(th->flags & TCP_FLAG_RST)) tcp_send_reset(src_ip, s->local_ip, th, seg_len);
+        return;
+    }
+    if (th->flags & TCP_FLAG_RST) {
+        if (ack_ok) {
+            s->state = TCP_CLOSED;           // Connection refused
+            s->reset = true;
+        }
+        return;
+    }
+    if (!(th->flags & TCP_FLAG_SYN)) return;
+
+    s->irs = seq;
+    s->rcv_nxt = seq + 1;
+    s->mss = tcp_parse_mss(th);
+    s->snd_wnd = ntohs(th->window_size);
+    tcp_set_cwnd(s);
+
+    if (ack_ok) {
+        s->snd_una = ack;
+        s->state = TCP_ESTABLISHED;
+        s->rto_deadline = 0;
+        s->retries = 0;
+        if (s->rtt_timing) {
+            tcp_rtt_sample(s, pit_get_ticks() - s->rtt_start);
+            s->rtt_timing = false;
+        }
+        tcp_send_ack(s);
+    } else {
+        s->state = TCP_SYN_RECEIVED;         // Simultaneous open
+        tcp_send_syn(s);
+    }
+}
+
+// Returns true if the segment's buffer was queued on the socket
+static bool tcp_process(uint32_t src_ip, uint32_t dst_ip, pbuf_t *p) {
+    uint8_t *segment = p->data;
+    uint16_t length = p->len;
+    bool queued = false;
+
+    if (length < sizeof(tcp_header_t)) return false;
+    if (!(p->flags & PBUF_F_CSUM_VALID) && ip_pseudo_checksum(src_ip, dst_ip, IP_PROTOCOL_TCP, segment, length) != 0) {
+        tcp_stats.bad_checksum++;
+        return false;
+    }
+
+    tcp_header_t *th = (tcp_header_t *)segment;
+    uint16_t hlen = TCP_HEADER_LEN(th);
+    if (hlen < sizeof(tcp_header_t) || hlen > length) return false;
+    tcp_stats.segs_in++;
+
+    uint8_t flags = th->flags;
+    uint32_t seq = ntohl(th->seq_num);
+    uint32_t ack = ntohl(th->ack_num);
+    uint8_t *data = segment + hlen;
+    uint16_t dlen = (uint16_t)(length - hlen);
+
+    tcp_socket_t *s = tcp_lookup(ntohs(th->dst_port), src_ip, ntohs(th->src_port));
+    if (!s) s = tcp_lookup_listener(ntohs(th->dst_port));
+    if (!s || s->state == TCP_CLOSED) {
+        if (!(flags & TCP_FLAG_RST)) tcp_send_reset(src_ip, dst_ip, th, dlen);
+        return false;
+    }
+
+    if (s->state == TCP_LISTEN) {
+        tcp_input_listen(s, src_ip, dst_ip, th, dlen);
+        return false;
+    }
+    if (s->state == TCP_SYN_SENT) {
+        tcp_input_syn_sent(s, th, src_ip, dlen);
+        return false;
+    }
+
+    // Trim data we already have; a segment entirely in the past only gets an ACK
+    bool ack_now = false;
+    if (SEQ_LT(seq, s->rcv_nxt)) {
+        uint32_t old = s->rcv_nxt - seq;
+        if (old > dlen || (old == dlen && !(flags & TCP_FLAG_FIN))) {
+            if (!(flags & TCP_FLAG_RST) && (dlen > 0 || (flags & (TCP_FLAG_SYN | TCP_FLAG_FIN)))) {
+                ack_now = true;
+            }
+            dlen = 0;
+            flags &= (uint8_t)~(TCP_FLAG_FIN | TCP_FLAG_SYN);
+            seq = s->rcv_nxt;
+        } else {
+            data += old;
+            dlen = (uint16_t)(dlen - old);
+            seq = s->rcv_nxt;
+        }
+    }
+
+    if (flags & TCP_FLAG_RST) {
+        if (seq == s->rcv_nxt) {
+            s->state = TCP_CLOSED;
+            s->reset = true;
+            s->rto_deadline = 0;
+            if (tcp_orphaned(s)) tcp_release(s);
+        }
+        return false;
+    }
+    if (flags & TCP_FLAG_SYN) {
+        tcp_send_ack(s);                     // Stray SYN in a synchronized state
+        return false;
+    }
+    if (!(flags & TCP_FLAG_ACK)) return false;
+
+    // --- ACK processing ---
+    if (s->state == TCP_SYN_RECEIVED) {
+        if (SEQ_LEQ(ack, s->snd_una) || SEQ_GT(ack, s->snd_max)) {
+            tcp_send_reset(src_ip, dst_ip, th, dlen);
+            return false;
+        }
+        s->state = TCP_ESTABLISHED;
+        s->snd_una = ack;                    // Covers our SYN
+        s->rto_deadline = 0;
+        s->retries = 0;
+    }
+
+    if (SEQ_GT(ack, s->snd_max)) {
+        tcp_send_ack(s);                     // Acknowledges something we never sent
+        return false;
+    }
+
+    uint32_t flight = s->snd_nxt - s->snd_una;
+    if (SEQ_GT(ack, s->snd_una)) {
+        tcp_ack_advance(s, ack);
+    } else if (ack == s->snd_una && dlen == 0 && !(flags & TCP_FLAG_FIN) &&
+               ntohs(th->window_size) == s->snd_wnd && flight > 0) {
+        if (++s->dupacks == 3) {
+            // Fast retransmit, then continue in congestion avoidance
+            s->ssthresh = flight / 2 > 2u * s->mss ? flight / 2 : 2u * s->mss;
+            s->cwnd = s->ssthresh;
+            s->rtt_timing = false;
+            tcp_stats.fast_retransmits++;
+            tcp_retransmit_head(s);
+        }
+    }
+    if (SEQ_GEQ(ack, s->snd_una)) s->snd_wnd = ntohs(th->window_size);
+
+    if (s->fin_acked) {
+        switch (s->state) {
+            case TCP_FIN_WAIT_1: s->state = TCP_FIN_WAIT_2; break;
+            case TCP_CLOSING:    tcp_enter_time_wait(s); break;
+            case TCP_LAST_ACK:
+                s->state = TCP_CLOSED;
+                s->rto_deadline = 0;
+                if (tcp_orphaned(s)) tcp_release(s);
+                return false;
+            default: break;
+        }
+    }
+
+    // --- Data ---
+    if (dlen > 0 && (s->state == TCP_ESTABLISHED || s->state == TCP_FIN_WAIT_1 || s->state == TCP_FIN_WAIT_2)) {
+        if (seq == s->rcv_nxt) {
+            // Queue the NIC buffer itself, cut down to the payload that fits the window
+            uint32_t n = tcp_min(dlen, tcp_receive_window(s));
+            if (n > 0) {
+                pbuf_pull(p, (uint16_t)(data - p->data));
+                pbuf_trim(p, (uint16_t)n);
+                pbuf_queue_push(&s->rcv, p);
+                queued = true;
+            }
+            s->rcv_nxt += n;
+            s->bytes_in += n;
+            if (n < dlen) {
+                ack_now = true;              // Window overrun, tell the peer where we are
+            } else if (++s->ack_pending >= 2) {
+                ack_now = true;              // ACK every second full segment
+            } else if (s->delack_deadline == 0) {
+                s->delack_deadline = tcp_deadline(TCP_DELACK_TIMEOUT);
+            }
+            seq += n;
+            if (n < dlen) flags &= (uint8_t)~TCP_FLAG_FIN;
+        } else {
+            // Ahead of rcv_nxt: drop it, the duplicate ACK triggers fast retransmit
+            tcp_stats.out_of_order++;
+            ack_now = true;
+            flags &= (uint8_t)~TCP_FLAG_FIN;
+        }
+    }
+
+    // --- FIN ---
+    if ((flags & TCP_FLAG_FIN) && seq == s->rcv_nxt && !s->fin_received) {
+        s->rcv_nxt++;
+        s->fin_received = true;
+        ack_now = true;
+        switch (s->state) {
+            case TCP_SYN_RECEIVED:
+            case TCP_ESTABLISHED: s->state = TCP_CLOSE_WAIT; break;
+            case TCP_FIN_WAIT_1:
+                if (s->fin_acked) tcp_enter_time_wait(s);
+                else s->state = TCP_CLOSING;
+                break;
+            case TCP_FIN_WAIT_2:  tcp_enter_time_wait(s); break;
+            default: break;
+        }
+    } else if ((flags & TCP_FLAG_FIN) && s->state == TCP_TIME_WAIT) {
+        ack_now = true;                      // Our last ACK was lost
+        s->timewait_deadline = tcp_deadline(TCP_TIME_WAIT_TIMEOUT);
+    }
+
+    // Every segment tcp_output sends carries the ACK, so only send a bare one if it sent nothing
+    uint32_t segs_before = tcp_stats.segs_out;
+    tcp_output(s, false);
+    if (ack_now && tcp_stats.segs_out == segs_before) {
+        tcp_send_ack(s);
+    }
+    return queued;
+}
+
+void tcp_input(uint32_t src_ip, uint32_t dst_ip, pbuf_t *p) {
+    if (!tcp_process(src_ip, dst_ip, p)) {
+        pbuf_free(p);
+    }
+}
+
+// =============================================================================
+// Timers
+// =============================================================================
+static void tcp_timeout(tcp_socket_t *s) {
+    if (++s->retries > TCP_MAX_RETRIES) {
+        printf("[TCP] connection to port %u timed out\n", s->remote_port);
+        tcp_abort(s);
+        s->rto_deadline = 0;
+        if (tcp_orphaned(s)) tcp_release(s);
+        return;
+    }
+
+    s->rto = tcp_min(s->rto * 2, TCP_RTO_MAX);
+    s->rtt_timing = false;                   // Karn: no samples from retransmissions
+    s->rto_deadline = 0;
+
+    if (s->state == TCP_SYN_SENT || s->state == TCP_SYN_RECEIVED) {
+        tcp_stats.retransmits++;
+        tcp_send_syn(s);
+    } else {
+        uint32_t flight = s->snd_nxt - s->snd_una;
+        if (flight == 0 && s->snd_wnd == 0) {
+            tcp_output(s, true);             // Zero window probe
+        } else {
+            s->ssthresh = flight / 2 > 2u * s->mss ? flight / 2 : 2u * s->mss;
+            s->cwnd = s->mss;
+            s->snd_nxt = s->snd_una;         // Go back and resend from the oldest byte
+            tcp_stats.retransmits++;
+            tcp_output(s, false);
+        }
+    }
+    if (s->rto_deadline == 0 && (s->snd_max != s->snd_una || s->state == TCP_SYN_SENT ||
+                                 s->state == TCP_SYN_RECEIVED)) {
+        s->rto_deadline = tcp_deadline(s->rto);
+    }
+}
+
+void tcp_timer(void) {
+    uint32_t now = pit_get_ticks();
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        tcp_socket_t *s = &tcp_sockets[i];
+        if (!s->used) continue;
+
+        if (tcp_expired(s->timewait_deadline, now)) {
+            // TIME_WAIT over, or an orphaned FIN_WAIT_2 peer never sent its FIN
+            s->state = TCP_CLOSED;
+            s->timewait_deadline = 0;
+            if (tcp_orphaned(s)) {
+                tcp_release(s);
+                continue;
+            }
+        }
+        if (tcp_expired(s->delack_deadline, now)) {
+            tcp_stats.delayed_acks++;
+            tcp_send_ack(s);
+        }
+        if (tcp_expired(s->rto_deadline, now)) {
+            tcp_timeout(s);
+        }
+        if (s->tx_blocked) {
+            tcp_output(s, false);
+        }
+    }
+}
+
+// =============================================================================
+// Socket API
+// =============================================================================
+static tcp_socket_t *tcp_socket(int socket) {
+    if (socket < 0 || socket >= TCP_MAX_SOCKETS || !tcp_sockets[socket].used) return NULL;
+    return &tcp_sockets[socket];
+}
+
+void tcp_init(void) {
+    memset(tcp_sockets, 0, sizeof(tcp_sockets));
+    for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+        tcp_sockets[i].hash_next = -1;
+        tcp_sockets[i].parent = -1;
+    }
+    for (int i = 0; i < TCP_HASH_BUCKETS; ++i) tcp_hash[i] = -1;
+    memset(&tcp_stats, 0, sizeof(tcp_stats));
+}
+
+int tcp_connect(uint32_t dst_ip, uint16_t dst_port) {
+    // Unconfigured default interface: try DHCP once
+    uint32_t local_ip = netstack_source_address(dst_ip);
+    if (local_ip == 0 && netstack_get_ip_address() != 0) local_ip = netstack_source_address(dst_ip);
+    if (local_ip == 0) return -1;
+    if (!netstack_resolve(dst_ip, 2000)) {
+        printf("[TCP] no ARP reply for next hop\n");
+        return -1;
+    }
+
+    uint16_t port = tcp_ephemeral_port();
+    if (port == 0) return -1;
+    tcp_socket_t *s = tcp_alloc(true);
+    if (!s) return -1;
+    s->local_ip    = local_ip;
+    s->local_port  = port;
+    s->remote_ip   = dst_ip;
+    s->remote_port = dst_port;
+    s->state       = TCP_SYN_SENT;
+    tcp_start_sequence(s);
+    tcp_hash_insert(s);
+
+    s->rtt_timing = true;
+    s->rtt_seq = s->snd_nxt;
+    s->rtt_start = pit_get_ticks();
+    tcp_send_syn(s);
+    s->rto_deadline = tcp_deadline(s->rto);
+
+    uint32_t start = pit_get_ticks();
+    while ((s->state == TCP_SYN_SENT || s->state == TCP_SYN_RECEIVED) &&
+           pit_get_ticks() - start < TCP_CONNECT_TIMEOUT) {
+        netstack_poll();
+    }
+    if (s->state != TCP_ESTABLISHED) {
+        tcp_abort(s);
+        tcp_release(s);
+        return -1;
+    }
+    return (int)(s - tcp_sockets);
+}
+
+int tcp_listen(uint16_t port) {
+    if (port == 0 || tcp_lookup_listener(port)) return -1;
+    tcp_socket_t *s = tcp_alloc(false);
+    if (!s) return -1;
+    s->local_port = port;
+    s->state = TCP_LISTEN;
+    return (int)(s - tcp_sockets);
+}
+
+int tcp_accept(int listener, uint32_t timeout_ms) {
+    tcp_socket_t *l = tcp_socket(listener);
+    if (!l || l->state != TCP_LISTEN) return -1;
+
+    uint32_t start = pit_get_ticks();
+    do {
+        for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+            tcp_socket_t *s = &tcp_sockets[i];
+            if (s->used && s->parent == listener && !s->accepted &&
+                (s->state == TCP_ESTABLISHED || s->state == TCP_CLOSE_WAIT)) {
+                s->accepted = true;
+                return i;
+            }
+        }
+        netstack_poll();
+    } while (pit_get_ticks() - start < timeout_ms);
+    return -1;
+}
+
+int tcp_send(int socket, uint8_t *data, uint16_t length) {
+    tcp_socket_t *s = tcp_socket(socket);
+    if (!s || !data) return -1;
+
+    uint32_t sent = 0;
+    uint32_t last_progress = pit_get_ticks();
+    while (sent < length) {
+        if (s->state != TCP_ESTABLISHED && s->state != TCP_CLOSE_WAIT) {
+            return sent ? (int)sent : -1;
+        }
+        uint32_t n = ring_write(&s->snd, data + sent, length - sent);
+        if (n) {
+            sent += n;
+            last_progress = pit_get_ticks();
+            tcp_output(s, false);
+        }
+        if (sent < length) {
+            if (pit_get_ticks() - last_progress >= TCP_IO_TIMEOUT) break;
+            netstack_poll();
+        }
+    }
+    return (int)sent;
+}
+
+int tcp_recv(int socket, uint8_t *buffer, uint16_t max_length) {
+    tcp_socket_t *s = tcp_socket(socket);
+    if (!s || !buffer || !s->snd.data) return -1;
+
+    uint32_t start = pit_get_ticks();
+    while (s->rcv.bytes == 0) {
+        if (s->fin_received) return 0;
+        if (s->reset || s->state == TCP_CLOSED) return -1;
+        if (pit_get_ticks() - start >= TCP_IO_TIMEOUT) return -1;
+        netstack_poll();
+    }
+
+    uint32_t n = pbuf_queue_read(&s->rcv, buffer, max_length);
+
+    // Window update once the window has opened by a useful amount (receiver SWS avoidance)
+    uint32_t right_edge = s->rcv_nxt + tcp_receive_window(s);
+    uint32_t threshold = tcp_min(2u * s->mss, TCP_BUFFER_SIZE / 2);
+    if (!s->fin_received && (int32_t)(right_edge - s->rcv_adv) >= (int32_t)threshold) {
+        tcp_send_ack(s);
+    }
+    return (int)n;
+}
+
+void tcp_close(int socket) {
+    tcp_socket_t *s = tcp_socket(socket);
+    if (!s) return;
+    s->user_closed = true;
+
+    switch (s->state) {
+        case TCP_LISTEN:
+            // Drop connections nobody accepted
+            for (int i = 0; i < TCP_MAX_SOCKETS; ++i) {
+                tcp_socket_t *c = &tcp_sockets[i];
+                if (c->used && c->parent == socket && !c->accepted) {
+                    tcp_abort(c);
+                    tcp_release(c);
+                } else if (c->used && c->parent == socket) {
+                    c->parent = -1;
+                }
+            }
+            tcp_release(s);
+            return;
+        case TCP_CLOSED:
+        case TCP_SYN_SENT:
+            tcp_release(s);
+            return;
+        case TCP_SYN_RECEIVED:
+        case TCP_ESTABLISHED:
+            s->fin_pending = true;
+            s->state = TCP_FIN_WAIT_1;
+            break;
+        case TCP_CLOSE_WAIT:
+            s->fin_pending = true;
+            s->state = TCP_LAST_ACK;
+            break;
+        default:
+            return;                          // Already closing
+    }
+    tcp_output(s, false);
+
+    // Linger until the queued data and our FIN are acknowledged
+    uint32_t start = pit_get_ticks();
+    while (s->used && s->user_closed &&
+           (s->state == TCP_FIN_WAIT_1 || s->state == TCP_CLOSING || s->state == TCP_LAST_ACK)) {
+        if (pit_get_ticks() - start >= TCP_IO_TIMEOUT) {
+            tcp_abort(s);
+            tcp_release(s);
+            return;
+        }
+        netstack_poll();
+    }
+    if (s->used && s->user_closed && s->state == TCP_FIN_WAIT_2) {
+        s->timewait_deadline = tcp_deadline(TCP_IO_TIMEOUT);
+    }
+    if (s->used && s->user_closed && s->state == TCP_CLOSED) {
+        tcp_release(s);
+    }
+}
+
+void tcp_set_nodelay(int socket, bool nodelay) {
+    tcp_socket_t *s = tcp_socket(socket);
+    if (s) s->nodelay = nodelay;
+}
+
+const tcp_socket_t* tcp_get_socket(int socket) {
+    return tcp_socket(socket);
+}
+
+void tcp_get_stats(tcp_stats_t *stats) {
+    if (stats) *stats = tcp_stats;
+}
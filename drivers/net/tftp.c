@@ -0,0 +1,678 @@
+// drivers/net/tftp.c
+// TFTP client and server on top of UDP sockets. Both directions share two
+// engines: tftp_receive() takes DATA blocks and acknowledges every window,
+// tftp_send() sends a window of blocks and slides it on each ACK (RFC 7440).
+// With windowsize 1 both degrade to the lock-step protocol of RFC 1350.
+
+#include "drivers/net/tftp.h"
+#include "drivers/net/netstack.h"
+#include "fs/vfs/vfs.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TFTP_HEADER_LEN   4
+#define TFTP_BLKSIZE_MIN  8              // RFC 2348
+#define TFTP_BLKSIZE_MTU  (ETH_MAX_PAYLOAD - sizeof(ip_header_t) - sizeof(udp_header_t) - TFTP_HEADER_LEN)
+
+// One transfer runs at a time, so the packet buffers are shared
+static uint8_t tftp_rx[TFTP_HEADER_LEN + TFTP_BLKSIZE_MAX];
+static uint8_t tftp_tx[TFTP_HEADER_LEN + TFTP_BLKSIZE_MAX];
+
+// A transfer between a local socket and the peer's transfer ID (its port)
+typedef struct {
+    int sock;
+    uint32_t peer_ip;
+    uint16_t peer_port;
+    bool tid_locked;             // peer_port is the peer's TID, not port 69
+    uint16_t blksize;
+    uint16_t windowsize;
+    tftp_result_t *result;
+} tftp_xfer_t;
+
+// Options found in a request or OACK
+typedef struct {
+    bool has_blksize, has_windowsize, has_tsize;
+    uint32_t blksize, windowsize, tsize;
+} tftp_opts_t;
+
+// =============================================================================
+// Packet helpers
+// =============================================================================
+static inline void tftp_put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline uint16_t tftp_get16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint16_t tftp_put_str(uint8_t *p, const char *s) {
+    uint16_t n = (uint16_t)strlen(s) + 1;
+    memcpy(p, s, n);
+    return n;
+}
+
+static uint16_t tftp_put_opt(uint8_t *p, const char *name, uint32_t value) {
+    char digits[11];
+    char text[11];
+    int n = 0, i = 0;
+    do { digits[n++] = (char)('0' + value % 10); value /= 10; } while (value);
+    while (n) text[i++] = digits[--n];
+    text[i] = '\0';
+    uint16_t len = tftp_put_str(p, name);
+    return (uint16_t)(len + tftp_put_str(p + len, text));
+}
+
+// Next NUL-terminated string in [*p, end), NULL if there is none
+static const char *tftp_next_str(const uint8_t **p, const uint8_t *end) {
+    const uint8_t *s = *p;
+    for (const uint8_t *c = s; c < end; ++c) {
+        if (*c == 0) { *p = c + 1; return (const char *)s; }
+    }
+    return NULL;
+}
+
+static void tftp_parse_opts(const uint8_t *p, const uint8_t *end, tftp_opts_t *o) {
+    memset(o, 0, sizeof(*o));
+    const char *name, *value;
+    while ((name = tftp_next_str(&p, end)) != NULL && (value = tftp_next_str(&p, end)) != NULL) {
+        uint32_t v = strtoul(value, NULL, 10);
+        if (strncasecmp(name, "blksize", 8) == 0)         { o->has_blksize = true;    o->blksize = v; }
+        else if (strncasecmp(name, "windowsize", 11) == 0) { o->has_windowsize = true; o->windowsize = v; }
+        else if (strncasecmp(name, "tsize", 6) == 0)       { o->has_tsize = true;      o->tsize = v; }
+    }
+}
+
+static void tftp_fail(tftp_result_t *r, const char *msg) {
+    strncpy(r->error, msg, sizeof(r->error) - 1);
+    r->error[sizeof(r->error) - 1] = '\0';
+}
+
+static void tftp_send_error_to(int sock, uint32_t ip, uint16_t port, uint16_t code, const char *msg) {
+    uint8_t pkt[TFTP_HEADER_LEN + 64];
+    tftp_put16(pkt, TFTP_OP_ERROR);
+    tftp_put16(pkt + 2, code);
+    uint16_t len = (uint16_t)strlen(msg);
+    if (len > 63) len = 63;
+    memcpy(pkt + TFTP_HEADER_LEN, msg, len);
+    pkt[TFTP_HEADER_LEN + len] = 0;
+    udp_sendto(sock, ip, port, pkt, (uint16_t)(TFTP_HEADER_LEN + len + 1));
+}
+
+static void tftp_send_error(tftp_xfer_t *x, uint16_t code, const char *msg) {
+    tftp_send_error_to(x->sock, x->peer_ip, x->peer_port, code, msg);
+    tftp_fail(x->result, msg);
+}
+
+static void tftp_send_ack(tftp_xfer_t *x, uint16_t block) {
+    uint8_t pkt[TFTP_HEADER_LEN];
+    tftp_put16(pkt, TFTP_OP_ACK);
+    tftp_put16(pkt + 2, block);
+    udp_sendto(x->sock, x->peer_ip, x->peer_port, pkt, TFTP_HEADER_LEN);
+}
+
+// ERROR packet from the peer: keep its message as the failure reason
+static void tftp_peer_error(tftp_xfer_t *x, int len) {
+    const uint8_t *p = tftp_rx + TFTP_HEADER_LEN;
+    const char *msg = tftp_next_str(&p, tftp_rx + len);
+    tftp_fail(x->result, msg && *msg ? msg : "peer reported an error");
+}
+
+// Wait for a packet from the peer. Until the peer's TID is known any port
+// on its address is accepted; afterwards strangers get ERROR 5 (RFC 1350).
+static int tftp_recv(tftp_xfer_t *x, uint32_t timeout_ms) {
+    uint32_t start = pit_get_ticks();
+    for (;;) {
+        uint32_t waited = pit_get_ticks() - start;
+        if (waited >= timeout_ms) return -1;
+        uint32_t ip;
+        uint16_t port;
+        int n = udp_recvfrom(x->sock, tftp_rx, sizeof(tftp_rx), &ip, &port, timeout_ms - waited);
+        if (n < 0) return -1;
+        if (ip != x->peer_ip) continue;
+        if (!x->tid_locked) {
+            x->peer_port = port;
+            x->tid_locked = true;
+        } else if (port != x->peer_port) {
+            tftp_send_error_to(x->sock, ip, port, TFTP_ERR_UNKNOWN_TID, "unknown transfer ID");
+            continue;
+        }
+        if (n >= TFTP_HEADER_LEN) return n;
+    }
+}
+
+// =============================================================================
+// Transfer engines
+// =============================================================================
+// Receive DATA blocks until a short one ends the file. 'pending' is the
+// length of a first DATA packet already sitting in tftp_rx (0 = none).
+static int tftp_receive(tftp_xfer_t *x, tftp_sink_t sink, void *ctx, int pending) {
+    tftp_result_t *r = x->result;
+    uint16_t acked = 0;          // Last block received in order
+    uint32_t offset = 0;
+    uint16_t in_window = 0;
+    bool nak_sent = false;
+    int retries = 0;
+
+    for (;;) {
+        int n = pending ? pending : tftp_recv(x, TFTP_TIMEOUT);
+        pending = 0;
+        if (n < 0) {
+            if (++retries > TFTP_RETRIES) { tftp_fail(r, "timed out"); return -1; }
+            tftp_send_ack(x, acked);
+            r->retransmits++;
+            in_window = 0;
+            continue;
+        }
+
+        uint16_t op = tftp_get16(tftp_rx);
+        if (op == TFTP_OP_ERROR) { tftp_peer_error(x, n); return -1; }
+        if (op != TFTP_OP_DATA) continue;
+
+        uint16_t block = tftp_get16(tftp_rx + 2);
+        uint16_t len = (uint16_t)(n - TFTP_HEADER_LEN);
+        if (block != (uint16_t)(acked + 1)) {
+            // Gap or duplicate: acknowledging the last good block makes the
+            // sender restart its window right after it. Once per stall only,
+            // so duplicates cannot multiply.
+            if (!nak_sent) {
+                tftp_send_ack(x, acked);
+                nak_sent = true;
+                r->retransmits++;
+            }
+            in_window = 0;
+            continue;
+        }
+        if (len > x->blksize) {
+            tftp_send_error(x, TFTP_ERR_ILLEGAL_OP, "block larger than blksize");
+            return -1;
+        }
+        if (len && !sink(ctx, offset, tftp_rx + TFTP_HEADER_LEN, len)) {
+            tftp_send_error(x, TFTP_ERR_DISK_FULL, "cannot store data");
+            return -1;
+        }
+
+        retries = 0;
+        nak_sent = false;
+        offset += len;
+        acked = block;
+        r->blocks++;
+        r->bytes = offset;
+        bool last = len < x->blksize;
+        if (last || ++in_window >= x->windowsize) {
+            tftp_send_ack(x, acked);
+            in_window = 0;
+        }
+        if (last) return (int)offset;
+    }
+}
+
+// Send the file a window at a time. Block numbers count on past 65535 on
+// the wire by wrapping to 0, as common implementations do.
+static int tftp_send(tftp_xfer_t *x, tftp_source_t source, void *ctx) {
+    tftp_result_t *r = x->result;
+    uint32_t base = 0;           // Blocks acknowledged
+    uint32_t last_block = 0;     // Number of the short final block once read
+    uint32_t total = 0;
+    int retries = 0;
+
+    for (;;) {
+        uint32_t sent = base;
+        for (uint32_t b = base + 1; b <= base + x->windowsize; ++b) {
+            int n = source(ctx, (b - 1) * x->blksize, tftp_tx + TFTP_HEADER_LEN, x->blksize);
+            if (n < 0) {
+                tftp_send_error(x, TFTP_ERR_ACCESS, "read error");
+                return -1;
+            }
+            tftp_put16(tftp_tx, TFTP_OP_DATA);
+            tftp_put16(tftp_tx + 2, (uint16_t)b);
+            // A full TX queue loses the rest of the window like the network would
+            if (udp_sendto(x->sock, x->peer_ip, x->peer_port, tftp_tx, (uint16_t)(TFTP_HEADER_LEN + n)) < 0) break;
+            sent = b;
+            if (n < x->blksize) {
+                last_block = b;
+                total = (b - 1) * x->blksize + (uint32_t)n;
+                break;
+            }
+        }
+
+        // Wait for an ACK that moves the window
+        for (;;) {
+            int n = tftp_recv(x, TFTP_TIMEOUT);
+            if (n < 0) {
+                if (++retries > TFTP_RETRIES) { tftp_fail(r, "timed out"); return -1; }
+                r->retransmits++;
+                break;
+            }
+            uint16_t op = tftp_get16(tftp_rx);
+            if (op == TFTP_OP_ERROR) { tftp_peer_error(x, n); return -1; }
+            if (op != TFTP_OP_ACK) continue;
+
+            uint16_t advance = (uint16_t)(tftp_get16(tftp_rx + 2) - (uint16_t)base);
+            if (advance == 0 && x->windowsize > 1) {
+                // Receiver saw a gap right after base (RFC 7440)
+                r->retransmits++;
+                break;
+            }
+            if (advance == 0 || advance > sent - base) continue;   // Stale or duplicate
+
+            base += advance;
+            retries = 0;
+            r->blocks = base;
+            r->bytes = base * x->blksize;
+            if (last_block && base == last_block) {
+                r->bytes = total;
+                return (int)total;
+            }
+            break;
+        }
+    }
+}
+
+// Build RRQ/WRQ with our option wishes in tftp_tx
+static uint16_t tftp_build_request(uint16_t op, const char *filename, uint16_t blksize, uint16_t windowsize) {
+    uint16_t len = 2;
+    tftp_put16(tftp_tx, op);
+    len += tftp_put_str(tftp_tx + len, filename);
+    len += tftp_put_str(tftp_tx + len, "octet");
+    if (blksize != TFTP_BLKSIZE_DEFAULT) len += tftp_put_opt(tftp_tx + len, "blksize", blksize);
+    if (windowsize > 1) len += tftp_put_opt(tftp_tx + len, "windowsize", windowsize);
+    if (op == TFTP_OP_RRQ) len += tftp_put_opt(tftp_tx + len, "tsize", 0);
+    return len;
+}
+
+// Apply the server's OACK; it may only lower what was asked for
+static bool tftp_accept_oack(tftp_xfer_t *x, int len, uint16_t want_blksize, uint16_t want_window) {
+    tftp_opts_t o;
+    tftp_parse_opts(tftp_rx + 2, tftp_rx + len, &o);
+    x->blksize = TFTP_BLKSIZE_DEFAULT;
+    x->windowsize = 1;
+    if (o.has_blksize) {
+        if (o.blksize < TFTP_BLKSIZE_MIN || o.blksize > want_blksize) return false;
+        x->blksize = (uint16_t)o.blksize;
+    }
+    if (o.has_windowsize) {
+        if (o.windowsize < 1 || o.windowsize > want_window) return false;
+        x->windowsize = (uint16_t)o.windowsize;
+    }
+    if (o.has_tsize) x->result->tsize = o.tsize;
+    return true;
+}
+
+// Socket, option wishes and the initial request; returns the first reply's length
+static int tftp_client_start(tftp_xfer_t *x, uint16_t op, uint32_t server_ip, const char *filename,
+                             const tftp_options_t *opts, tftp_result_t *result,
+                             uint16_t *want_blksize, uint16_t *want_window) {
+    memset(result, 0, sizeof(*result));
+    memset(x, 0, sizeof(*x));
+    x->result = result;
+    x->peer_ip = server_ip;
+    x->peer_port = TFTP_PORT;
+    x->sock = udp_open(0);
+    if (x->sock < 0) { tftp_fail(result, "no free UDP socket"); return -1; }
+    if (strlen(filename) > 255) { tftp_fail(result, "file name too long"); return -1; }
+
+    uint32_t blksize = opts && opts->blksize ? opts->blksize : TFTP_BLKSIZE_MTU;
+    uint32_t window = opts && opts->windowsize ? opts->windowsize : TFTP_WINDOW_MAX;
+    if (blksize < TFTP_BLKSIZE_MIN) blksize = TFTP_BLKSIZE_MIN;
+    if (blksize > TFTP_BLKSIZE_MAX) blksize = TFTP_BLKSIZE_MAX;
+    if (window > TFTP_WINDOW_MAX) window = TFTP_WINDOW_MAX;
+    *want_blksize = (uint16_t)blksize;
+    *want_window = (uint16_t)window;
+
+    uint16_t len = tftp_build_request(op, filename, *want_blksize, *want_window);
+    for (int attempt = 0; attempt <= TFTP_RETRIES; ++attempt) {
+        if (attempt) result->retransmits++;
+        udp_sendto(x->sock, server_ip, TFTP_PORT, tftp_tx, len);
+        int n = tftp_recv(x, TFTP_TIMEOUT);
+        if (n >= 0) return n;
+    }
+    tftp_fail(result, "no answer from server");
+    return -1;
+}
+
+// =============================================================================
+// Client
+// =============================================================================
+int tftp_get(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+             tftp_sink_t sink, void *ctx, tftp_result_t *result) {
+    tftp_result_t local;
+    if (!result) result = &local;
+    tftp_xfer_t x;
+    uint16_t want_blksize, want_window;
+    uint32_t start = pit_get_ticks();
+    int n = tftp_client_start(&x, TFTP_OP_RRQ, server_ip, filename, opts, result, &want_blksize, &want_window);
+
+    int r = -1;
+    if (n >= 0) {
+        uint16_t op = tftp_get16(tftp_rx);
+        if (op == TFTP_OP_OACK) {
+            if (tftp_accept_oack(&x, n, want_blksize, want_window)) {
+                tftp_send_ack(&x, 0);
+                r = tftp_receive(&x, sink, ctx, 0);
+            } else {
+                tftp_send_error(&x, TFTP_ERR_OPTIONS, "unacceptable options");
+            }
+        } else if (op == TFTP_OP_DATA) {
+            // Server without option support (RFC 1350 defaults)
+            x.blksize = TFTP_BLKSIZE_DEFAULT;
+            x.windowsize = 1;
+            r = tftp_receive(&x, sink, ctx, n);
+        } else if (op == TFTP_OP_ERROR) {
+            tftp_peer_error(&x, n);
+        } else {
+            tftp_send_error(&x, TFTP_ERR_ILLEGAL_OP, "unexpected opcode");
+        }
+    }
+    result->blksize = x.blksize;
+    result->windowsize = x.windowsize;
+    result->elapsed_ms = pit_get_ticks() - start;
+    if (x.sock >= 0) udp_close(x.sock);
+    return r;
+}
+
+int tftp_put(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+             tftp_source_t source, void *ctx, tftp_result_t *result) {
+    tftp_result_t local;
+    if (!result) result = &local;
+    tftp_xfer_t x;
+    uint16_t want_blksize, want_window;
+    uint32_t start = pit_get_ticks();
+    int n = tftp_client_start(&x, TFTP_OP_WRQ, server_ip, filename, opts, result, &want_blksize, &want_window);
+
+    int r = -1;
+    if (n >= 0) {
+        uint16_t op = tftp_get16(tftp_rx);
+        if (op == TFTP_OP_OACK) {
+            if (tftp_accept_oack(&x, n, want_blksize, want_window)) {
+                r = tftp_send(&x, source, ctx);
+            } else {
+                tftp_send_error(&x, TFTP_ERR_OPTIONS, "unacceptable options");
+            }
+        } else if (op == TFTP_OP_ACK && tftp_get16(tftp_rx + 2) == 0) {
+            x.blksize = TFTP_BLKSIZE_DEFAULT;
+            x.windowsize = 1;
+            r = tftp_send(&x, source, ctx);
+        } else if (op == TFTP_OP_ERROR) {
+            tftp_peer_error(&x, n);
+        } else {
+            tftp_send_error(&x, TFTP_ERR_ILLEGAL_OP, "unexpected opcode");
+        }
+    }
+    result->blksize = x.blksize;
+    result->windowsize = x.windowsize;
+    result->elapsed_ms = pit_get_ticks() - start;
+    if (x.sock >= 0) udp_close(x.sock);
+    return r;
+}
+
+// Sinks and sources for memory and VFS files
+typedef struct {
+    uint8_t *dst;
+    uint32_t max;
+} tftp_memory_t;
+
+static bool tftp_memory_sink(void *ctx, uint32_t offset, const uint8_t *data, uint16_t len) {
+    tftp_memory_t *m = (tftp_memory_t *)ctx;
+    if (offset + len > m->max) return false;
+    memcpy(m->dst + offset, data, len);
+    return true;
+}
+
+static bool tftp_file_sink(void *ctx, uint32_t offset, const uint8_t *data, uint16_t len) {
+    return vfs_write((vfs_node_t *)ctx, offset, len, data) == (int)len;
+}
+
+static int tftp_file_source(void *ctx, uint32_t offset, uint8_t *buf, uint16_t len) {
+    vfs_node_t *node = (vfs_node_t *)ctx;
+    if (offset >= node->size) return 0;
+    if (node->size - offset < len) len = (uint16_t)(node->size - offset);
+    return vfs_read(node, offset, len, buf) == (int)len ? (int)len : -1;
+}
+
+int tftp_get_to_memory(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+                       uint8_t *dst, uint32_t max, tftp_result_t *result) {
+    tftp_memory_t m = { dst, max };
+    return tftp_get(server_ip, filename, opts, tftp_memory_sink, &m, result);
+}
+
+// Transfers land in "<path>.part" and replace 'path' only once complete
+static bool tftp_part_path(const char *path, char *out, size_t size) {
+    if (strlen(path) + 6 > size) return false;
+    strcpy(out, path);
+    strcat(out, ".part");
+    return true;
+}
+
+int tftp_get_to_file(uint32_t server_ip, const char *filename, const char *path,
+                     const tftp_options_t *opts, tftp_result_t *result) {
+    char part[256];
+    vfs_node_t *node;
+    if (!tftp_part_path(path, part, sizeof(part))) {
+        if (result) tftp_fail(result, "local path too long");
+        return -1;
+    }
+    vfs_delete(part);
+    if (vfs_create(part) != VFS_OK || vfs_open(part, &node) != VFS_OK) {
+        if (result) tftp_fail(result, "cannot create local file");
+        return -1;
+    }
+    int r = tftp_get(server_ip, filename, opts, tftp_file_sink, node, result);
+    vfs_close(node);
+    if (r >= 0 && vfs_rename(part, path) != VFS_OK) {
+        if (result) tftp_fail(result, "cannot replace local file");
+        r = -1;
+    }
+    if (r < 0) vfs_delete(part);
+    return r;
+}
+
+int tftp_put_file(uint32_t server_ip, const char *path, const char *filename,
+                  const tftp_options_t *opts, tftp_result_t *result) {
+    vfs_node_t *node;
+    if (vfs_open(path, &node) != VFS_OK) {
+        if (result) tftp_fail(result, "cannot open local file");
+        return -1;
+    }
+    int r = tftp_put(server_ip, filename, opts, tftp_file_source, node, result);
+    vfs_close(node);
+    return r;
+}
+
+// =============================================================================
+// Server
+// =============================================================================
+// root + "/" + name; names climbing out of root are refused
+static bool tftp_server_path(const char *root, const char *name, char *path, uint32_t size) {
+    while (*name == '/') name++;
+    if (!*name || strstr(name, "..")) return false;
+    uint32_t root_len = (uint32_t)strlen(root);
+    while (root_len && root[root_len - 1] == '/') root_len--;
+    if (root_len + 1 + strlen(name) + 1 > size) return false;
+    memcpy(path, root, (uint16_t)root_len);
+    path[root_len] = '/';
+    strcpy(path + root_len + 1, name);
+    return true;
+}
+
+// Send our OACK and wait for what acknowledges it: ACK 0 for reads, DATA 1
+// for writes (left in tftp_rx). Returns the reply length or -1.
+static int tftp_server_oack(tftp_xfer_t *x, uint16_t op, const tftp_opts_t *o, uint32_t tsize) {
+    uint16_t len = 2;
+    tftp_put16(tftp_tx, TFTP_OP_OACK);
+    if (o->has_blksize) len += tftp_put_opt(tftp_tx + len, "blksize", x->blksize);
+    if (o->has_windowsize) len += tftp_put_opt(tftp_tx + len, "windowsize", x->windowsize);
+    if (o->has_tsize) len += tftp_put_opt(tftp_tx + len, "tsize", tsize);
+
+    for (int attempt = 0; attempt <= TFTP_RETRIES; ++attempt) {
+        if (attempt) x->result->retransmits++;
+        udp_sendto(x->sock, x->peer_ip, x->peer_port, tftp_tx, len);
+        int n = tftp_recv(x, TFTP_TIMEOUT);
+        if (n < 0) continue;
+        uint16_t rop = tftp_get16(tftp_rx);
+        if (rop == TFTP_OP_ERROR) { tftp_peer_error(x, n); return -1; }
+        if (op == TFTP_OP_RRQ && rop == TFTP_OP_ACK && tftp_get16(tftp_rx + 2) == 0) return n;
+        if (op == TFTP_OP_WRQ && rop == TFTP_OP_DATA) return n;
+    }
+    tftp_fail(x->result, "no answer to OACK");
+    return -1;
+}
+
+// Handle one RRQ/WRQ sitting in tftp_rx; returns the bytes moved or -1
+static int tftp_server_request(const char *root, bool allow_write, uint32_t ip, uint16_t port, int len) {
+    tftp_result_t result;
+    tftp_xfer_t x;
+    memset(&result, 0, sizeof(result));
+    memset(&x, 0, sizeof(x));
+    x.result = &result;
+    x.peer_ip = ip;
+    x.peer_port = port;
+    x.tid_locked = true;
+    x.blksize = TFTP_BLKSIZE_DEFAULT;
+    x.windowsize = 1;
+    x.sock = udp_open(0);        // Our TID
+    if (x.sock < 0) return -1;
+
+    // The request lives in tftp_rx, which the transfer overwrites; keep a
+    // copy of the name for the messages at the end
+    const uint8_t *p = tftp_rx + 2;
+    const uint8_t *end = tftp_rx + len;
+    uint16_t op = tftp_get16(tftp_rx);
+    const char *req_name = tftp_next_str(&p, end);
+    const char *mode = req_name ? tftp_next_str(&p, end) : NULL;
+    tftp_opts_t o;
+    tftp_parse_opts(p, end, &o);
+
+    char name_buf[128];
+    const char *name = NULL;
+    if (req_name && strlen(req_name) < sizeof(name_buf)) {
+        strcpy(name_buf, req_name);
+        name = name_buf;
+    }
+
+    char path[256];
+    char part[256];
+    vfs_node_t *node = NULL;
+    int r = -1;
+    uint32_t start = pit_get_ticks();
+
+    // netascii is passed through unconverted
+    if ((op != TFTP_OP_RRQ && op != TFTP_OP_WRQ) || !name || !mode ||
+        (strncasecmp(mode, "octet", 6) != 0 && strncasecmp(mode, "netascii", 9) != 0)) {
+        tftp_send_error(&x, TFTP_ERR_ILLEGAL_OP, "bad request");
+        goto done;
+    }
+    if (!tftp_server_path(root, name, path, sizeof(path))) {
+        tftp_send_error(&x, TFTP_ERR_ACCESS, "access violation");
+        goto done;
+    }
+
+    if (o.has_blksize) {
+        if (o.blksize < TFTP_BLKSIZE_MIN) o.has_blksize = false;
+        else x.blksize = (uint16_t)(o.blksize > TFTP_BLKSIZE_MAX ? TFTP_BLKSIZE_MAX : o.blksize);
+    }
+    if (o.has_windowsize) {
+        if (o.windowsize < 1) o.has_windowsize = false;
+        else x.windowsize = (uint16_t)(o.windowsize > TFTP_WINDOW_MAX ? TFTP_WINDOW_MAX : o.windowsize);
+    }
+    bool oack = o.has_blksize || o.has_windowsize || o.has_tsize;
+
+    if (op == TFTP_OP_RRQ) {
+        if (vfs_open(path, &node) != VFS_OK || node->type != VFS_FILE) {
+            tftp_send_error(&x, TFTP_ERR_NOT_FOUND, "file not found");
+            goto done;
+        }
+        if (oack && tftp_server_oack(&x, op, &o, node->size) < 0) goto done;
+        r = tftp_send(&x, tftp_file_source, node);
+    } else {
+        vfs_dir_entry_t st;
+        if (!allow_write) {
+            tftp_send_error(&x, TFTP_ERR_ACCESS, "server is read-only");
+            goto done;
+        }
+        if (vfs_stat(path, &st) == VFS_OK) {
+            tftp_send_error(&x, TFTP_ERR_EXISTS, "file already exists");
+            goto done;
+        }
+        if (!tftp_part_path(path, part, sizeof(part))) {
+            tftp_send_error(&x, TFTP_ERR_ACCESS, "access violation");
+            goto done;
+        }
+        vfs_delete(part);
+        if (vfs_create(part) != VFS_OK || vfs_open(part, &node) != VFS_OK) {
+            tftp_send_error(&x, TFTP_ERR_ACCESS, "cannot create file");
+            goto done;
+        }
+        int pending = 0;
+        if (oack) {
+            pending = tftp_server_oack(&x, op, &o, o.tsize);
+            if (pending < 0) goto done;
+        } else {
+            tftp_send_ack(&x, 0);
+        }
+        r = tftp_receive(&x, tftp_file_sink, node, pending);
+    }
+
+done:
+    if (node) vfs_close(node);
+    if (op == TFTP_OP_WRQ && node) {
+        if (r >= 0 && vfs_rename(part, path) != VFS_OK) {
+            tftp_fail(&result, "cannot rename upload");
+            r = -1;
+        }
+        if (r < 0) vfs_delete(part);
+    }
+    udp_close(x.sock);
+
+    char ip_s[16];
+    format_ipv4(ip, ip_s);
+    uint32_t ms = pit_get_ticks() - start;
+    if (r >= 0) {
+        printf("[TFTP] %s %s %s: %u bytes in %u ms (blksize %u, window %u)\n",
+               op == TFTP_OP_RRQ ? "sent" : "received", name, ip_s, (uint32_t)r, ms, x.blksize, x.windowsize);
+    } else {
+        printf("[TFTP] %s from %s failed: %s\n", name ? name : "request", ip_s, result.error);
+    }
+    return r;
+}
+
+int tftp_serve(const char *root, bool allow_write, uint32_t duration_ms) {
+    int sock = udp_open(TFTP_PORT);
+    if (sock < 0) return -1;
+
+    uint32_t start = pit_get_ticks();
+    uint32_t last_ip = 0;
+    uint16_t last_port = 0;
+    uint32_t last_done = 0;
+    int completed = 0;
+    for (;;) {
+        uint32_t timeout = UDP_WAIT_FOREVER;
+        if (duration_ms) {
+            uint32_t elapsed = pit_get_ticks() - start;
+            if (elapsed >= duration_ms) break;
+            timeout = duration_ms - elapsed;
+        }
+        uint32_t ip;
+        uint16_t port;
+        int n = udp_recvfrom(sock, tftp_rx, sizeof(tftp_rx), &ip, &port, timeout);
+        if (n < 0) break;
+        if (n < TFTP_HEADER_LEN) continue;
+        // Requests the client repeated while we were busy with it
+        if (ip == last_ip && port == last_port &&
+            pit_get_ticks() - last_done < TFTP_TIMEOUT * TFTP_RETRIES) continue;
+
+        if (tftp_server_request(root, allow_write, ip, port, n) >= 0) completed++;
+        last_ip = ip;
+        last_port = port;
+        last_done = pit_get_ticks();
+        if (!duration_ms) break;
+    }
+    udp_close(sock);
+    return completed;
+}
@@ -0,0 +1,76 @@
+#ifndef TFTP_H
+#define TFTP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// =============================================================================
+// TFTP (RFC 1350) with the blksize, tsize and windowsize options
+// (RFC 2348, 2349, 7440). Client and server run on UDP sockets and block
+// the caller, polling the stack like every other blocking network call.
+// =============================================================================
+
+#define TFTP_PORT             69
+
+#define TFTP_OP_RRQ           1
+#define TFTP_OP_WRQ           2
+#define TFTP_OP_DATA          3
+#define TFTP_OP_ACK           4
+#define TFTP_OP_ERROR         5
+#define TFTP_OP_OACK          6
+
+#define TFTP_ERR_UNDEFINED    0
+#define TFTP_ERR_NOT_FOUND    1
+#define TFTP_ERR_ACCESS       2
+#define TFTP_ERR_DISK_FULL    3
+#define TFTP_ERR_ILLEGAL_OP   4
+#define TFTP_ERR_UNKNOWN_TID  5
+#define TFTP_ERR_EXISTS       6
+#define TFTP_ERR_OPTIONS      8
+
+#define TFTP_BLKSIZE_DEFAULT  512         // Without the blksize option
+#define TFTP_BLKSIZE_MAX      8192        // Largest block asked for or granted; IP fragments it
+#define TFTP_WINDOW_MAX       16          // Largest windowsize asked for or granted
+#define TFTP_TIMEOUT          1000        // Block or window resent after this (ms)
+#define TFTP_RETRIES          5           // Timeouts in a row before a transfer is abandoned
+
+typedef struct {
+    uint16_t blksize;            // Requested block size (0 = TFTP_BLKSIZE_MAX)
+    uint16_t windowsize;         // Requested window (0 = TFTP_WINDOW_MAX, 1 = lock-step)
+} tftp_options_t;
+
+typedef struct {
+    uint32_t bytes;
+    uint32_t blocks;
+    uint32_t tsize;              // Size announced by the peer (0 = unknown)
+    uint16_t blksize;            // Negotiated values
+    uint16_t windowsize;
+    uint32_t retransmits;        // Windows resent or ACKs repeated
+    uint32_t elapsed_ms;
+    char error[64];              // Reason for a failed transfer
+} tftp_result_t;
+
+// Receives the file in order; returns false to abort (e.g. disk full)
+typedef bool (*tftp_sink_t)(void *ctx, uint32_t offset, const uint8_t *data, uint16_t len);
+// Reads up to len bytes at offset; fewer marks the end of the file, -1 an error
+typedef int (*tftp_source_t)(void *ctx, uint32_t offset, uint8_t *buf, uint16_t len);
+
+// Client; all return the bytes transferred or -1 (reason in result->error)
+int tftp_get(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+             tftp_sink_t sink, void *ctx, tftp_result_t *result);
+int tftp_put(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+             tftp_source_t source, void *ctx, tftp_result_t *result);
+int tftp_get_to_memory(uint32_t server_ip, const char *filename, const tftp_options_t *opts,
+                       uint8_t *dst, uint32_t max, tftp_result_t *result);
+// Local paths are absolute VFS paths; an existing file is replaced
+int tftp_get_to_file(uint32_t server_ip, const char *filename, const char *path,
+                     const tftp_options_t *opts, tftp_result_t *result);
+int tftp_put_file(uint32_t server_ip, const char *path, const char *filename,
+                  const tftp_options_t *opts, tftp_result_t *result);
+
+// Server on port 69 for 'duration_ms' (0 = one transfer). Requested names are
+// looked up below 'root'; write requests are refused unless allow_write.
+// Returns the number of completed transfers, -1 if the port is taken.
+int tftp_serve(const char *root, bool allow_write, uint32_t duration_ms);
+
+#endif // TFTP_H
@@ -0,0 +1,274 @@
+// drivers/net/udp.c
+// UDP: sockets in a table hashed by local port, each with a bounded queue
+// of received datagrams filled from the RX path. Like TCP there is no
+// network thread: blocking receives spin on netstack_poll().
+
+#include "drivers/net/netstack.h"
+#include "include/kernel/panic.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+static udp_socket_t udp_sockets[UDP_MAX_SOCKETS];
+static int udp_hash[UDP_HASH_BUCKETS];
+static udp_stats_t udp_stats;
+static uint16_t udp_next_port = UDP_EPHEMERAL_BASE;
+
+// A queued datagram keeps its buffer positioned at the UDP header, whose
+// bytes are reused for the sender's address once the datagram is demuxed
+typedef struct {
+    uint32_t src_ip;
+    uint16_t src_port;
+    uint16_t length;             // Payload bytes following this header
+} udp_rx_meta_t;
+
+STATIC_ASSERT(sizeof(udp_rx_meta_t) == sizeof(udp_header_t));
+
+// =============================================================================
+// Socket table
+// =============================================================================
+static inline uint32_t udp_hash_key(uint16_t port) {
+    return (port ^ (port >> 8)) & (UDP_HASH_BUCKETS - 1);
+}
+
+static void udp_hash_insert(udp_socket_t *s) {
+    uint32_t b = udp_hash_key(s->local_port);
+    s->hash_next = udp_hash[b];
+    udp_hash[b] = (int)(s - udp_sockets);
+}
+
+static void udp_hash_remove(udp_socket_t *s) {
+    uint32_t b = udp_hash_key(s->local_port);
+    int idx = (int)(s - udp_sockets);
+    for (int *link = &udp_hash[b]; *link >= 0; link = &udp_sockets[*link].hash_next) {
+        if (*link == idx) {
+            *link = s->hash_next;
+            break;
+        }
+    }
+    s->hash_next = -1;
+}
+
+static udp_socket_t *udp_lookup(uint16_t port) {
+    int idx = udp_hash[udp_hash_key(port)];
+    while (idx >= 0) {
+        if (udp_sockets[idx].local_port == port) return &udp_sockets[idx];
+        idx = udp_sockets[idx].hash_next;
+    }
+    return NULL;
+}
+
+static udp_socket_t *udp_socket(int socket) {
+    if (socket < 0 || socket >= UDP_MAX_SOCKETS || !udp_sockets[socket].used) return NULL;
+    return &udp_sockets[socket];
+}
+
+static uint16_t udp_ephemeral_port(void) {
+    for (int tries = 0; tries < 16384; ++tries) {
+        uint16_t port = udp_next_port++;
+        if (udp_next_port == 0) udp_next_port = UDP_EPHEMERAL_BASE;
+        if (!udp_lookup(port)) return port;
+    }
+    return 0;
+}
+
+// =============================================================================
+// Datagram output
+// =============================================================================
+static int udp_output(netstack_route_t *route, uint32_t dst_ip, uint16_t src_port, uint16_t dst_port,
+                      const uint8_t *data, uint16_t len) {
+    // Datagrams above the MTU are fragmented by the IP layer
+    if (sizeof(udp_header_t) + len > IP_MAX_PAYLOAD) return -1;
+
+    pbuf_t *p = pbuf_alloc_len(PBUF_HEADROOM, sizeof(udp_header_t) + len);
+    if (!p) return -1;
+    udp_header_t *udp = (udp_header_t *)pbuf_put(p, (uint16_t)(sizeof(udp_header_t) + len));
+    udp->src_port = htons(src_port);
+    udp->dst_port = htons(dst_port);
+    udp->length   = htons((uint16_t)(sizeof(udp_header_t) + len));
+    udp->checksum = 0;
+    if (len) memcpy((uint8_t *)(udp + 1), data, len);
+    netstack_csum_request(p, udp, offsetof(udp_header_t, checksum));
+
+    int r = route ? netstack_ip_output_route(route, dst_ip, IP_PROTOCOL_UDP, p)
+                  : netstack_ip_output(dst_ip, IP_PROTOCOL_UDP, p);
+    if (r == 0) udp_stats.datagrams_out++;
+    return r;
+}
+
+// =============================================================================
+// Datagram input
+// =============================================================================
+void udp_input(uint32_t src_ip, uint32_t dst_ip, pbuf_t *p) {
+    if (p->len < sizeof(udp_header_t)) { pbuf_free(p); return; }
+    udp_header_t *udp = (udp_header_t *)p->data;
+    uint16_t total = ntohs(udp->length);
+    if (total < sizeof(udp_header_t) || total > p->len) { pbuf_free(p); return; }
+    pbuf_trim(p, total);
+
+    if (udp->checksum != 0 && !(p->flags & PBUF_F_CSUM_VALID) &&
+        ip_pseudo_checksum(src_ip, dst_ip, IP_PROTOCOL_UDP, udp, total) != 0) {
+        udp_stats.bad_checksum++;
+        pbuf_free(p);
+        return;
+    }
+    udp_stats.datagrams_in++;
+
+    uint16_t src_port = ntohs(udp->src_port);
+    uint16_t dst_port = ntohs(udp->dst_port);
+    uint16_t len = (uint16_t)(total - sizeof(udp_header_t));
+
+    udp_socket_t *s = udp_lookup(dst_port);
+    if (!s) {
+        // Echo (RFC 862) answers from the received buffer; discard (RFC 863) just counts
+        if (dst_port == UDP_PORT_ECHO) {
+            udp->src_port = htons(UDP_PORT_ECHO);
+            udp->dst_port = htons(src_port);
+            udp->checksum = 0;
+            netstack_csum_request(p, udp, offsetof(udp_header_t, checksum));
+            udp_stats.datagrams_out++;
+            netstack_ip_output(src_ip, IP_PROTOCOL_UDP, p);
+            return;
+        }
+        if (dst_port != UDP_PORT_DISCARD) udp_stats.no_port++;
+        pbuf_free(p);
+        return;
+    }
+
+    s->datagrams_in++;
+    if (s->callback) {
+        s->callback(src_ip, src_port, (uint8_t *)(udp + 1), len);
+        pbuf_free(p);
+        return;
+    }
+    if (s->rcv.count >= UDP_RCV_QUEUE_LEN) {
+        s->dropped++;
+        udp_stats.queue_drops++;
+        pbuf_free(p);
+        return;
+    }
+
+    udp_rx_meta_t *meta = (udp_rx_meta_t *)p->data;
+    meta->src_ip   = src_ip;
+    meta->src_port = src_port;
+    meta->length   = len;
+    pbuf_queue_push(&s->rcv, p);
+}
+
+// =============================================================================
+// Socket API
+// =============================================================================
+void udp_init(void) {
+    for (int i = 0; i < UDP_MAX_SOCKETS; ++i) {
+        if (udp_sockets[i].used) pbuf_queue_flush(&udp_sockets[i].rcv);
+    }
+    memset(udp_sockets, 0, sizeof(udp_sockets));
+    for (int i = 0; i < UDP_MAX_SOCKETS; ++i) udp_sockets[i].hash_next = -1;
+    for (int i = 0; i < UDP_HASH_BUCKETS; ++i) udp_hash[i] = -1;
+    memset(&udp_stats, 0, sizeof(udp_stats));
+}
+
+int udp_open(uint16_t port) {
+    if (port == 0) port = udp_ephemeral_port();
+    if (port == 0 || udp_lookup(port)) return -1;
+
+    for (int i = 0; i < UDP_MAX_SOCKETS; ++i) {
+        udp_socket_t *s = &udp_sockets[i];
+        if (s->used) continue;
+        memset(s, 0, sizeof(*s));
+        s->used = true;
+        s->local_port = port;
+        udp_hash_insert(s);
+        return i;
+    }
+    return -1;
+}
+
+void udp_close(int socket) {
+    udp_socket_t *s = udp_socket(socket);
+    if (!s) return;
+    udp_hash_remove(s);
+    pbuf_queue_flush(&s->rcv);
+    memset(s, 0, sizeof(*s));
+    s->hash_next = -1;
+}
+
+int udp_sendto(int socket, uint32_t dst_ip, uint16_t dst_port, const uint8_t *data, uint16_t length) {
+    udp_socket_t *s = udp_socket(socket);
+    if (!s || (length && !data)) return -1;
+    if (udp_output(&s->route, dst_ip, s->local_port, dst_port, data, length) != 0) return -1;
+    s->datagrams_out++;
+    return length;
+}
+
+int udp_recvfrom(int socket, void *buffer, size_t buflen, uint32_t *src_ip, uint16_t *src_port, uint32_t timeout_ms) {
+    udp_socket_t *s = udp_socket(socket);
+    if (!s || !buffer) return -1;
+
+    // Sleep until the next interrupt (NIC or PIT) whenever a poll found nothing
+    uint32_t start = pit_get_ticks();
+    while (s->rcv.count == 0) {
+        int frames = netstack_poll();
+        if (s->rcv.count) break;
+        if (timeout_ms != UDP_WAIT_FOREVER && pit_get_ticks() - start >= timeout_ms) return -1;
+        if (frames == 0) __asm__ __volatile__("hlt");
+    }
+
+    pbuf_t *p = pbuf_queue_pop(&s->rcv);
+    udp_rx_meta_t *meta = (udp_rx_meta_t *)p->data;
+    uint16_t n = meta->length < buflen ? meta->length : (uint16_t)buflen;
+    memcpy(buffer, (uint8_t *)(meta + 1), n);
+    if (src_ip)   *src_ip   = meta->src_ip;
+    if (src_port) *src_port = meta->src_port;
+    pbuf_free(p);
+    return n;
+}
+
+uint16_t udp_local_port(int socket) {
+    udp_socket_t *s = udp_socket(socket);
+    return s ? s->local_port : 0;
+}
+
+const udp_socket_t* udp_get_socket(int socket) {
+    return udp_socket(socket);
+}
+
+void udp_get_stats(udp_stats_t *stats) {
+    if (stats) *stats = udp_stats;
+}
+
+int udp_send(uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t *data, uint16_t length) {
+    return udp_output(NULL, dst_ip, src_port, dst_port, data, length);
+}
+
+int udp_receive(uint16_t port, void *buffer, size_t buflen, uint32_t *src_ip, uint16_t *src_port, uint32_t timeout_ms) {
+    udp_socket_t *s = udp_lookup(port);
+    if (s) return udp_recvfrom((int)(s - udp_sockets), buffer, buflen, src_ip, src_port, timeout_ms);
+
+    int socket = udp_open(port);
+    if (socket < 0) return -1;
+    int n = udp_recvfrom(socket, buffer, buflen, src_ip, src_port, timeout_ms);
+    udp_close(socket);
+    return n;
+}
+
+void udp_bind(uint16_t port, udp_callback_t callback) {
+    udp_socket_t *s = udp_lookup(port);
+    if (!callback) {
+        if (s && s->callback) udp_close((int)(s - udp_sockets));
+        return;
+    }
+    if (!s) {
+        int socket = udp_open(port);
+        if (socket < 0) {
+            printf("[UDP] bind %u failed\n", port);
+            return;
+        }
+        s = &udp_sockets[socket];
+    }
+    s->callback = callback;
+}
@@ -0,0 +1,476 @@
+// drivers/net/virtio_net.c
+// virtio-net over the legacy (transitional) PCI I/O interface.
+//
+// Each queue pairs its descriptors: slot i is descriptor 2i (virtio header)
+// chained to 2i+1 (the frame in a pbuf). RX slots are all posted at start and
+// reposted as frames are taken; TX slots come from a free list. The device
+// is only kicked from the flush op, once per batch, and not at all while it
+// sets VRING_USED_F_NO_NOTIFY. TX completions never interrupt; finished
+// slots are reclaimed on send and poll.
+
+#include "drivers/net/virtio_net.h"
+#include "drivers/net/netstack.h"
+#include "drivers/net/netdev.h"
+#include "drivers/net/pbuf.h"
+#include "drivers/bus/pci.h"
+#include "drivers/char/io.h"
+#include "arch/x86/include/sys.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
+
+// Legacy PCI register block (I/O BAR0)
+#define VIRTIO_PCI_HOST_FEATURES        0x00
+#define VIRTIO_PCI_GUEST_FEATURES       0x04
+#define VIRTIO_PCI_QUEUE_PFN            0x08
+#define VIRTIO_PCI_QUEUE_SIZE           0x0C
+#define VIRTIO_PCI_QUEUE_SEL            0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY         0x10
+#define VIRTIO_PCI_STATUS               0x12
+#define VIRTIO_PCI_ISR                  0x13        // Read clears
+#define VIRTIO_PCI_CONFIG               0x14        // Device config (no MSI-X)
+
+// Device status
+#define VIRTIO_STATUS_ACKNOWLEDGE       0x01
+#define VIRTIO_STATUS_DRIVER            0x02
+#define VIRTIO_STATUS_DRIVER_OK         0x04
+#define VIRTIO_STATUS_FAILED            0x80
+
+// ISR status
+#define VIRTIO_ISR_QUEUE                0x01
+#define VIRTIO_ISR_CONFIG               0x02
+
+// Feature bits
+#define VIRTIO_NET_F_CSUM               (1u << 0)   // Device completes partial TX checksums
+#define VIRTIO_NET_F_GUEST_CSUM         (1u << 1)   // RX frames may carry partial checksums
+#define VIRTIO_NET_F_MAC                (1u << 5)
+#define VIRTIO_NET_F_STATUS             (1u << 16)
+#define VIRTIO_NET_WANTED_FEATURES      (VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM | \
+                                         VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS)
+
+// Device config
+#define VIRTIO_NET_CONFIG_MAC           0x00
+#define VIRTIO_NET_CONFIG_STATUS        0x06
+#define VIRTIO_NET_S_LINK_UP            0x01
+
+// Header flags
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM     0x01
+#define VIRTIO_NET_HDR_F_DATA_VALID     0x02
+
+// Ring flags
+#define VRING_DESC_F_NEXT               0x01
+#define VRING_DESC_F_WRITE              0x02
+#define VRING_AVAIL_F_NO_INTERRUPT      0x01
+#define VRING_USED_F_NO_NOTIFY          0x01
+
+#define VIRTIO_NET_RXQ                  0
+#define VIRTIO_NET_TXQ                  1
+#define VIRTIO_NET_SLOTS                (VIRTIO_NET_QUEUE_MAX / 2)
+#define VIRTIO_NET_MAX_FRAME            1514
+
+// Legacy layout: descriptors and avail ring, then the used ring on the next page
+#define VRING_ALIGN(x)                  (((x) + 4095) & ~4095u)
+#define VRING_USED_OFFSET(n)            VRING_ALIGN(16 * (n) + 6 + 2 * (n))
+#define VRING_BYTES(n)                  (VRING_USED_OFFSET(n) + VRING_ALIGN(6 + 8 * (n)))
+
+typedef struct {
+    uint16_t index;
+    uint16_t size;                      // Descriptors, as offered by the device
+    volatile struct virtq_desc *desc;
+    volatile struct virtq_avail *avail;
+    volatile struct virtq_used *used;
+    uint16_t avail_idx;                 // Shadow of avail->idx
+    uint16_t kicked_idx;                // avail_idx at the last kick
+    uint16_t last_used;                 // Next used entry to look at
+    pbuf_t *pbufs[VIRTIO_NET_SLOTS];
+    virtio_net_hdr_t *hdrs;
+    virtio_net_queue_stats_t stats;
+} virtq_t;
+
+static uint8_t rx_ring_mem[VRING_BYTES(VIRTIO_NET_QUEUE_MAX)] __attribute__((aligned(4096)));
+static uint8_t tx_ring_mem[VRING_BYTES(VIRTIO_NET_QUEUE_MAX)] __attribute__((aligned(4096)));
+static virtio_net_hdr_t rx_hdrs[VIRTIO_NET_SLOTS] __attribute__((aligned(16)));
+static virtio_net_hdr_t tx_hdrs[VIRTIO_NET_SLOTS] __attribute__((aligned(16)));
+
+static virtq_t rxq;
+static virtq_t txq;
+static uint16_t tx_free_slots[VIRTIO_NET_SLOTS];
+static uint16_t tx_free_count = 0;
+
+static uint16_t io_base = 0;
+static uint8_t irq_line = 0;
+static uint32_t features = 0;
+static uint8_t mac_address[6];
+static bool initialized = false;
+static volatile bool rx_poll_scheduled = false;
+static netdev_t virtio_netdev;
+
+// Full barrier: avail->idx must be visible before used->flags is read
+static inline void virtio_mb(void) {
+    __asm__ volatile("lock; addl $0, 0(%%esp)" ::: "memory");
+}
+
+// Compiler barrier; x86 keeps stores in order and loads in order
+static inline void virtio_barrier(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+static bool virtq_setup(virtq_t *q, uint16_t index, uint8_t *mem, virtio_net_hdr_t *hdrs, bool device_writes) {
+    outw(io_base + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inw(io_base + VIRTIO_PCI_QUEUE_SIZE);
+    if (size == 0 || size > VIRTIO_NET_QUEUE_MAX || (size & 1)) {
+        printf("VIRTIO-NET: queue %u has unusable size %u (max %u)\n", index, size, VIRTIO_NET_QUEUE_MAX);
+        return false;
+    }
+
+    memset(mem, 0, VRING_BYTES(size));
+    memset(q, 0, sizeof(*q));
+    q->index = index;
+    q->size = size;
+    q->desc = (volatile struct virtq_desc *)mem;
+    q->avail = (volatile struct virtq_avail *)(mem + 16 * size);
+    q->used = (volatile struct virtq_used *)(mem + VRING_USED_OFFSET(size));
+    q->hdrs = hdrs;
+
+    // Header descriptors never change; frame descriptors get their buffer when posted
+    uint16_t write = device_writes ? VRING_DESC_F_WRITE : 0;
+    for (uint16_t slot = 0; slot < size / 2; slot++) {
+        q->desc[2 * slot].addr = (uint32_t)&hdrs[slot];
+        q->desc[2 * slot].len = sizeof(virtio_net_hdr_t);
+        q->desc[2 * slot].flags = VRING_DESC_F_NEXT | write;
+        q->desc[2 * slot].next = 2 * slot + 1;
+        q->desc[2 * slot + 1].flags = write;
+    }
+
+    outl(io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)mem >> 12);
+    return true;
+}
+
+// Make a slot available to the device (not kicked yet)
+static void virtq_post(virtq_t *q, uint16_t slot) {
+    q->avail->ring[q->avail_idx % q->size] = 2 * slot;
+    q->avail_idx++;
+    virtio_barrier();
+    q->avail->idx = q->avail_idx;
+}
+
+static void virtq_kick(virtq_t *q) {
+    if (q->kicked_idx == q->avail_idx) {
+        return;
+    }
+    q->kicked_idx = q->avail_idx;
+    virtio_mb();
+    if (q->used->flags & VRING_USED_F_NO_NOTIFY) {
+        q->stats.kicks_saved++;
+        return;
+    }
+    outw(io_base + VIRTIO_PCI_QUEUE_NOTIFY, q->index);
+    q->stats.kicks++;
+}
+
+// Entries (and the buffers behind them) are only read after used->idx
+static bool virtq_used_pending(virtq_t *q) {
+    bool pending = q->last_used != q->used->idx;
+    virtio_barrier();
+    return pending;
+}
+
+static void virtio_net_isr(void) {
+    uint8_t isr = inb(io_base + VIRTIO_PCI_ISR);
+    if (!isr) {
+        return;
+    }
+
+    // Top half only: stop RX notifications until the poll op drains the queue
+    if (isr & VIRTIO_ISR_QUEUE) {
+        rxq.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+        rx_poll_scheduled = true;
+        rxq.stats.interrupts++;
+    }
+    if ((isr & VIRTIO_ISR_CONFIG) && (features & VIRTIO_NET_F_STATUS)) {
+        uint16_t status = inw(io_base + VIRTIO_PCI_CONFIG + VIRTIO_NET_CONFIG_STATUS);
+        printf("VIRTIO-NET: Link is %s\n", (status & VIRTIO_NET_S_LINK_UP) ? "up" : "down");
+    }
+}
+
+// =============================================================================
+// TX
+// =============================================================================
+static void virtio_net_tx_reclaim(void) {
+    while (virtq_used_pending(&txq)) {
+        uint16_t slot = txq.used->ring[txq.last_used % txq.size].id / 2;
+        txq.last_used++;
+        if (slot < VIRTIO_NET_SLOTS && txq.pbufs[slot]) {
+            pbuf_free(txq.pbufs[slot]);
+            txq.pbufs[slot] = NULL;
+            tx_free_slots[tx_free_count++] = slot;
+        }
+    }
+}
+
+static bool virtio_net_xmit(netdev_t *dev, pbuf_t *p) {
+    (void)dev;
+    if (p->len < 14 || p->len > VIRTIO_NET_MAX_FRAME) {
+        txq.stats.dropped++;
+        pbuf_free(p);
+        return false;
+    }
+    if (tx_free_count == 0) {
+        virtio_net_tx_reclaim();
+    }
+    if (tx_free_count == 0) {
+        txq.stats.dropped++;
+        pbuf_free(p);
+        return false;
+    }
+
+    // A partial TCP/UDP checksum is left to the host; otherwise the header
+    // only says "plain frame"
+    uint16_t slot = tx_free_slots[--tx_free_count];
+    virtio_net_hdr_t *hdr = &txq.hdrs[slot];
+    memset(hdr, 0, sizeof(virtio_net_hdr_t));
+    if ((p->flags & PBUF_F_CSUM_PARTIAL) && (features & VIRTIO_NET_F_CSUM)) {
+        hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        hdr->csum_start = (uint16_t)(p->buffer + p->csum_start - p->data);
+        hdr->csum_offset = p->csum_offset;
+        txq.stats.csum_fixups++;
+    }
+    txq.desc[2 * slot + 1].addr = (uint32_t)p->data;
+    txq.desc[2 * slot + 1].len = p->len;
+    txq.pbufs[slot] = p;
+    virtq_post(&txq, slot);
+
+    txq.stats.packets++;
+    txq.stats.bytes += p->len;
+    return true;
+}
+
+static void virtio_net_flush(netdev_t *dev) {
+    (void)dev;
+    virtq_kick(&txq);
+}
+
+static bool virtio_net_tx_ready(netdev_t *dev) {
+    (void)dev;
+    if (tx_free_count == 0) {
+        virtio_net_tx_reclaim();
+    }
+    return tx_free_count > 0;
+}
+
+// =============================================================================
+// RX
+// =============================================================================
+static void virtio_net_rx_post(uint16_t slot, pbuf_t *p) {
+    rxq.pbufs[slot] = p;
+    rxq.desc[2 * slot + 1].addr = (uint32_t)p->buffer;
+    rxq.desc[2 * slot + 1].len = PBUF_BUF_SIZE;
+    virtq_post(&rxq, slot);
+}
+
+// The host may hand over frames whose L4 checksum holds only the pseudo
+// header sum (GUEST_CSUM). Finish it here so the stack sees a normal frame.
+static void virtio_net_rx_csum(const virtio_net_hdr_t *hdr, pbuf_t *p) {
+    uint32_t start = hdr->csum_start;
+    uint32_t field = start + hdr->csum_offset;
+    if (field + 2 > p->len) {
+        return;
+    }
+    uint16_t sum = ip_checksum(p->data + start, (uint16_t)(p->len - start));
+    p->data[field] = (uint8_t)(sum >> 8);
+    p->data[field + 1] = (uint8_t)sum;
+    p->flags |= PBUF_F_CSUM_VALID;
+    rxq.stats.csum_fixups++;
+}
+
+static int virtio_net_poll(netdev_t *dev, int budget) {
+    int done = 0;
+
+    virtio_net_tx_reclaim();
+    while (done < budget && virtq_used_pending(&rxq)) {
+        volatile struct virtq_used_elem *e = &rxq.used->ring[rxq.last_used % rxq.size];
+        uint16_t slot = e->id / 2;
+        uint32_t len = e->len;
+        rxq.last_used++;
+
+        pbuf_t *p = rxq.pbufs[slot];
+        pbuf_t *fresh = NULL;
+        if (len > sizeof(virtio_net_hdr_t) && len - sizeof(virtio_net_hdr_t) <= PBUF_BUF_SIZE) {
+            fresh = pbuf_alloc(0);
+        }
+        if (!fresh) {
+            // Bad length or pool empty: drop the frame and reuse its buffer
+            rxq.stats.dropped++;
+            virtio_net_rx_post(slot, p);
+            continue;
+        }
+        virtio_net_rx_post(slot, fresh);
+
+        p->len = (uint16_t)(len - sizeof(virtio_net_hdr_t));
+        if (rxq.hdrs[slot].flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+            virtio_net_rx_csum(&rxq.hdrs[slot], p);
+        } else if (rxq.hdrs[slot].flags & VIRTIO_NET_HDR_F_DATA_VALID) {
+            p->flags |= PBUF_F_CSUM_VALID;
+        }
+        rxq.stats.packets++;
+        rxq.stats.bytes += p->len;
+        netdev_rx(dev, p);
+        done++;
+    }
+    // One notification for everything reposted in this round
+    virtq_kick(&rxq);
+
+    // Queue drained: back to interrupt mode. A frame that arrived before the
+    // flag cleared raised no interrupt, so look once more.
+    if (done < budget && rx_poll_scheduled) {
+        rx_poll_scheduled = false;
+        rxq.avail->flags = 0;
+        virtio_mb();
+        if (virtq_used_pending(&rxq)) {
+            rxq.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+            rx_poll_scheduled = true;
+        }
+    }
+    return done;
+}
+
+// =============================================================================
+// netdev glue
+// =============================================================================
+static void virtio_net_netdev_get_mac(netdev_t *dev, uint8_t *mac) {
+    (void)dev;
+    virtio_net_get_mac_address(mac);
+}
+
+static void virtio_net_netdev_get_stats(netdev_t *dev, netdev_stats_t *stats) {
+    *stats = dev->stats;
+    stats->rx_dropped = rxq.stats.dropped;
+    stats->tx_dropped = txq.stats.dropped;
+}
+
+static const netdev_ops_t virtio_net_ops = {
+    .xmit = virtio_net_xmit,
+    .flush = virtio_net_flush,
+    .poll = virtio_net_poll,
+    .tx_ready = virtio_net_tx_ready,
+    .get_mac = virtio_net_netdev_get_mac,
+    .get_stats = virtio_net_netdev_get_stats,
+};
+
+// =============================================================================
+// Setup
+// =============================================================================
+static void virtio_net_fail(const char *reason) {
+    printf("VIRTIO-NET: %s\n", reason);
+    outb(io_base + VIRTIO_PCI_STATUS, inb(io_base + VIRTIO_PCI_STATUS) | VIRTIO_STATUS_FAILED);
+}
+
+static int virtio_net_init(void) {
+    // Reset, then announce ourselves
+    outb(io_base + VIRTIO_PCI_STATUS, 0);
+    outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    uint32_t offered = inl(io_base + VIRTIO_PCI_HOST_FEATURES);
+    features = offered & VIRTIO_NET_WANTED_FEATURES;
+    outl(io_base + VIRTIO_PCI_GUEST_FEATURES, features);
+    printf("VIRTIO-NET: features offered 0x%08X, using 0x%08X\n", offered, features);
+
+    if (features & VIRTIO_NET_F_MAC) {
+        for (int i = 0; i < 6; i++) {
+            mac_address[i] = inb(io_base + VIRTIO_PCI_CONFIG + VIRTIO_NET_CONFIG_MAC + i);
+        }
+    } else {
+        static const uint8_t fallback[6] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x57};
+        memcpy(mac_address, fallback, 6);
+    }
+
+    if (!virtq_setup(&rxq, VIRTIO_NET_RXQ, rx_ring_mem, rx_hdrs, true) ||
+        !virtq_setup(&txq, VIRTIO_NET_TXQ, tx_ring_mem, tx_hdrs, false)) {
+        virtio_net_fail("queue setup failed");
+        return -1;
+    }
+
+    // Post every RX slot up front
+    for (uint16_t slot = 0; slot < rxq.size / 2; slot++) {
+        pbuf_t *p = pbuf_alloc(0);
+        if (!p) {
+            virtio_net_fail("out of packet buffers for RX");
+            return -1;
+        }
+        virtio_net_rx_post(slot, p);
+    }
+    tx_free_count = 0;
+    for (uint16_t slot = txq.size / 2; slot > 0; slot--) {
+        tx_free_slots[tx_free_count++] = slot - 1;
+    }
+    // TX completions are collected by polling
+    txq.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+    rx_poll_scheduled = false;
+
+    register_interrupt_handler(irq_line, virtio_net_isr);
+    outb(io_base + VIRTIO_PCI_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    virtq_kick(&rxq);
+
+    printf("VIRTIO-NET: RX %u slots, TX %u slots\n", rxq.size / 2, txq.size / 2);
+    return 0;
+}
+
+int virtio_net_probe(pci_device_t *pci_dev) {
+    if (pci_dev->vendor_id != VIRTIO_VENDOR_ID || pci_dev->device_id != VIRTIO_NET_DEVICE_ID) {
+        return -1;
+    }
+    if (!(pci_dev->bar[0] & 0x01)) {
+        printf("VIRTIO-NET: BAR0 is not an I/O BAR (modern-only device?)\n");
+        return -1;
+    }
+
+    pci_enable_device(pci_dev);
+    pci_set_bus_master(pci_dev->bus, pci_dev->slot, 1);
+    io_base = (uint16_t)(pci_dev->bar[0] & ~0x3);
+    irq_line = pci_configure_irq(pci_dev);
+
+    if (virtio_net_init() != 0) {
+        return -1;
+    }
+    initialized = true;
+
+    char mac_s[18];
+    format_mac(mac_address, mac_s);
+    printf("VIRTIO-NET: MAC %s, IO Base 0x%04X, IRQ %u\n", mac_s, io_base, irq_line);
+
+    virtio_netdev.ops = &virtio_net_ops;
+    virtio_netdev.speed = 10000;
+    if (features & VIRTIO_NET_F_CSUM) {
+        virtio_netdev.features |= NETDEV_F_TX_CSUM;
+    }
+    if (features & VIRTIO_NET_F_GUEST_CSUM) {
+        virtio_netdev.features |= NETDEV_F_RX_CSUM;
+    }
+    netdev_register(&virtio_netdev);
+    return 0;
+}
+
+void virtio_net_detect(void) {
+    pci_register_driver(VIRTIO_VENDOR_ID, VIRTIO_NET_DEVICE_ID, virtio_net_probe);
+}
+
+bool virtio_net_is_initialized(void) {
+    return initialized;
+}
+
+void virtio_net_get_mac_address(uint8_t *mac) {
+    memcpy(mac, mac_address, 6);
+}
+
+uint32_t virtio_net_get_features(void) {
+    return features;
+}
+
+void virtio_net_get_rx_stats(virtio_net_queue_stats_t *stats) {
+    *stats = rxq.stats;
+}
+
+void virtio_net_get_tx_stats(virtio_net_queue_stats_t *stats) {
+    *stats = txq.stats;
+}
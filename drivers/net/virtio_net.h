@@ -0,0 +1,71 @@
+#ifndef VIRTIO_NET_H
+#define VIRTIO_NET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define VIRTIO_VENDOR_ID                0x1AF4
+#define VIRTIO_NET_DEVICE_ID            0x1000      // Transitional device (legacy I/O interface)
+
+// Largest queue the static vring memory is sized for. QEMU offers 256 for
+// both queues unless rx_queue_size/tx_queue_size say otherwise.
+#ifndef VIRTIO_NET_QUEUE_MAX
+#define VIRTIO_NET_QUEUE_MAX            256
+#endif
+
+// Split virtqueue layout (virtio 1.0, section 2.6)
+struct virtq_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+struct virtq_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed));
+
+struct virtq_used_elem {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed));
+
+struct virtq_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct virtq_used_elem ring[];
+} __attribute__((packed));
+
+// Header in front of every frame (no mergeable RX buffers negotiated)
+typedef struct {
+    uint8_t  flags;
+    uint8_t  gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+} __attribute__((packed)) virtio_net_hdr_t;
+
+// Counters for one virtqueue
+typedef struct {
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t dropped;       // RX: bad length or pool exhaustion; TX: queue full
+    uint32_t interrupts;
+    uint32_t kicks;         // Notify register writes
+    uint32_t kicks_saved;   // Kicks skipped because the device asked for none
+    uint32_t csum_fixups;   // RX: partial checksums completed in software
+                            // TX: partial checksums left to the host
+} virtio_net_queue_stats_t;
+
+void virtio_net_detect(void);
+bool virtio_net_is_initialized(void);
+void virtio_net_get_mac_address(uint8_t *mac);
+uint32_t virtio_net_get_features(void);     // Negotiated feature bits
+void virtio_net_get_rx_stats(virtio_net_queue_stats_t *stats);
+void virtio_net_get_tx_stats(virtio_net_queue_stats_t *stats);
+
+#endif // VIRTIO_NET_H
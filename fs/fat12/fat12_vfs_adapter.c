@@ -49,6 +49,7 @@ static int fat12_vfs_mount(vfs_filesystem_t* fs, drive_t* drive) {
     root->fs_specific = NULL;
     
     fs->root = root;
+    fs->flags |= VFS_FS_NOCACHE;    // Reads always start at offset 0 (see fat12_vfs_read)
     
     printf("FAT12: Successfully mounted\n");
     return VFS_OK;
@@ -1,4 +1,5 @@
 #include "fat32.h"
+#include "fs/vfs/vfs.h"
 #include "lib/libc/stdio.h"
 
 // Function to read a file's data into a buffer
@@ -102,56 +103,162 @@ unsigned int read_file_data(unsigned int start_cluster, char* buffer, unsigned i
     return total_bytes_read;
 }
 
-int read_file_data_to_address(unsigned int start_cluster, void* load_address, unsigned int file_size) {
-    // Safety checks
-    if (file_size == 0) {
-        return 0; // Empty file
+// Destination cursor over an I/O vector
+typedef struct {
+    const vfs_iovec_t* iov;
+    unsigned int iovcnt;
+    unsigned int index;         // Current segment
+    unsigned int pos;           // Bytes consumed in the current segment
+} iov_cursor_t;
+
+// Bytes left in the current segment (skipping exhausted/empty segments)
+static unsigned int iov_room(iov_cursor_t* cursor) {
+    while (cursor->index < cursor->iovcnt && cursor->pos >= cursor->iov[cursor->index].len) {
+        cursor->index++;
+        cursor->pos = 0;
     }
-    
-    if (boot_sector.sectors_per_cluster == 0) {
-        printf("Error: sectors_per_cluster is zero\n");
+    return (cursor->index < cursor->iovcnt) ? cursor->iov[cursor->index].len - cursor->pos : 0;
+}
+
+static uint8_t* iov_ptr(iov_cursor_t* cursor) {
+    return (uint8_t*)cursor->iov[cursor->index].base + cursor->pos;
+}
+
+// Scatter 'len' bytes across the remaining segments
+static void iov_copy_in(iov_cursor_t* cursor, const uint8_t* src, unsigned int len) {
+    while (len > 0) {
+        unsigned int room = iov_room(cursor);
+        if (room == 0) {
+            return;
+        }
+        unsigned int chunk = (len < room) ? len : room;
+        memcpy(iov_ptr(cursor), src, chunk);
+        cursor->pos += chunk;
+        src += chunk;
+        len -= chunk;
+    }
+}
+
+// Read 'bytes_to_read' bytes starting at byte 'offset' of the cluster chain
+// into an I/O vector. Physically consecutive clusters are merged into runs and
+// every sector-aligned stretch of a run that fits the current segment goes to
+// the drive as a single multi-sector command; only partial sectors at the edges
+// of the request or of a segment are bounced through a sector buffer.
+unsigned int read_file_data_v(unsigned int start_cluster, unsigned int offset, const vfs_iovec_t* iov, unsigned int iovcnt, unsigned int bytes_to_read) {
+    extern drive_t* current_drive;
+    extern bool is_valid_cluster(struct fat32_boot_sector* bs, unsigned int cluster);
+
+    if (iov == NULL || iovcnt == 0 || bytes_to_read == 0 || boot_sector.sectors_per_cluster == 0) {
         return 0;
     }
-    
+
+    unsigned int cluster_size = SECTOR_SIZE * boot_sector.sectors_per_cluster;
     unsigned int current_cluster = start_cluster;
-    unsigned int bytes_read = 0;
-    unsigned char* buffer_ptr = (unsigned char*)load_address;
-    
-    while (bytes_read < file_size) {
-        // Validate cluster before using it
-        extern bool is_valid_cluster(struct fat32_boot_sector* bs, unsigned int cluster);
+
+    // Skip whole clusters in front of the requested offset
+    for (unsigned int skip = offset / cluster_size; skip > 0; skip--) {
+        current_cluster = get_next_cluster_in_chain(&boot_sector, current_cluster);
+        if (is_end_of_cluster_chain(current_cluster) || current_cluster == INVALID_CLUSTER) {
+            return 0;
+        }
+    }
+
+    iov_cursor_t cursor = { iov, iovcnt, 0, 0 };
+    unsigned int skip = offset % cluster_size;
+    unsigned int total_bytes_read = 0;
+
+    while (total_bytes_read < bytes_to_read) {
         if (!is_valid_cluster(&boot_sector, current_cluster)) {
             printf("Error: Invalid cluster %u during file read\n", current_cluster);
             break;
         }
-        
-        unsigned int sector_number = cluster_to_sector(&boot_sector, current_cluster);
-        
-        // Read each sector in the current cluster
-        for (unsigned int i = 0; i < boot_sector.sectors_per_cluster; i++) {
-            if (!ata_read_sector(current_drive->base, sector_number + i, buffer_ptr, current_drive->is_master)) {
-                printf("Error: Failed to read sector %u\n", sector_number + i);
-                return bytes_read;
+
+        // Extend the run while the chain stays physically contiguous
+        unsigned int last_cluster = current_cluster;
+        unsigned int run_clusters = 1;
+        unsigned int next_cluster = INVALID_CLUSTER;
+        while (run_clusters * cluster_size < skip + (bytes_to_read - total_bytes_read)) {
+            next_cluster = get_next_cluster_in_chain(&boot_sector, last_cluster);
+            if (next_cluster != last_cluster + 1 || !is_valid_cluster(&boot_sector, next_cluster)) {
+                break;
+            }
+            last_cluster = next_cluster;
+            run_clusters++;
+            next_cluster = INVALID_CLUSTER;
+        }
+
+        unsigned int lba = cluster_to_sector(&boot_sector, current_cluster) + skip / SECTOR_SIZE;
+        unsigned int sectors_left = run_clusters * boot_sector.sectors_per_cluster - skip / SECTOR_SIZE;
+        unsigned int sector_offset = skip % SECTOR_SIZE;
+
+        while (sectors_left > 0 && total_bytes_read < bytes_to_read) {
+            unsigned int want = bytes_to_read - total_bytes_read;
+            unsigned int room = iov_room(&cursor);
+            if (room == 0) {
+                return total_bytes_read;
             }
-            
-            buffer_ptr += SECTOR_SIZE;
-            bytes_read += SECTOR_SIZE;
 
-            if (bytes_read >= file_size) {
-                break; // Stop if we have read the entire file
+            if (sector_offset == 0 && want >= SECTOR_SIZE && room >= SECTOR_SIZE) {
+                unsigned int count = ((want < room) ? want : room) / SECTOR_SIZE;
+                if (count > sectors_left) {
+                    count = sectors_left;
+                }
+                if (!ata_read_sectors(current_drive->base, lba, count, iov_ptr(&cursor), current_drive->is_master)) {
+                    printf("Error: Failed to read sectors %u-%u\n", lba, lba + count - 1);
+                    return total_bytes_read;
+                }
+                cursor.pos += count * SECTOR_SIZE;
+                total_bytes_read += count * SECTOR_SIZE;
+                lba += count;
+                sectors_left -= count;
+            } else {
+                uint8_t sector_buffer[SECTOR_SIZE];
+                if (!ata_read_sector(current_drive->base, lba, sector_buffer, current_drive->is_master)) {
+                    printf("Error: Failed to read sector %u\n", lba);
+                    return total_bytes_read;
+                }
+                unsigned int chunk = SECTOR_SIZE - sector_offset;
+                if (chunk > want) {
+                    chunk = want;
+                }
+                iov_copy_in(&cursor, sector_buffer + sector_offset, chunk);
+                total_bytes_read += chunk;
+                lba++;
+                sectors_left--;
+                sector_offset = 0;
             }
         }
-        
-        // Get the next cluster in the chain
-        current_cluster = get_next_cluster_in_chain(&boot_sector, current_cluster);
-        
-        // Check if we have reached the end of the file
-        if (is_end_of_cluster_chain(current_cluster)) {
+
+        skip = 0;
+        if (total_bytes_read >= bytes_to_read || next_cluster == INVALID_CLUSTER ||
+            is_end_of_cluster_chain(next_cluster)) {
             break;
         }
+        current_cluster = next_cluster;
+    }
+
+    return total_bytes_read;
+}
+
+// Read 'bytes_to_read' bytes starting at byte 'offset' of the cluster chain
+unsigned int read_file_data_at(unsigned int start_cluster, unsigned int offset, char* buffer, unsigned int bytes_to_read) {
+    vfs_iovec_t iov = { buffer, bytes_to_read };
+    return read_file_data_v(start_cluster, offset, &iov, 1, bytes_to_read);
+}
+
+int read_file_data_to_address(unsigned int start_cluster, void* load_address, unsigned int file_size) {
+    // Safety checks
+    if (file_size == 0) {
+        return 0; // Empty file
+    }
+    
+    if (boot_sector.sectors_per_cluster == 0) {
+        printf("Error: sectors_per_cluster is zero\n");
+        return 0;
     }
     
-    return bytes_read;
+    // Whole contiguous cluster runs go to the drive as multi-sector reads
+    return (int)read_file_data_at(start_cluster, 0, (char*)load_address, file_size);
 }
 
 int fat32_load_file(const char* filename, void* load_address) {
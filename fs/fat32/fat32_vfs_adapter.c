@@ -15,7 +15,7 @@ extern int fat32_init_fs(unsigned short base, bool is_master);
 extern struct fat32_boot_sector boot_sector;
 extern unsigned int current_directory_cluster;
 extern struct fat32_dir_entry* find_file_in_directory(const char* filename);
-extern unsigned int read_file_data(unsigned int start_cluster, char* buffer, unsigned int buffer_size, unsigned int bytes_to_read);
+extern unsigned int read_file_data_v(unsigned int start_cluster, unsigned int offset, const vfs_iovec_t* iov, unsigned int iovcnt, unsigned int bytes_to_read);
 extern bool fat32_read_dir(const char* path);
 
 // ===========================================================================
@@ -206,8 +206,8 @@ static int fat32_vfs_close(vfs_node_t* node) {
     return VFS_OK;
 }
 
-static int fat32_vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
-    if (!node || !buffer) {
+static int fat32_vfs_readv(vfs_node_t* node, uint32_t offset, const vfs_iovec_t* iov, uint32_t iovcnt) {
+    if (!node || !iov) {
         return VFS_ERR_INVALID;
     }
     
@@ -218,17 +218,30 @@ static int fat32_vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint
     extern drive_t* current_drive;
     current_drive = node->fs->drive;  // Set current drive
     
-    // For now, only support reading from start (offset must be 0)
-    if (offset != 0) {
-        printf("FAT32: Warning - offset %u not supported, reading from start\n", offset);
+    if (offset >= node->size) {
+        return 0;
+    }
+    
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        size += iov[i].len;
     }
     
-    uint32_t bytes_to_read = (size < node->size) ? size : node->size;
-    unsigned int bytes_read = read_file_data(node->inode, (char*)buffer, size, bytes_to_read);
+    uint32_t bytes_to_read = (size < node->size - offset) ? size : node->size - offset;
+    unsigned int bytes_read = read_file_data_v(node->inode, offset, iov, iovcnt, bytes_to_read);
     
     return bytes_read;
 }
 
+static int fat32_vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (!buffer) {
+        return VFS_ERR_INVALID;
+    }
+    
+    vfs_iovec_t iov = { buffer, size };
+    return fat32_vfs_readv(node, offset, &iov, 1);
+}
+
 static int fat32_vfs_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer) {
     // Write not implemented yet
     return VFS_ERR_UNSUPPORTED;
@@ -353,7 +366,8 @@ vfs_filesystem_ops_t fat32_vfs_ops = {
     .rmdir = fat32_vfs_rmdir,
     .create = fat32_vfs_create,
     .delete = fat32_vfs_delete,
-    .stat = fat32_vfs_stat
+    .stat = fat32_vfs_stat,
+    .readv = fat32_vfs_readv
 };
 
 // ===========================================================================
@@ -0,0 +1,830 @@
+#include "tmpfs.h"
+#include "fs/vfs/vfs.h"
+#include "fs/vfs/page_cache.h"
+#include "arch/x86/mm/paging.h"
+#include "kernel/time/pit.h"
+#include "lib/libc/stdio.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdlib.h"
+
+// ===========================================================================
+// TMPFS - RAM-backed filesystem
+// Directory entries live in a per-instance hash table keyed by
+// (parent inode, name). File data is stored in page-granular extents taken
+// from the page frame allocator, so no block device is involved.
+// ===========================================================================
+
+// Pseudo drive so tmpfs can be mounted through vfs_mount()
+static drive_t tmpfs_drive = {
+    .type = DRIVE_TYPE_NONE,
+    .name = "tmpfs",
+    .model = "RAM filesystem",
+};
+
+// ===========================================================================
+// Helper Functions
+// ===========================================================================
+
+static uint32_t tmpfs_hash(uint32_t parent_ino, const char* name) {
+    // FNV-1a over the parent inode number and the entry name
+    uint32_t hash = 2166136261u ^ parent_ino;
+    hash *= 16777619u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static tmpfs_inode_t* tmpfs_alloc_inode(tmpfs_sb_t* sb, vfs_node_type_t type) {
+    tmpfs_inode_t* inode = (tmpfs_inode_t*)malloc(sizeof(tmpfs_inode_t));
+    if (!inode) {
+        return NULL;
+    }
+
+    memset(inode, 0, sizeof(tmpfs_inode_t));
+    inode->ino = sb->next_ino++;
+    inode->type = type;
+
+    uint32_t now = pit_get_ticks();
+    inode->create_time = now;
+    inode->modify_time = now;
+    inode->access_time = now;
+
+    sb->inode_count++;
+    return inode;
+}
+
+static void tmpfs_free_inode(tmpfs_sb_t* sb, tmpfs_inode_t* inode) {
+    for (uint32_t i = 0; i < inode->extent_count; i++) {
+        free_pages(inode->extents[i].base, inode->extents[i].pages);
+    }
+    sb->used_pages -= inode->page_count;
+    sb->inode_count--;
+
+    if (inode->extents) {
+        free(inode->extents);
+    }
+    free(inode);
+}
+
+// Free an unlinked inode now, or on last close if it is still open
+static void tmpfs_release_inode(tmpfs_sb_t* sb, tmpfs_inode_t* inode) {
+    if (inode->open_count > 0) {
+        inode->unlinked = true;
+        return;
+    }
+    tmpfs_free_inode(sb, inode);
+}
+
+static tmpfs_dirent_t* tmpfs_lookup(tmpfs_sb_t* sb, tmpfs_inode_t* dir, const char* name) {
+    uint32_t hash = tmpfs_hash(dir->ino, name);
+    tmpfs_dirent_t* de = sb->buckets[hash % TMPFS_HASH_BUCKETS];
+
+    while (de) {
+        if (de->hash == hash && de->parent == dir && strcmp(de->name, name) == 0) {
+            return de;
+        }
+        de = de->hash_next;
+    }
+    return NULL;
+}
+
+static int tmpfs_link(tmpfs_sb_t* sb, tmpfs_inode_t* dir, const char* name, tmpfs_inode_t* inode) {
+    tmpfs_dirent_t* de = (tmpfs_dirent_t*)malloc(sizeof(tmpfs_dirent_t));
+    if (!de) {
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    strncpy(de->name, name, TMPFS_NAME_MAX - 1);
+    de->name[TMPFS_NAME_MAX - 1] = '\0';
+    de->hash = tmpfs_hash(dir->ino, de->name);
+    de->parent = dir;
+    de->inode = inode;
+    de->sibling = NULL;
+
+    // Insert into hash bucket
+    uint32_t bucket = de->hash % TMPFS_HASH_BUCKETS;
+    de->hash_next = sb->buckets[bucket];
+    sb->buckets[bucket] = de;
+
+    // Append to the directory's child list
+    if (dir->last_child) {
+        dir->last_child->sibling = de;
+    } else {
+        dir->first_child = de;
+    }
+    dir->last_child = de;
+    dir->child_count++;
+    dir->modify_time = pit_get_ticks();
+
+    return VFS_OK;
+}
+
+static void tmpfs_unlink(tmpfs_sb_t* sb, tmpfs_dirent_t* de) {
+    tmpfs_inode_t* dir = de->parent;
+
+    // Remove from hash bucket
+    tmpfs_dirent_t** link = &sb->buckets[de->hash % TMPFS_HASH_BUCKETS];
+    while (*link && *link != de) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = de->hash_next;
+    }
+
+    // Remove from the directory's child list
+    tmpfs_dirent_t* prev = NULL;
+    tmpfs_dirent_t* cur = dir->first_child;
+    while (cur && cur != de) {
+        prev = cur;
+        cur = cur->sibling;
+    }
+    if (cur) {
+        if (prev) {
+            prev->sibling = de->sibling;
+        } else {
+            dir->first_child = de->sibling;
+        }
+        if (dir->last_child == de) {
+            dir->last_child = prev;
+        }
+        dir->child_count--;
+    }
+    dir->modify_time = pit_get_ticks();
+
+    free(de);
+}
+
+/**
+ * Walk 'path' down to the directory holding its final component.
+ * On success *parent is that directory and 'name' holds the final
+ * component; for the root path *parent is NULL and 'name' is empty.
+ */
+static int tmpfs_walk(tmpfs_sb_t* sb, const char* path, tmpfs_inode_t** parent, char* name) {
+    tmpfs_inode_t* dir = sb->root;
+    const char* p = path;
+
+    name[0] = '\0';
+    while (*p == '/') {
+        p++;
+    }
+
+    while (*p) {
+        uint32_t len = 0;
+        while (p[len] && p[len] != '/') {
+            len++;
+        }
+        if (len >= TMPFS_NAME_MAX) {
+            return VFS_ERR_INVALID;
+        }
+
+        const char* next = p + len;
+        while (*next == '/') {
+            next++;
+        }
+
+        char component[TMPFS_NAME_MAX];
+        memcpy(component, p, len);
+        component[len] = '\0';
+
+        if (*next == '\0') {
+            strcpy(name, component);
+            *parent = dir;
+            return VFS_OK;
+        }
+
+        tmpfs_dirent_t* de = tmpfs_lookup(sb, dir, component);
+        if (!de) {
+            return VFS_ERR_NOT_FOUND;
+        }
+        if (de->inode->type != VFS_DIRECTORY) {
+            return VFS_ERR_NOT_DIR;
+        }
+        dir = de->inode;
+        p = next;
+    }
+
+    *parent = NULL;
+    return VFS_OK;
+}
+
+static int tmpfs_resolve(tmpfs_sb_t* sb, const char* path, tmpfs_inode_t** inode) {
+    tmpfs_inode_t* parent;
+    char name[TMPFS_NAME_MAX];
+
+    int result = tmpfs_walk(sb, path, &parent, name);
+    if (result != VFS_OK) {
+        return result;
+    }
+
+    if (!parent) {
+        *inode = sb->root;
+        return VFS_OK;
+    }
+
+    tmpfs_dirent_t* de = tmpfs_lookup(sb, parent, name);
+    if (!de) {
+        return VFS_ERR_NOT_FOUND;
+    }
+
+    *inode = de->inode;
+    return VFS_OK;
+}
+
+// Map a file page index to its backing memory
+static uint8_t* tmpfs_page_at(tmpfs_inode_t* inode, uint32_t page_index) {
+    for (uint32_t i = 0; i < inode->extent_count; i++) {
+        tmpfs_extent_t* ext = &inode->extents[i];
+        if (page_index < ext->pages) {
+            return ext->base + page_index * TMPFS_PAGE_SIZE;
+        }
+        page_index -= ext->pages;
+    }
+    return NULL;
+}
+
+// Make sure the inode has backing pages for 'size' bytes
+static int tmpfs_reserve(tmpfs_sb_t* sb, tmpfs_inode_t* inode, uint32_t size) {
+    uint32_t needed = (size + TMPFS_PAGE_SIZE - 1) / TMPFS_PAGE_SIZE;
+    if (needed <= inode->page_count) {
+        return VFS_OK;
+    }
+
+    uint32_t limit_pages = sb->size_limit / TMPFS_PAGE_SIZE;
+    if (sb->used_pages + (needed - inode->page_count) > limit_pages) {
+        return VFS_ERR_NO_SPACE;
+    }
+
+    while (inode->page_count < needed) {
+        uint32_t want = needed - inode->page_count;
+        if (want > TMPFS_MAX_EXTENT_PAGES) {
+            want = TMPFS_MAX_EXTENT_PAGES;
+        }
+
+        // Reclaim page cache pages first, then fall back to smaller runs
+        // when the pool is fragmented
+        uint8_t* run = NULL;
+        while (want > 0 && !(run = (uint8_t*)allocate_pages(want))) {
+            if (page_cache_shrink(want) == 0) {
+                want /= 2;
+            }
+        }
+        if (!run) {
+            return VFS_ERR_NO_MEMORY;
+        }
+        memset(run, 0, want * TMPFS_PAGE_SIZE);
+
+        // Extend the last extent if the new run is physically adjacent
+        tmpfs_extent_t* last = inode->extent_count ? &inode->extents[inode->extent_count - 1] : NULL;
+        if (last && last->base + last->pages * TMPFS_PAGE_SIZE == run) {
+            last->pages += want;
+        } else {
+            if (inode->extent_count == inode->extent_capacity) {
+                uint32_t capacity = inode->extent_capacity ? inode->extent_capacity * 2 : 4;
+                tmpfs_extent_t* extents = (tmpfs_extent_t*)realloc(inode->extents, capacity * sizeof(tmpfs_extent_t));
+                if (!extents) {
+                    free_pages(run, want);
+                    return VFS_ERR_NO_MEMORY;
+                }
+                inode->extents = extents;
+                inode->extent_capacity = capacity;
+            }
+            inode->extents[inode->extent_count].base = run;
+            inode->extents[inode->extent_count].pages = want;
+            inode->extent_count++;
+        }
+
+        inode->page_count += want;
+        sb->used_pages += want;
+    }
+
+    return VFS_OK;
+}
+
+static vfs_node_t* tmpfs_make_node(vfs_filesystem_t* fs, tmpfs_inode_t* inode, const char* name) {
+    vfs_node_t* node = (vfs_node_t*)malloc(sizeof(vfs_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(vfs_node_t));
+    strncpy(node->name, name, 255);
+    node->name[255] = '\0';
+    node->type = inode->type;
+    node->inode = inode->ino;
+    node->size = inode->size;
+    node->fs = fs;
+    node->fs_specific = inode;
+
+    inode->open_count++;
+    ((tmpfs_sb_t*)fs->fs_data)->open_nodes++;
+    return node;
+}
+
+static void tmpfs_fill_entry(const char* name, tmpfs_inode_t* inode, vfs_dir_entry_t* entry) {
+    strncpy(entry->name, name, 255);
+    entry->name[255] = '\0';
+    entry->type = inode->type;
+    entry->size = inode->size;
+    entry->inode = inode->ino;
+    entry->create_time = inode->create_time;
+    entry->modify_time = inode->modify_time;
+    entry->access_time = inode->access_time;
+    entry->attributes = (inode->type == VFS_DIRECTORY) ? 0x10 : 0;
+}
+
+// Create a file or directory at 'path'
+static int tmpfs_make_entry(vfs_filesystem_t* fs, const char* path, vfs_node_type_t type) {
+    if (!fs || !fs->fs_data || !path) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+    tmpfs_inode_t* parent;
+    char name[TMPFS_NAME_MAX];
+
+    int result = tmpfs_walk(sb, path, &parent, name);
+    if (result != VFS_OK) {
+        return result;
+    }
+    if (!parent) {
+        return VFS_ERR_EXISTS;  // Root always exists
+    }
+    if (tmpfs_lookup(sb, parent, name)) {
+        return VFS_ERR_EXISTS;
+    }
+
+    tmpfs_inode_t* inode = tmpfs_alloc_inode(sb, type);
+    if (!inode) {
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    result = tmpfs_link(sb, parent, name, inode);
+    if (result != VFS_OK) {
+        tmpfs_free_inode(sb, inode);
+    }
+    return result;
+}
+
+// Remove the entry at 'path' if its type matches
+static int tmpfs_remove_entry(vfs_filesystem_t* fs, const char* path, vfs_node_type_t type) {
+    if (!fs || !fs->fs_data || !path) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+    tmpfs_inode_t* parent;
+    char name[TMPFS_NAME_MAX];
+
+    int result = tmpfs_walk(sb, path, &parent, name);
+    if (result != VFS_OK) {
+        return result;
+    }
+    if (!parent) {
+        return VFS_ERR_INVALID;  // Cannot remove the root
+    }
+
+    tmpfs_dirent_t* de = tmpfs_lookup(sb, parent, name);
+    if (!de) {
+        return VFS_ERR_NOT_FOUND;
+    }
+
+    tmpfs_inode_t* inode = de->inode;
+    if (type == VFS_DIRECTORY) {
+        if (inode->type != VFS_DIRECTORY) {
+            return VFS_ERR_NOT_DIR;
+        }
+        if (inode->child_count > 0) {
+            return VFS_ERR_NOT_EMPTY;
+        }
+    } else if (inode->type == VFS_DIRECTORY) {
+        return VFS_ERR_IS_DIR;
+    }
+
+    tmpfs_unlink(sb, de);
+    tmpfs_release_inode(sb, inode);
+    return VFS_OK;
+}
+
+// ===========================================================================
+// VFS Operations Implementation
+// ===========================================================================
+
+static int tmpfs_vfs_mount(vfs_filesystem_t* fs, drive_t* drive) {
+    if (!fs) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)malloc(sizeof(tmpfs_sb_t));
+    if (!sb) {
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    memset(sb, 0, sizeof(tmpfs_sb_t));
+    sb->next_ino = TMPFS_ROOT_INO;
+    sb->size_limit = TMPFS_DEFAULT_SIZE_LIMIT;
+
+    sb->root = tmpfs_alloc_inode(sb, VFS_DIRECTORY);
+    if (!sb->root) {
+        free(sb);
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    vfs_node_t* root = (vfs_node_t*)malloc(sizeof(vfs_node_t));
+    if (!root) {
+        free(sb->root);
+        free(sb);
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    memset(root, 0, sizeof(vfs_node_t));
+    strcpy(root->name, "/");
+    root->type = VFS_DIRECTORY;
+    root->inode = sb->root->ino;
+    root->fs = fs;
+    root->fs_specific = sb->root;
+
+    fs->fs_data = sb;
+    fs->root = root;
+    fs->flags |= VFS_FS_NOCACHE;    // File data already lives in RAM
+
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_unmount(vfs_filesystem_t* fs) {
+    if (!fs || !fs->fs_data) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+
+    // Open files would be left pointing at freed inodes, and unlinked ones
+    // are only reachable through their open nodes
+    if (sb->open_nodes > 0) {
+        return VFS_ERR_BUSY;
+    }
+
+    // Every inode except the root is reachable through exactly one dirent
+    for (int i = 0; i < TMPFS_HASH_BUCKETS; i++) {
+        tmpfs_dirent_t* de = sb->buckets[i];
+        while (de) {
+            tmpfs_dirent_t* next = de->hash_next;
+            tmpfs_free_inode(sb, de->inode);
+            free(de);
+            de = next;
+        }
+        sb->buckets[i] = NULL;
+    }
+    tmpfs_free_inode(sb, sb->root);
+
+    free(sb);
+    fs->fs_data = NULL;
+
+    if (fs->root) {
+        free(fs->root);
+        fs->root = NULL;
+    }
+
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_open(vfs_filesystem_t* fs, const char* path, vfs_node_t** node) {
+    if (!fs || !fs->fs_data || !path || !node) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+    tmpfs_inode_t* parent;
+    char name[TMPFS_NAME_MAX];
+
+    int result = tmpfs_walk(sb, path, &parent, name);
+    if (result != VFS_OK) {
+        return result;
+    }
+
+    // Handle root directory
+    if (!parent) {
+        *node = fs->root;
+        return VFS_OK;
+    }
+
+    tmpfs_dirent_t* de = tmpfs_lookup(sb, parent, name);
+    if (!de) {
+        return VFS_ERR_NOT_FOUND;
+    }
+
+    vfs_node_t* new_node = tmpfs_make_node(fs, de->inode, de->name);
+    if (!new_node) {
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    *node = new_node;
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_close(vfs_node_t* node) {
+    if (!node || !node->fs) {
+        return VFS_ERR_INVALID;
+    }
+
+    // Don't free root node
+    if (node == node->fs->root) {
+        return VFS_OK;
+    }
+
+    tmpfs_inode_t* inode = (tmpfs_inode_t*)node->fs_specific;
+    if (inode && inode->open_count > 0) {
+        inode->open_count--;
+        ((tmpfs_sb_t*)node->fs->fs_data)->open_nodes--;
+        if (inode->unlinked && inode->open_count == 0) {
+            tmpfs_free_inode((tmpfs_sb_t*)node->fs->fs_data, inode);
+        }
+    }
+
+    free(node);
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (!node || !node->fs_specific || !buffer) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_inode_t* inode = (tmpfs_inode_t*)node->fs_specific;
+    if (inode->type != VFS_FILE) {
+        return VFS_ERR_IS_DIR;
+    }
+
+    if (offset >= inode->size) {
+        return 0;
+    }
+    if (size > inode->size - offset) {
+        size = inode->size - offset;
+    }
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t page_offset = pos % TMPFS_PAGE_SIZE;
+        uint32_t chunk = TMPFS_PAGE_SIZE - page_offset;
+        if (chunk > size - done) {
+            chunk = size - done;
+        }
+
+        uint8_t* page = tmpfs_page_at(inode, pos / TMPFS_PAGE_SIZE);
+        if (!page) {
+            break;
+        }
+        memcpy(buffer + done, page + page_offset, chunk);
+        done += chunk;
+    }
+
+    inode->access_time = pit_get_ticks();
+    return done;
+}
+
+static int tmpfs_vfs_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer) {
+    if (!node || !node->fs_specific || !buffer) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_inode_t* inode = (tmpfs_inode_t*)node->fs_specific;
+    if (inode->type != VFS_FILE) {
+        return VFS_ERR_IS_DIR;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    uint32_t end = offset + size;
+    if (end < offset) {
+        return VFS_ERR_INVALID;  // Overflow
+    }
+
+    int result = tmpfs_reserve((tmpfs_sb_t*)node->fs->fs_data, inode, end);
+    if (result != VFS_OK) {
+        return result;
+    }
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t page_offset = pos % TMPFS_PAGE_SIZE;
+        uint32_t chunk = TMPFS_PAGE_SIZE - page_offset;
+        if (chunk > size - done) {
+            chunk = size - done;
+        }
+
+        uint8_t* page = tmpfs_page_at(inode, pos / TMPFS_PAGE_SIZE);
+        memcpy(page + page_offset, buffer + done, chunk);
+        done += chunk;
+    }
+
+    if (end > inode->size) {
+        inode->size = end;
+    }
+    node->size = inode->size;
+    inode->modify_time = pit_get_ticks();
+
+    return done;
+}
+
+static int tmpfs_vfs_readdir(vfs_node_t* node, uint32_t index, vfs_dir_entry_t* entry) {
+    if (!node || !node->fs_specific || !entry) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_inode_t* dir = (tmpfs_inode_t*)node->fs_specific;
+    if (dir->type != VFS_DIRECTORY) {
+        return VFS_ERR_NOT_DIR;
+    }
+
+    tmpfs_dirent_t* de = dir->first_child;
+    while (de && index > 0) {
+        de = de->sibling;
+        index--;
+    }
+    if (!de) {
+        return VFS_ERR_NOT_FOUND;  // Index out of range
+    }
+
+    tmpfs_fill_entry(de->name, de->inode, entry);
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_finddir(vfs_node_t* node, const char* name, vfs_node_t** child) {
+    if (!node || !node->fs_specific || !name || !child) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_inode_t* dir = (tmpfs_inode_t*)node->fs_specific;
+    if (dir->type != VFS_DIRECTORY) {
+        return VFS_ERR_NOT_DIR;
+    }
+
+    tmpfs_dirent_t* de = tmpfs_lookup((tmpfs_sb_t*)node->fs->fs_data, dir, name);
+    if (!de) {
+        return VFS_ERR_NOT_FOUND;
+    }
+
+    vfs_node_t* new_node = tmpfs_make_node(node->fs, de->inode, de->name);
+    if (!new_node) {
+        return VFS_ERR_NO_MEMORY;
+    }
+
+    *child = new_node;
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_mkdir(vfs_filesystem_t* fs, const char* path) {
+    return tmpfs_make_entry(fs, path, VFS_DIRECTORY);
+}
+
+static int tmpfs_vfs_rmdir(vfs_filesystem_t* fs, const char* path) {
+    return tmpfs_remove_entry(fs, path, VFS_DIRECTORY);
+}
+
+static int tmpfs_vfs_create(vfs_filesystem_t* fs, const char* path) {
+    return tmpfs_make_entry(fs, path, VFS_FILE);
+}
+
+static int tmpfs_vfs_delete(vfs_filesystem_t* fs, const char* path) {
+    return tmpfs_remove_entry(fs, path, VFS_FILE);
+}
+
+// Move a file to 'new_path', replacing a file already there
+static int tmpfs_vfs_rename(vfs_filesystem_t* fs, const char* old_path, const char* new_path) {
+    if (!fs || !fs->fs_data || !old_path || !new_path) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+    tmpfs_inode_t* old_parent;
+    tmpfs_inode_t* new_parent;
+    char old_name[TMPFS_NAME_MAX];
+    char new_name[TMPFS_NAME_MAX];
+
+    int result = tmpfs_walk(sb, old_path, &old_parent, old_name);
+    if (result != VFS_OK) {
+        return result;
+    }
+    result = tmpfs_walk(sb, new_path, &new_parent, new_name);
+    if (result != VFS_OK) {
+        return result;
+    }
+    if (!old_parent || !new_parent) {
+        return VFS_ERR_INVALID;  // The root cannot be moved or replaced
+    }
+
+    tmpfs_dirent_t* src = tmpfs_lookup(sb, old_parent, old_name);
+    if (!src) {
+        return VFS_ERR_NOT_FOUND;
+    }
+    if (src->inode->type == VFS_DIRECTORY) {
+        return VFS_ERR_IS_DIR;   // Only files; no cycle checks needed
+    }
+
+    tmpfs_dirent_t* target = tmpfs_lookup(sb, new_parent, new_name);
+    if (target == src) {
+        return VFS_OK;
+    }
+    if (target && target->inode->type == VFS_DIRECTORY) {
+        return VFS_ERR_IS_DIR;
+    }
+
+    tmpfs_inode_t* inode = src->inode;
+    result = tmpfs_link(sb, new_parent, new_name, inode);
+    if (result != VFS_OK) {
+        return result;
+    }
+    if (target) {
+        tmpfs_inode_t* replaced = target->inode;
+        tmpfs_unlink(sb, target);
+        tmpfs_release_inode(sb, replaced);
+    }
+    tmpfs_unlink(sb, src);
+    inode->modify_time = pit_get_ticks();
+    return VFS_OK;
+}
+
+static int tmpfs_vfs_stat(vfs_filesystem_t* fs, const char* path, vfs_dir_entry_t* stat) {
+    if (!fs || !fs->fs_data || !path || !stat) {
+        return VFS_ERR_INVALID;
+    }
+
+    tmpfs_inode_t* inode;
+    int result = tmpfs_resolve((tmpfs_sb_t*)fs->fs_data, path, &inode);
+    if (result != VFS_OK) {
+        return result;
+    }
+
+    // Report the final path component as the entry name
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' && p[1] != '\0') {
+            name = p + 1;
+        }
+    }
+    tmpfs_fill_entry(name, inode, stat);
+    if (inode == ((tmpfs_sb_t*)fs->fs_data)->root) {
+        strcpy(stat->name, "/");
+    }
+    return VFS_OK;
+}
+
+// ===========================================================================
+// VFS Operations Table
+// ===========================================================================
+
+vfs_filesystem_ops_t tmpfs_vfs_ops = {
+    .mount = tmpfs_vfs_mount,
+    .unmount = tmpfs_vfs_unmount,
+    .open = tmpfs_vfs_open,
+    .close = tmpfs_vfs_close,
+    .read = tmpfs_vfs_read,
+    .write = tmpfs_vfs_write,
+    .readdir = tmpfs_vfs_readdir,
+    .finddir = tmpfs_vfs_finddir,
+    .mkdir = tmpfs_vfs_mkdir,
+    .rmdir = tmpfs_vfs_rmdir,
+    .create = tmpfs_vfs_create,
+    .delete = tmpfs_vfs_delete,
+    .stat = tmpfs_vfs_stat,
+    .rename = tmpfs_vfs_rename
+};
+
+// ===========================================================================
+// Registration and Mounting
+// ===========================================================================
+
+void tmpfs_register_vfs(void) {
+    vfs_register_filesystem("tmpfs", &tmpfs_vfs_ops);
+}
+
+int tmpfs_mount(const char* mount_path, uint32_t size_limit) {
+    int result = vfs_mount(&tmpfs_drive, "tmpfs", mount_path);
+    if (result != VFS_OK) {
+        return result;
+    }
+
+    vfs_filesystem_t* fs = vfs_get_filesystem(mount_path);
+    if (fs && fs->fs_data && size_limit > 0) {
+        ((tmpfs_sb_t*)fs->fs_data)->size_limit = size_limit;
+    }
+
+    return VFS_OK;
+}
+
+bool tmpfs_get_usage(const char* mount_path, uint32_t* used_bytes, uint32_t* limit_bytes, uint32_t* inodes) {
+    vfs_filesystem_t* fs = vfs_get_filesystem(mount_path);
+    if (!fs || !fs->fs_data || strcmp(fs->name, "tmpfs") != 0) {
+        return false;
+    }
+
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)fs->fs_data;
+    if (used_bytes) *used_bytes = sb->used_pages * TMPFS_PAGE_SIZE;
+    if (limit_bytes) *limit_bytes = sb->size_limit;
+    if (inodes) *inodes = sb->inode_count;
+    return true;
+}
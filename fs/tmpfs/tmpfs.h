@@ -0,0 +1,84 @@
+#ifndef TMPFS_H
+#define TMPFS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fs/vfs/vfs.h"
+
+// ===========================================================================
+// TMPFS Constants
+// ===========================================================================
+
+#define TMPFS_PAGE_SIZE             4096
+#define TMPFS_HASH_BUCKETS          128
+#define TMPFS_NAME_MAX              64
+#define TMPFS_ROOT_INO              1
+#define TMPFS_DEFAULT_SIZE_LIMIT    (4 * 1024 * 1024)   // 4 MB per instance
+#define TMPFS_MAX_EXTENT_PAGES      16                  // Largest run requested at once
+
+// ===========================================================================
+// TMPFS Structures
+// ===========================================================================
+
+// A physically contiguous run of pages backing part of a file
+typedef struct tmpfs_extent {
+    uint8_t* base;                  // First page of the run
+    uint32_t pages;                 // Number of pages in the run
+} tmpfs_extent_t;
+
+struct tmpfs_dirent;
+
+typedef struct tmpfs_inode {
+    uint32_t ino;                   // Inode number
+    vfs_node_type_t type;           // VFS_FILE or VFS_DIRECTORY
+    uint32_t size;                  // File size in bytes
+    uint32_t create_time;           // Timestamps are PIT ticks since boot
+    uint32_t modify_time;
+    uint32_t access_time;
+    uint32_t open_count;            // Open VFS nodes referencing this inode
+    bool unlinked;                  // Removed from its directory, freed on last close
+
+    // File data
+    tmpfs_extent_t* extents;        // Extent list in file order
+    uint32_t extent_count;
+    uint32_t extent_capacity;
+    uint32_t page_count;            // Total pages across all extents
+
+    // Directory children (insertion order, used by readdir)
+    struct tmpfs_dirent* first_child;
+    struct tmpfs_dirent* last_child;
+    uint32_t child_count;
+} tmpfs_inode_t;
+
+typedef struct tmpfs_dirent {
+    char name[TMPFS_NAME_MAX];      // Entry name
+    uint32_t hash;                  // Hash of (parent ino, name)
+    tmpfs_inode_t* parent;          // Containing directory
+    tmpfs_inode_t* inode;           // Target inode
+    struct tmpfs_dirent* hash_next; // Next entry in the same hash bucket
+    struct tmpfs_dirent* sibling;   // Next entry in the parent directory
+} tmpfs_dirent_t;
+
+// Per-instance superblock (stored in vfs_filesystem_t.fs_data)
+typedef struct tmpfs_sb {
+    tmpfs_dirent_t* buckets[TMPFS_HASH_BUCKETS];
+    tmpfs_inode_t* root;
+    uint32_t next_ino;
+    uint32_t size_limit;            // Maximum bytes of file data
+    uint32_t used_pages;            // Pages currently allocated
+    uint32_t inode_count;
+    uint32_t open_nodes;            // VFS nodes handed out and not yet closed
+} tmpfs_sb_t;
+
+// ===========================================================================
+// TMPFS Function Declarations
+// ===========================================================================
+
+// Registration and mounting
+void tmpfs_register_vfs(void);
+int tmpfs_mount(const char* mount_path, uint32_t size_limit);
+
+// Usage information for a mounted instance
+bool tmpfs_get_usage(const char* mount_path, uint32_t* used_bytes, uint32_t* limit_bytes, uint32_t* inodes);
+
+#endif // TMPFS_H
@@ -6,6 +6,7 @@
 #include "lib/libc/stdio.h"
 #include "fs/fat32/fat32.h"
 #include "fs/fat12/fat12.h"
+#include "fs/tmpfs/tmpfs.h"
 #include "drivers/char/io.h"
 #include <stddef.h>
 
@@ -210,11 +211,6 @@ void auto_mount_all_drives(void) {
     extern short drive_count;
     extern drive_t* current_drive;  // Shell needs this set
     
-    if (drive_count == 0) {
-        printf("Auto-mount: No drives detected\n");
-        return;
-    }
-    
     // Initialize VFS
     vfs_init();
     
@@ -222,7 +218,18 @@ void auto_mount_all_drives(void) {
     fat32_register_vfs();
     fat12_register_vfs();
     ext2_register_vfs();
-    printf("VFS: FAT32, FAT12, and EXT2 filesystems registered\n");
+    tmpfs_register_vfs();
+    printf("VFS: FAT32, FAT12, EXT2 and TMPFS filesystems registered\n");
+    
+    // RAM-backed scratch space, available even without block devices
+    if (tmpfs_mount("/tmp", TMPFS_DEFAULT_SIZE_LIMIT) == VFS_OK) {
+        printf("  %-6s %-20s %s\n", "tmp", "RAM filesystem", "tmpfs");
+    }
+    
+    if (drive_count == 0) {
+        printf("Auto-mount: No drives detected\n");
+        return;
+    }
     
     int mounted_count = 0;
     int failed_count = 0;
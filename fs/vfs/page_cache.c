@@ -0,0 +1,668 @@
+#include "page_cache.h"
+#include "arch/x86/mm/paging.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+
+// ===========================================================================
+// Page Cache
+// Caches file data of disk-backed filesystems in 4 KB pages keyed by
+// (filesystem, inode, page index). Sequential readers get a growing
+// read-ahead window; dirty pages of VFS_FS_WRITEBACK filesystems are written
+// back on close, sync or eviction.
+// ===========================================================================
+
+typedef struct page_cache_stream {
+    vfs_filesystem_t* fs;               // NULL = unused slot
+    uint32_t inode;
+    uint32_t next_offset;               // Offset a sequential reader asks for next
+    uint32_t window;                    // Current read-ahead window (pages)
+    uint32_t last_use;
+} page_cache_stream_t;
+
+static page_cache_page_t descriptors[PAGE_CACHE_MAX_PAGES];
+static page_cache_page_t* free_descriptors = NULL;
+static page_cache_page_t* buckets[PAGE_CACHE_HASH_BUCKETS];
+static page_cache_page_t* lru_head = NULL;     // Most recently used
+static page_cache_page_t* lru_tail = NULL;     // Least recently used
+static page_cache_stream_t streams[PAGE_CACHE_STREAMS];
+static uint32_t stream_clock = 0;
+static page_cache_stats_t stats;
+static bool initialized = false;
+
+// ===========================================================================
+// Lookup and LRU helpers
+// ===========================================================================
+
+static uint32_t pc_hash(vfs_filesystem_t* fs, uint32_t inode, uint32_t index) {
+    uint32_t h = ((uint32_t)fs >> 4) ^ (inode * 2654435761u) ^ (index * 40503u);
+    return (h ^ (h >> 16)) & (PAGE_CACHE_HASH_BUCKETS - 1);
+}
+
+static page_cache_page_t* pc_lookup(vfs_filesystem_t* fs, uint32_t inode, uint32_t index) {
+    page_cache_page_t* page = buckets[pc_hash(fs, inode, index)];
+    while (page) {
+        if (page->fs == fs && page->inode == inode && page->index == index) {
+            return page;
+        }
+        page = page->hash_next;
+    }
+    return NULL;
+}
+
+static void pc_lru_unlink(page_cache_page_t* page) {
+    if (page->lru_prev) {
+        page->lru_prev->lru_next = page->lru_next;
+    } else {
+        lru_head = page->lru_next;
+    }
+    if (page->lru_next) {
+        page->lru_next->lru_prev = page->lru_prev;
+    } else {
+        lru_tail = page->lru_prev;
+    }
+    page->lru_prev = page->lru_next = NULL;
+}
+
+static void pc_lru_push_front(page_cache_page_t* page) {
+    page->lru_prev = NULL;
+    page->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = page;
+    } else {
+        lru_tail = page;
+    }
+    lru_head = page;
+}
+
+static void pc_touch(page_cache_page_t* page) {
+    if (page != lru_head) {
+        pc_lru_unlink(page);
+        pc_lru_push_front(page);
+    }
+}
+
+static page_cache_page_t* pc_insert(vfs_filesystem_t* fs, uint32_t inode, uint32_t index, uint8_t* data, uint32_t valid) {
+    page_cache_page_t* page = free_descriptors;
+    free_descriptors = page->hash_next;
+
+    page->fs = fs;
+    page->inode = inode;
+    page->index = index;
+    page->data = data;
+    page->valid = valid;
+    page->dirty = false;
+    page->readahead = false;
+    page->owner = NULL;
+    page->map_count = 0;
+    page->orphaned = false;
+
+    uint32_t bucket = pc_hash(fs, inode, index);
+    page->hash_next = buckets[bucket];
+    buckets[bucket] = page;
+    pc_lru_push_front(page);
+
+    stats.cached_pages++;
+    return page;
+}
+
+// Descriptors in use: cached pages plus orphans still pinned by a mapping.
+// Both count against PAGE_CACHE_MAX_PAGES.
+static uint32_t pc_pages_used(void) {
+    return stats.cached_pages + stats.orphaned_pages;
+}
+
+static void pc_free(page_cache_page_t* page) {
+    if (page->orphaned) {
+        stats.orphaned_pages--;
+    }
+    free_page(page->data);
+    page->fs = NULL;
+    page->data = NULL;
+    page->orphaned = false;
+    page->hash_next = free_descriptors;
+    free_descriptors = page;
+}
+
+static void pc_release(page_cache_page_t* page) {
+    page_cache_page_t** link = &buckets[pc_hash(page->fs, page->inode, page->index)];
+    while (*link && *link != page) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = page->hash_next;
+    }
+    pc_lru_unlink(page);
+
+    if (page->dirty) {
+        stats.dirty_pages--;
+        page->dirty = false;
+    }
+    stats.cached_pages--;
+
+    // Mapped pages stay allocated until the last mapping goes away
+    if (page->map_count > 0) {
+        page->orphaned = true;
+        page->fs = NULL;
+        stats.orphaned_pages++;
+        return;
+    }
+    pc_free(page);
+}
+
+// ===========================================================================
+// Write-back and eviction
+// ===========================================================================
+
+static int pc_writeback(page_cache_page_t* page, vfs_node_t* node) {
+    if (!page->dirty) {
+        return VFS_OK;
+    }
+    if (!node) {
+        node = page->owner;
+    }
+    if (!node || !node->fs->ops->write) {
+        return VFS_ERR_IO;
+    }
+
+    int result = node->fs->ops->write(node, page->index * PAGE_CACHE_PAGE_SIZE, page->valid, page->data);
+    if (result < 0) {
+        return result;
+    }
+
+    page->dirty = false;
+    page->owner = NULL;
+    stats.dirty_pages--;
+    stats.writebacks++;
+    return VFS_OK;
+}
+
+// Reclaim the least recently used page that can be written back
+static bool pc_evict_one(void) {
+    for (page_cache_page_t* page = lru_tail; page; page = page->lru_prev) {
+        if (page->map_count > 0) {
+            continue;
+        }
+        if (page->dirty && pc_writeback(page, NULL) != VFS_OK) {
+            continue;
+        }
+        pc_release(page);
+        stats.evictions++;
+        return true;
+    }
+    return false;
+}
+
+// Allocate a contiguous run of up to 'count' pages, evicting under pressure.
+// Returns the number of pages obtained.
+static uint32_t pc_alloc_run(uint32_t count, uint8_t** run) {
+    while (pc_pages_used() + count > PAGE_CACHE_MAX_PAGES && pc_evict_one()) {
+    }
+    if (pc_pages_used() + count > PAGE_CACHE_MAX_PAGES) {
+        count = PAGE_CACHE_MAX_PAGES - pc_pages_used();
+    }
+
+    uint32_t reclaim = count;
+    while (count > 0) {
+        *run = (uint8_t*)allocate_pages(count);
+        if (*run) {
+            return count;
+        }
+        // Pool exhausted: give back cached pages first, then ask for less
+        if (reclaim > 0 && pc_evict_one()) {
+            reclaim--;
+        } else {
+            count /= 2;
+        }
+    }
+    return 0;
+}
+
+// Allocate up to 'count' individual pages, evicting under pressure.
+// Returns the number of pages obtained.
+static uint32_t pc_alloc_scatter(uint32_t count, uint8_t** pages) {
+    uint32_t got = 0;
+    while (got < count) {
+        if (pc_pages_used() + got >= PAGE_CACHE_MAX_PAGES && !pc_evict_one()) {
+            break;
+        }
+        pages[got] = (uint8_t*)allocate_page();
+        if (pages[got]) {
+            got++;
+        } else if (!pc_evict_one()) {
+            break;
+        }
+    }
+    return got;
+}
+
+// ===========================================================================
+// Filling pages from the filesystem
+// ===========================================================================
+
+// Read up to 'count' pages starting at 'index' with a single filesystem call
+// (vectored when the filesystem supports it).
+// The first 'demand' pages were requested by the caller; the rest are read-ahead.
+// Returns the number of pages inserted or a VFS error.
+static int pc_fill(vfs_node_t* node, uint32_t index, uint32_t count, uint32_t demand) {
+    uint32_t file_pages = (node->size + PAGE_CACHE_PAGE_SIZE - 1) / PAGE_CACHE_PAGE_SIZE;
+    if (index >= file_pages || count == 0) {
+        return 0;
+    }
+    if (count > file_pages - index) {
+        count = file_pages - index;
+    }
+    if (count > PAGE_CACHE_RA_MAX) {
+        count = PAGE_CACHE_RA_MAX;
+    }
+
+    // Stop in front of pages that are already cached
+    for (uint32_t i = 1; i < count; i++) {
+        if (pc_lookup(node->fs, node->inode, index + i)) {
+            count = i;
+            break;
+        }
+    }
+
+    uint8_t* pages[PAGE_CACHE_RA_MAX];
+    uint32_t offset = index * PAGE_CACHE_PAGE_SIZE;
+    int result;
+
+    if (node->fs->ops->readv) {
+        // Scatter straight into individual pages with one vectored read
+        vfs_iovec_t iov[PAGE_CACHE_RA_MAX];
+        count = pc_alloc_scatter(count, pages);
+        if (count == 0) {
+            return VFS_ERR_NO_MEMORY;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            iov[i].base = pages[i];
+            iov[i].len = PAGE_CACHE_PAGE_SIZE;
+        }
+        result = node->fs->ops->readv(node, offset, iov, count);
+    } else {
+        uint8_t* run;
+        count = pc_alloc_run(count, &run);
+        if (count == 0) {
+            return VFS_ERR_NO_MEMORY;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            pages[i] = run + i * PAGE_CACHE_PAGE_SIZE;
+        }
+
+        uint32_t bytes = count * PAGE_CACHE_PAGE_SIZE;
+        if (bytes > node->size - offset) {
+            bytes = node->size - offset;
+        }
+        result = node->fs->ops->read(node, offset, bytes, run);
+    }
+
+    if (result < 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            free_page(pages[i]);
+        }
+        return result;
+    }
+
+    uint32_t inserted = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t* data = pages[i];
+        uint32_t start = i * PAGE_CACHE_PAGE_SIZE;
+        if ((uint32_t)result <= start) {
+            free_page(data);
+            continue;
+        }
+        uint32_t valid = (uint32_t)result - start;
+        if (valid > PAGE_CACHE_PAGE_SIZE) {
+            valid = PAGE_CACHE_PAGE_SIZE;
+        }
+        pc_insert(node->fs, node->inode, index + i, data, valid);
+        inserted++;
+        if (i < demand) {
+            stats.misses++;
+        } else {
+            stats.readahead_pages++;
+        }
+    }
+
+    // Mark the middle of a read-ahead batch so the next window is started
+    // before the reader runs off its end
+    if (inserted > demand) {
+        page_cache_page_t* marker = pc_lookup(node->fs, node->inode, index + demand + (inserted - demand) / 2);
+        if (marker) {
+            marker->readahead = true;
+        }
+    }
+
+    return (int)inserted;
+}
+
+static page_cache_stream_t* pc_stream_get(vfs_node_t* node) {
+    page_cache_stream_t* victim = &streams[0];
+    for (int i = 0; i < PAGE_CACHE_STREAMS; i++) {
+        if (streams[i].fs == node->fs && streams[i].inode == node->inode) {
+            streams[i].last_use = ++stream_clock;
+            return &streams[i];
+        }
+        if (!streams[i].fs || streams[i].last_use < victim->last_use) {
+            victim = &streams[i];
+        }
+    }
+
+    victim->fs = node->fs;
+    victim->inode = node->inode;
+    victim->next_offset = 0;            // A fresh read from offset 0 counts as sequential
+    victim->window = 0;
+    victim->last_use = ++stream_clock;
+    return victim;
+}
+
+// ===========================================================================
+// Public API
+// ===========================================================================
+
+void page_cache_init(void) {
+    if (initialized) {
+        page_cache_drop(NULL);
+    }
+
+    memset(buckets, 0, sizeof(buckets));
+    memset(streams, 0, sizeof(streams));
+    memset(&stats, 0, sizeof(stats));
+    lru_head = lru_tail = NULL;
+
+    free_descriptors = NULL;
+    for (int i = PAGE_CACHE_MAX_PAGES - 1; i >= 0; i--) {
+        if (descriptors[i].map_count > 0) {
+            stats.orphaned_pages++;     // Still mapped, freed on unmap
+            continue;
+        }
+        descriptors[i].fs = NULL;
+        descriptors[i].hash_next = free_descriptors;
+        free_descriptors = &descriptors[i];
+    }
+
+    stream_clock = 0;
+    initialized = true;
+}
+
+bool page_cache_enabled(vfs_node_t* node) {
+    return initialized && node && node->fs && node->type == VFS_FILE &&
+           node->inode != 0 && !(node->fs->flags & VFS_FS_NOCACHE) &&
+           node->fs->ops->read;
+}
+
+int page_cache_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (offset >= node->size || size == 0) {
+        return 0;
+    }
+    if (size > node->size - offset) {
+        size = node->size - offset;
+    }
+
+    page_cache_stream_t* stream = pc_stream_get(node);
+    if (offset == stream->next_offset) {
+        stream->window = stream->window ? stream->window * 2 : PAGE_CACHE_RA_MIN;
+        if (stream->window > PAGE_CACHE_RA_MAX) {
+            stream->window = PAGE_CACHE_RA_MAX;
+        }
+    } else {
+        stream->window = 0;
+    }
+
+    uint32_t first = offset / PAGE_CACHE_PAGE_SIZE;
+    uint32_t last = (offset + size - 1) / PAGE_CACHE_PAGE_SIZE;
+    uint32_t copied = 0;
+    bool trigger = false;
+
+    for (uint32_t index = first; index <= last && copied < size; index++) {
+        page_cache_page_t* page = pc_lookup(node->fs, node->inode, index);
+        if (!page) {
+            uint32_t demand = last - index + 1;
+            uint32_t want = (stream->window > demand) ? stream->window : demand;
+            int result = pc_fill(node, index, want, demand);
+            if (result <= 0) {
+                if (copied == 0 && result < 0) {
+                    return result;
+                }
+                break;
+            }
+            page = pc_lookup(node->fs, node->inode, index);
+            if (!page) {
+                break;
+            }
+        } else {
+            stats.hits++;
+            if (page->readahead) {
+                page->readahead = false;
+                trigger = true;
+            }
+        }
+        pc_touch(page);
+
+        uint32_t page_offset = (index == first) ? offset % PAGE_CACHE_PAGE_SIZE : 0;
+        if (page_offset >= page->valid) {
+            break;
+        }
+        uint32_t chunk = page->valid - page_offset;
+        if (chunk > size - copied) {
+            chunk = size - copied;
+        }
+        memcpy(buffer + copied, page->data + page_offset, chunk);
+        copied += chunk;
+
+        if (page->valid < PAGE_CACHE_PAGE_SIZE) {
+            break;                      // Short page: end of file or read error
+        }
+    }
+
+    stream->next_offset = offset + copied;
+
+    // The reader reached a read-ahead marker: start the next window now.
+    // There are no kernel worker threads, so the window is read inline once
+    // the caller's data has been copied out.
+    if (trigger && stream->window) {
+        uint32_t next = last + 1;
+        while (next <= last + stream->window && pc_lookup(node->fs, node->inode, next)) {
+            next++;
+        }
+        if (next <= last + stream->window) {
+            pc_fill(node, next, stream->window, 0);
+        }
+    }
+
+    return (int)copied;
+}
+
+int page_cache_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer) {
+    uint32_t written = 0;
+
+    while (written < size) {
+        uint32_t pos = offset + written;
+        uint32_t index = pos / PAGE_CACHE_PAGE_SIZE;
+        uint32_t page_offset = pos % PAGE_CACHE_PAGE_SIZE;
+        uint32_t chunk = PAGE_CACHE_PAGE_SIZE - page_offset;
+        if (chunk > size - written) {
+            chunk = size - written;
+        }
+
+        page_cache_page_t* page = pc_lookup(node->fs, node->inode, index);
+        if (!page && chunk < PAGE_CACHE_PAGE_SIZE && pos - page_offset < node->size) {
+            // Partial overwrite of existing data: read the page first
+            pc_fill(node, index, 1, 1);
+            page = pc_lookup(node->fs, node->inode, index);
+            if (!page) {
+                break;
+            }
+        }
+        if (!page) {
+            uint8_t* data;
+            if (pc_alloc_run(1, &data) == 0) {
+                break;
+            }
+            memset(data, 0, PAGE_CACHE_PAGE_SIZE);
+            page = pc_insert(node->fs, node->inode, index, data, 0);
+        }
+
+        if (page_offset > page->valid) {
+            memset(page->data + page->valid, 0, page_offset - page->valid);
+        }
+        memcpy(page->data + page_offset, buffer + written, chunk);
+        if (page->valid < page_offset + chunk) {
+            page->valid = page_offset + chunk;
+        }
+        if (!page->dirty) {
+            page->dirty = true;
+            page->owner = node;
+            stats.dirty_pages++;
+        }
+        pc_touch(page);
+        written += chunk;
+    }
+
+    if (written == 0 && size > 0) {
+        return VFS_ERR_NO_MEMORY;
+    }
+    if (offset + written > node->size) {
+        node->size = offset + written;
+    }
+
+    // Throttle writers so dirty data cannot crowd out the whole cache
+    if (stats.dirty_pages > PAGE_CACHE_MAX_PAGES / 2) {
+        page_cache_flush_node(node);
+    }
+
+    return (int)written;
+}
+
+int page_cache_flush_node(vfs_node_t* node) {
+    if (!page_cache_enabled(node)) {
+        return VFS_OK;
+    }
+
+    int status = VFS_OK;
+    for (page_cache_page_t* page = lru_head; page; page = page->lru_next) {
+        if (page->fs != node->fs || page->inode != node->inode) {
+            continue;
+        }
+        if (page->dirty) {
+            int result = pc_writeback(page, node);
+            if (result != VFS_OK && status == VFS_OK) {
+                status = result;
+            }
+        }
+        if (page->owner == node) {
+            page->owner = NULL;         // Node is about to go away
+        }
+    }
+    return status;
+}
+
+void page_cache_invalidate(vfs_filesystem_t* fs, uint32_t inode, uint32_t offset, uint32_t size) {
+    if (!initialized || size == 0) {
+        return;
+    }
+
+    uint32_t first = offset / PAGE_CACHE_PAGE_SIZE;
+    uint32_t end = offset + size;
+    uint32_t last = (end < offset) ? 0xFFFFFFFF : (end - 1) / PAGE_CACHE_PAGE_SIZE;
+
+    page_cache_page_t* page = lru_head;
+    while (page) {
+        page_cache_page_t* next = page->lru_next;
+        if (page->fs == fs && page->inode == inode && page->index >= first && page->index <= last) {
+            pc_release(page);
+        }
+        page = next;
+    }
+}
+
+int page_cache_sync(vfs_filesystem_t* fs) {
+    int status = VFS_OK;
+    for (page_cache_page_t* page = lru_head; page; page = page->lru_next) {
+        if (page->dirty && (!fs || page->fs == fs)) {
+            int result = pc_writeback(page, NULL);
+            if (result != VFS_OK && status == VFS_OK) {
+                status = result;
+            }
+        }
+    }
+    return status;
+}
+
+void page_cache_drop(vfs_filesystem_t* fs) {
+    if (!initialized) {
+        return;
+    }
+
+    page_cache_sync(fs);
+
+    page_cache_page_t* page = lru_head;
+    while (page) {
+        page_cache_page_t* next = page->lru_next;
+        if (!fs || page->fs == fs) {
+            pc_release(page);
+        }
+        page = next;
+    }
+
+    for (int i = 0; i < PAGE_CACHE_STREAMS; i++) {
+        if (!fs || streams[i].fs == fs) {
+            streams[i].fs = NULL;
+        }
+    }
+}
+
+uint8_t* page_cache_map_page(vfs_node_t* node, uint32_t index) {
+    if (!page_cache_enabled(node) || index >= (node->size + PAGE_CACHE_PAGE_SIZE - 1) / PAGE_CACHE_PAGE_SIZE) {
+        return NULL;
+    }
+
+    page_cache_page_t* page = pc_lookup(node->fs, node->inode, index);
+    if (page) {
+        stats.hits++;
+    } else {
+        // Mapped files are mostly walked front to back
+        if (pc_fill(node, index, PAGE_CACHE_RA_MIN, 1) <= 0) {
+            return NULL;
+        }
+        page = pc_lookup(node->fs, node->inode, index);
+        if (!page) {
+            return NULL;
+        }
+    }
+
+    if (page->valid < PAGE_CACHE_PAGE_SIZE) {
+        memset(page->data + page->valid, 0, PAGE_CACHE_PAGE_SIZE - page->valid);
+    }
+    page->map_count++;
+    pc_touch(page);
+    return page->data;
+}
+
+bool page_cache_unmap_page(uint8_t* data) {
+    for (int i = 0; i < PAGE_CACHE_MAX_PAGES; i++) {
+        page_cache_page_t* page = &descriptors[i];
+        if (page->data != data || page->map_count == 0) {
+            continue;
+        }
+        if (--page->map_count == 0 && page->orphaned) {
+            pc_free(page);
+        }
+        return true;
+    }
+    return false;
+}
+
+uint32_t page_cache_shrink(uint32_t pages) {
+    uint32_t reclaimed = 0;
+    while (initialized && reclaimed < pages && pc_evict_one()) {
+        reclaimed++;
+    }
+    return reclaimed;
+}
+
+void page_cache_get_stats(page_cache_stats_t* out) {
+    if (out) {
+        *out = stats;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fs/vfs/vfs.h"
+
+// ===========================================================================
+// Page Cache Constants
+// ===========================================================================
+
+#define PAGE_CACHE_PAGE_SIZE        4096
+#define PAGE_CACHE_MAX_PAGES        512     // 2 MB of cached file data
+#define PAGE_CACHE_HASH_BUCKETS     256
+#define PAGE_CACHE_STREAMS          8       // Concurrently tracked sequential readers
+#define PAGE_CACHE_RA_MIN           4       // Initial read-ahead window (pages)
+#define PAGE_CACHE_RA_MAX           32      // Largest read-ahead window (pages)
+
+// ===========================================================================
+// Page Cache Structures
+// ===========================================================================
+
+// One cached page of file data, keyed by (filesystem, inode, page index)
+typedef struct page_cache_page {
+    vfs_filesystem_t* fs;
+    uint32_t inode;
+    uint32_t index;                     // Page index within the file
+    uint8_t* data;                      // 4 KB page from the paging pool
+    uint32_t valid;                     // Bytes of 'data' holding file contents
+    bool dirty;                         // Modified, not yet written back
+    bool readahead;                     // Reaching this page triggers the next window
+    vfs_node_t* owner;                  // Open node used to write back dirty data
+    uint32_t map_count;                 // Memory mappings pinning this page
+    bool orphaned;                      // Dropped from the cache while still mapped
+    struct page_cache_page* hash_next;
+    struct page_cache_page* lru_prev;   // Towards most recently used
+    struct page_cache_page* lru_next;   // Towards least recently used
+} page_cache_page_t;
+
+typedef struct page_cache_stats {
+    uint32_t hits;                      // Pages served from the cache
+    uint32_t misses;                    // Pages read on demand
+    uint32_t readahead_pages;           // Pages read ahead of demand
+    uint32_t evictions;                 // Pages reclaimed
+    uint32_t writebacks;                // Dirty pages written to the filesystem
+    uint32_t cached_pages;
+    uint32_t dirty_pages;
+    uint32_t orphaned_pages;            // Dropped but still mapped; they keep their descriptor
+} page_cache_stats_t;
+
+// ===========================================================================
+// Page Cache Function Declarations
+// ===========================================================================
+
+void page_cache_init(void);
+
+// True if reads/writes on this node go through the cache
+bool page_cache_enabled(vfs_node_t* node);
+
+// Cached file I/O (called by vfs_read/vfs_write)
+int page_cache_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+int page_cache_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer);
+
+// Write back dirty pages of the node's file
+int page_cache_flush_node(vfs_node_t* node);
+
+// Drop cached pages of a file overlapping [offset, offset + size)
+void page_cache_invalidate(vfs_filesystem_t* fs, uint32_t inode, uint32_t offset, uint32_t size);
+
+// Write back and drop every page of a filesystem (NULL = all filesystems)
+int page_cache_sync(vfs_filesystem_t* fs);
+void page_cache_drop(vfs_filesystem_t* fs);
+
+// Pin a page of the node's file for a memory mapping (NULL if not cacheable
+// or past end of file). Bytes past end of file read as zero.
+uint8_t* page_cache_map_page(vfs_node_t* node, uint32_t index);
+// Release a pinned page; false if 'data' is not a page cache page
+bool page_cache_unmap_page(uint8_t* data);
+
+// Reclaim up to 'pages' pages for other users of the page pool
+uint32_t page_cache_shrink(uint32_t pages);
+
+void page_cache_get_stats(page_cache_stats_t* stats);
+
+#endif // PAGE_CACHE_H
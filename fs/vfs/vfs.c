@@ -1,4 +1,5 @@
 #include "vfs.h"
+#include "page_cache.h"
 #include "lib/libc/string.h"
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"
@@ -9,6 +10,7 @@
 
 #define MAX_FILESYSTEMS 10
 #define MAX_MOUNTS 10
+#define VFS_COPY_CHUNK 4096     // Buffer size for copy-based rename
 
 typedef struct {
     char name[32];
@@ -35,6 +37,8 @@ void vfs_init(void) {
     mount_list = NULL;
     fs_count = 0;
     
+    page_cache_init();
+    
     printf("VFS: Initialization complete.\n");
 }
 
@@ -113,6 +117,8 @@ int vfs_mount(drive_t* drive, const char* fs_type, const char* mount_path) {
     fs->ops = ops;
     fs->fs_data = NULL;
     fs->root = NULL;
+    fs->flags = 0;
+    fs->mappings = 0;
     
     // Call filesystem-specific mount
     int result = ops->mount(fs, drive);
@@ -149,11 +155,28 @@ int vfs_unmount(const char* mount_path) {
         if (strcmp((*current)->path, mount_path) == 0) {
             vfs_mount_t* to_remove = *current;
             
-            // Unmount filesystem
+            // Mapped files keep their nodes open past any fs-level check
+            if (to_remove->fs->mappings > 0) {
+                return VFS_ERR_BUSY;
+            }
+            
+            // Write back dirty pages while the filesystem can still take them
+            int result = page_cache_sync(to_remove->fs);
+            if (result != VFS_OK) {
+                return result;
+            }
+            
+            // Unmount filesystem (it may refuse while files are open)
             if (to_remove->fs->ops->unmount) {
-                to_remove->fs->ops->unmount(to_remove->fs);
+                result = to_remove->fs->ops->unmount(to_remove->fs);
+                if (result != VFS_OK) {
+                    return result;
+                }
             }
             
+            // Only now forget the cached pages; they are all clean
+            page_cache_drop(to_remove->fs);
+            
             // Remove from list
             *current = to_remove->next;
             free(to_remove->fs);
@@ -248,7 +271,11 @@ int vfs_close(vfs_node_t* node) {
         return VFS_ERR_UNSUPPORTED;
     }
     
-    return node->fs->ops->close(node);
+    // Dirty pages may be written back through this node only while it is open
+    int flush_result = page_cache_flush_node(node);
+    int result = node->fs->ops->close(node);
+    
+    return (result == VFS_OK) ? flush_result : result;
 }
 
 int vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
@@ -260,6 +287,10 @@ int vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer)
         return VFS_ERR_UNSUPPORTED;
     }
     
+    if (page_cache_enabled(node)) {
+        return page_cache_read(node, offset, size, buffer);
+    }
+    
     return node->fs->ops->read(node, offset, size, buffer);
 }
 
@@ -272,7 +303,65 @@ int vfs_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* b
         return VFS_ERR_READ_ONLY;
     }
     
-    return node->fs->ops->write(node, offset, size, buffer);
+    if (!page_cache_enabled(node)) {
+        return node->fs->ops->write(node, offset, size, buffer);
+    }
+    
+    if (node->fs->flags & VFS_FS_WRITEBACK) {
+        return page_cache_write(node, offset, size, buffer);
+    }
+    
+    // Write-through: keep cached pages from going stale
+    int result = node->fs->ops->write(node, offset, size, buffer);
+    page_cache_invalidate(node->fs, node->inode, offset, size);
+    return result;
+}
+
+static int vfs_check_iov(const vfs_iovec_t* iov, uint32_t iovcnt, uint32_t* total) {
+    if (!iov || iovcnt == 0 || iovcnt > VFS_IOV_MAX) {
+        return VFS_ERR_INVALID;
+    }
+    
+    *total = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        if (!iov[i].base && iov[i].len) {
+            return VFS_ERR_INVALID;
+        }
+        *total += iov[i].len;
+    }
+    return VFS_OK;
+}
+
+int vfs_readv(vfs_node_t* node, uint32_t offset, const vfs_iovec_t* iov, uint32_t iovcnt) {
+    uint32_t total;
+    if (!node || !node->fs || vfs_check_iov(iov, iovcnt, &total) != VFS_OK) {
+        return VFS_ERR_INVALID;
+    }
+    
+    if (!node->fs->ops->read) {
+        return VFS_ERR_UNSUPPORTED;
+    }
+    
+    // Cached files are served page by page; the filesystem sees whole pages
+    if (!page_cache_enabled(node) && node->fs->ops->readv) {
+        return node->fs->ops->readv(node, offset, iov, iovcnt);
+    }
+    
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len == 0) {
+            continue;
+        }
+        int result = vfs_read(node, offset + done, iov[i].len, (uint8_t*)iov[i].base);
+        if (result < 0) {
+            return done ? (int)done : result;
+        }
+        done += (uint32_t)result;
+        if ((uint32_t)result < iov[i].len) {
+            break;                      // End of file
+        }
+    }
+    return (int)done;
 }
 
 // ===========================================================================
@@ -398,7 +487,105 @@ int vfs_delete(const char* path) {
         return VFS_ERR_UNSUPPORTED;
     }
     
-    return fs->ops->delete(fs, relative_path);
+    // Remember the inode so its cached pages can be dropped
+    vfs_dir_entry_t entry;
+    bool cached = !(fs->flags & VFS_FS_NOCACHE) && fs->ops->stat &&
+                  fs->ops->stat(fs, relative_path, &entry) == VFS_OK;
+    
+    int result = fs->ops->delete(fs, relative_path);
+    if (result == VFS_OK && cached) {
+        page_cache_invalidate(fs, entry.inode, 0, 0xFFFFFFFF);
+    }
+    
+    return result;
+}
+
+// Copy-and-delete for filesystems without a rename operation. The old
+// target is removed before the copy, so a failure here loses it.
+static int vfs_rename_copy(const char* old_path, const char* new_path) {
+    vfs_node_t* src;
+    vfs_node_t* dst;
+    
+    int result = vfs_open(old_path, &src);
+    if (result != VFS_OK) {
+        return result;
+    }
+    if (src->type == VFS_DIRECTORY) {
+        vfs_close(src);
+        return VFS_ERR_IS_DIR;
+    }
+    
+    uint8_t* buffer = (uint8_t*)malloc(VFS_COPY_CHUNK);
+    if (!buffer) {
+        vfs_close(src);
+        return VFS_ERR_NO_MEMORY;
+    }
+    
+    vfs_delete(new_path);
+    result = vfs_create(new_path);
+    if (result == VFS_OK) {
+        result = vfs_open(new_path, &dst);
+    }
+    if (result == VFS_OK) {
+        uint32_t offset = 0;
+        while (offset < src->size) {
+            uint32_t chunk = src->size - offset;
+            if (chunk > VFS_COPY_CHUNK) {
+                chunk = VFS_COPY_CHUNK;
+            }
+            int got = vfs_read(src, offset, chunk, buffer);
+            if (got <= 0) {
+                result = (got < 0) ? got : VFS_ERR_IO;
+                break;
+            }
+            int put = vfs_write(dst, offset, (uint32_t)got, buffer);
+            if (put != got) {
+                result = (put < 0) ? put : VFS_ERR_NO_SPACE;
+                break;
+            }
+            offset += (uint32_t)got;
+        }
+        vfs_close(dst);
+        if (result != VFS_OK) {
+            vfs_delete(new_path);
+        }
+    }
+    
+    free(buffer);
+    vfs_close(src);
+    return (result == VFS_OK) ? vfs_delete(old_path) : result;
+}
+
+int vfs_rename(const char* old_path, const char* new_path) {
+    if (!old_path || !new_path) {
+        return VFS_ERR_INVALID;
+    }
+    if (strcmp(old_path, new_path) == 0) {
+        return VFS_OK;
+    }
+    
+    vfs_filesystem_t* fs = vfs_get_filesystem(old_path);
+    if (!fs) {
+        return VFS_ERR_NOT_FOUND;
+    }
+    if (vfs_get_filesystem(new_path) != fs || !fs->ops->rename) {
+        return vfs_rename_copy(old_path, new_path);
+    }
+    
+    const char* old_relative = vfs_get_relative_path(old_path, fs);
+    const char* new_relative = vfs_get_relative_path(new_path, fs);
+    
+    // The file being replaced keeps no cached pages behind
+    vfs_dir_entry_t entry;
+    bool cached = !(fs->flags & VFS_FS_NOCACHE) && fs->ops->stat &&
+                  fs->ops->stat(fs, new_relative, &entry) == VFS_OK;
+    
+    int result = fs->ops->rename(fs, old_relative, new_relative);
+    if (result == VFS_OK && cached) {
+        page_cache_invalidate(fs, entry.inode, 0, 0xFFFFFFFF);
+    }
+    
+    return result;
 }
 
 int vfs_stat(const char* path, vfs_dir_entry_t* stat) {
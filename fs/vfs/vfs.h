@@ -38,6 +38,16 @@ typedef struct vfs_dir_entry {
     uint8_t attributes;          // File attributes
 } vfs_dir_entry_t;
 
+// ===========================================================================
+// VFS I/O Vector (scatter/gather segment)
+// ===========================================================================
+typedef struct vfs_iovec {
+    void* base;                  // Segment start
+    uint32_t len;                // Segment length in bytes
+} vfs_iovec_t;
+
+#define VFS_IOV_MAX         64   // Maximum segments per vectored call
+
 // ===========================================================================
 // VFS Node (represents a file, directory, device, etc.)
 // ===========================================================================
@@ -75,6 +85,10 @@ typedef struct vfs_filesystem_ops {
     int (*create)(struct vfs_filesystem* fs, const char* path);
     int (*delete)(struct vfs_filesystem* fs, const char* path);
     int (*stat)(struct vfs_filesystem* fs, const char* path, vfs_dir_entry_t* stat);
+    int (*rename)(struct vfs_filesystem* fs, const char* old_path, const char* new_path);  // Optional; replaces new_path
+    
+    // Vectored reads (optional; the VFS falls back to read per segment)
+    int (*readv)(vfs_node_t* node, uint32_t offset, const vfs_iovec_t* iov, uint32_t iovcnt);
 } vfs_filesystem_ops_t;
 
 // ===========================================================================
@@ -86,8 +100,14 @@ typedef struct vfs_filesystem {
     vfs_filesystem_ops_t* ops;        // Operations table
     void* fs_data;                    // Filesystem-specific data (boot sector, etc.)
     vfs_node_t* root;                 // Root directory node
+    uint32_t flags;                   // VFS_FS_* flags, set by the mount operation
+    uint32_t mappings;                // mmap regions holding a node open; unmount is refused while set
 } vfs_filesystem_t;
 
+// Filesystem flags
+#define VFS_FS_NOCACHE      0x01      // Bypass the page cache (RAM-backed or no offset reads)
+#define VFS_FS_WRITEBACK    0x02      // Writes may stay dirty in the page cache until flushed
+
 // ===========================================================================
 // VFS Mount Point
 // ===========================================================================
@@ -111,6 +131,8 @@ typedef struct vfs_mount {
 #define VFS_ERR_NO_SPACE    -8
 #define VFS_ERR_READ_ONLY   -9
 #define VFS_ERR_UNSUPPORTED -10
+#define VFS_ERR_NOT_EMPTY   -11
+#define VFS_ERR_BUSY        -12
 
 // ===========================================================================
 // VFS Public API
@@ -131,6 +153,7 @@ int vfs_open(const char* path, vfs_node_t** node);
 int vfs_close(vfs_node_t* node);
 int vfs_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
 int vfs_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer);
+int vfs_readv(vfs_node_t* node, uint32_t offset, const vfs_iovec_t* iov, uint32_t iovcnt);
 
 // Directory operations
 int vfs_readdir(const char* path, uint32_t index, vfs_dir_entry_t* entry);
@@ -140,6 +163,7 @@ int vfs_rmdir(const char* path);
 // File management
 int vfs_create(const char* path);
 int vfs_delete(const char* path);
+int vfs_rename(const char* old_path, const char* new_path);
 int vfs_stat(const char* path, vfs_dir_entry_t* stat);
 
 // Utility functions
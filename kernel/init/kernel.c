@@ -56,6 +56,9 @@
 #include "drivers/net/e1000.h"
 #include "drivers/net/ne2000.h"
 #include "drivers/net/rtl8139.h"
+#include "drivers/net/virtio_net.h"
+#include "drivers/net/netdev.h"
+#include "drivers/net/loopback.h"
 #include "drivers/net/netstack.h"
 
 // Filesystems
@@ -167,6 +170,12 @@ static void driver_init(void) {
         rtl8139_detect(); // Register RTL8139 driver
     }
     
+    // virtio-net (vendor: 0x1AF4, device: 0x1000, transitional)
+    if (pci_device_exists(VIRTIO_VENDOR_ID, VIRTIO_NET_DEVICE_ID)) {
+        printf("  - virtio-net detected, registering driver\n");
+        virtio_net_detect(); // Register virtio-net driver
+    }
+    
     // NE2000 compatible (vendor: 0x10EC, device: 0x8029)
     if (pci_device_exists(0x10EC, 0x8029)) {
         printf("  - NE2000 compatible detected, registering driver\n");
@@ -176,6 +185,9 @@ static void driver_init(void) {
     // Probe PCI devices and initialize registered drivers
     //printf("Initializing network drivers...\n");
     pci_probe_drivers();
+
+    // Software loopback interface (127.0.0.0/8)
+    loopback_init();
     
     // Enable hardware interrupts
     __asm__ __volatile__("sti");
@@ -209,7 +221,7 @@ static void system_ready(void) {
     printf("Drives Detected: %d\n", drive_count);
     
     // Network stack initialization (optional)
-    if (ne2000_is_initialized()) {
+    if (netdev_count() > 0) {
         netstack_init();
         printf("Network stack initialized\n");
     }
@@ -9,12 +9,160 @@
 #include "kernel/init/prg.h"
 #include "kernel/sched/scheduler.h"
 
-#define PROGRAM_LOAD_ADDRESS 0x01100000 // default address where the program will be loaded into memory except in the case of a program header
+extern drive_t* current_drive;
+extern int read_file_data_to_address(unsigned int start_cluster, void* load_address, unsigned int file_size);
 
 
 Process process_list[MAX_PROGRAMS];
 int next_pid = 1; // PID counter starting at 1
 
+// Program image cache: pristine (optionally relocated) images of recently
+// loaded binaries, keyed by drive, directory and name and validated against
+// the directory entry's start cluster, size and last write time.
+typedef struct {
+    bool used;
+    drive_t* drive;
+    unsigned int dir_cluster;
+    char name[32];
+    bool relocated;             // Relocation applied for PROGRAM_LOAD_ADDRESS
+    uint32_t start_cluster;
+    uint32_t size;
+    uint32_t modify_time;       // FAT write date << 16 | write time
+    uint8_t* image;
+    uint32_t last_use;
+} program_image_t;
+
+static program_image_t image_cache[PROGRAM_CACHE_ENTRIES];
+static uint32_t image_cache_bytes = 0;
+static uint32_t image_cache_clock = 0;
+static uint32_t image_cache_hits = 0;
+static uint32_t image_cache_misses = 0;
+
+// copy a whole image; memcpy takes a 16-bit length
+static void copy_image(void* dest, const void* src, uint32_t size) {
+    uint32_t dwords = size / 4;
+    uint32_t bytes = size % 4;
+    __asm__ __volatile__("rep movsl\n\t"
+                         "movl %3, %%ecx\n\t"
+                         "rep movsb"
+                         : "+D"(dest), "+S"(src), "+c"(dwords)
+                         : "r"(bytes)
+                         : "memory");
+}
+
+static void drop_image(program_image_t* entry) {
+    k_free(entry->image);
+    image_cache_bytes -= entry->size;
+    entry->image = NULL;
+    entry->used = false;
+}
+
+static program_image_t* find_image(const char* name, bool relocated) {
+    for (int i = 0; i < PROGRAM_CACHE_ENTRIES; i++) {
+        program_image_t* entry = &image_cache[i];
+        if (entry->used && entry->drive == current_drive &&
+            entry->dir_cluster == current_directory_cluster &&
+            entry->relocated == relocated && strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// keep a copy of a freshly loaded image, evicting least recently used images
+static void store_image(const char* name, bool relocated, struct fat32_dir_entry* dir_entry, const void* image) {
+    uint32_t size = dir_entry->file_size;
+    if (size == 0 || size > PROGRAM_CACHE_MAX_BYTES || strlen(name) >= sizeof(image_cache[0].name)) {
+        return;
+    }
+
+    program_image_t* slot = NULL;
+    while (!slot || image_cache_bytes + size > PROGRAM_CACHE_MAX_BYTES) {
+        program_image_t* victim = NULL;
+        slot = NULL;
+        for (int i = 0; i < PROGRAM_CACHE_ENTRIES; i++) {
+            if (!image_cache[i].used) {
+                slot = slot ? slot : &image_cache[i];
+            } else if (!victim || image_cache[i].last_use < victim->last_use) {
+                victim = &image_cache[i];
+            }
+        }
+        if (slot && image_cache_bytes + size <= PROGRAM_CACHE_MAX_BYTES) {
+            break;
+        }
+        if (!victim) {
+            return;
+        }
+        drop_image(victim);
+    }
+
+    slot->image = (uint8_t*)k_malloc(size);
+    if (!slot->image) {
+        return;
+    }
+    copy_image(slot->image, image, size);
+
+    slot->used = true;
+    slot->drive = current_drive;
+    slot->dir_cluster = current_directory_cluster;
+    strcpy(slot->name, name);
+    slot->relocated = relocated;
+    slot->start_cluster = read_start_cluster(dir_entry);
+    slot->size = size;
+    slot->modify_time = ((uint32_t)dir_entry->write_date << 16) | dir_entry->write_time;
+    slot->last_use = ++image_cache_clock;
+    image_cache_bytes += size;
+}
+
+// Load a program image to 'address', from the image cache when the file is
+// unchanged. Returns the image size, 0 if the file was not found.
+static uint32_t load_program_image(const char* program_name, uint32_t address, bool relocate) {
+    if (boot_sector.bytes_per_sector == 0 || boot_sector.sectors_per_cluster == 0) {
+        printf("Error: Filesystem not properly initialized\n");
+        return 0;
+    }
+
+    struct fat32_dir_entry* dir_entry = find_file_in_directory(program_name);
+    if (!dir_entry) {
+        return 0;
+    }
+
+    uint32_t modify_time = ((uint32_t)dir_entry->write_date << 16) | dir_entry->write_time;
+    program_image_t* cached = find_image(program_name, relocate);
+    if (cached) {
+        if (cached->start_cluster == read_start_cluster(dir_entry) &&
+            cached->size == dir_entry->file_size && cached->modify_time == modify_time) {
+            copy_image((void*)address, cached->image, cached->size);
+            cached->last_use = ++image_cache_clock;
+            image_cache_hits++;
+            free(dir_entry);
+            return cached->size;
+        }
+        drop_image(cached);     // file changed on disk
+    }
+    image_cache_misses++;
+
+    uint32_t start_cluster = read_start_cluster(dir_entry);
+    if (start_cluster < 2 || read_file_data_to_address(start_cluster, (void*)address, dir_entry->file_size) <= 0) {
+        free(dir_entry);
+        return 0;
+    }
+
+    if (relocate) {
+        program_header_t* header = (program_header_t*)address;
+        uint32_t* relocation_table = (uint32_t*)(address + header->relocation_offset);
+        uint32_t relocation_count = header->relocation_size / sizeof(uint32_t);
+        apply_relocation(relocation_table, relocation_count, address);
+    }
+
+    // cache the image before the program gets to modify its data
+    store_image(program_name, relocate, dir_entry, (void*)address);
+
+    uint32_t size = dir_entry->file_size;
+    free(dir_entry);
+    return size;
+}
+
 // execute the program at the specified entry point
 void start_program_execution(long entry_point) {
     void (*program)() = (void (*)())entry_point;
@@ -23,8 +171,8 @@ void start_program_execution(long entry_point) {
 
 // load the program into memory
 void load_and_execute_program(const char* program_name) {
-    // Load the program into the specified memory location
-    if (fat32_load_file(program_name, (void*)PROGRAM_LOAD_ADDRESS) > 0) {
+    // Load the relocated program image into the specified memory location
+    if (load_program_image(program_name, PROGRAM_LOAD_ADDRESS, true) > 0) {
         program_header_t* header = (program_header_t*)PROGRAM_LOAD_ADDRESS;
 
         // print the program header details
@@ -38,13 +186,6 @@ void load_and_execute_program(const char* program_name) {
         // printf("Relocation size: %d\n", header->relocation_size);
         // printf("Program address: %p\n", (void*)PROGRAM_LOAD_ADDRESS);
 
-        // get the address of the userspace
-        uint32_t* relocation_table = (uint32_t*)(PROGRAM_LOAD_ADDRESS + header->relocation_offset);
-        uint32_t relocation_count = header->relocation_size / sizeof(uint32_t);
-
-        // apply the relocation
-        apply_relocation(relocation_table, relocation_count, PROGRAM_LOAD_ADDRESS);
-
         printf("Start prg at address: %p\n", header->entry_point + PROGRAM_LOAD_ADDRESS);
 
         // execute the program
@@ -61,9 +202,28 @@ void load_and_execute_program(const char* program_name) {
     }
 }
 
+// execute a program image that was put at PROGRAM_LOAD_ADDRESS without the
+// filesystem (e.g. fetched over the network)
+bool execute_program_image(uint32_t size) {
+    program_header_t* header = (program_header_t*)PROGRAM_LOAD_ADDRESS;
+    if (size < sizeof(program_header_t) || header->entry_point >= size ||
+        header->relocation_offset > size || header->relocation_size > size - header->relocation_offset) {
+        printf("Error: not a valid program image\n");
+        return false;
+    }
+
+    uint32_t* relocation_table = (uint32_t*)(PROGRAM_LOAD_ADDRESS + header->relocation_offset);
+    apply_relocation(relocation_table, header->relocation_size / sizeof(uint32_t), PROGRAM_LOAD_ADDRESS);
+
+    printf("Start prg at address: %p\n", header->entry_point + PROGRAM_LOAD_ADDRESS);
+    void (*program)() = (void (*)())(header->entry_point + PROGRAM_LOAD_ADDRESS);
+    program();
+    return true;
+}
+
 void load_program_into_memory(const char* program_name, uint32_t address) {
     // Load the program into the specified memory location
-    if (fat32_load_file(program_name, (void*)address) > 0) {
+    if (load_program_image(program_name, address, false) > 0) {
         program_header_t* header = (program_header_t*)address;
         printf("entry_point: %p\n", address + header->entry_point);
     } else {
@@ -163,3 +323,22 @@ void terminate_process(int pid) {
 
     printf("Error: PID %d not found.\n", pid);
 }
+
+void list_program_cache() {
+    printf("Program image cache: %u bytes, %u hits, %u misses\n",
+           image_cache_bytes, image_cache_hits, image_cache_misses);
+    for (int i = 0; i < PROGRAM_CACHE_ENTRIES; i++) {
+        if (image_cache[i].used) {
+            printf("  %-12s %8u bytes%s\n", image_cache[i].name, image_cache[i].size,
+                   image_cache[i].relocated ? " (relocated)" : "");
+        }
+    }
+}
+
+void flush_program_cache() {
+    for (int i = 0; i < PROGRAM_CACHE_ENTRIES; i++) {
+        if (image_cache[i].used) {
+            drop_image(&image_cache[i]);
+        }
+    }
+}
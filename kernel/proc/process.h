@@ -6,6 +6,10 @@
 
 
 #define MAX_PROGRAMS 256 // Maximum number of running programs
+#define PROGRAM_CACHE_ENTRIES 8 // Program images kept in memory
+#define PROGRAM_CACHE_MAX_BYTES (2 * 1024 * 1024) // Memory budget for cached images
+#define PROGRAM_LOAD_ADDRESS 0x01100000 // default address where the program will be loaded into memory except in the case of a program header
+#define PROGRAM_MAX_BYTES (8 * 1024 * 1024) // user_programs region in klink.ld
 
 typedef struct {
     int pid;
@@ -22,6 +26,10 @@ void terminate_process(int pid);
 
 void start_program_execution(long entry_point);
 void load_and_execute_program(const char* program_name);
+bool execute_program_image(uint32_t size);
 void load_program_into_memory(const char* program_name, uint32_t address);
 
+void list_program_cache();
+void flush_program_cache();
+
 #endif // PROCESS_H
\ No newline at end of file
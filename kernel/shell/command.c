@@ -4,6 +4,7 @@
 #include "arch/x86/include/sys.h"
 #include "kernel/sched/scheduler.h"
 #include "mm/kmalloc.h"
+#include "mm/mmap.h"
 
 #include "drivers/char/rtc.h"
 #include "drivers/block/ata.h"
@@ -15,15 +16,23 @@
 #include "lib/libc/stdlib.h"
 #include "drivers/video/video.h"
 #include "drivers/char/kb.h"
+#include "drivers/char/serial.h"
 #include "kernel/time/pit.h"
 #include "fs/vfs/filesystem.h"
 #include "fs/vfs/vfs.h"
+#include "fs/vfs/page_cache.h"
 #include "fs/fat32/fat32.h"
 #include "fs/fat12/fat12.h"
+#include "fs/tmpfs/tmpfs.h"
 #include "drivers/net/rtl8139.h"
 #include "drivers/net/e1000.h"
 #include "drivers/net/ne2000.h"
+#include "drivers/net/virtio_net.h"
+#include "drivers/net/netdev.h"
 #include "drivers/net/netstack.h"
+#include "drivers/net/tftp.h"
+#include "drivers/net/dns.h"
+#include "drivers/net/pcap.h"
 // #include "drivers/net/vmxnet3.h"
 
 char current_path[256] = "/";
@@ -77,6 +86,7 @@ void cmd_rmfile(int cnt, const char **args);
 void cmd_run(int cnt, const char **args);
 void cmd_exec(int cnt, const char **args);
 void cmd_kill(int cnt, const char **args);
+void cmd_progcache(int cnt, const char **args);
 void cmd_sys(int cnt, const char **args);
 void cmd_open(int cnt, const char **args);
 void cmd_read_datetime(int cnt, const char **args);
@@ -93,11 +103,22 @@ void list_running_processes(int cnt, const char **args);
 void cmd_start_task(int cnt, const char **args);
 void cmd_net(int cnt, const char **args);
 void cmd_ifconfig(int cnt, const char **args);
+void cmd_ethtool(int cnt, const char **args);
 void cmd_ping(int cnt, const char **args);
 void cmd_arp(int cnt, const char **args);
+void cmd_tcp(int cnt, const char **args);
+void cmd_udp(int cnt, const char **args);
+void cmd_tftp(int cnt, const char **args);
+void cmd_dns(int cnt, const char **args);
+void cmd_route(int cnt, const char **args);
+void cmd_pcap(int cnt, const char **args);
 void cmd_history(int cnt, const char **args);
 void cmd_basic(int cnt, const char **args);
 void cmd_get_ip(int cnt, const char **args);
+void cmd_fsbench(int cnt, const char **args);
+void cmd_pcache(int cnt, const char **args);
+void cmd_mmap(int cnt, const char **args);
+void cmd_nettest(int cnt, const char **args);
 
 // Command table
 command_t command_table[MAX_COMMANDS] = {
@@ -118,6 +139,7 @@ command_t command_table[MAX_COMMANDS] = {
     {"run", cmd_run},
     {"exec", cmd_exec},
     {"kill", cmd_kill},
+    {"progcache", cmd_progcache},
     {"sys", cmd_sys},
     {"open", cmd_open},
     {"datetime", cmd_read_datetime},
@@ -134,12 +156,23 @@ command_t command_table[MAX_COMMANDS] = {
     {"rtask", cmd_start_task},
     {"net", cmd_net},
     {"ifconfig", cmd_ifconfig},
+    {"ethtool", cmd_ethtool},
+    {"route", cmd_route},
     {"ping", cmd_ping},
     {"arp", cmd_arp},
+    {"tcp", cmd_tcp},
+    {"udp", cmd_udp},
+    {"tftp", cmd_tftp},
+    {"dns", cmd_dns},
+    {"pcap", cmd_pcap},
     {"history", cmd_history},
     {"basic", cmd_basic},
     {"pci", cmd_pci},
     {"getip", cmd_get_ip},
+    {"fsbench", cmd_fsbench},
+    {"pcache", cmd_pcache},
+    {"mmap", cmd_mmap},
+    {"nettest", cmd_nettest},
     {NULL, NULL} // End marker
 };
 
@@ -711,7 +744,9 @@ void command_loop() {
                 }
             }
         } else {
-            // No input available - use HLT to wait efficiently
+            // No input available - service the network, then HLT until the
+            // next interrupt (keyboard, timer or NIC)
+            netstack_poll();
             __asm__ __volatile__("hlt");
         }
     }
@@ -1154,6 +1189,15 @@ void cmd_kill(int arg_count, const char** arguments) {
     }
 }
 
+void cmd_progcache(int arg_count, const char** arguments) {
+    if (arg_count > 0 && strcmp(arguments[0], "flush") == 0) {
+        flush_program_cache();
+        printf("Program image cache flushed\n");
+    } else {
+        list_program_cache();
+    }
+}
+
 //TryContext ctx;
 
 void cmd_sys(int arg_count, const char** arguments) {
@@ -1325,12 +1369,8 @@ void cmd_run(int arg_count, const char** arguments) {
         printf("RUN command without arguments\n");
         return;
     }
-    char* program_name = (char*)arguments[0];
-    
-    int pid = create_process(program_name);
-    if (pid == -1) {
-        printf("Failed to start program '%s'.\n", program_name);
-    }
+    // Runs in the foreground; the image comes from the program cache when unchanged
+    load_and_execute_program(arguments[0]);
 }
 
 // Open the specified file and print its contents
@@ -1435,6 +1475,58 @@ void cmd_start_task(int arg_count, const char** arguments) {
     //start_task(task_id);
 }
 
+// Transmit 'count' 60 byte broadcast frames (local experimental EtherType)
+// through the batched E1000 TX path and report the packet rate
+static void net_blast(uint32_t count) {
+    uint8_t mac[6];
+    e1000_get_mac_address(mac);
+
+    pbuf_t *batch[32];
+    uint32_t sent = 0, stalls = 0;
+    uint32_t start = pit_get_ticks();
+    while (sent < count) {
+        int n = 0;
+        while (n < 32 && sent + n < count) {
+            pbuf_t *p = pbuf_alloc(0);
+            if (!p) break;
+            uint8_t *frame = pbuf_put(p, 60);
+            memset(frame, 0, 60);
+            memset(frame, 0xFF, 6);
+            memcpy(frame + 6, mac, 6);
+            frame[12] = 0x88;
+            frame[13] = 0xB5;
+            batch[n++] = p;
+        }
+        int taken = e1000_send_batch(batch, n);
+        for (int i = taken; i < n; i++) {
+            pbuf_free(batch[i]);            // Ring full: retry these next round
+        }
+        if (taken < n || n == 0) {
+            stalls++;
+        }
+        sent += taken;
+    }
+    while (!e1000_tx_idle() && pit_get_ticks() - start < 10000) {
+        // Wait for the last batch to leave the card
+    }
+    uint32_t elapsed = pit_get_ticks() - start;
+    if (elapsed == 0) elapsed = 1;
+    printf("Sent %u frames in %u ms (%u frames/s, %u stalls)\n",
+           sent, elapsed, sent * 1000 / elapsed, stalls);
+}
+
+// Loop frames through the RTL8139 and report how fast the ring is drained
+static void net_rxbench(uint32_t count, uint16_t size) {
+    rtl8139_bench_t r;
+    bool ok = rtl8139_rx_benchmark(count, size, &r);
+    uint32_t per_frame = r.frames ? (uint32_t)(r.rx_cycles / r.frames) : 0;
+    uint32_t elapsed = r.elapsed_ms ? r.elapsed_ms : 1;
+    printf("Received %u/%u frames in %u batches, %u lost%s\n",
+           r.frames, count, r.batches, r.lost, ok ? "" : " (FAILED)");
+    printf("  RX path: %u cycles/frame; with loopback TX: %u frames/s, %u KB/s\n",
+           per_frame, r.frames * 1000 / elapsed, (uint32_t)((uint64_t)r.bytes * 1000 / 1024 / elapsed));
+}
+
 void cmd_net(int arg_count, const char** arguments) {
     if (arg_count == 0) {
         printf("NET command - Network interface management\n");
@@ -1445,6 +1537,8 @@ void cmd_net(int arg_count, const char** arguments) {
         printf("  NET DEBUG   - Show E1000 register dump\n");
         printf("  NET LISTEN [n] - Listen for incoming packets (n=count, default 10)\n");
         printf("  NET RECV    - Try to receive one packet\n");
+        printf("  NET BLAST [n] - Send n minimum-size frames in batches (E1000)\n");
+        printf("  NET RXBENCH [n] [size] - Time the RTL8139 ring consumer in loopback\n");
         return;
     }
 
@@ -1492,8 +1586,15 @@ void cmd_net(int arg_count, const char** arguments) {
             rtl8139_get_mac_address(mac);
             printf("  MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n",
                    mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-            printf("  Status: Initialized and ready\n");
             printf("  Driver: Realtek RTL8139 (PCI 10EC:8139)\n");
+            rtl8139_stats_t st;
+            rtl8139_get_stats(&st);
+            printf("  RX: %u packets, %u bytes, %u dropped, %u errors, %u overflows\n",
+                   st.rx_packets, st.rx_bytes, st.rx_dropped, st.rx_errors, st.rx_overflows);
+            printf("      %u interrupts, %u polls, %u CAPR writes\n",
+                   st.interrupts, st.polls, st.capr_writes);
+            printf("  TX: %u packets, %u bytes, %u descriptor busy\n",
+                   st.tx_packets, st.tx_bytes, st.tx_busy);
             has_info = true;
         }
         
@@ -1506,9 +1607,45 @@ void cmd_net(int arg_count, const char** arguments) {
                    mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
             printf("  Status: Initialized and ready\n");
             printf("  Driver: Intel E1000 (PCI 8086:100E)\n");
+            e1000_queue_stats_t rx, tx;
+            e1000_get_rx_stats(&rx);
+            e1000_get_tx_stats(&tx);
+            printf("  RX queue 0: %u packets, %u bytes, %u dropped, %u overruns\n",
+                   rx.packets, rx.bytes, rx.dropped, rx.overruns);
+            printf("              %u interrupts, %u polls, %u tail writes\n",
+                   rx.interrupts, rx.polls, rx.doorbells);
+            printf("              %u checksums verified, %u checksum errors\n",
+                   rx.csum_ok, rx.csum_errors);
+            printf("  TX queue 0: %u packets, %u bytes, %u dropped, %u ring full\n",
+                   tx.packets, tx.bytes, tx.dropped, tx.overruns);
+            printf("              %u interrupts, %u tail writes, %d descriptors free\n",
+                   tx.interrupts, tx.doorbells, e1000_tx_free());
+            printf("              %u checksums offloaded\n", tx.csum_offloaded);
             has_info = true;
         }
         
+        if (virtio_net_is_initialized()) {
+            if (has_info) printf("\n");
+            printf("virtio-net Network Adapter Info:\n");
+            uint8_t mac[6];
+            virtio_net_get_mac_address(mac);
+            printf("  MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n",
+                   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            printf("  Driver: virtio-net legacy (PCI 1AF4:1000), features 0x%08X\n",
+                   virtio_net_get_features());
+            virtio_net_queue_stats_t rx, tx;
+            virtio_net_get_rx_stats(&rx);
+            virtio_net_get_tx_stats(&tx);
+            printf("  RX queue: %u packets, %u bytes, %u dropped, %u checksum fixups\n",
+                   rx.packets, rx.bytes, rx.dropped, rx.csum_fixups);
+            printf("            %u interrupts, %u kicks, %u kicks suppressed\n",
+                   rx.interrupts, rx.kicks, rx.kicks_saved);
+            printf("  TX queue: %u packets, %u bytes, %u dropped, %u checksums offloaded\n",
+                   tx.packets, tx.bytes, tx.dropped, tx.csum_fixups);
+            printf("            %u kicks, %u kicks suppressed\n", tx.kicks, tx.kicks_saved);
+            has_info = true;
+        }
+
         if (ne2000_is_initialized()) {
             if (has_info) printf("\n");  // Separator if both adapters present
             printf("NE2000 Network Adapter Info:\n");
@@ -1518,11 +1655,35 @@ void cmd_net(int arg_count, const char** arguments) {
                    mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
             printf("  Status: Initialized and ready\n");
             printf("  Driver: NE2000 compatible (PCI 10EC:8029)\n");
+            ne2000_ring_layout_t layout;
+            ne2000_get_ring_layout(&layout);
+            printf("  Ring: TX pages %02X-%02X (2 buffers), RX pages %02X-%02X\n",
+                   layout.tx_start, layout.tx_start + 2 * NE2000_TX_PAGES - 1,
+                   layout.rx_start, layout.rx_stop - 1);
+            ne2000_stats_t st;
+            ne2000_get_stats(&st);
+            printf("  RX: %u packets, %u bytes, %u dropped, %u errors, %u overflows\n",
+                   st.rx_packets, st.rx_bytes, st.rx_dropped, st.rx_errors, st.rx_overflows);
+            printf("      %u frames wrapped at the ring end\n", st.rx_wraps);
+            printf("  TX: %u packets, %u bytes, %u errors\n",
+                   st.tx_packets, st.tx_bytes, st.tx_errors);
+            printf("      %u loaded behind a transmit, %u waited for a buffer\n",
+                   st.tx_queued, st.tx_busy);
             has_info = true;
         }
         
         if (!has_info) {
             printf("No network card initialized\n");
+        } else {
+            netstack_stats_t st;
+            netstack_get_stats(&st);
+            printf("\nIPv4: %u in, %u out, %u dropped (%u bad checksum), %u unknown protocol\n",
+                   st.ip_in, st.ip_out, st.ip_dropped, st.ip_bad_checksum, st.ip_unknown_proto);
+            printf("  fragments: %u out, %u in, %u reassembled, %u expired, %u dropped\n",
+                   st.ip_frags_out, st.ip_frags_in, st.ip_reassembled,
+                   st.ip_reass_timeouts, st.ip_reass_drops);
+            printf("  forwarded: %u, no route: %u, TTL expired: %u, ICMP errors sent: %u\n",
+                   st.ip_forwarded, st.ip_fwd_no_route, st.ip_fwd_ttl_expired, st.icmp_errors_out);
         }
     } else if (strcmp(arguments[0], "DEBUG") == 0 || strcmp(arguments[0], "debug") == 0) {
         // Show network debug info
@@ -1674,6 +1835,21 @@ void cmd_net(int arg_count, const char** arguments) {
         } else {
             printf("No packet available.\n");
         }
+    } else if (strcmp(arguments[0], "BLAST") == 0 || strcmp(arguments[0], "blast") == 0) {
+        if (!e1000_is_initialized()) {
+            printf("E1000 not initialized\n");
+            return;
+        }
+        uint32_t count = arg_count > 1 ? (uint32_t)atoi(arguments[1]) : 10000;
+        net_blast(count);
+    } else if (strcmp(arguments[0], "RXBENCH") == 0 || strcmp(arguments[0], "rxbench") == 0) {
+        if (!rtl8139_is_initialized()) {
+            printf("RTL8139 not initialized\n");
+            return;
+        }
+        uint32_t count = arg_count > 1 ? (uint32_t)atoi(arguments[1]) : 10000;
+        uint16_t size = arg_count > 2 ? (uint16_t)atoi(arguments[2]) : 60;
+        net_rxbench(count, size);
     } else {
         printf("Unknown NET command: %s\n", arguments[0]);
         printf("Type 'NET' without arguments for help\n");
@@ -1681,16 +1857,104 @@ void cmd_net(int arg_count, const char** arguments) {
 }
 
 // Network stack commands
-extern void netstack_set_config(uint32_t ip, uint32_t netmask, uint32_t gateway);
 extern uint32_t parse_ipv4(const char *ip_string);
 extern void netstack_process_packet(uint8_t *packet, uint16_t length);
 extern void arp_send_request(uint32_t target_ip);
 
+// Dotted quad or host name; prints why a name did not resolve
+static uint32_t resolve_host(const char* host) {
+    uint32_t ip = 0;
+    int r = dns_resolve(host, &ip);
+    if (r != DNS_OK) {
+        printf("Error: %s: %s\n", host, dns_strerror(r));
+        return 0;
+    }
+    return ip;
+}
+
+static void ifconfig_show(netdev_t* dev) {
+    char mac_s[18], ip_s[16], mask_s[16], gw_s[16];
+    netdev_stats_t st;
+
+    format_mac(dev->mac, mac_s);
+    format_ipv4(dev->ip_address, ip_s);
+    format_ipv4(dev->netmask, mask_s);
+    format_ipv4(dev->gateway, gw_s);
+    netdev_get_stats(dev, &st);
+
+    printf("%s%s  HWaddr %s  MTU %u  %u Mbit/s\n", dev->name,
+           dev == netdev_default() ? "*" : " ", mac_s, dev->mtu, dev->speed);
+    printf("      inet %s  mask %s  gw %s\n", ip_s, mask_s, gw_s);
+    printf("      RX %u packets %u bytes %u dropped\n", st.rx_packets, st.rx_bytes, st.rx_dropped);
+    printf("      TX %u packets %u bytes %u dropped\n", st.tx_packets, st.tx_bytes, st.tx_dropped);
+    if (dev->features) {
+        printf("      features:%s%s%s\n",
+               (dev->features & NETDEV_F_TX_CSUM) ? " tx-csum" : "",
+               (dev->features & NETDEV_F_RX_CSUM) ? " rx-csum" : "",
+               (dev->features & NETDEV_F_LOOPBACK) ? " loopback" : "");
+    }
+
+    netdev_param_t params[16];
+    int count = netdev_get_tunables(dev, params, 16);
+    if (count > 0) {
+        printf("     ");
+        for (int i = 0; i < count && i < 16; i++) {
+            printf(" %s %u", params[i].name, (uint32_t)params[i].value);
+        }
+        printf("\n");
+    }
+}
+
+// "ifconfig eth0 itr 488 rx-ring 128": name/value pairs for the driver
+static void ifconfig_tune(netdev_t* dev, int arg_count, const char** arguments) {
+    if (arg_count % 2 != 0) {
+        printf("Error: Tunables come in name/value pairs\n");
+        return;
+    }
+    for (int i = 0; i < arg_count; i += 2) {
+        char* end;
+        uint32_t value = strtoul(arguments[i + 1], &end, 10);
+        if (*end != '\0' || !netdev_set_tunable(dev, arguments[i], value)) {
+            printf("Error: %s does not accept %s %s\n", dev->name, arguments[i], arguments[i + 1]);
+            if (strcmp(arguments[i], "rx-ring") == 0 || strcmp(arguments[i], "tx-ring") == 0) {
+                printf("RX and TX rings together may hold at most %u of the %u packet buffers\n",
+                       PBUF_RING_BUDGET, PBUF_POOL_SIZE);
+            }
+            return;
+        }
+    }
+    ifconfig_show(dev);
+}
+
 void cmd_ifconfig(int arg_count, const char** arguments) {
     if (arg_count == 0) {
-        printf("IFCONFIG - Configure network interface\n");
-        printf("Usage: ifconfig <ip> <netmask> <gateway>\n");
-        printf("Example: ifconfig 10.0.2.15 255.255.255.0 10.0.2.1\n");
+        if (netdev_count() == 0) {
+            printf("No network interfaces\n");
+        }
+        for (int i = 0; i < netdev_count(); i++) {
+            ifconfig_show(netdev_get(i));
+        }
+        printf("Usage: ifconfig [iface] <ip> <netmask> <gateway>\n");
+        printf("       ifconfig [iface] <tunable> <value> ...\n");
+        printf("Example: ifconfig eth0 10.0.2.15 255.255.255.0 10.0.2.1\n");
+        printf("Example: ifconfig eth0 itr 488 rdtr 0 radv 0 tidv 64 rx-ring 128\n");
+        return;
+    }
+
+    // Optional interface name in front of the addresses
+    netdev_t* dev = netdev_find(arguments[0]);
+    if (dev) {
+        arguments++;
+        arg_count--;
+    } else {
+        dev = netdev_default();
+    }
+    if (!dev) {
+        printf("Error: No network interface\n");
+        return;
+    }
+    if (arg_count > 0 && (arguments[0][0] < '0' || arguments[0][0] > '9')) {
+        ifconfig_tune(dev, arg_count, arguments);
         return;
     }
     
@@ -1703,13 +1967,200 @@ void cmd_ifconfig(int arg_count, const char** arguments) {
     uint32_t netmask = parse_ipv4(arguments[1]);
     uint32_t gateway = parse_ipv4(arguments[2]);
     
-    if (ip == 0 || netmask == 0 || gateway == 0) {
+    if (ip == 0 || netmask == 0 || (gateway == 0 && strcmp(arguments[2], "0.0.0.0") != 0)) {
         printf("Error: Invalid IP address format\n");
         return;
     }
     
-    netstack_set_config(ip, netmask, gateway);
-    printf("Network interface configured successfully\n");
+    netstack_configure(dev, ip, netmask, gateway);
+    printf("Network interface %s configured successfully\n", dev->name);
+}
+
+/**
+ * Hardware counters of an interface, like "ethtool -S"
+ * Usage: ethtool -S <iface>
+ */
+void cmd_ethtool(int arg_count, const char** arguments) {
+    if (arg_count != 2 || strcmp(arguments[0], "-S") != 0) {
+        printf("Usage: ethtool -S <iface>   - Show the NIC's hardware counters\n");
+        return;
+    }
+    netdev_t* dev = netdev_find(arguments[1]);
+    if (!dev) {
+        printf("Error: No interface %s\n", arguments[1]);
+        return;
+    }
+
+    netdev_param_t stats[64];
+    int count = netdev_get_hw_stats(dev, stats, 64);
+    if (count == 0) {
+        printf("%s: no hardware counters\n", dev->name);
+        return;
+    }
+    printf("NIC statistics:\n");
+    for (int i = 0; i < count && i < 64; i++) {
+        printf("     %s: %llu\n", stats[i].name, stats[i].value);
+    }
+}
+
+// "10.1.0.0/16", a bare address (/32) or "default" (0.0.0.0/0)
+static bool parse_prefix(const char* text, uint32_t* prefix, uint8_t* prefix_len) {
+    if (strcmp(text, "default") == 0) {
+        *prefix = 0;
+        *prefix_len = 0;
+        return true;
+    }
+    char addr[16];
+    const char* slash = strchr(text, '/');
+    size_t n = slash ? (size_t)(slash - text) : strlen(text);
+    if (n >= sizeof(addr)) {
+        return false;
+    }
+    memcpy(addr, text, (uint16_t)n);
+    addr[n] = '\0';
+    *prefix = parse_ipv4(addr);
+    *prefix_len = 32;
+    if (slash) {
+        char* end;
+        uint32_t len = strtoul(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' || len > 32) {
+            return false;
+        }
+        *prefix_len = (uint8_t)len;
+    }
+    return *prefix != 0 || strcmp(addr, "0.0.0.0") == 0;
+}
+
+static void route_show(void) {
+    printf("%-18s %-15s %-8s %-6s %s\n", "Destination", "Gateway", "Iface", "Metric", "Flags");
+    for (int i = 0; ; i++) {
+        const route_entry_t* r = route_get_entry(i);
+        if (!r) {
+            break;
+        }
+        char net_s[16], gw_s[16], dst[24], flags[4];
+        format_ipv4(r->prefix, net_s);
+        format_ipv4(r->gateway, gw_s);
+        snprintf(dst, sizeof(dst), "%s/%d", net_s, r->prefix_len);
+        int f = 0;
+        flags[f++] = 'U';
+        if (r->flags & ROUTE_F_GATEWAY) flags[f++] = 'G';
+        if (r->flags & ROUTE_F_STATIC) flags[f++] = 'S';
+        flags[f] = '\0';
+        printf("%-18s %-15s %-8s %-6u %s\n", dst, r->gateway ? gw_s : "*", r->dev->name, r->metric, flags);
+    }
+
+    netstack_stats_t st;
+    netstack_get_stats(&st);
+    printf("Forwarding %s: %u forwarded, %u no route, %u TTL expired, %u too big, %u dropped\n",
+           netstack_get_forwarding() ? "on" : "off", st.ip_forwarded, st.ip_fwd_no_route,
+           st.ip_fwd_ttl_expired, st.ip_fwd_frag_needed, st.ip_fwd_dropped);
+}
+
+/**
+ * Routing table and IP forwarding
+ * Usage: route [add|del|get|forward] ...
+ */
+void cmd_route(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        route_show();
+        printf("Usage:\n");
+        printf("  route add <net>/<len> [via <gw>] [dev <iface>] [metric <n>]\n");
+        printf("  route del <net>/<len>       - Remove a static route\n");
+        printf("  route get <ip>              - Show the route taken to <ip>\n");
+        printf("  route forward [on|off]      - Forward packets between interfaces\n");
+        printf("Example: route add 10.1.0.0/16 via 10.0.2.2\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "forward") == 0) {
+        if (arg_count > 1) {
+            if (strcmp(arguments[1], "on") != 0 && strcmp(arguments[1], "off") != 0) {
+                printf("Error: Use on or off\n");
+                return;
+            }
+            netstack_set_forwarding(strcmp(arguments[1], "on") == 0);
+        }
+        printf("IP forwarding %s\n", netstack_get_forwarding() ? "on" : "off");
+        return;
+    }
+
+    if (strcmp(arguments[0], "get") == 0) {
+        uint32_t ip = arg_count > 1 ? parse_ipv4(arguments[1]) : 0;
+        if (ip == 0) {
+            printf("Error: Invalid address\n");
+            return;
+        }
+        const route_entry_t* r = route_lookup(ip);
+        if (!r) {
+            printf("No route to %s\n", arguments[1]);
+            return;
+        }
+        char net_s[16], gw_s[16];
+        format_ipv4(r->prefix, net_s);
+        format_ipv4(r->gateway, gw_s);
+        printf("%s via %s dev %s (%s/%u)\n", arguments[1], r->gateway ? gw_s : "link",
+               r->dev->name, net_s, r->prefix_len);
+        return;
+    }
+
+    uint32_t prefix;
+    uint8_t prefix_len;
+    if (arg_count < 2 || !parse_prefix(arguments[1], &prefix, &prefix_len)) {
+        printf("Error: Expected a network like 10.1.0.0/16\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "del") == 0) {
+        if (route_del(prefix, prefix_len) != 0) {
+            printf("Error: No static route %s\n", arguments[1]);
+        }
+        return;
+    }
+
+    if (strcmp(arguments[0], "add") != 0) {
+        printf("Error: Unknown subcommand %s\n", arguments[0]);
+        return;
+    }
+    uint32_t gateway = 0;
+    uint32_t metric = 0;
+    netdev_t* dev = NULL;
+    for (int i = 2; i + 1 < arg_count; i += 2) {
+        if (strcmp(arguments[i], "via") == 0) {
+            gateway = parse_ipv4(arguments[i + 1]);
+            if (gateway == 0) {
+                printf("Error: Invalid gateway %s\n", arguments[i + 1]);
+                return;
+            }
+        } else if (strcmp(arguments[i], "dev") == 0) {
+            dev = netdev_find(arguments[i + 1]);
+            if (!dev) {
+                printf("Error: No interface %s\n", arguments[i + 1]);
+                return;
+            }
+        } else if (strcmp(arguments[i], "metric") == 0) {
+            char* end;
+            metric = strtoul(arguments[i + 1], &end, 10);
+            if (*end != '\0' || metric > 0xFFFF) {
+                printf("Error: Invalid metric %s\n", arguments[i + 1]);
+                return;
+            }
+        } else {
+            printf("Error: Unknown option %s\n", arguments[i]);
+            return;
+        }
+    }
+    if (arg_count % 2 != 0) {
+        printf("Error: %s needs a value\n", arguments[arg_count - 1]);
+        return;
+    }
+    if (!gateway && !dev) {
+        printf("Error: Give a gateway (via) or an interface (dev)\n");
+        return;
+    }
+    if (route_add(prefix, prefix_len, gateway, dev, (uint16_t)metric) != 0) {
+        printf("Error: Gateway not on a connected network or table full\n");
+    }
 }
 
 extern void icmp_send_echo_request(uint32_t dst_ip, uint16_t id, uint16_t seq);
@@ -1717,58 +2168,605 @@ extern void icmp_send_echo_request(uint32_t dst_ip, uint16_t id, uint16_t seq);
 void cmd_ping(int arg_count, const char** arguments) {
     if (arg_count == 0) {
         printf("PING - Send ICMP echo request\n");
-        printf("Usage: ping <ip_address>\n");
+        printf("Usage: ping <host>\n");
         printf("Example: ping 10.0.2.1\n");
         return;
     }
 
-    uint32_t target_ip = parse_ipv4(arguments[0]);
+    uint32_t target_ip = resolve_host(arguments[0]);
     if (target_ip == 0) {
-        printf("Error: Invalid IP address\n");
         return;
     }
 
     static uint16_t ping_id = 0x1234;
     static uint16_t seq = 1;
 
-    printf("PING %s (id=0x%04X, seq=%d)...\n", arguments[0], ping_id, seq);
-
-    // Try to resolve ARP first
-    uint8_t mac[6];
-    if (!arp_lookup(target_ip, mac)) {
-        printf("No ARP entry for %s, sending ARP request...\n", arguments[0]);
-        arp_send_request(target_ip);
-        printf("Try again after ARP reply is received.\n");
-        return;
-    }
+    char ip_s[16];
+    format_ipv4(target_ip, ip_s);
+    printf("PING %s (%s) (id=0x%04X, seq=%d)...\n", arguments[0], ip_s, ping_id, seq);
 
+    // Without an ARP entry the request waits in the ARP cache until the reply
     icmp_send_echo_request(target_ip, htons(ping_id), htons(seq));
     seq++;
 }
 
+static void arp_show_cache(void) {
+    static const char* states[] = { "free", "pending", "resolved" };
+    uint32_t now = pit_get_ticks();
+    int shown = 0;
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        const arp_cache_entry_t* e = arp_get_entry(i);
+        if (!e) {
+            continue;
+        }
+        char ip_s[16], mac_s[18];
+        format_ipv4(e->ip, ip_s);
+        if (e->state == ARP_STATE_RESOLVED) {
+            format_mac((uint8_t*)e->mac, mac_s);
+        } else {
+            strcpy(mac_s, "-");
+        }
+        printf("  %-15s %-17s %-8s %-5s age %u s, %u queued\n", ip_s, mac_s, states[e->state],
+               e->dev ? e->dev->name : "-", (now - e->timestamp) / 1000, e->pending.count);
+        shown++;
+    }
+    if (shown == 0) {
+        printf("  (empty)\n");
+    }
+
+    arp_stats_t st;
+    arp_get_stats(&st);
+    printf("Requests out: %u, replies in: %u, requests in: %u, replies out: %u\n",
+           st.requests_out, st.replies_in, st.requests_in, st.replies_out);
+    printf("Entries updated: %u, gratuitous: %u, conflicts: %u\n", st.updates, st.gratuitous, st.conflicts);
+    printf("Packets queued: %u, dropped: %u, timeouts: %u\n", st.queued, st.queue_drops, st.timeouts);
+}
+
 void cmd_arp(int arg_count, const char** arguments) {
+    if (arg_count > 0 && strcmp(arguments[0], "cache") == 0) {
+        arp_show_cache();
+        return;
+    }
+
     printf("ARP - Address Resolution Protocol\n");
     printf("Commands:\n");
-    printf("  arp scan <ip> - Send ARP request to IP\n");
-    printf("  arp cache     - Show ARP cache (not yet implemented)\n");
+    printf("  arp scan <host> - Send ARP request to a host\n");
+    printf("  arp cache       - Show ARP cache and counters\n");
     
     if (arg_count > 0 && strcmp(arguments[0], "scan") == 0) {
         if (arg_count < 2) {
-            printf("Usage: arp scan <ip_address>\n");
+            printf("Usage: arp scan <host>\n");
             return;
         }
         
-        uint32_t target_ip = parse_ipv4(arguments[1]);
+        uint32_t target_ip = resolve_host(arguments[1]);
         if (target_ip == 0) {
-            printf("Error: Invalid IP address\n");
             return;
         }
         
-        printf("Sending ARP request to %s...\n", arguments[1]);
+        char ip_s[16];
+        format_ipv4(target_ip, ip_s);
+        printf("Sending ARP request to %s...\n", ip_s);
         arp_send_request(target_ip);
     }
 }
 
+static const char* tcp_state_name(tcp_state_t state) {
+    static const char* names[] = {
+        "CLOSED", "LISTEN", "SYN_SENT", "SYN_RECEIVED", "ESTABLISHED", "FIN_WAIT_1",
+        "FIN_WAIT_2", "CLOSE_WAIT", "CLOSING", "LAST_ACK", "TIME_WAIT"
+    };
+    return state <= TCP_TIME_WAIT ? names[state] : "?";
+}
+
+static void tcp_report_throughput(const char* label, uint32_t bytes, uint32_t ms, int socket) {
+    uint32_t kb_per_s = ms ? (uint32_t)((uint64_t)bytes * 1000 / 1024 / ms) : 0;
+    printf("%s %u bytes in %u ms (%u KB/s)\n", label, bytes, ms, kb_per_s);
+    const tcp_socket_t* s = tcp_get_socket(socket);
+    if (s) {
+        printf("  mss=%u cwnd=%u srtt=%u ms rto=%u ms retransmits=%u\n",
+               s->mss, s->cwnd, s->srtt >> 3, s->rto, s->retransmits);
+    }
+}
+
+/**
+ * TCP connection table and throughput test against a host-side peer
+ * (see scripts/tcp_throughput.py)
+ */
+void cmd_tcp(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("TCP - Transmission Control Protocol\n");
+        printf("Usage:\n");
+        printf("  tcp stat                    - Show connections and counters\n");
+        printf("  tcp send <host> <port> [KB] - Stream data to a peer and report throughput\n");
+        printf("  tcp recv <port>             - Accept one connection and count bytes until EOF\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "stat") == 0) {
+        tcp_stats_t st;
+        tcp_get_stats(&st);
+        printf("Segments in: %u, out: %u, bad checksum: %u, out of order: %u\n",
+               st.segs_in, st.segs_out, st.bad_checksum, st.out_of_order);
+        printf("Retransmits: %u (fast: %u), delayed ACKs: %u, resets sent: %u, TX stalls: %u\n",
+               st.retransmits, st.fast_retransmits, st.delayed_acks, st.resets_out, st.tx_stalls);
+        pbuf_stats_t pb;
+        pbuf_get_stats(&pb);
+        printf("Packet buffers: %u/%u free (low water %u, allocation failures %u)\n",
+               pb.free, pb.total, pb.low_water, pb.alloc_failures);
+        printf("Large buffers: %u/%u free (allocation failures %u)\n",
+               pb.large_free, pb.large_total, pb.large_failures);
+        for (int i = 0; i < TCP_MAX_SOCKETS; i++) {
+            const tcp_socket_t* s = tcp_get_socket(i);
+            if (!s) {
+                continue;
+            }
+            char ip_s[16];
+            format_ipv4(s->remote_ip, ip_s);
+            printf("  [%2d] %-12s local %5u remote %s:%u  in %u out %u\n",
+                   i, tcp_state_name(s->state), s->local_port, ip_s, s->remote_port,
+                   s->bytes_in, s->bytes_out);
+        }
+        return;
+    }
+
+    if (strcmp(arguments[0], "send") == 0) {
+        if (arg_count < 3) {
+            printf("Usage: tcp send <host> <port> [KB]\n");
+            return;
+        }
+        uint16_t port = (uint16_t)atoi(arguments[2]);
+        uint32_t total = (arg_count > 3 ? (uint32_t)atoi(arguments[3]) : 1024) * 1024;
+        if (port == 0) {
+            printf("Error: Invalid port\n");
+            return;
+        }
+        uint32_t ip = resolve_host(arguments[1]);
+        if (ip == 0) {
+            return;
+        }
+
+        int sock = tcp_connect(ip, port);
+        if (sock < 0) {
+            printf("Connection to %s:%u failed\n", arguments[1], port);
+            return;
+        }
+
+        uint8_t chunk[TCP_MSS_LOCAL];
+        for (uint32_t i = 0; i < sizeof(chunk); i++) {
+            chunk[i] = (uint8_t)('A' + i % 26);
+        }
+
+        uint32_t start = pit_get_ticks();
+        uint32_t sent = 0;
+        while (sent < total) {
+            uint16_t n = (uint16_t)(total - sent < sizeof(chunk) ? total - sent : sizeof(chunk));
+            int r = tcp_send(sock, chunk, n);
+            if (r <= 0) {
+                break;
+            }
+            sent += (uint32_t)r;
+        }
+        uint32_t elapsed = pit_get_ticks() - start;
+        tcp_report_throughput("Sent", sent, elapsed, sock);
+        tcp_close(sock);
+        return;
+    }
+
+    if (strcmp(arguments[0], "recv") == 0) {
+        if (arg_count < 2) {
+            printf("Usage: tcp recv <port>\n");
+            return;
+        }
+        uint16_t port = (uint16_t)atoi(arguments[1]);
+        int listener = tcp_listen(port);
+        if (listener < 0) {
+            printf("Cannot listen on port %u\n", port);
+            return;
+        }
+        printf("Waiting for a connection on port %u...\n", port);
+        int sock = tcp_accept(listener, 60000);
+        tcp_close(listener);
+        if (sock < 0) {
+            printf("No connection\n");
+            return;
+        }
+
+        uint8_t buffer[2048];
+        uint32_t received = 0;
+        uint32_t start = pit_get_ticks();
+        int r;
+        while ((r = tcp_recv(sock, buffer, sizeof(buffer))) > 0) {
+            received += (uint32_t)r;
+        }
+        uint32_t elapsed = pit_get_ticks() - start;
+        tcp_report_throughput(r == 0 ? "Received" : "Received (aborted)", received, elapsed, sock);
+        tcp_close(sock);
+        return;
+    }
+
+    printf("Unknown TCP command: %s\n", arguments[0]);
+}
+
+/**
+ * UDP socket table, one-shot sends and a simple datagram listener
+ */
+void cmd_udp(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("UDP - User Datagram Protocol\n");
+        printf("Usage:\n");
+        printf("  udp stat                      - Show sockets and counters\n");
+        printf("  udp send <host> <port> <text> - Send one datagram\n");
+        printf("  udp recv <port> [seconds]     - Print datagrams arriving on a port\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "stat") == 0) {
+        udp_stats_t st;
+        udp_get_stats(&st);
+        printf("Datagrams in: %u, out: %u, no port: %u, queue drops: %u, bad checksum: %u\n",
+               st.datagrams_in, st.datagrams_out, st.no_port, st.queue_drops, st.bad_checksum);
+        for (int i = 0; i < UDP_MAX_SOCKETS; i++) {
+            const udp_socket_t* s = udp_get_socket(i);
+            if (!s) {
+                continue;
+            }
+            printf("  [%2d] port %5u  queued %u  in %u out %u dropped %u%s\n",
+                   i, s->local_port, s->rcv.count, s->datagrams_in, s->datagrams_out,
+                   s->dropped, s->callback ? "  (callback)" : "");
+        }
+        return;
+    }
+
+    if (strcmp(arguments[0], "send") == 0) {
+        if (arg_count < 4) {
+            printf("Usage: udp send <host> <port> <text>\n");
+            return;
+        }
+        uint16_t port = (uint16_t)atoi(arguments[2]);
+        if (port == 0) {
+            printf("Error: Invalid port\n");
+            return;
+        }
+        uint32_t ip = resolve_host(arguments[1]);
+        if (ip == 0) {
+            return;
+        }
+        int sock = udp_open(0);
+        if (sock < 0) {
+            printf("No free UDP socket\n");
+            return;
+        }
+        uint16_t len = (uint16_t)strlen(arguments[3]);
+        // The first datagram to a new next hop only triggers ARP
+        if (!netstack_resolve(ip, 2000) ||
+            udp_sendto(sock, ip, port, (const uint8_t*)arguments[3], len) != len) {
+            printf("Send failed\n");
+        } else {
+            printf("Sent %u bytes from port %u\n", len, udp_local_port(sock));
+        }
+        udp_close(sock);
+        return;
+    }
+
+    if (strcmp(arguments[0], "recv") == 0) {
+        if (arg_count < 2) {
+            printf("Usage: udp recv <port> [seconds]\n");
+            return;
+        }
+        uint16_t port = (uint16_t)atoi(arguments[1]);
+        uint32_t seconds = arg_count > 2 ? (uint32_t)atoi(arguments[2]) : 30;
+        int sock = udp_open(port);
+        if (sock < 0) {
+            printf("Cannot bind port %u\n", port);
+            return;
+        }
+        printf("Listening on port %u for %u s...\n", port, seconds);
+
+        char buffer[256];
+        uint32_t start = pit_get_ticks();
+        uint32_t count = 0;
+        while (pit_get_ticks() - start < seconds * 1000) {
+            uint32_t src_ip;
+            uint16_t src_port;
+            int n = udp_recvfrom(sock, buffer, sizeof(buffer) - 1, &src_ip, &src_port, 100);
+            if (n < 0) {
+                continue;
+            }
+            buffer[n] = '\0';
+            char ip_s[16];
+            format_ipv4(src_ip, ip_s);
+            printf("  %s:%u (%d bytes): %s\n", ip_s, src_port, n, buffer);
+            count++;
+        }
+        printf("%u datagram(s)\n", count);
+        udp_close(sock);
+        return;
+    }
+
+    printf("Unknown UDP command: %s\n", arguments[0]);
+}
+
+static void tftp_report(const char* verb, int bytes, const tftp_result_t* r) {
+    if (bytes < 0) {
+        printf("TFTP failed: %s\n", r->error);
+        return;
+    }
+    uint32_t ms = r->elapsed_ms ? r->elapsed_ms : 1;
+    printf("%s %d bytes in %u ms (%u KB/s), blksize %u, window %u, %u retransmits\n",
+           verb, bytes, r->elapsed_ms, (uint32_t)((uint64_t)bytes * 1000 / 1024 / ms),
+           r->blksize, r->windowsize, r->retransmits);
+}
+
+// Last path component of a remote file name
+static const char* tftp_basename(const char* name) {
+    const char* base = name;
+    for (const char* c = name; *c; c++) {
+        if (*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+    return base;
+}
+
+/**
+ * TFTP client (get/put/run) and server
+ * Usage: tftp [-b blksize] [-w window] <get|put|run|serve> ...
+ */
+void cmd_tftp(int arg_count, const char** arguments) {
+    tftp_options_t opts = {0, 0};
+    while (arg_count >= 2 && arguments[0][0] == '-') {
+        if (strcmp(arguments[0], "-b") == 0) {
+            opts.blksize = (uint16_t)atoi(arguments[1]);
+        } else if (strcmp(arguments[0], "-w") == 0) {
+            opts.windowsize = (uint16_t)atoi(arguments[1]);
+        } else {
+            break;
+        }
+        arguments += 2;
+        arg_count -= 2;
+    }
+
+    if (arg_count == 0 || arguments[0][0] == '-') {
+        printf("TFTP - Trivial File Transfer Protocol (blksize/windowsize options)\n");
+        printf("Usage: tftp [-b blksize] [-w window] <command>\n");
+        printf("  tftp get <host> <file> [path]   - Fetch a file (default /tmp/<file>)\n");
+        printf("  tftp put <host> <path> [file]   - Send a local file\n");
+        printf("  tftp run <host> <file>          - Fetch a program into memory and start it\n");
+        printf("  tftp serve [seconds] [root] [rw] - Serve files below root (default /),\n");
+        printf("                                    0 s = one transfer, rw allows uploads\n");
+        return;
+    }
+
+    tftp_result_t result;
+    if (strcmp(arguments[0], "serve") == 0) {
+        uint32_t seconds = arg_count > 1 ? (uint32_t)atoi(arguments[1]) : 60;
+        const char* root = arg_count > 2 ? arguments[2] : "/";
+        bool rw = arg_count > 3 && strcmp(arguments[3], "rw") == 0;
+        char ip_s[16];
+        format_ipv4(netstack_get_ip_address(), ip_s);
+        printf("Serving %s on %s:%u (%s)%s\n", root, ip_s, TFTP_PORT, rw ? "read-write" : "read-only",
+               seconds ? "" : ", one transfer");
+        int done = tftp_serve(root, rw, seconds * 1000);
+        if (done < 0) {
+            printf("Port %u busy\n", TFTP_PORT);
+        } else {
+            printf("%d transfer(s) completed\n", done);
+        }
+        return;
+    }
+
+    if (arg_count < 3) {
+        printf("Usage: tftp %s <host> <file>\n", arguments[0]);
+        return;
+    }
+    uint32_t ip = resolve_host(arguments[1]);
+    if (ip == 0) {
+        return;
+    }
+    // The request must not wait in the ARP queue while the retry timer runs
+    if (!netstack_resolve(ip, 2000)) {
+        printf("Host unreachable\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "get") == 0) {
+        char path[128];
+        if (arg_count > 3) {
+            strncpy(path, arguments[3], sizeof(path) - 1);
+            path[sizeof(path) - 1] = '\0';
+        } else {
+            strcpy(path, "/tmp/");
+            strncat(path, tftp_basename(arguments[2]), sizeof(path) - 6);
+        }
+        int n = tftp_get_to_file(ip, arguments[2], path, &opts, &result);
+        tftp_report("Received", n, &result);
+        if (n >= 0) {
+            printf("Saved to %s\n", path);
+        }
+    } else if (strcmp(arguments[0], "put") == 0) {
+        const char* remote = arg_count > 3 ? arguments[3] : tftp_basename(arguments[2]);
+        int n = tftp_put_file(ip, arguments[2], remote, &opts, &result);
+        tftp_report("Sent", n, &result);
+    } else if (strcmp(arguments[0], "run") == 0) {
+        // Straight into the program area, no filesystem involved
+        int n = tftp_get_to_memory(ip, arguments[2], &opts, (uint8_t*)PROGRAM_LOAD_ADDRESS,
+                                   PROGRAM_MAX_BYTES, &result);
+        tftp_report("Received", n, &result);
+        if (n > 0) {
+            execute_program_image((uint32_t)n);
+        }
+    } else {
+        printf("Unknown TFTP command: %s\n", arguments[0]);
+    }
+}
+
+/**
+ * DNS resolver: lookups, cache and server
+ * Usage: dns <host> | dns cache | dns flush | dns server [ip]
+ */
+void cmd_dns(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("DNS - Resolve host names (A records, cached for their TTL)\n");
+        printf("Usage:\n");
+        printf("  dns <host>        - Look up a host\n");
+        printf("  dns cache         - Show cached names and counters\n");
+        printf("  dns flush         - Drop all cached answers\n");
+        printf("  dns server [ip]   - Show or set the DNS server\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "server") == 0) {
+        if (arg_count > 1) {
+            uint32_t ip = parse_ipv4(arguments[1]);
+            if (ip == 0) {
+                printf("Error: Invalid address\n");
+                return;
+            }
+            netstack_set_dns_server(ip);
+        }
+        char ip_s[16];
+        format_ipv4(netstack_get_dns_server(), ip_s);
+        printf("DNS server: %s\n", ip_s);
+        return;
+    }
+
+    if (strcmp(arguments[0], "flush") == 0) {
+        dns_flush();
+        printf("DNS cache flushed\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "cache") == 0) {
+        static const char* states[] = { "free", "pending", "valid", "negative" };
+        uint32_t now = pit_get_ticks();
+        int shown = 0;
+        for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+            const dns_entry_t* e = dns_get_entry(i);
+            if (!e) {
+                continue;
+            }
+            char ip_s[16];
+            format_ipv4(e->ip, ip_s);
+            int32_t left = (int32_t)(e->expires - now);
+            printf("  %-32s %-15s %-8s %s  ttl %d s\n", e->name,
+                   e->state == DNS_ENTRY_VALID ? ip_s : "-", states[e->state],
+                   e->state == DNS_ENTRY_NEGATIVE ? dns_strerror(e->result) : "",
+                   e->state == DNS_ENTRY_PENDING || left < 0 ? 0 : left / 1000);
+            shown++;
+        }
+        if (shown == 0) {
+            printf("  (empty)\n");
+        }
+
+        dns_stats_t st;
+        dns_get_stats(&st);
+        printf("Lookups: %u, hits: %u, negative hits: %u, coalesced: %u\n",
+               st.lookups, st.hits, st.negative_hits, st.coalesced);
+        printf("Queries: %u, retransmits: %u, responses: %u, bad: %u, timeouts: %u\n",
+               st.queries, st.retransmits, st.responses, st.bad_responses, st.timeouts);
+        return;
+    }
+
+    uint32_t start = pit_get_ticks();
+    uint32_t ip = resolve_host(arguments[0]);
+    if (ip == 0) {
+        return;
+    }
+    char ip_s[16];
+    format_ipv4(ip, ip_s);
+    printf("%s has address %s (%u ms)\n", arguments[0], ip_s, pit_get_ticks() - start);
+}
+
+/**
+ * Packet capture into the in-kernel ring, exported as a pcap file
+ * Usage: pcap <start|stop|stat|clear|save|serial> ...
+ */
+void cmd_pcap(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("PCAP - Packet capture on all interfaces\n");
+        printf("Usage:\n");
+        printf("  pcap start [-s snaplen] [filter] - Clear the ring and capture\n");
+        printf("  pcap stop                        - Stop capturing, keep the ring\n");
+        printf("  pcap stat                        - Show capture counters\n");
+        printf("  pcap clear                       - Empty the ring\n");
+        printf("  pcap save <path>                 - Write the ring as a pcap file\n");
+        printf("  pcap serial [com1|com2]          - Stream the pcap file raw (default com2)\n");
+        printf("Filter terms (ANDed, 'not' negates the next one):\n");
+        printf("  arp ip ip6 icmp tcp udp rx tx, ip proto <n>, ether proto <n>,\n");
+        printf("  host <ip>, src <ip>, dst <ip>, port <n>, dev <name>\n");
+        return;
+    }
+
+    if (strcmp(arguments[0], "start") == 0) {
+        uint16_t snaplen = 0;
+        arguments++;
+        arg_count--;
+        if (arg_count >= 2 && strcmp(arguments[0], "-s") == 0) {
+            snaplen = (uint16_t)atoi(arguments[1]);
+            arguments += 2;
+            arg_count -= 2;
+        }
+        pcap_filter_t filter;
+        const char* error;
+        if (!pcap_filter_compile(&filter, arg_count, arguments, &error)) {
+            printf("Bad filter at '%s'\n", error ? error : "");
+            return;
+        }
+        pcap_start(&filter, snaplen);
+        pcap_stats_t st;
+        pcap_get_stats(&st);
+        printf("Capturing (%u filter term(s), snaplen %u, %u records)\n",
+               filter.count, st.snaplen, PCAP_RING_RECORDS);
+        return;
+    }
+
+    if (strcmp(arguments[0], "stop") == 0) {
+        pcap_stop();
+        return;
+    }
+
+    if (strcmp(arguments[0], "clear") == 0) {
+        pcap_clear();
+        return;
+    }
+
+    if (strcmp(arguments[0], "stat") == 0) {
+        pcap_stats_t st;
+        pcap_get_stats(&st);
+        printf("Capture %s, snaplen %u\n", st.running ? "running" : "stopped", st.snaplen);
+        printf("  Seen: %u, filtered: %u, captured: %u, in ring: %u/%u\n",
+               st.seen, st.filtered, st.captured, st.buffered, PCAP_RING_RECORDS);
+        return;
+    }
+
+    if (strcmp(arguments[0], "save") == 0) {
+        if (arg_count < 2) {
+            printf("Usage: pcap save <path>\n");
+            return;
+        }
+        int n = pcap_save(arguments[1]);
+        if (n < 0) {
+            printf("Cannot write %s\n", arguments[1]);
+        } else {
+            printf("%d packet(s) written to %s\n", n, arguments[1]);
+        }
+        return;
+    }
+
+    if (strcmp(arguments[0], "serial") == 0) {
+        uint16_t port = SERIAL_COM2;
+        if (arg_count > 1 && strcmp(arguments[1], "com1") == 0) {
+            port = SERIAL_COM1;
+        }
+        int n = pcap_stream_serial(port);
+        printf("%d packet(s) sent to COM%d\n", n, port == SERIAL_COM1 ? 1 : 2);
+        return;
+    }
+
+    printf("Unknown PCAP command: %s\n", arguments[0]);
+}
+
 /**
  * Display command history
  */
@@ -1835,3 +2833,497 @@ void cmd_basic(int arg_count, const char** arguments) {
     basic_interpreter(); // Call BASIC interpreter
     printf("\nReturned to shell.\n");
 }
+
+//=============================================================================
+// FILESYSTEM BENCHMARK
+//=============================================================================
+
+static inline uint64_t bench_read_tsc(void) {
+    uint32_t high, low;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+static uint32_t bench_cycles_to_us(uint64_t cycles) {
+    if (cpu_frequency == 0) {
+        return 0;
+    }
+    return (uint32_t)(cycles * 1000000ULL / cpu_frequency);
+}
+
+static void bench_report(const char* label, uint64_t cycles, uint32_t iterations, uint32_t bytes) {
+    uint32_t us = bench_cycles_to_us(cycles);
+    uint32_t kb_per_s = 0;
+    if (us > 0) {
+        kb_per_s = (uint32_t)((uint64_t)bytes * iterations * 1000000ULL / 1024 / us);
+    }
+    printf("  %-22s %10u us total %8u us/op %8u KB/s\n",
+           label, us, us / iterations, kb_per_s);
+}
+
+// Time 'iterations' open/read/close cycles of a whole file through the VFS
+static int bench_read_file(const char* path, uint8_t* buffer, uint32_t size, uint32_t iterations, uint64_t* cycles) {
+    uint64_t start = bench_read_tsc();
+    for (uint32_t i = 0; i < iterations; i++) {
+        vfs_node_t* node;
+        if (vfs_open(path, &node) != VFS_OK) {
+            return VFS_ERR_NOT_FOUND;
+        }
+        int result = vfs_read(node, 0, size, buffer);
+        vfs_close(node);
+        if (result < 0) {
+            return result;
+        }
+    }
+    *cycles = bench_read_tsc() - start;
+    return VFS_OK;
+}
+
+/**
+ * Compare tmpfs with FAT32 on the same workload
+ * Usage: fsbench <file on FAT32> [iterations]
+ */
+void cmd_fsbench(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("FSBENCH - Compare tmpfs (/tmp) with FAT32\n");
+        printf("Usage: fsbench <file> [iterations]\n");
+        printf("Example: fsbench /HELLO.BAS 20\n");
+        return;
+    }
+
+    uint32_t iterations = (arg_count > 1) ? strtoul(arguments[1], NULL, 10) : 20;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    char src_path[128];
+    if (arguments[0][0] == '/') {
+        snprintf(src_path, sizeof(src_path), "%s", arguments[0]);
+    } else {
+        snprintf(src_path, sizeof(src_path), "/%s", arguments[0]);
+    }
+
+    vfs_dir_entry_t st;
+    if (vfs_stat(src_path, &st) != VFS_OK || st.type != VFS_FILE || st.size == 0) {
+        printf("File not found or empty: %s\n", src_path);
+        return;
+    }
+
+    uint8_t* buffer = (uint8_t*)malloc(st.size);
+    if (!buffer) {
+        printf("Failed to allocate %u byte buffer\n", st.size);
+        return;
+    }
+
+    // Stage a copy of the file in tmpfs
+    const char* tmp_path = "/tmp/fsbench.dat";
+    vfs_node_t* node;
+    int result = vfs_open(src_path, &node);
+    if (result == VFS_OK) {
+        result = vfs_read(node, 0, st.size, buffer);
+        vfs_close(node);
+    }
+    if (result < 0) {
+        printf("Failed to read %s (VFS error %d)\n", src_path, result);
+        free(buffer);
+        return;
+    }
+
+    vfs_delete(tmp_path);
+    if (vfs_create(tmp_path) != VFS_OK || vfs_open(tmp_path, &node) != VFS_OK) {
+        printf("Failed to create %s (is /tmp mounted?)\n", tmp_path);
+        free(buffer);
+        return;
+    }
+    result = vfs_write(node, 0, st.size, buffer);
+    vfs_close(node);
+    if (result < 0) {
+        printf("Failed to write %s (VFS error %d)\n", tmp_path, result);
+        vfs_delete(tmp_path);
+        free(buffer);
+        return;
+    }
+
+    printf("Workload: %u x read of %u bytes\n", iterations, st.size);
+
+    // First read comes from disk, the rest are served by the page cache
+    uint64_t cold_cycles = 0, fat_cycles = 0, tmp_cycles = 0;
+    page_cache_drop(vfs_get_filesystem(src_path));
+    if (bench_read_file(src_path, buffer, st.size, 1, &cold_cycles) == VFS_OK) {
+        bench_report("disk (cold cache)", cold_cycles, 1, st.size);
+    }
+    if (bench_read_file(src_path, buffer, st.size, iterations, &fat_cycles) == VFS_OK) {
+        bench_report(st.name, fat_cycles, iterations, st.size);
+    } else {
+        printf("  %-22s read failed\n", st.name);
+    }
+    if (bench_read_file(tmp_path, buffer, st.size, iterations, &tmp_cycles) == VFS_OK) {
+        bench_report(tmp_path, tmp_cycles, iterations, st.size);
+    } else {
+        printf("  %-22s read failed\n", tmp_path);
+    }
+
+    // Create/write/delete cycle (FAT32 has no VFS write path yet)
+    uint64_t start = bench_read_tsc();
+    uint32_t done = 0;
+    for (; done < iterations; done++) {
+        if (vfs_create("/tmp/fsbench.w") != VFS_OK || vfs_open("/tmp/fsbench.w", &node) != VFS_OK) {
+            break;
+        }
+        result = vfs_write(node, 0, st.size, buffer);
+        vfs_close(node);
+        vfs_delete("/tmp/fsbench.w");
+        if (result < 0) {
+            break;
+        }
+    }
+    if (done > 0) {
+        bench_report("tmpfs create/write/rm", bench_read_tsc() - start, done, st.size);
+    }
+
+    if (fat_cycles > 0) {
+        printf("Page cache speedup over disk: %ux\n", (uint32_t)(cold_cycles * iterations / fat_cycles));
+    }
+    if (tmp_cycles > 0) {
+        printf("tmpfs speedup over FAT32: %ux\n", (uint32_t)(fat_cycles / tmp_cycles));
+    }
+
+    vfs_delete(tmp_path);
+    free(buffer);
+}
+
+/**
+ * Show page cache statistics, write back or drop cached pages
+ * Usage: pcache [stats|sync|drop]
+ */
+void cmd_pcache(int arg_count, const char** arguments) {
+    if (arg_count > 0 && strcmp(arguments[0], "sync") == 0) {
+        int result = page_cache_sync(NULL);
+        printf(result == VFS_OK ? "Page cache synced\n" : "Page cache sync failed (VFS error %d)\n", result);
+        return;
+    }
+    if (arg_count > 0 && strcmp(arguments[0], "drop") == 0) {
+        page_cache_drop(NULL);
+        printf("Page cache dropped\n");
+        return;
+    }
+    if (arg_count > 0 && strcmp(arguments[0], "stats") != 0) {
+        printf("Usage: pcache [stats|sync|drop]\n");
+        return;
+    }
+
+    page_cache_stats_t st;
+    page_cache_get_stats(&st);
+
+    uint32_t lookups = st.hits + st.misses;
+    printf("Page cache: %u/%u pages (%u KB), %u dirty\n",
+           st.cached_pages, PAGE_CACHE_MAX_PAGES,
+           st.cached_pages * PAGE_CACHE_PAGE_SIZE / 1024, st.dirty_pages);
+    printf("  hits:        %u\n", st.hits);
+    printf("  misses:      %u\n", st.misses);
+    printf("  hit rate:    %u%%\n", lookups ? st.hits * 100 / lookups : 0);
+    printf("  read-ahead:  %u pages\n", st.readahead_pages);
+    printf("  evictions:   %u\n", st.evictions);
+    printf("  writebacks:  %u\n", st.writebacks);
+    printf("  orphaned:    %u pages (dropped, still mapped)\n", st.orphaned_pages);
+}
+
+/**
+ * Map a file and walk it through the mapping, comparing with vfs_read
+ * Usage: mmap <file>
+ */
+void cmd_mmap(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("MMAP - Demand-paged file mapping test\n");
+        printf("Usage: mmap <file>\n");
+        return;
+    }
+
+    char path[128];
+    if (arguments[0][0] == '/') {
+        snprintf(path, sizeof(path), "%s", arguments[0]);
+    } else {
+        snprintf(path, sizeof(path), "/%s", arguments[0]);
+    }
+
+    vfs_dir_entry_t st;
+    if (vfs_stat(path, &st) != VFS_OK || st.type != VFS_FILE || st.size == 0) {
+        printf("File not found or empty: %s\n", path);
+        return;
+    }
+
+    // Reference checksum through the regular read path
+    uint8_t* buffer = (uint8_t*)malloc(st.size);
+    vfs_node_t* node;
+    if (!buffer || vfs_open(path, &node) != VFS_OK) {
+        printf("Failed to read %s\n", path);
+        free(buffer);
+        return;
+    }
+    int result = vfs_read(node, 0, st.size, buffer);
+    vfs_close(node);
+    uint32_t expected = 0;
+    for (int i = 0; i < result; i++) {
+        expected += buffer[i];
+    }
+    free(buffer);
+
+    mmap_stats_t before, after;
+    mmap_get_stats(&before);
+
+    const uint8_t* map = (const uint8_t*)mmap_file(path, 0, 0, MMAP_READ);
+    if (!map) {
+        printf("mmap failed for %s\n", path);
+        return;
+    }
+
+    uint64_t start = bench_read_tsc();
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < st.size; i++) {
+        sum += map[i];
+    }
+    uint64_t cold = bench_read_tsc() - start;
+
+    start = bench_read_tsc();
+    uint32_t again = 0;
+    for (uint32_t i = 0; i < st.size; i++) {
+        again += map[i];
+    }
+    uint64_t warm = bench_read_tsc() - start;
+
+    mmap_get_stats(&after);
+    printf("Mapped %u bytes of %s at %p\n", st.size, path, map);
+    printf("  faults: %u (%u shared with page cache, %u private)\n",
+           after.faults - before.faults,
+           after.shared_pages - before.shared_pages,
+           after.private_pages - before.private_pages);
+    printf("  first pass: %u us, second pass: %u us\n",
+           bench_cycles_to_us(cold), bench_cycles_to_us(warm));
+    printf("  checksum: 0x%08X (%s)\n", sum,
+           (sum == expected && again == expected) ? "matches vfs_read" : "MISMATCH");
+
+    munmap_file((void*)map);
+}
+
+//=============================================================================
+// NETWORK STACK BENCHMARK
+//=============================================================================
+
+#define NETTEST_PORT      5201
+#define NETTEST_TIMEOUT   1000      // ms to wait for one echo
+#define NETTEST_MAX_SIZE  65000
+
+static void nettest_report(const char* label, uint32_t packets, uint32_t bytes, uint64_t cycles) {
+    uint32_t us = bench_cycles_to_us(cycles);
+    if (us == 0) {
+        us = 1;
+    }
+    uint32_t pps = (uint32_t)((uint64_t)packets * 1000000ULL / us);
+    uint32_t kb_per_s = (uint32_t)((uint64_t)bytes * 1000000ULL / 1024 / us);
+    uint32_t per_packet = packets ? (uint32_t)(cycles / packets) : 0;
+    printf("  %-10s %6u pkts %8u us %8u pkts/s %4u.%02u MB/s %8u cycles/pkt\n",
+           label, packets, us, pps, kb_per_s / 1024, (kb_per_s % 1024) * 100 / 1024, per_packet);
+}
+
+// Ping-pong: one echo request in flight at a time
+static void nettest_icmp(uint32_t dst, uint32_t count, uint16_t size) {
+    netstack_stats_t st;
+    uint32_t done = 0;
+    uint64_t start = bench_read_tsc();
+
+    for (uint32_t seq = 0; seq < count; seq++) {
+        netstack_get_stats(&st);
+        uint32_t replies = st.icmp_echo_replies;
+        if (icmp_send_echo(dst, 0x4E54, (uint16_t)seq, size) != 0) {
+            break;
+        }
+        uint32_t sent_at = pit_get_ticks();
+        while (st.icmp_echo_replies == replies && pit_get_ticks() - sent_at < NETTEST_TIMEOUT) {
+            netstack_poll();
+            netstack_get_stats(&st);
+        }
+        if (st.icmp_echo_replies == replies) {
+            printf("  echo %u timed out\n", seq);
+            break;
+        }
+        done++;
+    }
+    nettest_report("icmp echo", done, done * size, bench_read_tsc() - start);
+}
+
+static void nettest_udp_echo(uint32_t dst, uint32_t count, uint16_t size) {
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    if (!buffer) {
+        return;
+    }
+    memset(buffer, 'u', size);
+    int sock = udp_open(NETTEST_PORT);
+    if (sock < 0) {
+        printf("  udp: port %u busy\n", NETTEST_PORT);
+        free(buffer);
+        return;
+    }
+
+    uint32_t done = 0;
+    uint64_t start = bench_read_tsc();
+    for (; done < count; done++) {
+        if (udp_sendto(sock, dst, UDP_PORT_ECHO, buffer, size) != size ||
+            udp_recvfrom(sock, buffer, size, NULL, NULL, NETTEST_TIMEOUT) != size) {
+            printf("  echo %u lost\n", done);
+            break;
+        }
+    }
+    nettest_report("udp echo", done, done * size, bench_read_tsc() - start);
+    udp_close(sock);
+    free(buffer);
+}
+
+// Blast datagrams at the discard port, polling whenever the interface is full
+static void nettest_udp_stream(uint32_t dst, uint32_t count, uint16_t size) {
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    if (!buffer) {
+        return;
+    }
+    memset(buffer, 's', size);
+    int sock = udp_open(0);
+    if (sock < 0) {
+        free(buffer);
+        return;
+    }
+
+    netstack_stats_t before, after;
+    netstack_get_stats(&before);
+    uint32_t sent = 0, failed = 0;
+    uint64_t start = bench_read_tsc();
+    while (sent < count && failed < 1000) {
+        if (!netstack_tx_ready(dst)) {
+            netstack_poll();
+            continue;
+        }
+        if (udp_sendto(sock, dst, UDP_PORT_DISCARD, buffer, size) == size) {
+            sent++;
+        } else {
+            failed++;
+            netstack_poll();
+        }
+    }
+    // Let the last frames arrive (only meaningful over lo)
+    uint32_t drain_start = pit_get_ticks();
+    do {
+        netstack_poll();
+        netstack_get_stats(&after);
+    } while (after.udp_in - before.udp_in < sent && pit_get_ticks() - drain_start < NETTEST_TIMEOUT);
+    uint64_t cycles = bench_read_tsc() - start;
+
+    nettest_report("udp send", sent, sent * size, cycles);
+    printf("  %u of %u datagrams delivered locally\n", after.udp_in - before.udp_in, sent);
+    udp_close(sock);
+    free(buffer);
+}
+
+// Client and server both run here, so the test alternates between the two
+static void nettest_tcp(uint32_t dst, uint32_t kbytes) {
+    static uint8_t chunk[4096];
+    int listener = tcp_listen(NETTEST_PORT);
+    if (listener < 0) {
+        printf("  tcp: port %u busy\n", NETTEST_PORT);
+        return;
+    }
+    int client = tcp_connect(dst, NETTEST_PORT);
+    int server = client >= 0 ? tcp_accept(listener, NETTEST_TIMEOUT) : -1;
+    if (server < 0) {
+        printf("  tcp: connect failed\n");
+        if (client >= 0) {
+            tcp_close(client);
+        }
+        tcp_close(listener);
+        return;
+    }
+    tcp_set_nodelay(client, true);
+    memset(chunk, 't', sizeof(chunk));
+
+    uint32_t total = kbytes * 1024, moved = 0, segments = 0;
+    tcp_stats_t before, after;
+    tcp_get_stats(&before);
+    uint64_t start = bench_read_tsc();
+    while (moved < total) {
+        uint16_t n = (uint16_t)(total - moved < sizeof(chunk) ? total - moved : sizeof(chunk));
+        if (tcp_send(client, chunk, n) != n) {
+            break;
+        }
+        uint32_t got = 0;
+        while (got < n) {
+            int r = tcp_recv(server, chunk, (uint16_t)(n - got));
+            if (r <= 0) {
+                break;
+            }
+            got += (uint32_t)r;
+        }
+        moved += got;
+        if (got < n) {
+            break;
+        }
+    }
+    uint64_t cycles = bench_read_tsc() - start;
+    tcp_get_stats(&after);
+    segments = after.segs_out - before.segs_out;
+    nettest_report("tcp stream", segments, moved, cycles);
+    if (moved < total) {
+        printf("  stalled after %u of %u bytes\n", moved, total);
+    }
+
+    tcp_close(client);
+    tcp_close(server);
+    tcp_close(listener);
+}
+
+/**
+ * Measure the protocol stack over the loopback interface (or any address)
+ * Usage: nettest <icmp|udp|stream|tcp|all> [count|KB] [size] [ip]
+ */
+void cmd_nettest(int arg_count, const char** arguments) {
+    if (arg_count == 0) {
+        printf("NETTEST - Network stack benchmark (default target 127.0.0.1)\n");
+        printf("Usage: nettest <icmp|udp|stream|tcp|all> [count] [size] [ip]\n");
+        printf("  icmp    - ICMP echo ping-pong\n");
+        printf("  udp     - UDP echo ping-pong (port 7)\n");
+        printf("  stream  - UDP stream to the discard port (9)\n");
+        printf("  tcp     - TCP stream, count in KB\n");
+        return;
+    }
+
+    uint32_t count = (arg_count > 1) ? strtoul(arguments[1], NULL, 10) : 0;
+    uint32_t size = (arg_count > 2) ? strtoul(arguments[2], NULL, 10) : 64;
+    uint32_t dst = (arg_count > 3) ? parse_ipv4(arguments[3]) : 0x7F000001;
+    // Anything above 1472 bytes leaves as IP fragments
+    if (size == 0 || size > NETTEST_MAX_SIZE) {
+        printf("Size must be 1..%u bytes\n", NETTEST_MAX_SIZE);
+        return;
+    }
+    if (dst == 0) {
+        printf("Invalid IP address: %s\n", arguments[3]);
+        return;
+    }
+
+    bool all = strcmp(arguments[0], "all") == 0;
+    bool known = all;
+    if (all || strcmp(arguments[0], "icmp") == 0) {
+        nettest_icmp(dst, count ? count : 1000, (uint16_t)size);
+        known = true;
+    }
+    if (all || strcmp(arguments[0], "udp") == 0) {
+        nettest_udp_echo(dst, count ? count : 1000, (uint16_t)size);
+        known = true;
+    }
+    if (all || strcmp(arguments[0], "stream") == 0) {
+        nettest_udp_stream(dst, count ? count : 10000, (uint16_t)size);
+        known = true;
+    }
+    if (all || strcmp(arguments[0], "tcp") == 0) {
+        nettest_tcp(dst, count ? count : 1024);
+        known = true;
+    }
+    if (!known) {
+        printf("Unknown test: %s\n", arguments[0]);
+    }
+}
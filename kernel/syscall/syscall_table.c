@@ -12,6 +12,7 @@
 #include "drivers/char/kb.h"
 #include "kernel/time/pit.h"
 #include "mm/kmalloc.h"
+#include "drivers/net/socket.h"
 #include "lib/libc/stdio.h"
 #include "lib/libc/stdlib.h"  // For SYS_MALLOC, SYS_FREE, SYS_REALLOC, etc.
 
@@ -51,6 +52,16 @@ void* syscall_table[512] __attribute__((section(".syscall_table"))) = {
     (void*)&k_realloc,                  // Syscall 6: Reallocate memory
     (void*)&getchar,                    // Syscall 7: Read character from keyboard
     (void*)&register_interrupt_handler, // Syscall 8: Register IRQ handler
+    (void*)&sys_socket,                 // Syscall 9: Create a socket
+    (void*)&sys_bind,                   // Syscall 10: Bind a local port
+    (void*)&sys_connect,                // Syscall 11: Connect / set UDP peer
+    (void*)&sys_sendto,                 // Syscall 12: Send
+    (void*)&sys_recvfrom,               // Syscall 13: Receive
+    (void*)&sys_listen,                 // Syscall 14: Listen for connections
+    (void*)&sys_accept,                 // Syscall 15: Accept a connection
+    (void*)&sys_close,                  // Syscall 16: Close a socket
+    (void*)&sys_poll,                   // Syscall 17: Wait for socket events
+    (void*)&sys_resolve,                // Syscall 18: Resolve a host name
     // Add more syscalls here as needed
 };
 
@@ -66,11 +77,17 @@ void* syscall_table[512] __attribute__((section(".syscall_table"))) = {
  * - EBX: argument 1
  * - ECX: argument 2
  * - EDX: argument 3
+ * - ESI: argument 4
+ * - EDI: argument 5
+ * 
+ * The result is returned in EAX, which the INT 0x80 stub leaves untouched
+ * on its way back to the caller.
  * 
  * @param irq_number Unused, for compatibility with IRQ handler signature
+ * @return Syscall result, -1 for an invalid syscall
  */
-void syscall_handler(void* irq_number) {
-    int syscall_index, arg1, arg2, arg3;
+int syscall_handler(void* irq_number) {
+    int syscall_index, arg1, arg2, arg3, arg4, arg5;
     
     // Retrieve register values into C variables
     __asm__ __volatile__(
@@ -78,14 +95,16 @@ void syscall_handler(void* irq_number) {
         : "=a"(syscall_index),  // EAX -> syscall_index
           "=b"(arg1),           // EBX -> arg1
           "=c"(arg2),           // ECX -> arg2
-          "=d"(arg3)            // EDX -> arg3
+          "=d"(arg3),           // EDX -> arg3
+          "=S"(arg4),           // ESI -> arg4
+          "=D"(arg5)            // EDI -> arg5
         :                       // No input operands
     );
 
     // Validate syscall index
     if (syscall_index < 0 || syscall_index >= 512 || syscall_table[syscall_index] == 0) {
         printf("Invalid syscall index: %d\n", syscall_index);
-        return;
+        return -1;
     }
 
     // Retrieve function pointer from table
@@ -98,31 +117,50 @@ void syscall_handler(void* irq_number) {
         case 3:  // kb_wait_enter
         case SYS_FREE:  // k_free
             ((void (*)(void))func_ptr)();
-            break;
+            return 0;
 
         // Single-argument syscalls
         case 1:  // kernel_print_number
         case 2:  // pit_delay
-        case SYS_MALLOC:  // k_malloc
             ((void (*)(int))func_ptr)((uint32_t)arg1);
-            break;
+            return 0;
+
+        case SYS_MALLOC:  // k_malloc
+            return (int)((void* (*)(size_t))func_ptr)((size_t)arg1);
 
         // Two-argument syscalls
         case SYS_REALLOC:  // k_realloc
-            ((void* (*)(void*, size_t))func_ptr)((void*)arg1, (size_t)arg2);
-            break;
+            return (int)((void* (*)(void*, size_t))func_ptr)((void*)arg1, (size_t)arg2);
 
         case SYS_INSTALL_IRQ:  // register_interrupt_handler
             ((void (*)(int, void*))func_ptr)(arg1, (void*)arg2);
-            break;
+            return 0;
 
         // Syscalls with return values
         case SYS_TERMINAL_GETCHAR:  // getchar
-            ((void* (*)(void))func_ptr)();
-            break;
+            return (int)((char (*)(void))func_ptr)();
+
+        // Sockets (drivers/net/socket.c)
+        case SYS_SOCKET:
+        case SYS_LISTEN:
+        case SYS_POLL:
+            return ((int (*)(int, int, int))func_ptr)(arg1, arg2, arg3);
+
+        case SYS_BIND:
+        case SYS_CONNECT:
+        case SYS_ACCEPT:
+        case SYS_RESOLVE:
+            return ((int (*)(int, void*))func_ptr)(arg1, (void*)arg2);
+
+        case SYS_CLOSE:
+            return ((int (*)(int))func_ptr)(arg1);
+
+        case SYS_SENDTO:
+        case SYS_RECVFROM:
+            return ((int (*)(int, void*, size_t, int, void*))func_ptr)(arg1, (void*)arg2, (size_t)arg3, arg4, (void*)arg5);
 
         default:
             printf("Unknown syscall index: %d\n", syscall_index);
-            break;
+            return -1;
     }
 }
@@ -76,6 +76,11 @@ uint16_t read_pit_counter() {
     return count;
 }
 
+// Milliseconds elapsed since timer_install (wraps after ~49 days)
+uint32_t pit_get_ticks(void) {
+    return timer_tick_count;
+}
+
 void pit_delay(uint32_t milliseconds) {
     //printf("Delay for %d ms\n", milliseconds);
     uint32_t start_tick = timer_tick_count;
@@ -6,5 +6,6 @@
 extern void timer_irq_handler(void* r);
 void timer_install(uint8_t ms);
 void pit_delay(uint32_t milliseconds);
+uint32_t pit_get_ticks(void);
 
 #endif // PIT_H
\ No newline at end of file
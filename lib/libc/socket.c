@@ -0,0 +1,67 @@
+#include "socket.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+// The kernel takes at most five register arguments, so the address length
+// is checked and filled in here rather than passed down
+
+static int addr_ok(const struct sockaddr *addr, socklen_t addrlen) {
+    return addr && addrlen >= sizeof(struct sockaddr_in);
+}
+
+int socket(int domain, int type, int protocol) {
+    return (int)syscall5(SYS_SOCKET, (void*)domain, (void*)type, (void*)protocol, NULL, NULL);
+}
+
+int bind(int fd, const struct sockaddr *addr, socklen_t addrlen) {
+    if (!addr_ok(addr, addrlen)) return -1;
+    return (int)syscall5(SYS_BIND, (void*)fd, (void*)addr, NULL, NULL, NULL);
+}
+
+int connect(int fd, const struct sockaddr *addr, socklen_t addrlen) {
+    if (!addr_ok(addr, addrlen)) return -1;
+    return (int)syscall5(SYS_CONNECT, (void*)fd, (void*)addr, NULL, NULL, NULL);
+}
+
+int listen(int fd, int backlog) {
+    return (int)syscall5(SYS_LISTEN, (void*)fd, (void*)backlog, NULL, NULL, NULL);
+}
+
+int accept(int fd, struct sockaddr *addr, socklen_t *addrlen) {
+    if (addr && (!addrlen || *addrlen < sizeof(struct sockaddr_in))) addr = NULL;
+    int r = (int)syscall5(SYS_ACCEPT, (void*)fd, addr, NULL, NULL, NULL);
+    if (r >= 0 && addr) *addrlen = sizeof(struct sockaddr_in);
+    return r;
+}
+
+int sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr, socklen_t addrlen) {
+    if (addr && !addr_ok(addr, addrlen)) return -1;
+    return (int)syscall5(SYS_SENDTO, (void*)fd, (void*)buf, (void*)len, (void*)flags, (void*)addr);
+}
+
+int recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr *addr, socklen_t *addrlen) {
+    if (addr && (!addrlen || *addrlen < sizeof(struct sockaddr_in))) addr = NULL;
+    int r = (int)syscall5(SYS_RECVFROM, (void*)fd, buf, (void*)len, (void*)flags, addr);
+    if (r >= 0 && addr) *addrlen = sizeof(struct sockaddr_in);
+    return r;
+}
+
+int send(int fd, const void *buf, size_t len, int flags) {
+    return sendto(fd, buf, len, flags, NULL, 0);
+}
+
+int recv(int fd, void *buf, size_t len, int flags) {
+    return recvfrom(fd, buf, len, flags, NULL, NULL);
+}
+
+int close(int fd) {
+    return (int)syscall5(SYS_CLOSE, (void*)fd, NULL, NULL, NULL, NULL);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout_ms) {
+    return (int)syscall5(SYS_POLL, fds, (void*)nfds, (void*)timeout_ms, NULL, NULL);
+}
+
+int inet_lookup(const char *host, struct in_addr *addr) {
+    return (int)syscall5(SYS_RESOLVE, (void*)host, addr, NULL, NULL, NULL);
+}
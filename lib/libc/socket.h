@@ -0,0 +1,88 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// =============================================================================
+// BSD sockets over INT 0x80. Addresses and ports in sockaddr_in are in
+// network byte order, as on other systems. Calls return -1 on failure;
+// there is no errno.
+// =============================================================================
+
+#define AF_INET         2
+
+#define SOCK_STREAM     1               // TCP
+#define SOCK_DGRAM      2               // UDP
+
+#define INADDR_ANY      0u
+
+// Flags for sendto/recvfrom
+#define MSG_DONTWAIT    0x40            // Return -1 instead of blocking
+
+// poll events
+#define POLLIN          0x0001
+#define POLLOUT         0x0004
+#define POLLERR         0x0008
+#define POLLHUP         0x0010
+#define POLLNVAL        0x0020
+
+typedef uint32_t socklen_t;
+
+struct in_addr {
+    uint32_t s_addr;
+};
+
+struct sockaddr {
+    uint16_t sa_family;
+    char sa_data[14];
+};
+
+struct sockaddr_in {
+    uint16_t sin_family;                // AF_INET
+    uint16_t sin_port;
+    struct in_addr sin_addr;
+    uint8_t sin_zero[8];
+};
+
+struct pollfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+typedef uint32_t nfds_t;
+
+// Byte order (x86 is little-endian, the network big-endian)
+static inline uint16_t htons(uint16_t x) {
+    return (uint16_t)((x << 8) | (x >> 8));
+}
+static inline uint16_t ntohs(uint16_t x) {
+    return htons(x);
+}
+static inline uint32_t htonl(uint32_t x) {
+    return ((x & 0x000000FFu) << 24) |
+           ((x & 0x0000FF00u) << 8)  |
+           ((x & 0x00FF0000u) >> 8)  |
+           ((x & 0xFF000000u) >> 24);
+}
+static inline uint32_t ntohl(uint32_t x) {
+    return htonl(x);
+}
+
+int socket(int domain, int type, int protocol);
+int bind(int fd, const struct sockaddr *addr, socklen_t addrlen);
+int connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+int listen(int fd, int backlog);
+int accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+int sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr, socklen_t addrlen);
+int recvfrom(int fd, void *buf, size_t len, int flags, struct sockaddr *addr, socklen_t *addrlen);
+int send(int fd, const void *buf, size_t len, int flags);
+int recv(int fd, void *buf, size_t len, int flags);
+int close(int fd);
+// timeout_ms < 0 waits forever, 0 only checks
+int poll(struct pollfd *fds, nfds_t nfds, int timeout_ms);
+// Host name or dotted quad to an address for connect/sendto (DNS A record)
+int inet_lookup(const char *host, struct in_addr *addr);
+
+#endif // SOCKET_H
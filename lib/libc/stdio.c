@@ -32,15 +32,29 @@ static inline int is_kernel_context() {
 
 void* syscall(int syscall_index, void* parameter1, void* parameter2, void* parameter3) {
     void* return_value;
+    // The kernel handler is a C function: ECX and EDX come back clobbered
     __asm__ volatile(
         "int $0x80\n"       // Trigger syscall interrupt
-        : "=a"(return_value) // Output: Get return value from EAX
-        : "a"(syscall_index), "b"(parameter1), "c"(parameter2), "d"(parameter3) // Inputs
+        : "=a"(return_value), "+c"(parameter2), "+d"(parameter3) // Output: Get return value from EAX
+        : "a"(syscall_index), "b"(parameter1) // Inputs
         : "memory"          // Clobbers
     );
     return return_value;     // Return the value in EAX
 }
 
+// Same with arguments 4 and 5 in ESI and EDI
+void* syscall5(int syscall_index, void* parameter1, void* parameter2, void* parameter3,
+               void* parameter4, void* parameter5) {
+    void* return_value;
+    __asm__ volatile(
+        "int $0x80\n"
+        : "=a"(return_value), "+c"(parameter2), "+d"(parameter3)
+        : "a"(syscall_index), "b"(parameter1), "S"(parameter4), "D"(parameter5)
+        : "memory"
+    );
+    return return_value;
+}
+
 // -----------------------------------------------------------------
 // Directory Handling Functions
 // the following functions are defined in the filesystem/fat32/fat32.c file
@@ -473,9 +487,12 @@ int printf(const char* format, ...) {
                 break;
             }
             case 'u': {
-                unsigned int u = va_arg(args, unsigned int);
                 char buf[32];
-                unsigned_int_to_str(u, buf, 10);
+                if (is_ll) {
+                    uint64_t_to_str(va_arg(args, uint64_t), buf, 10);
+                } else {
+                    unsigned_int_to_str(va_arg(args, unsigned int), buf, 10);
+                }
                 int len = (int)strlen(buf);
                 int pad = (width_specified && width > len) ? (width - len) : 0;
                 if (!left_align) pad_out(pad, zero_padding);
@@ -484,6 +501,19 @@ int printf(const char* format, ...) {
                 break;
             }
             case 'X': {
+                if (is_ll) {
+                    uint64_t v = va_arg(args, uint64_t);
+                    char tmp[32];
+                    uint64_t_to_str(v, tmp, 16);
+                    // in Großbuchstaben wandeln (falls Helper klein liefert)
+                    for (char* p = tmp; *p; ++p) if (*p >= 'a' && *p <= 'f') *p = (char)(*p - 'a' + 'A');
+                    int len = (int)strlen(tmp);
+                    int pad = (width_specified && width > len) ? (width - len) : 0;
+                    if (!left_align) pad_out(pad, zero_padding);
+                    for (int i = 0; i < len; ++i) putchar(tmp[i]);
+                    if (left_align) pad_out(pad, false);
+                    break;
+                }
                 // 32-bit Hex
                 unsigned int x = va_arg(args, unsigned int);
                 char buf[32];
@@ -501,33 +531,6 @@ int printf(const char* format, ...) {
                 break;
             }
             default: {
-                // Falls "ll" gesetzt war, unterstützen wir %llX / %llu:
-                if (is_ll && *format == 'X') {
-                    uint64_t v = va_arg(args, uint64_t);
-                    // Einfach: in 64-bit Helfer wandeln – Padding simpel nachziehen
-                    char tmp[32];
-                    uint64_t_to_str(v, tmp, 16); // hex ohne 0x, klein/bzw. groß? (deine Helper)
-                    // in Großbuchstaben wandeln (falls Helper klein liefert)
-                    for (char* p = tmp; *p; ++p) if (*p >= 'a' && *p <= 'f') *p = (char)(*p - 'a' + 'A');
-                    int len = (int)strlen(tmp);
-                    int pad = (width_specified && width > len) ? (width - len) : 0;
-                    if (!left_align) pad_out(pad, zero_padding);
-                    for (int i = 0; i < len; ++i) putchar(tmp[i]);
-                    if (left_align) pad_out(pad, false);
-                    break;
-                }
-                if (is_ll && *format == 'u') {
-                    uint64_t v = va_arg(args, uint64_t);
-                    char buf[32];
-                    uint64_t_to_str(v, buf, 10);
-                    int len = (int)strlen(buf);
-                    int pad = (width_specified && width > len) ? (width - len) : 0;
-                    if (!left_align) pad_out(pad, zero_padding);
-                    const char* p = buf; while (*p) putchar(*p++);
-                    if (left_align) pad_out(pad, false);
-                    break;
-                }
-
                 // Unbekannter Specifier – gebe ihn wörtlich aus
                 putchar('%');
                 if (is_ll) { putchar('l'); putchar('l'); }
@@ -15,6 +15,8 @@
 #endif
 
 void* syscall(int syscall_index, void* parameter1, void* parameter2, void* parameter3);
+void* syscall5(int syscall_index, void* parameter1, void* parameter2, void* parameter3,
+               void* parameter4, void* parameter5);
 
 // File Handling Functions
 int mkfile(const char* path);                                   // create file
@@ -17,6 +17,16 @@
 #define SYS_REALLOC 6
 #define SYS_TERMINAL_GETCHAR 7
 #define SYS_INSTALL_IRQ 8
+#define SYS_SOCKET 9 // Socket syscalls, see socket.h
+#define SYS_BIND 10
+#define SYS_CONNECT 11
+#define SYS_SENDTO 12
+#define SYS_RECVFROM 13
+#define SYS_LISTEN 14
+#define SYS_ACCEPT 15
+#define SYS_CLOSE 16
+#define SYS_POLL 17
+#define SYS_RESOLVE 18
 
 // // Macros for try-catch handling
 // #define try(ctx) if (setjmp(&(ctx)) == 0)
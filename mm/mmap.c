@@ -0,0 +1,251 @@
+#include "mm/mmap.h"
+#include "mm/kmalloc.h"
+#include "arch/x86/mm/paging.h"
+#include "fs/vfs/page_cache.h"
+#include "drivers/bus/pci.h"
+#include "lib/libc/string.h"
+#include "lib/libc/stdio.h"
+
+// ===========================================================================
+// Memory mapped files
+// Pages are faulted in on first access. Read-only mappings of cached files
+// map the page cache page itself; writable mappings and uncached filesystems
+// get a private frame filled through vfs_read.
+// ===========================================================================
+
+static mmap_region_t regions[MMAP_MAX_REGIONS];
+static mmap_stats_t stats;
+static uint32_t window_base = 0;        // 0 = not chosen yet
+static volatile bool fault_busy = false;
+
+// Faults are served with interrupts on (ATA waits on the PIT, the floppy
+// on its IRQ), so the scheduler may switch to another task that faults or
+// unmaps too. The page cache and the page tables are not reentrant: one
+// fault or munmap at a time, the others sleep until it is done.
+static void mmap_lock(void) {
+    for (;;) {
+        __asm__ __volatile__("cli");
+        if (!fault_busy) {
+            fault_busy = true;
+            break;
+        }
+        __asm__ __volatile__("sti; hlt");
+    }
+    __asm__ __volatile__("sti");
+}
+
+static void mmap_unlock(void) {
+    fault_busy = false;
+}
+
+// Pick the window once; paging is switched on with it left unmapped
+static uint32_t mmap_window(void) {
+    if (window_base) {
+        return window_base;
+    }
+    uint32_t base = ((uint32_t)total_memory + MMAP_SIZE - 1) & ~(MMAP_SIZE - 1);
+    if (base == 0 || (uint64_t)total_memory > MMAP_WINDOW_LIMIT) {
+        base = MMAP_SIZE;
+    }
+    for (; base != 0 && base <= MMAP_WINDOW_LIMIT - MMAP_SIZE; base += MMAP_SIZE) {
+        if ((uint64_t)total_memory <= base && !pci_mmio_overlaps(base, base + MMAP_SIZE)) {
+            window_base = base;
+            return base;
+        }
+    }
+    printf("mmap: no %u MB window clear of RAM and PCI devices\n", MMAP_SIZE >> 20);
+    return 0;
+}
+
+static mmap_region_t* find_region(uint32_t address) {
+    for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+        if (regions[i].used && address >= regions[i].start &&
+            address - regions[i].start < regions[i].length) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+// First fit search for 'length' bytes of free virtual space in the window
+static uint32_t find_free_range(uint32_t length) {
+    uint32_t candidate = window_base;
+    bool moved = true;
+
+    while (moved) {
+        moved = false;
+        if (length > window_base + MMAP_SIZE - candidate) {
+            return 0;
+        }
+        for (int i = 0; i < MMAP_MAX_REGIONS; i++) {
+            if (regions[i].used && candidate < regions[i].start + regions[i].length &&
+                regions[i].start < candidate + length) {
+                candidate = regions[i].start + regions[i].length;
+                moved = true;
+            }
+        }
+    }
+    return candidate;
+}
+
+static void* mmap_create(const char* path, uint32_t offset, uint32_t length, uint32_t flags) {
+    if (!mmap_window()) {
+        return NULL;
+    }
+
+    mmap_region_t* region = NULL;
+    for (int i = 0; i < MMAP_MAX_REGIONS && !region; i++) {
+        if (!regions[i].used) {
+            region = &regions[i];
+        }
+    }
+    if (!region) {
+        return NULL;
+    }
+
+    vfs_node_t* node;
+    if (vfs_open(path, &node) != VFS_OK) {
+        return NULL;
+    }
+    if (node->type != VFS_FILE || (length == 0 && offset >= node->size)) {
+        vfs_close(node);
+        return NULL;
+    }
+    if (length == 0) {
+        length = node->size - offset;
+    }
+
+    length = (length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t start = find_free_range(length);
+    if (start == 0) {
+        vfs_close(node);
+        return NULL;
+    }
+
+    // The window is left unmapped so every first access faults
+    init_paging_identity(window_base, window_base + MMAP_SIZE);
+
+    region->used = true;
+    region->start = start;
+    region->length = length;
+    region->offset = offset;
+    region->flags = flags;
+    region->node = node;
+    region->faults = 0;
+    node->fs->mappings++;
+
+    return (void*)start;
+}
+
+void* mmap_file(const char* path, uint32_t offset, uint32_t length, uint32_t flags) {
+    if (!path || (offset % PAGE_SIZE) != 0 || !(flags & (MMAP_READ | MMAP_WRITE))) {
+        return NULL;
+    }
+    mmap_lock();
+    void* address = mmap_create(path, offset, length, flags);
+    mmap_unlock();
+    return address;
+}
+
+int munmap_file(void* address) {
+    mmap_lock();
+    mmap_region_t* region = find_region((uint32_t)address);
+    if (!region || region->start != (uint32_t)address) {
+        mmap_unlock();
+        return VFS_ERR_INVALID;
+    }
+
+    page_directory_t* pd = get_kernel_page_directory();
+    for (uint32_t va = region->start; va < region->start + region->length; va += PAGE_SIZE) {
+        uint32_t frame = get_mapped_address(pd, va);
+        if (!frame) {
+            continue;
+        }
+        unmap_page(pd, va);
+        if (!page_cache_unmap_page((uint8_t*)frame)) {
+            free_page((void*)frame);
+        }
+    }
+
+    region->node->fs->mappings--;
+    vfs_close(region->node);
+    region->used = false;
+    mmap_unlock();
+    return VFS_OK;
+}
+
+// Map the page at 'address'; called with the mmap lock held
+static bool mmap_fill_page(mmap_region_t* region, uint32_t address) {
+    uint32_t va = address & ~(PAGE_SIZE - 1);
+    page_directory_t* pd = get_kernel_page_directory();
+    if (get_mapped_address(pd, va)) {
+        return true;                // Another task faulted it in while we waited
+    }
+
+    uint32_t file_offset = region->offset + (va - region->start);
+    bool writable = (region->flags & MMAP_WRITE) != 0;
+    vfs_node_t* node = region->node;
+
+    uint8_t* frame = NULL;
+    if (!writable) {
+        frame = page_cache_map_page(node, file_offset / PAGE_SIZE);
+        if (frame) {
+            stats.shared_pages++;
+        }
+    }
+
+    if (!frame) {
+        frame = (uint8_t*)allocate_page();
+        if (!frame && page_cache_shrink(1) > 0) {
+            frame = (uint8_t*)allocate_page();
+        }
+        if (!frame) {
+            return false;
+        }
+
+        memset(frame, 0, PAGE_SIZE);
+        if (file_offset < node->size) {
+            uint32_t bytes = node->size - file_offset;
+            if (bytes > PAGE_SIZE) {
+                bytes = PAGE_SIZE;
+            }
+            if (vfs_read(node, file_offset, bytes, frame) < 0) {
+                free_page(frame);
+                return false;
+            }
+        }
+        stats.private_pages++;
+    }
+
+    map_page(pd, va, (uint32_t)frame, PAGE_PRESENT | (writable ? PAGE_RW : 0));
+    if (get_mapped_address(pd, va) != (uint32_t)frame) {
+        // No memory for the page table
+        if (!page_cache_unmap_page(frame)) {
+            free_page(frame);
+        }
+        return false;
+    }
+    region->faults++;
+    stats.faults++;
+    return true;
+}
+
+bool mmap_handle_fault(uint32_t address, uint32_t error_code) {
+    if (!find_region(address) || (error_code & 0x1)) {
+        return false;               // Not ours, or a write to a read-only page
+    }
+
+    // Enables interrupts: filling the page may wait for the disk. The
+    // region may be gone once we get the lock.
+    mmap_lock();
+    mmap_region_t* region = find_region(address);
+    bool ok = region && mmap_fill_page(region, address);
+    mmap_unlock();
+    return ok;
+}
+
+void mmap_get_stats(mmap_stats_t* out) {
+    if (out) {
+        *out = stats;
+    }
+}
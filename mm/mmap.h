@@ -0,0 +1,46 @@
+#ifndef MMAP_H
+#define MMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fs/vfs/vfs.h"
+
+// Virtual window for file mappings. Everything outside it stays identity
+// mapped with 4 MB pages once paging is switched on by the first mapping.
+// The window is the first MMAP_SIZE slot above RAM that holds no PCI BAR
+// or MMCONFIG range; the top slot (APICs, HPET, firmware) is never used.
+#define MMAP_SIZE           0x10000000      // 256 MB, also the window alignment
+#define MMAP_WINDOW_LIMIT   0xF0000000
+#define MMAP_MAX_REGIONS    16
+
+// Protection flags
+#define MMAP_READ           0x1
+#define MMAP_WRITE          0x2             // Private copy-on-fault pages, never written back
+
+typedef struct mmap_region {
+    bool used;
+    uint32_t start;                 // First virtual address
+    uint32_t length;                // Mapped bytes (rounded up to whole pages)
+    uint32_t offset;                // File offset of 'start' (page aligned)
+    uint32_t flags;                 // MMAP_READ / MMAP_WRITE
+    vfs_node_t* node;               // Open file backing the region
+    uint32_t faults;                // Pages faulted in so far
+} mmap_region_t;
+
+typedef struct mmap_stats {
+    uint32_t faults;                // Demand faults served
+    uint32_t shared_pages;          // Page cache pages mapped in place
+    uint32_t private_pages;         // Pages copied into private frames
+} mmap_stats_t;
+
+// Map 'length' bytes of a file starting at a page aligned 'offset'
+// (length 0 = up to end of file). Returns NULL on failure.
+void* mmap_file(const char* path, uint32_t offset, uint32_t length, uint32_t flags);
+int munmap_file(void* address);
+
+// Called from the page fault handler; true if the fault was resolved
+bool mmap_handle_fault(uint32_t address, uint32_t error_code);
+
+void mmap_get_stats(mmap_stats_t* stats);
+
+#endif // MMAP_H
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+Host-side peer for the kernel's TCP throughput test over tap0
+
+  sink   - listen for 'tcp send <host-ip> <port> [KB]' and count bytes until EOF
+  source - connect to 'tcp recv <port>' running in the kernel and stream data
+
+Examples (host is 10.0.2.1 on tap0, kernel is configured with ifconfig):
+  python3 scripts/tcp_throughput.py sink --port 5001
+  python3 scripts/tcp_throughput.py source --host 10.0.2.15 --port 5001 --size 4096
+"""
+
+import argparse
+import socket
+import sys
+import time
+
+
+def report(label: str, total: int, elapsed: float) -> None:
+    rate = total / 1024 / elapsed if elapsed > 0 else 0
+    print(f"{label} {total} bytes in {elapsed * 1000:.0f} ms ({rate:.0f} KB/s)")
+
+
+def sink(port: int) -> int:
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as server:
+        server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        server.bind(("0.0.0.0", port))
+        server.listen(1)
+        print(f"Waiting on port {port}...")
+        conn, addr = server.accept()
+        with conn:
+            print(f"Connection from {addr[0]}:{addr[1]}")
+            total = 0
+            start = time.monotonic()
+            while True:
+                data = conn.recv(65536)
+                if not data:
+                    break
+                total += len(data)
+            report("Received", total, time.monotonic() - start)
+    return 0
+
+
+def source(host: str, port: int, size_kb: int) -> int:
+    chunk = bytes((ord("A") + i % 26) for i in range(65536))
+    remaining = size_kb * 1024
+    with socket.create_connection((host, port), timeout=30) as conn:
+        start = time.monotonic()
+        while remaining > 0:
+            n = min(remaining, len(chunk))
+            conn.sendall(chunk[:n])
+            remaining -= n
+        conn.shutdown(socket.SHUT_WR)
+        conn.recv(1)  # Wait for the kernel to close its side
+        report("Sent", size_kb * 1024, time.monotonic() - start)
+    return 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mode", choices=["sink", "source"])
+    parser.add_argument("--host", default="10.0.2.15", help="kernel IP address (source mode)")
+    parser.add_argument("--port", type=int, default=5001)
+    parser.add_argument("--size", type=int, default=1024, help="KB to send (source mode)")
+    args = parser.parse_args()
+
+    if args.mode == "sink":
+        return sink(args.port)
+    return source(args.host, args.port, args.size)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,73 +1,833 @@
-#include <iostream>
+// send_paket.cpp
+// Host-side traffic generator and latency meter for the kernel's NIC
+// drivers and network stack, run against the QEMU TAP interface.
+//
+//   make send-paket
+//   (or: g++ -O2 -std=c++17 -pthread send_paket.cpp -o send_paket)
+//   sudo ./send_paket -i tap0 --dst-ip 10.0.2.15 -m icmp -t 2 --pps 20000 -d 10
+//
+// Frames are built and received on AF_PACKET sockets, so the host's own
+// IP stack is not involved. The tool claims its own source address
+// (--src-ip, default 10.0.2.100) and answers the guest's ARP requests for
+// it. Workloads:
+//
+//   icmp  ICMP echo requests, answered by the kernel's ICMP code
+//   udp   datagrams to the UDP echo port (7, RFC 862)
+//   arp   ARP requests for --dst-ip
+//   raw   IPv4 frames filled with 0xAA that nothing answers (RX load only)
+//
+// Every sender thread has its own socket and paces itself to its share
+// of --pps / --mbps. Each request carries (thread, sequence); the send
+// time goes into a per-thread ring and is paired with the receive time
+// the host kernel stamps on the reply (SO_TIMESTAMPNS). ICMP and UDP keep
+// the pair in the payload. ARP keeps it in the sender MAC (02:tt:ss:ss:ss:ss),
+// which the reply's target MAC echoes; the guest's ARP entry for the source
+// address then points at that MAC, which is harmless because a TAP
+// interface sees every frame the guest sends.
+//
+// Results: sent/received/lost/duplicates, achieved rates, RTT
+// min/avg/p50/p90/p99/p999/max and a log2 histogram, as text, CSV (one row
+// per run, --label tags it, --no-header appends) or JSON. --samples writes
+// one CSV line per reply.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <sys/socket.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <arpa/inet.h>
-#include <netinet/ether.h>
+#include <getopt.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
 #include <net/if.h>
-#include <unistd.h>
+#include <netinet/if_ether.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/udp.h>
+#include <poll.h>
 #include <sys/ioctl.h>
-#include <linux/if_packet.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_MAX        1514
+#define PAYLOAD_MAGIC    0x4B50414Bu        // "KPAK"
+#define TX_RING_SIZE     65536              // Requests in flight per thread that can still be timed
+#define MAX_THREADS      64
+#define UDP_ECHO_PORT    7
+#define UDP_SRC_PORT     40000              // + thread
+#define ICMP_ID_BASE     0x5000             // + thread
+#define HIST_BUCKETS     32                 // log2 microsecond buckets
+
+enum class Mode { ICMP, UDP, ARP, RAW };
+enum class Format { TEXT, CSV, JSON };
+
+struct Config {
+    std::string iface = "tap0";
+    Mode mode = Mode::ICMP;
+    uint32_t src_ip = 0;                    // Network order; 0 = 10.0.2.100
+    uint32_t dst_ip = 0;                    // Network order; 0 = 10.0.2.15
+    uint8_t dst_mac[6] = {0};
+    bool dst_mac_set = false;
+    unsigned threads = 1;
+    uint64_t count = 0;                     // Total requests (0 = until --duration or Ctrl-C)
+    double duration = 0;                    // Seconds
+    double pps = 0;                         // Aggregate rate limits (0 = as fast as possible)
+    double mbps = 0;
+    unsigned size = 56;                     // ICMP/UDP payload bytes
+    uint16_t port = UDP_ECHO_PORT;
+    unsigned wait_ms = 1000;                // Straggler wait after the last request
+    Format format = Format::TEXT;
+    std::string out;
+    std::string samples;
+    std::string label;
+    bool header = true;
+};
+
+// Leads the ICMP/UDP payload; echoed back unchanged
+struct __attribute__((packed)) Cookie {
+    uint32_t magic;
+    uint32_t thread;
+    uint64_t seq;
+};
+
+struct TxSlot {
+    std::atomic<uint64_t> seq{UINT64_MAX};
+    std::atomic<uint64_t> ts{0};
+};
+
+struct ThreadStats {
+    uint64_t sent = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+};
+
+struct Sample {
+    uint32_t thread;
+    uint64_t seq;
+    uint64_t tx_ns;
+    uint64_t rx_ns;
+};
+
+static Config cfg;
+static uint8_t src_mac[6];
+static int ifindex;
+static std::atomic<bool> stop_flag{false};
+static std::atomic<bool> senders_done{false};
+static std::atomic<uint64_t> total_sent{0};
+static std::unique_ptr<TxSlot[]> tx_rings[MAX_THREADS];
+static ThreadStats thread_stats[MAX_THREADS];
+static std::vector<Sample> samples;
+static uint64_t stale_replies = 0;          // Reply whose send slot was already reused
+static uint64_t arp_answers = 0;            // ARP requests for src_ip we answered
+
+static uint64_t now_ns() {
+    // CLOCK_REALTIME: the clock SO_TIMESTAMPNS stamps received frames with
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void on_signal(int) {
+    stop_flag = true;
+}
+
+// =============================================================================
+// Frames
+// =============================================================================
+static uint16_t inet_checksum(const void *data, size_t len) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint32_t sum = 0;
+    for (; len > 1; p += 2, len -= 2) sum += (uint32_t)(p[0] << 8 | p[1]);
+    if (len) sum += (uint32_t)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons((uint16_t)~sum);
+}
+
+static size_t put_eth(uint8_t *f, const uint8_t *dst, uint16_t type) {
+    auto *eh = reinterpret_cast<ether_header *>(f);
+    memcpy(eh->ether_dhost, dst, 6);
+    memcpy(eh->ether_shost, src_mac, 6);
+    eh->ether_type = htons(type);
+    return sizeof(ether_header);
+}
+
+static size_t put_ipv4(uint8_t *f, uint8_t proto, size_t l4_len) {
+    auto *ip = reinterpret_cast<iphdr *>(f);
+    memset(ip, 0, sizeof(*ip));
+    ip->version = 4;
+    ip->ihl = 5;
+    ip->tot_len = htons((uint16_t)(sizeof(iphdr) + l4_len));
+    ip->ttl = 64;
+    ip->protocol = proto;
+    ip->saddr = cfg.src_ip;
+    ip->daddr = cfg.dst_ip;
+    return sizeof(iphdr);
+}
+
+// Request template for one thread; fill_seq patches in the sequence
+static size_t build_frame(uint8_t *f, unsigned thread) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    size_t off = 0;
+    memset(f, 0, FRAME_MAX);
+
+    if (cfg.mode == Mode::ARP) {
+        off = put_eth(f, bcast, ETH_P_ARP);
+        auto *arp = reinterpret_cast<ether_arp *>(f + off);
+        arp->arp_hrd = htons(ARPHRD_ETHER);
+        arp->arp_pro = htons(ETH_P_IP);
+        arp->arp_hln = 6;
+        arp->arp_pln = 4;
+        arp->arp_op = htons(ARPOP_REQUEST);
+        memset(arp->arp_tha, 0, 6);
+        memcpy(arp->arp_spa, &cfg.src_ip, 4);
+        memcpy(arp->arp_tpa, &cfg.dst_ip, 4);
+        return 60;
+    }
 
-#define BUF_SIZE 42 // Minimum Ethernet frame size (including the Ethernet header)
-
-int main() {
-    int sockfd;
-    char buffer[BUF_SIZE];
-    struct sockaddr_ll device;
-    struct ifreq if_idx;
-    struct ifreq if_mac;
-    const char* interface = "eth0"; // Replace with your network interface
-    unsigned char dest_mac[6] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56}; // Destination MAC address
-
-    // Create a raw socket
-    sockfd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
-    if (sockfd < 0) {
-        perror("socket");
-        return 1;
-    }
-
-    // Get the index of the network interface
-    memset(&if_idx, 0, sizeof(struct ifreq));
-    strncpy(if_idx.ifr_name, interface, IFNAMSIZ - 1);
-    if (ioctl(sockfd, SIOCGIFINDEX, &if_idx) < 0) {
-        perror("SIOCGIFINDEX");
-        close(sockfd);
-        return 1;
-    }
-
-    // Get the MAC address of the interface
-    memset(&if_mac, 0, sizeof(struct ifreq));
-    strncpy(if_mac.ifr_name, interface, IFNAMSIZ - 1);
-    if (ioctl(sockfd, SIOCGIFHWADDR, &if_mac) < 0) {
+    off = put_eth(f, cfg.dst_mac, ETH_P_IP);
+    if (cfg.mode == Mode::RAW) {
+        memset(f + off, 0xAA, cfg.size);
+        return std::max<size_t>(off + cfg.size, 60);
+    }
+
+    uint8_t proto = cfg.mode == Mode::ICMP ? IPPROTO_ICMP : IPPROTO_UDP;
+    size_t l4_hdr = cfg.mode == Mode::ICMP ? sizeof(icmphdr) : sizeof(udphdr);
+    off += put_ipv4(f + off, proto, l4_hdr + cfg.size);
+    if (cfg.mode == Mode::ICMP) {
+        auto *icmp = reinterpret_cast<icmphdr *>(f + off);
+        memset(icmp, 0, sizeof(*icmp));
+        icmp->type = ICMP_ECHO;
+        icmp->un.echo.id = htons((uint16_t)(ICMP_ID_BASE + thread));
+    } else {
+        // Checksum 0: not computed (RFC 768)
+        auto *udp = reinterpret_cast<udphdr *>(f + off);
+        udp->source = htons((uint16_t)(UDP_SRC_PORT + thread));
+        udp->dest = htons(cfg.port);
+        udp->len = htons((uint16_t)(sizeof(udphdr) + cfg.size));
+        udp->check = 0;
+    }
+    off += l4_hdr;
+
+    auto *c = reinterpret_cast<Cookie *>(f + off);
+    c->magic = htonl(PAYLOAD_MAGIC);
+    c->thread = htonl(thread);
+    for (size_t i = sizeof(Cookie); i < cfg.size; ++i) f[off + i] = (uint8_t)('a' + i % 23);
+    return std::max<size_t>(off + cfg.size, 60);
+}
+
+static void fill_seq(uint8_t *f, size_t len, unsigned thread, uint64_t seq) {
+    if (cfg.mode == Mode::RAW) return;
+    if (cfg.mode == Mode::ARP) {
+        auto *arp = reinterpret_cast<ether_arp *>(f + sizeof(ether_header));
+        uint32_t s = htonl((uint32_t)seq);
+        arp->arp_sha[0] = 0x02;                  // Locally administered, unicast
+        arp->arp_sha[1] = (uint8_t)thread;
+        memcpy(&arp->arp_sha[2], &s, 4);
+        return;
+    }
+
+    auto *ip = reinterpret_cast<iphdr *>(f + sizeof(ether_header));
+    ip->id = htons((uint16_t)seq);
+    ip->check = 0;
+    ip->check = inet_checksum(ip, sizeof(iphdr));
+
+    uint8_t *l4 = reinterpret_cast<uint8_t *>(ip) + sizeof(iphdr);
+    size_t l4_hdr = cfg.mode == Mode::ICMP ? sizeof(icmphdr) : sizeof(udphdr);
+    auto *c = reinterpret_cast<Cookie *>(l4 + l4_hdr);
+    c->seq = htobe64(seq);
+    if (cfg.mode == Mode::ICMP) {
+        auto *icmp = reinterpret_cast<icmphdr *>(l4);
+        icmp->un.echo.sequence = htons((uint16_t)seq);
+        icmp->checksum = 0;
+        icmp->checksum = inet_checksum(icmp, sizeof(icmphdr) + cfg.size);
+    }
+    (void)len;
+}
+
+// =============================================================================
+// Sockets
+// =============================================================================
+static int open_socket(bool rx) {
+    int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd < 0) {
+        perror("socket (needs CAP_NET_RAW)");
+        exit(1);
+    }
+    sockaddr_ll sll{};
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(rx ? ETH_P_ALL : 0);
+    sll.sll_ifindex = ifindex;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&sll), sizeof(sll)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+    if (rx) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+        int rcvbuf = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    return fd;
+}
+
+static bool send_frame(int fd, const uint8_t *f, size_t len) {
+    sockaddr_ll to{};
+    to.sll_family = AF_PACKET;
+    to.sll_ifindex = ifindex;
+    to.sll_halen = 6;
+    memcpy(to.sll_addr, f, 6);
+    return sendto(fd, f, len, 0, reinterpret_cast<sockaddr *>(&to), sizeof(to)) == (ssize_t)len;
+}
+
+static void interface_setup() {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ifreq ifr{};
+    strncpy(ifr.ifr_name, cfg.iface.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        perror(("SIOCGIFINDEX " + cfg.iface).c_str());
+        exit(1);
+    }
+    ifindex = ifr.ifr_ifindex;
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
         perror("SIOCGIFHWADDR");
-        close(sockfd);
-        return 1;
+        exit(1);
+    }
+    memcpy(src_mac, ifr.ifr_hwaddr.sa_data, 6);
+    close(fd);
+}
+
+// Receive one frame with its kernel timestamp; false on timeout.
+// Frames we sent ourselves are skipped.
+static bool receive_frame(int fd, uint8_t *buf, size_t &len, uint64_t &ts, int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    for (;;) {
+        if (poll(&pfd, 1, timeout_ms) <= 0) return false;
+        sockaddr_ll from{};
+        iovec iov{buf, FRAME_MAX};
+        char ctrl[128];
+        msghdr msg{};
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        ssize_t n = recvmsg(fd, &msg, MSG_DONTWAIT);
+        if (n <= 0) continue;
+        if (from.sll_pkttype == PACKET_OUTGOING) continue;
+
+        ts = 0;
+        for (cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec t;
+                memcpy(&t, CMSG_DATA(c), sizeof(t));
+                ts = (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+            }
+        }
+        if (ts == 0) ts = now_ns();
+        len = (size_t)n;
+        return true;
+    }
+}
+
+static void answer_arp(int fd, const ether_arp *req) {
+    uint8_t f[60] = {0};
+    size_t off = put_eth(f, req->arp_sha, ETH_P_ARP);
+    auto *arp = reinterpret_cast<ether_arp *>(f + off);
+    arp->arp_hrd = htons(ARPHRD_ETHER);
+    arp->arp_pro = htons(ETH_P_IP);
+    arp->arp_hln = 6;
+    arp->arp_pln = 4;
+    arp->arp_op = htons(ARPOP_REPLY);
+    memcpy(arp->arp_sha, src_mac, 6);
+    memcpy(arp->arp_spa, &cfg.src_ip, 4);
+    memcpy(arp->arp_tha, req->arp_sha, 6);
+    memcpy(arp->arp_tpa, req->arp_spa, 4);
+    send_frame(fd, f, sizeof(f));
+    arp_answers++;
+}
+
+// ARP for --dst-ip with our real MAC until the guest answers
+static bool resolve_dst_mac(int fd) {
+    uint8_t f[60] = {0};
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    size_t off = put_eth(f, bcast, ETH_P_ARP);
+    auto *arp = reinterpret_cast<ether_arp *>(f + off);
+    arp->arp_hrd = htons(ARPHRD_ETHER);
+    arp->arp_pro = htons(ETH_P_IP);
+    arp->arp_hln = 6;
+    arp->arp_pln = 4;
+    arp->arp_op = htons(ARPOP_REQUEST);
+    memcpy(arp->arp_sha, src_mac, 6);
+    memcpy(arp->arp_spa, &cfg.src_ip, 4);
+    memcpy(arp->arp_tpa, &cfg.dst_ip, 4);
+
+    uint8_t buf[FRAME_MAX];
+    for (int attempt = 0; attempt < 3 && !stop_flag; ++attempt) {
+        send_frame(fd, f, sizeof(f));
+        uint64_t deadline = now_ns() + 1000000000ull;
+        while (now_ns() < deadline) {
+            size_t len;
+            uint64_t ts;
+            if (!receive_frame(fd, buf, len, ts, 100)) continue;
+            auto *eh = reinterpret_cast<ether_header *>(buf);
+            if (len < sizeof(ether_header) + sizeof(ether_arp) || ntohs(eh->ether_type) != ETH_P_ARP) continue;
+            auto *r = reinterpret_cast<ether_arp *>(buf + sizeof(ether_header));
+            if (ntohs(r->arp_op) == ARPOP_REQUEST && memcmp(r->arp_tpa, &cfg.src_ip, 4) == 0) {
+                answer_arp(fd, r);
+            } else if (ntohs(r->arp_op) == ARPOP_REPLY && memcmp(r->arp_spa, &cfg.dst_ip, 4) == 0) {
+                memcpy(cfg.dst_mac, r->arp_sha, 6);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// Sender and receiver threads
+// =============================================================================
+static void sender(unsigned thread) {
+    int fd = open_socket(false);
+    uint8_t f[FRAME_MAX];
+    size_t len = build_frame(f, thread);
+    ThreadStats &st = thread_stats[thread];
+    TxSlot *ring = tx_rings[thread].get();
+
+    // This thread's share of the count and the rate
+    uint64_t my_count = 0;
+    if (cfg.count) my_count = cfg.count / cfg.threads + (thread < cfg.count % cfg.threads ? 1 : 0);
+    double pps = cfg.pps;
+    if (cfg.mbps > 0) {
+        double mbps_pps = cfg.mbps * 1e6 / (len * 8.0);
+        pps = pps > 0 ? std::min(pps, mbps_pps) : mbps_pps;
+    }
+    uint64_t interval = pps > 0 ? (uint64_t)(1e9 * cfg.threads / pps) : 0;
+
+    st.start_ns = now_ns();
+    uint64_t end = cfg.duration > 0 ? st.start_ns + (uint64_t)(cfg.duration * 1e9) : UINT64_MAX;
+    uint64_t next = st.start_ns;
+    for (uint64_t seq = 0; !stop_flag && (my_count == 0 || seq < my_count); ++seq) {
+        uint64_t now = now_ns();
+        if (now >= end) break;
+        if (interval) {
+            // Sleep through long gaps, spin through short ones
+            while ((now = now_ns()) < next) {
+                if (next - now > 200000) {
+                    timespec d{0, (long)(next - now - 100000)};
+                    nanosleep(&d, nullptr);
+                }
+            }
+            // More than 1 s behind after a stall: restart pacing instead of bursting
+            if (now - next > 1000000000ull) next = now;
+            next += interval;
+        }
+
+        fill_seq(f, len, thread, seq);
+        TxSlot &slot = ring[seq % TX_RING_SIZE];
+        uint64_t ts = now_ns();
+        slot.ts.store(ts, std::memory_order_relaxed);
+        slot.seq.store(seq, std::memory_order_release);
+        if (send_frame(fd, f, len)) {
+            st.sent++;
+            st.bytes += len;
+            total_sent++;
+        } else {
+            st.errors++;
+            if (errno == ENOBUFS) std::this_thread::yield();
+        }
+    }
+    st.end_ns = now_ns();
+    close(fd);
+}
+
+static void record(uint32_t thread, uint64_t seq, uint64_t rx_ns) {
+    if (thread >= cfg.threads) return;
+    TxSlot &slot = tx_rings[thread][seq % TX_RING_SIZE];
+    if (slot.seq.load(std::memory_order_acquire) != seq) {
+        stale_replies++;
+        return;
+    }
+    samples.push_back({thread, seq, slot.ts.load(std::memory_order_relaxed), rx_ns});
+}
+
+static void receiver(int fd) {
+    uint8_t buf[FRAME_MAX];
+    uint64_t wait_until = 0;
+    for (;;) {
+        if (senders_done) {
+            uint64_t now = now_ns();
+            if (wait_until == 0) wait_until = now + (uint64_t)cfg.wait_ms * 1000000ull;
+            if (now >= wait_until || samples.size() >= total_sent.load() || stop_flag || cfg.mode == Mode::RAW) break;
+        }
+
+        size_t len;
+        uint64_t ts;
+        if (!receive_frame(fd, buf, len, ts, 20)) continue;
+        if (len < sizeof(ether_header)) continue;
+        uint16_t type = ntohs(reinterpret_cast<ether_header *>(buf)->ether_type);
+
+        if (type == ETH_P_ARP && len >= sizeof(ether_header) + sizeof(ether_arp)) {
+            auto *arp = reinterpret_cast<ether_arp *>(buf + sizeof(ether_header));
+            uint16_t op = ntohs(arp->arp_op);
+            if (op == ARPOP_REQUEST && memcmp(arp->arp_tpa, &cfg.src_ip, 4) == 0) {
+                answer_arp(fd, arp);
+            } else if (op == ARPOP_REPLY && cfg.mode == Mode::ARP &&
+                       memcmp(arp->arp_spa, &cfg.dst_ip, 4) == 0 && arp->arp_tha[0] == 0x02) {
+                uint32_t s;
+                memcpy(&s, &arp->arp_tha[2], 4);
+                record(arp->arp_tha[1], ntohl(s), ts);
+            }
+            continue;
+        }
+        if (type != ETH_P_IP || (cfg.mode != Mode::ICMP && cfg.mode != Mode::UDP)) continue;
+
+        auto *ip = reinterpret_cast<iphdr *>(buf + sizeof(ether_header));
+        size_t ihl = ip->ihl * 4u;
+        if (len < sizeof(ether_header) + ihl || ip->saddr != cfg.dst_ip || ip->daddr != cfg.src_ip) continue;
+        uint8_t *l4 = reinterpret_cast<uint8_t *>(ip) + ihl;
+        size_t l4_len = len - sizeof(ether_header) - ihl;
+
+        const Cookie *c = nullptr;
+        if (cfg.mode == Mode::ICMP && ip->protocol == IPPROTO_ICMP && l4_len >= sizeof(icmphdr) + sizeof(Cookie)) {
+            auto *icmp = reinterpret_cast<icmphdr *>(l4);
+            if (icmp->type == ICMP_ECHOREPLY) c = reinterpret_cast<const Cookie *>(l4 + sizeof(icmphdr));
+        } else if (cfg.mode == Mode::UDP && ip->protocol == IPPROTO_UDP && l4_len >= sizeof(udphdr) + sizeof(Cookie)) {
+            auto *udp = reinterpret_cast<udphdr *>(l4);
+            if (ntohs(udp->source) == cfg.port) c = reinterpret_cast<const Cookie *>(l4 + sizeof(udphdr));
+        }
+        if (c && ntohl(c->magic) == PAYLOAD_MAGIC) record(ntohl(c->thread), be64toh(c->seq), ts);
+    }
+}
+
+// =============================================================================
+// Results
+// =============================================================================
+struct Summary {
+    uint64_t sent = 0, errors = 0, bytes = 0, received = 0, duplicates = 0, lost = 0;
+    double seconds = 0, tx_pps = 0, tx_mbps = 0, rx_pps = 0;
+    double rtt_min = 0, rtt_avg = 0, rtt_stddev = 0, rtt_max = 0;
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0;           // Microseconds
+    uint64_t hist[HIST_BUCKETS] = {0};
+};
+
+static double percentile(const std::vector<uint64_t> &sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t i = (size_t)std::ceil(q * sorted.size());
+    return sorted[i ? i - 1 : 0] / 1000.0;
+}
+
+static Summary summarize() {
+    Summary s;
+    uint64_t first = UINT64_MAX, last = 0;
+    for (unsigned t = 0; t < cfg.threads; ++t) {
+        s.sent += thread_stats[t].sent;
+        s.errors += thread_stats[t].errors;
+        s.bytes += thread_stats[t].bytes;
+        first = std::min(first, thread_stats[t].start_ns);
+        last = std::max(last, thread_stats[t].end_ns);
+    }
+    s.seconds = last > first ? (last - first) / 1e9 : 0;
+    if (s.seconds > 0) {
+        s.tx_pps = s.sent / s.seconds;
+        s.tx_mbps = s.bytes * 8 / s.seconds / 1e6;
+    }
+
+    std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.seq < b.seq;
+    });
+    std::vector<uint64_t> rtts;
+    rtts.reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (i && samples[i].thread == samples[i - 1].thread && samples[i].seq == samples[i - 1].seq) {
+            s.duplicates++;
+            continue;
+        }
+        const Sample &x = samples[i];
+        rtts.push_back(x.rx_ns > x.tx_ns ? x.rx_ns - x.tx_ns : 0);
+    }
+    s.received = rtts.size();
+    s.lost = s.sent > s.received ? s.sent - s.received : 0;
+    if (s.seconds > 0) s.rx_pps = s.received / s.seconds;
+    if (rtts.empty()) return s;
+
+    double sum = 0, sq = 0;
+    for (uint64_t r : rtts) {
+        sum += r / 1000.0;
+        sq += (r / 1000.0) * (r / 1000.0);
+        uint64_t us = r / 1000;
+        unsigned b = 0;
+        while (us > 1 && b < HIST_BUCKETS - 1) {
+            us >>= 1;
+            b++;
+        }
+        s.hist[b]++;
     }
+    std::sort(rtts.begin(), rtts.end());
+    s.rtt_min = rtts.front() / 1000.0;
+    s.rtt_max = rtts.back() / 1000.0;
+    s.rtt_avg = sum / rtts.size();
+    s.rtt_stddev = std::sqrt(std::max(0.0, sq / rtts.size() - s.rtt_avg * s.rtt_avg));
+    s.p50 = percentile(rtts, 0.50);
+    s.p90 = percentile(rtts, 0.90);
+    s.p99 = percentile(rtts, 0.99);
+    s.p999 = percentile(rtts, 0.999);
+    return s;
+}
 
-    // Construct the Ethernet header
-    struct ether_header* eh = reinterpret_cast<struct ether_header*>(buffer);
-    std::memcpy(eh->ether_shost, if_mac.ifr_hwaddr.sa_data, 6); // Source MAC address
-    std::memcpy(eh->ether_dhost, dest_mac, 6);                 // Destination MAC address
-    eh->ether_type = htons(ETH_P_IP);                          // EtherType: IPv4
+static const char *mode_name(Mode m) {
+    switch (m) {
+        case Mode::ICMP: return "icmp";
+        case Mode::UDP:  return "udp";
+        case Mode::ARP:  return "arp";
+        default:         return "raw";
+    }
+}
 
-    // Fill the payload with dummy data
-    std::memset(buffer + sizeof(struct ether_header), 0xAA, BUF_SIZE - sizeof(struct ether_header));
+static void write_text(FILE *o, const Summary &s) {
+    char src[16], dst[16];
+    inet_ntop(AF_INET, &cfg.src_ip, src, sizeof(src));
+    inet_ntop(AF_INET, &cfg.dst_ip, dst, sizeof(dst));
+    fprintf(o, "%s%s%s %s -> %s on %s, %u thread(s), %u byte payload\n",
+            cfg.label.c_str(), cfg.label.empty() ? "" : ": ", mode_name(cfg.mode), src, dst,
+            cfg.iface.c_str(), cfg.threads, cfg.size);
+    fprintf(o, "sent %llu (%llu errors) in %.3f s: %.0f pps, %.2f Mbit/s\n",
+            (unsigned long long)s.sent, (unsigned long long)s.errors, s.seconds, s.tx_pps, s.tx_mbps);
+    if (cfg.mode == Mode::RAW) return;
+    fprintf(o, "received %llu, lost %llu (%.2f%%), duplicates %llu, late %llu, ARP answered %llu\n",
+            (unsigned long long)s.received, (unsigned long long)s.lost,
+            s.sent ? 100.0 * s.lost / s.sent : 0.0, (unsigned long long)s.duplicates,
+            (unsigned long long)stale_replies, (unsigned long long)arp_answers);
+    if (!s.received) return;
+    fprintf(o, "rtt us: min %.1f avg %.1f (sd %.1f) p50 %.1f p90 %.1f p99 %.1f p999 %.1f max %.1f\n",
+            s.rtt_min, s.rtt_avg, s.rtt_stddev, s.p50, s.p90, s.p99, s.p999, s.rtt_max);
 
-    // Set up the sockaddr_ll structure
-    std::memset(&device, 0, sizeof(device));
-    device.sll_ifindex = if_idx.ifr_ifindex;
-    device.sll_halen = ETH_ALEN;
-    std::memcpy(device.sll_addr, dest_mac, 6);
+    uint64_t peak = *std::max_element(s.hist, s.hist + HIST_BUCKETS);
+    for (unsigned b = 0; b < HIST_BUCKETS; ++b) {
+        if (!s.hist[b]) continue;
+        int bar = (int)(50 * s.hist[b] / peak);
+        fprintf(o, "  %8llu us %10llu %.*s\n", b ? 1ull << b : 0ull,
+                (unsigned long long)s.hist[b], bar ? bar : 1,
+                "##################################################");
+    }
+}
 
-    // Send the packet
-    if (sendto(sockfd, buffer, BUF_SIZE, 0, reinterpret_cast<struct sockaddr*>(&device), sizeof(device)) < 0) {
-        perror("sendto");
-        close(sockfd);
-        return 1;
+static void write_csv(FILE *o, const Summary &s) {
+    if (cfg.header) {
+        fprintf(o, "label,mode,threads,size,sent,errors,received,lost,duplicates,seconds,tx_pps,tx_mbps,rx_pps,"
+                   "rtt_min_us,rtt_avg_us,rtt_p50_us,rtt_p90_us,rtt_p99_us,rtt_p999_us,rtt_max_us\n");
     }
+    fprintf(o, "%s,%s,%u,%u,%llu,%llu,%llu,%llu,%llu,%.3f,%.0f,%.3f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+            cfg.label.c_str(), mode_name(cfg.mode), cfg.threads, cfg.size,
+            (unsigned long long)s.sent, (unsigned long long)s.errors, (unsigned long long)s.received,
+            (unsigned long long)s.lost, (unsigned long long)s.duplicates, s.seconds, s.tx_pps, s.tx_mbps,
+            s.rx_pps, s.rtt_min, s.rtt_avg, s.p50, s.p90, s.p99, s.p999, s.rtt_max);
+}
 
-    std::cout << "Packet sent successfully." << std::endl;
+static void write_json(FILE *o, const Summary &s) {
+    char src[16], dst[16];
+    inet_ntop(AF_INET, &cfg.src_ip, src, sizeof(src));
+    inet_ntop(AF_INET, &cfg.dst_ip, dst, sizeof(dst));
+    fprintf(o, "{\n");
+    fprintf(o, "  \"label\": \"%s\", \"mode\": \"%s\", \"interface\": \"%s\", \"src\": \"%s\", \"dst\": \"%s\",\n",
+            cfg.label.c_str(), mode_name(cfg.mode), cfg.iface.c_str(), src, dst);
+    fprintf(o, "  \"threads\": %u, \"size\": %u, \"pps_limit\": %.0f, \"mbps_limit\": %.3f,\n",
+            cfg.threads, cfg.size, cfg.pps, cfg.mbps);
+    fprintf(o, "  \"sent\": %llu, \"errors\": %llu, \"received\": %llu, \"lost\": %llu, \"duplicates\": %llu, "
+               "\"late\": %llu,\n",
+            (unsigned long long)s.sent, (unsigned long long)s.errors, (unsigned long long)s.received,
+            (unsigned long long)s.lost, (unsigned long long)s.duplicates, (unsigned long long)stale_replies);
+    fprintf(o, "  \"seconds\": %.3f, \"tx_pps\": %.0f, \"tx_mbps\": %.3f, \"rx_pps\": %.0f,\n",
+            s.seconds, s.tx_pps, s.tx_mbps, s.rx_pps);
+    fprintf(o, "  \"rtt_us\": {\"min\": %.1f, \"avg\": %.1f, \"stddev\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+               "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f},\n",
+            s.rtt_min, s.rtt_avg, s.rtt_stddev, s.p50, s.p90, s.p99, s.p999, s.rtt_max);
+    fprintf(o, "  \"histogram_us\": [");
+    bool first = true;
+    for (unsigned b = 0; b < HIST_BUCKETS; ++b) {
+        if (!s.hist[b]) continue;
+        fprintf(o, "%s{\"from\": %llu, \"count\": %llu}", first ? "" : ", ",
+                b ? 1ull << b : 0ull, (unsigned long long)s.hist[b]);
+        first = false;
+    }
+    fprintf(o, "]\n}\n");
+}
 
-    close(sockfd);
+static void write_samples(const std::string &path) {
+    FILE *o = fopen(path.c_str(), "w");
+    if (!o) {
+        perror(path.c_str());
+        return;
+    }
+    fprintf(o, "thread,seq,tx_ns,rx_ns,rtt_ns\n");
+    for (const Sample &x : samples) {
+        fprintf(o, "%u,%llu,%llu,%llu,%llu\n", x.thread, (unsigned long long)x.seq,
+                (unsigned long long)x.tx_ns, (unsigned long long)x.rx_ns,
+                (unsigned long long)(x.rx_ns > x.tx_ns ? x.rx_ns - x.tx_ns : 0));
+    }
+    fclose(o);
+}
+
+// =============================================================================
+// Command line
+// =============================================================================
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -i, --iface IF        interface (default tap0)\n"
+            "  -m, --mode MODE       icmp | udp | arp | raw (default icmp)\n"
+            "      --dst-ip IP       guest address (default 10.0.2.15)\n"
+            "      --dst-mac MAC     guest MAC (default: resolved with ARP)\n"
+            "      --src-ip IP       address claimed by this tool (default 10.0.2.100)\n"
+            "  -p, --port PORT       UDP echo port (default 7)\n"
+            "  -t, --threads N       sender threads (default 1, max %d)\n"
+            "  -c, --count N         requests in total (default: until -d or Ctrl-C)\n"
+            "  -d, --duration S      seconds to send\n"
+            "      --pps N           aggregate packets per second\n"
+            "      --mbps N          aggregate Mbit/s of Ethernet frames\n"
+            "  -s, --size N          ICMP/UDP payload bytes (default 56, min %zu)\n"
+            "  -w, --wait MS         wait for late replies (default 1000)\n"
+            "  -f, --format FMT      text | csv | json (default text)\n"
+            "  -o, --out FILE        write the summary to FILE (CSV appends)\n"
+            "  -l, --label TEXT      tag for the run (e.g. driver name)\n"
+            "      --no-header       CSV without the header line\n"
+            "      --samples FILE    per-reply CSV (thread,seq,tx_ns,rx_ns,rtt_ns)\n",
+            argv0, MAX_THREADS, sizeof(Cookie));
+}
+
+static bool parse_mac(const char *s, uint8_t *mac) {
+    unsigned v[6];
+    if (sscanf(s, "%x:%x:%x:%x:%x:%x", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) return false;
+    for (int i = 0; i < 6; ++i) mac[i] = (uint8_t)v[i];
+    return true;
+}
+
+static void parse_args(int argc, char **argv) {
+    enum { OPT_DST_IP = 256, OPT_DST_MAC, OPT_SRC_IP, OPT_PPS, OPT_MBPS, OPT_NO_HEADER, OPT_SAMPLES };
+    static const option longopts[] = {
+        {"iface", required_argument, nullptr, 'i'},    {"mode", required_argument, nullptr, 'm'},
+        {"dst-ip", required_argument, nullptr, OPT_DST_IP}, {"dst-mac", required_argument, nullptr, OPT_DST_MAC},
+        {"src-ip", required_argument, nullptr, OPT_SRC_IP}, {"port", required_argument, nullptr, 'p'},
+        {"threads", required_argument, nullptr, 't'},  {"count", required_argument, nullptr, 'c'},
+        {"duration", required_argument, nullptr, 'd'}, {"pps", required_argument, nullptr, OPT_PPS},
+        {"mbps", required_argument, nullptr, OPT_MBPS}, {"size", required_argument, nullptr, 's'},
+        {"wait", required_argument, nullptr, 'w'},     {"format", required_argument, nullptr, 'f'},
+        {"out", required_argument, nullptr, 'o'},      {"label", required_argument, nullptr, 'l'},
+        {"no-header", no_argument, nullptr, OPT_NO_HEADER}, {"samples", required_argument, nullptr, OPT_SAMPLES},
+        {"help", no_argument, nullptr, 'h'},           {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:m:p:t:c:d:s:w:f:o:l:h", longopts, nullptr)) != -1) {
+        switch (opt) {
+            case 'i': cfg.iface = optarg; break;
+            case 'm':
+                if (!strcmp(optarg, "icmp")) cfg.mode = Mode::ICMP;
+                else if (!strcmp(optarg, "udp")) cfg.mode = Mode::UDP;
+                else if (!strcmp(optarg, "arp")) cfg.mode = Mode::ARP;
+                else if (!strcmp(optarg, "raw")) cfg.mode = Mode::RAW;
+                else { usage(argv[0]); exit(2); }
+                break;
+            case OPT_DST_IP:
+                if (inet_pton(AF_INET, optarg, &cfg.dst_ip) != 1) { usage(argv[0]); exit(2); }
+                break;
+            case OPT_DST_MAC:
+                if (!parse_mac(optarg, cfg.dst_mac)) { usage(argv[0]); exit(2); }
+                cfg.dst_mac_set = true;
+                break;
+            case OPT_SRC_IP:
+                if (inet_pton(AF_INET, optarg, &cfg.src_ip) != 1) { usage(argv[0]); exit(2); }
+                break;
+            case 'p': cfg.port = (uint16_t)atoi(optarg); break;
+            case 't': cfg.threads = (unsigned)atoi(optarg); break;
+            case 'c': cfg.count = strtoull(optarg, nullptr, 10); break;
+            case 'd': cfg.duration = atof(optarg); break;
+            case OPT_PPS: cfg.pps = atof(optarg); break;
+            case OPT_MBPS: cfg.mbps = atof(optarg); break;
+            case 's': cfg.size = (unsigned)atoi(optarg); break;
+            case 'w': cfg.wait_ms = (unsigned)atoi(optarg); break;
+            case 'f':
+                if (!strcmp(optarg, "text")) cfg.format = Format::TEXT;
+                else if (!strcmp(optarg, "csv")) cfg.format = Format::CSV;
+                else if (!strcmp(optarg, "json")) cfg.format = Format::JSON;
+                else { usage(argv[0]); exit(2); }
+                break;
+            case 'o': cfg.out = optarg; break;
+            case 'l': cfg.label = optarg; break;
+            case OPT_NO_HEADER: cfg.header = false; break;
+            case OPT_SAMPLES: cfg.samples = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? 0 : 2);
+        }
+    }
+
+    if (!cfg.src_ip) inet_pton(AF_INET, "10.0.2.100", &cfg.src_ip);
+    if (!cfg.dst_ip) inet_pton(AF_INET, "10.0.2.15", &cfg.dst_ip);
+    if (cfg.threads < 1 || cfg.threads > MAX_THREADS) cfg.threads = cfg.threads < 1 ? 1 : MAX_THREADS;
+
+    // IPv4 without fragmentation: the whole request fits one frame
+    size_t l4_hdr = cfg.mode == Mode::ICMP ? sizeof(icmphdr) : sizeof(udphdr);
+    size_t max_payload = FRAME_MAX - sizeof(ether_header) - (cfg.mode == Mode::RAW ? 0 : sizeof(iphdr) + l4_hdr);
+    if (cfg.mode != Mode::RAW && cfg.size < sizeof(Cookie)) cfg.size = sizeof(Cookie);
+    if (cfg.size > max_payload) cfg.size = (unsigned)max_payload;
+    if (cfg.mode == Mode::RAW && !cfg.count && cfg.duration <= 0) cfg.count = 1;   // The old one-shot
+}
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+    interface_setup();
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int rx = open_socket(true);
+    if (!cfg.dst_mac_set && cfg.mode == Mode::RAW) {
+        // QEMU's default NIC address, as the old one-shot sender used
+        static const uint8_t qemu_mac[6] = {0x52, 0x54, 0x00, 0x12, 0x34, 0x56};
+        memcpy(cfg.dst_mac, qemu_mac, 6);
+    } else if (!cfg.dst_mac_set && cfg.mode != Mode::ARP) {
+        if (!resolve_dst_mac(rx)) {
+            fprintf(stderr, "No ARP reply from the guest; pass --dst-mac\n");
+            return 1;
+        }
+    }
+
+    for (unsigned t = 0; t < cfg.threads; ++t) tx_rings[t].reset(new TxSlot[TX_RING_SIZE]);
+    if (cfg.count) samples.reserve(cfg.count);
+
+    std::thread rx_thread(receiver, rx);
+    std::vector<std::thread> senders;
+    for (unsigned t = 0; t < cfg.threads; ++t) senders.emplace_back(sender, t);
+    for (auto &t : senders) t.join();
+    senders_done = true;
+    rx_thread.join();
+    close(rx);
+
+    Summary s = summarize();
+    FILE *o = stdout;
+    if (!cfg.out.empty()) {
+        o = fopen(cfg.out.c_str(), cfg.format == Format::CSV ? "a" : "w");
+        if (!o) {
+            perror(cfg.out.c_str());
+            return 1;
+        }
+    }
+    switch (cfg.format) {
+        case Format::TEXT: write_text(o, s); break;
+        case Format::CSV:  write_csv(o, s); break;
+        case Format::JSON: write_json(o, s); break;
+    }
+    if (o != stdout) fclose(o);
+    if (!cfg.samples.empty()) write_samples(cfg.samples);
     return 0;
 }
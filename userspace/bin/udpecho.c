@@ -0,0 +1,38 @@
+#include "lib/libc/stdio.h"
+#include "lib/libc/socket.h"
+
+// UDP echo server on port 7007 using the socket syscalls
+
+#define ECHO_PORT 7007
+
+void main() __attribute__((section(".text.main"))); // Set the entry point to the main function
+void main()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        printf("socket failed\n");
+        return;
+    }
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(ECHO_PORT);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("bind failed\n");
+        close(fd);
+        return;
+    }
+    printf("Echoing UDP on port %d\n", ECHO_PORT);
+
+    uint8_t buffer[1472];
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (1) {
+        if (poll(&pfd, 1, 1000) <= 0) continue;
+
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        int n = recvfrom(fd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr*)&peer, &peer_len);
+        if (n < 0) continue;
+        sendto(fd, buffer, n, 0, (struct sockaddr*)&peer, peer_len);
+    }
+}